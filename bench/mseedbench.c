@@ -0,0 +1,1389 @@
+/***************************************************************************
+ * mseedbench.c - End-to-end benchmark of mseedindex.
+ *
+ * Generate a reproducible corpus of synthetic miniSEED using the
+ * libmseed packing routines and run mseedindex against SQLite and
+ * JSON sinks, reporting throughput and resource usage of each phase
+ * as JSON lines.
+ *
+ * The corpus is controlled by record length (fixed, or variable for
+ * miniSEED 3), format version, channel count and interleaving, gaps,
+ * out-of-order records and file sizes.  All content is derived from a
+ * seeded pseudo-random generator, the same options produce the same
+ * files.
+ *
+ * Alternatively the corpus files are built by repeating the records of
+ * a template file, such as the libmseed test data, up to the file size.
+ *
+ * Phases measured:
+ *   generate - packing and writing the corpus, in this process
+ *   index    - mseedindex of the corpus to an empty sink
+ *   reindex  - mseedindex of the corpus again, replacing existing rows
+ *              (SQLite only)
+ *
+ * With a baseline of results from a previous run, the best throughput
+ * of each indexing phase over the runs is compared to the best of the
+ * baseline results of the same phase, sink and corpus.  While any
+ * phase is slower than the tolerance allows the runs are repeated, up
+ * to MAXRETRIES more, and the exit status is 1 if any remains slower.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libmseed.h>
+#include <yyjson.h>
+
+#define VERSION "1.0"
+#define PACKAGE "mseedbench"
+
+/* Samples per packing block of a channel, each block is flushed */
+#define BLOCKSAMPLES 4000
+
+/* Additional runs while a phase is slower than the baseline tolerance */
+#define MAXRETRIES 2
+
+/* Records of a channel, or of a file, in packing order */
+typedef struct RecordList
+{
+  char *data;
+  size_t length;
+  size_t max;
+  size_t *offsets;
+  int *lengths;
+  int64_t count;
+  int64_t countmax;
+} RecordList;
+
+/* Generation state of a channel */
+typedef struct Channel
+{
+  char sid[LM_SIDLEN];
+  nstime_t nexttime;
+  int32_t value;
+  RecordList records;
+} Channel;
+
+/* Best throughput of an indexing phase over the runs */
+typedef struct Best
+{
+  const char *phase;
+  const char *sink;
+  double rate;     /* Records per second, 0 if not run */
+  double baseline; /* Best records per second of the baseline, 0 if none */
+} Best;
+
+/* Resource usage of a measured phase */
+typedef struct Usage
+{
+  double wall;
+  double user;
+  double system;
+  long maxrss;
+  int status;
+} Usage;
+
+static flag verbose = 0;
+static char *corpusdir = "bench-corpus";
+static char *indexprog = "../mseedindex";
+static char *outputfile = "-";
+static int filecount = 4;
+static int64_t filesize = 8 * 1048576;
+static int channelcount = 12;
+static int msformat = 3;
+static int reclen = 4096;  /* 0 = variable record lengths (miniSEED 3) */
+static int interleave = 1; /* Records of a channel before the next, 0 = channel sequential */
+static double samprate = 100.0;
+static double gapprob = 0.0;
+static double oooprob = 0.0;
+static uint64_t seed = 1;
+static flag sinksqlite = 1;
+static flag sinkjson = 1;
+static int repeat = 1;
+static flag generateonly = 0;
+static flag keepcorpus = 0;
+static char *templatefile = NULL;
+static char *baselinefile = NULL;
+static double tolerance = 25.0;
+
+static Best best[] = {
+    {"index", "sqlite", 0.0, 0.0},
+    {"reindex", "sqlite", 0.0, 0.0},
+    {"index", "json", 0.0, 0.0},
+};
+
+/* Totals of the generated corpus */
+static int64_t corpusrecords = 0;
+static int64_t corpusbytes = 0;
+
+static uint64_t randstate;
+static FILE *output = NULL;
+
+static int GenerateCorpus (Usage *usage);
+static int GenerateFile (Channel *channels, const char *filename);
+static int GenerateTemplateFile (const char *template, int64_t length, int64_t records,
+                                 const char *filename);
+static int LoadTemplate (char **template, int64_t *length, int64_t *records);
+static int PackBlock (Channel *channel);
+static void RecordHandler (char *record, int reclength, void *handlerdata);
+static int AddRecord (RecordList *list, const char *record, int reclength);
+static int RunIndex (const char *sink, const char *sinkfile, Usage *usage);
+static int WriteResult (const char *phase, const char *sink, int run, const Usage *usage);
+static yyjson_mut_val *AddCorpus (yyjson_mut_doc *doc, yyjson_mut_val *obj);
+static int LoadBaseline (void);
+static int Regressed (void);
+static int CheckBaseline (void);
+static void RemoveCorpus (void);
+static uint64_t Random (void);
+static double RandomUnit (void);
+static double TimeDiff (const struct timespec *start, const struct timespec *end);
+static int64_t GetOptSize (int argcount, char **argvec, int argopt);
+static int ProcessParam (int argcount, char **argvec);
+static char *GetOptValue (int argcount, char **argvec, int argopt);
+static void PrintUsage (void);
+
+int
+main (int argc, char **argv)
+{
+  char sinkfile[1024];
+  Usage usage;
+  int run;
+  int rv = 0;
+
+  /* Set default error message prefix */
+  ms_loginit (NULL, NULL, NULL, "ERROR: ");
+
+  /* Process given parameters (command line and parameter file) */
+  if (ProcessParam (argc, argv) < 0)
+    return 1;
+
+  if (!strcmp (outputfile, "-"))
+  {
+    output = stdout;
+  }
+  else if (!(output = fopen (outputfile, "ab")))
+  {
+    ms_log (2, "Cannot open output file %s: %s\n", outputfile, strerror (errno));
+    return 1;
+  }
+
+  if (GenerateCorpus (&usage) || WriteResult ("generate", NULL, 1, &usage))
+  {
+    RemoveCorpus ();
+    return 1;
+  }
+
+  if (generateonly)
+  {
+    if (verbose)
+      ms_log (1, "Generated %" PRId64 " records (%" PRId64 " bytes) in %s\n",
+              corpusrecords, corpusbytes, corpusdir);
+
+    if (output != stdout)
+      fclose (output);
+
+    return 0;
+  }
+
+  if (baselinefile && LoadBaseline ())
+  {
+    RemoveCorpus ();
+    return 1;
+  }
+
+  /* Run again while slower than the baseline, to rule out a transient disturbance */
+  for (run = 1; rv == 0 && (run <= repeat || (run <= repeat + MAXRETRIES && Regressed ())); run++)
+  {
+    if (sinksqlite)
+    {
+      snprintf (sinkfile, sizeof (sinkfile), "%s/bench.sqlite", corpusdir);
+      unlink (sinkfile);
+
+      rv = RunIndex ("-sqlite", sinkfile, &usage);
+      if (rv == 0)
+        rv = WriteResult ("index", "sqlite", run, &usage);
+
+      if (rv == 0)
+        rv = RunIndex ("-sqlite", sinkfile, &usage);
+      if (rv == 0)
+        rv = WriteResult ("reindex", "sqlite", run, &usage);
+    }
+
+    if (sinkjson && rv == 0)
+    {
+      snprintf (sinkfile, sizeof (sinkfile), "%s/bench.json", corpusdir);
+      unlink (sinkfile);
+
+      rv = RunIndex ("-json", sinkfile, &usage);
+      if (rv == 0)
+        rv = WriteResult ("index", "json", run, &usage);
+    }
+  }
+
+  if (!keepcorpus)
+    RemoveCorpus ();
+
+  if (output != stdout)
+    fclose (output);
+
+  if (rv == 0 && baselinefile)
+    rv = CheckBaseline ();
+
+  return (rv) ? 1 : 0;
+} /* End of main() */
+
+/***************************************************************************
+ * GenerateCorpus():
+ *
+ * Generate the corpus files in the corpus directory and a list file
+ * naming them for mseedindex.  The channels continue from one file to
+ * the next, as for files of consecutive time periods.  With a template
+ * file each corpus file repeats its records instead.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+GenerateCorpus (Usage *usage)
+{
+  struct timespec start;
+  struct timespec end;
+  struct rusage rustart;
+  struct rusage ruend;
+  Channel *channels = NULL;
+  char *template = NULL;
+  int64_t templatelength = 0;
+  int64_t templaterecords = 0;
+  char filename[1024];
+  char listfile[1024];
+  FILE *listfp;
+  int idx;
+  int rv = 0;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  getrusage (RUSAGE_SELF, &rustart);
+
+  if (mkdir (corpusdir, 0755) && errno != EEXIST)
+  {
+    ms_log (2, "Cannot create corpus directory %s: %s\n", corpusdir, strerror (errno));
+    return -1;
+  }
+
+  snprintf (listfile, sizeof (listfile), "%s/files.list", corpusdir);
+  if (!(listfp = fopen (listfile, "w")))
+  {
+    ms_log (2, "Cannot open %s: %s\n", listfile, strerror (errno));
+    return -1;
+  }
+
+  if (templatefile)
+  {
+    if (LoadTemplate (&template, &templatelength, &templaterecords))
+    {
+      fclose (listfp);
+      return -1;
+    }
+
+    channelcount = 0;
+  }
+  else if (!(channels = calloc (channelcount, sizeof (Channel))))
+  {
+    ms_log (2, "Cannot allocate memory for channels\n");
+    fclose (listfp);
+    return -1;
+  }
+
+  randstate = seed ^ UINT64_C (0x9E3779B97F4A7C15); /* Nonzero for a seed of 0 */
+
+  /* Stations of three components, all starting at the same time */
+  for (idx = 0; idx < channelcount; idx++)
+  {
+    char station[11];
+    char chan[4];
+
+    snprintf (station, sizeof (station), "B%03d", idx / 3);
+    snprintf (chan, sizeof (chan), "HH%c", "ZNE"[idx % 3]);
+    ms_nslc2sid (channels[idx].sid, sizeof (channels[idx].sid), 0, "XX", station, "00", chan);
+
+    channels[idx].nexttime = ms_timestr2nstime ("2020-01-01T00:00:00");
+    channels[idx].value = (int32_t)(Random () % 2001) - 1000;
+  }
+
+  for (idx = 0; idx < filecount && rv == 0; idx++)
+  {
+    snprintf (filename, sizeof (filename), "%s/corpus-%03d.mseed", corpusdir, idx);
+
+    if (template)
+      rv = GenerateTemplateFile (template, templatelength, templaterecords, filename);
+    else
+      rv = GenerateFile (channels, filename);
+
+    if (rv == 0)
+      fprintf (listfp, "%s\n", filename);
+  }
+
+  free (template);
+
+  for (idx = 0; idx < channelcount; idx++)
+  {
+    free (channels[idx].records.data);
+    free (channels[idx].records.offsets);
+    free (channels[idx].records.lengths);
+  }
+  free (channels);
+
+  if (fclose (listfp))
+  {
+    ms_log (2, "Cannot write %s: %s\n", listfile, strerror (errno));
+    rv = -1;
+  }
+
+  getrusage (RUSAGE_SELF, &ruend);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  usage->wall = TimeDiff (&start, &end);
+  usage->user = (ruend.ru_utime.tv_sec - rustart.ru_utime.tv_sec) +
+                (ruend.ru_utime.tv_usec - rustart.ru_utime.tv_usec) / 1e6;
+  usage->system = (ruend.ru_stime.tv_sec - rustart.ru_stime.tv_sec) +
+                  (ruend.ru_stime.tv_usec - rustart.ru_stime.tv_usec) / 1e6;
+  usage->maxrss = ruend.ru_maxrss;
+  usage->status = rv;
+
+  return rv;
+} /* End of GenerateCorpus() */
+
+/***************************************************************************
+ * GenerateFile():
+ *
+ * Pack blocks of each channel in turn until the file size is reached,
+ * then write the records to the file.  Records of each channel are
+ * swapped with the following record according to the out-of-order
+ * probability, and written in groups of 'interleave' records per
+ * channel, or all records of each channel in turn when 0.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+GenerateFile (Channel *channels, const char *filename)
+{
+  RecordList *list;
+  int64_t bytes = 0;
+  int64_t *next;
+  int64_t count;
+  int64_t idx;
+  size_t length;
+  size_t offset;
+  int reclength;
+  int remaining;
+  int chidx;
+  FILE *fp;
+  int rv = 0;
+
+  for (chidx = 0; chidx < channelcount; chidx++)
+    channels[chidx].records.length = channels[chidx].records.count = 0;
+
+  while (bytes < filesize && rv == 0)
+  {
+    for (chidx = 0; chidx < channelcount && rv == 0; chidx++)
+    {
+      length = channels[chidx].records.length;
+
+      if ((rv = PackBlock (&channels[chidx])) == 0)
+        bytes += channels[chidx].records.length - length;
+    }
+  }
+
+  if (rv)
+    return -1;
+
+  /* Swap records with the following record of the channel */
+  for (chidx = 0; chidx < channelcount && oooprob > 0.0; chidx++)
+  {
+    list = &channels[chidx].records;
+
+    for (idx = 0; idx + 1 < list->count; idx++)
+    {
+      if (RandomUnit () >= oooprob)
+        continue;
+
+      /* Exchange record positions, the data stays in place */
+      offset = list->offsets[idx];
+      list->offsets[idx] = list->offsets[idx + 1];
+      list->offsets[idx + 1] = offset;
+
+      reclength = list->lengths[idx];
+      list->lengths[idx] = list->lengths[idx + 1];
+      list->lengths[idx + 1] = reclength;
+
+      idx++;
+    }
+  }
+
+  if (!(fp = fopen (filename, "wb")))
+  {
+    ms_log (2, "Cannot open %s: %s\n", filename, strerror (errno));
+    return -1;
+  }
+
+  if (!(next = calloc (channelcount, sizeof (int64_t))))
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    fclose (fp);
+    return -1;
+  }
+
+  /* Write groups of records of each channel until all are written */
+  do
+  {
+    count = 0;
+
+    for (chidx = 0; chidx < channelcount && rv == 0; chidx++)
+    {
+      list = &channels[chidx].records;
+      remaining = (interleave > 0) ? interleave : -1;
+
+      while (next[chidx] < list->count && remaining-- != 0)
+      {
+        idx = next[chidx]++;
+
+        if (fwrite (list->data + list->offsets[idx], list->lengths[idx], 1, fp) != 1)
+        {
+          ms_log (2, "Cannot write %s: %s\n", filename, strerror (errno));
+          rv = -1;
+          break;
+        }
+
+        corpusrecords++;
+        corpusbytes += list->lengths[idx];
+        count++;
+      }
+    }
+  } while (count > 0 && rv == 0);
+
+  free (next);
+
+  if (fclose (fp) && rv == 0)
+  {
+    ms_log (2, "Cannot write %s: %s\n", filename, strerror (errno));
+    rv = -1;
+  }
+
+  if (verbose >= 2)
+    ms_log (1, "Generated %s\n", filename);
+
+  return rv;
+} /* End of GenerateFile() */
+
+/***************************************************************************
+ * LoadTemplate():
+ *
+ * Read the template file and count its records, all of which must be
+ * miniSEED with a detectable record length.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+LoadTemplate (char **template, int64_t *length, int64_t *records)
+{
+  struct stat st;
+  int64_t offset;
+  int reclength;
+  uint8_t formatversion;
+  FILE *fp;
+
+  if (!(fp = fopen (templatefile, "rb")) || fstat (fileno (fp), &st))
+  {
+    ms_log (2, "Cannot open template %s: %s\n", templatefile, strerror (errno));
+    if (fp)
+      fclose (fp);
+    return -1;
+  }
+
+  *length = st.st_size;
+  *records = 0;
+
+  if (*length <= 0 || !(*template = malloc (*length)) ||
+      fread (*template, *length, 1, fp) != 1)
+  {
+    ms_log (2, "Cannot read template %s\n", templatefile);
+    fclose (fp);
+    return -1;
+  }
+
+  fclose (fp);
+
+  for (offset = 0; offset < *length; offset += reclength)
+  {
+    reclength = ms3_detect (*template + offset, *length - offset, &formatversion);
+
+    if (reclength <= 0 || reclength > *length - offset)
+    {
+      ms_log (2, "Template %s is not miniSEED with known record lengths at offset %" PRId64 "\n",
+              templatefile, offset);
+      free (*template);
+      *template = NULL;
+      return -1;
+    }
+
+    (*records)++;
+  }
+
+  return 0;
+} /* End of LoadTemplate() */
+
+/***************************************************************************
+ * GenerateTemplateFile():
+ *
+ * Write the template records repeatedly until the file size is reached.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+GenerateTemplateFile (const char *template, int64_t length, int64_t records,
+                      const char *filename)
+{
+  int64_t bytes;
+  FILE *fp;
+  int rv = 0;
+
+  if (!(fp = fopen (filename, "wb")))
+  {
+    ms_log (2, "Cannot open %s: %s\n", filename, strerror (errno));
+    return -1;
+  }
+
+  for (bytes = 0; bytes < filesize; bytes += length)
+  {
+    if (fwrite (template, length, 1, fp) != 1)
+    {
+      ms_log (2, "Cannot write %s: %s\n", filename, strerror (errno));
+      rv = -1;
+      break;
+    }
+
+    corpusrecords += records;
+    corpusbytes += length;
+  }
+
+  if (fclose (fp) && rv == 0)
+  {
+    ms_log (2, "Cannot write %s: %s\n", filename, strerror (errno));
+    rv = -1;
+  }
+
+  if (verbose >= 2)
+    ms_log (1, "Generated %s\n", filename);
+
+  return rv;
+} /* End of GenerateTemplateFile() */
+
+/***************************************************************************
+ * PackBlock():
+ *
+ * Generate a block of random walk samples for a channel, following a
+ * gap according to the gap probability, and pack them into records
+ * added to the records of the channel.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+PackBlock (Channel *channel)
+{
+  static int32_t samples[BLOCKSAMPLES];
+  MS3Record *msr;
+  int64_t packedsamples = 0;
+  nstime_t period = (nstime_t)(NSTMODULUS / samprate);
+  int idx;
+  int rv;
+
+  if (gapprob > 0.0 && RandomUnit () < gapprob)
+    channel->nexttime += period * (nstime_t)(1 + Random () % BLOCKSAMPLES);
+
+  for (idx = 0; idx < BLOCKSAMPLES; idx++)
+  {
+    /* Mostly small steps, occasionally large to vary compression */
+    if (Random () % 100 == 0)
+      channel->value += (int32_t)(Random () % 200001) - 100000;
+    else
+      channel->value += (int32_t)(Random () % 201) - 100;
+
+    samples[idx] = channel->value;
+  }
+
+  if (!(msr = msr3_init (NULL)))
+  {
+    ms_log (2, "Cannot allocate record\n");
+    return -1;
+  }
+
+  strcpy (msr->sid, channel->sid);
+  msr->formatversion = (uint8_t)msformat;
+  msr->reclen = (reclen > 0) ? reclen : (int)(512 + Random () % 3585);
+  msr->encoding = DE_STEIM2;
+  msr->pubversion = 1;
+  msr->samprate = samprate;
+  msr->starttime = channel->nexttime;
+  msr->datasamples = samples;
+  msr->numsamples = BLOCKSAMPLES;
+  msr->sampletype = 'i';
+
+  rv = msr3_pack (msr, RecordHandler, &channel->records, &packedsamples, MSF_FLUSHDATA, verbose - 2);
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+
+  if (rv < 0 || packedsamples != BLOCKSAMPLES)
+  {
+    ms_log (2, "Cannot pack records for %s\n", channel->sid);
+    return -1;
+  }
+
+  channel->nexttime += period * BLOCKSAMPLES;
+
+  return 0;
+} /* End of PackBlock() */
+
+/***************************************************************************
+ * RecordHandler():
+ *
+ * Add a packed record to a record list.  Allocation failure is fatal.
+ ***************************************************************************/
+static void
+RecordHandler (char *record, int reclength, void *handlerdata)
+{
+  if (AddRecord ((RecordList *)handlerdata, record, reclength))
+  {
+    ms_log (2, "Cannot allocate memory for records\n");
+    exit (1);
+  }
+} /* End of RecordHandler() */
+
+/***************************************************************************
+ * AddRecord():
+ *
+ * Append a record to a record list, growing it as needed.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+AddRecord (RecordList *list, const char *record, int reclength)
+{
+  size_t *newoffsets;
+  int *newlengths;
+  char *newdata;
+  size_t newmax;
+
+  if (list->length + reclength > list->max)
+  {
+    newmax = (list->max) ? list->max * 2 : 1048576;
+    while (newmax < list->length + reclength)
+      newmax *= 2;
+
+    if (!(newdata = realloc (list->data, newmax)))
+      return -1;
+
+    list->data = newdata;
+    list->max = newmax;
+  }
+
+  if (list->count == list->countmax)
+  {
+    list->countmax = (list->countmax) ? list->countmax * 2 : 1024;
+
+    if (!(newoffsets = realloc (list->offsets, list->countmax * sizeof (size_t))))
+      return -1;
+    list->offsets = newoffsets;
+
+    if (!(newlengths = realloc (list->lengths, list->countmax * sizeof (int))))
+      return -1;
+    list->lengths = newlengths;
+  }
+
+  memcpy (list->data + list->length, record, reclength);
+  list->offsets[list->count] = list->length;
+  list->lengths[list->count] = reclength;
+  list->length += reclength;
+  list->count++;
+
+  return 0;
+} /* End of AddRecord() */
+
+/***************************************************************************
+ * RunIndex():
+ *
+ * Run mseedindex on the corpus with a sink option and file, measuring
+ * the wall time and the resource usage of the process.  Standard
+ * output of mseedindex is discarded unless verbose.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+RunIndex (const char *sink, const char *sinkfile, Usage *usage)
+{
+  struct timespec start;
+  struct timespec end;
+  struct rusage rusage;
+  char listarg[1100];
+  char statsfile[1100];
+  char *argv[8];
+  pid_t pid;
+  int status;
+  int fd;
+
+  snprintf (listarg, sizeof (listarg), "@%s/files.list", corpusdir);
+  snprintf (statsfile, sizeof (statsfile), "%s/stats.json", corpusdir);
+  unlink (statsfile);
+
+  argv[0] = indexprog;
+  argv[1] = (char *)sink;
+  argv[2] = (char *)sinkfile;
+  argv[3] = "-statsjson";
+  argv[4] = statsfile;
+  argv[5] = listarg;
+  argv[6] = NULL;
+
+  if (verbose)
+    ms_log (1, "Running %s %s %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3], argv[4], argv[5]);
+
+  fflush (output);
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  if ((pid = fork ()) < 0)
+  {
+    ms_log (2, "Cannot fork: %s\n", strerror (errno));
+    return -1;
+  }
+
+  if (pid == 0)
+  {
+    if (!verbose && (fd = open ("/dev/null", O_WRONLY)) >= 0)
+    {
+      dup2 (fd, STDOUT_FILENO);
+      close (fd);
+    }
+
+    execv (indexprog, argv);
+    ms_log (2, "Cannot execute %s: %s\n", indexprog, strerror (errno));
+    _exit (127);
+  }
+
+  if (wait4 (pid, &status, 0, &rusage) < 0)
+  {
+    ms_log (2, "Cannot wait for %s: %s\n", indexprog, strerror (errno));
+    return -1;
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  usage->wall = TimeDiff (&start, &end);
+  usage->user = rusage.ru_utime.tv_sec + rusage.ru_utime.tv_usec / 1e6;
+  usage->system = rusage.ru_stime.tv_sec + rusage.ru_stime.tv_usec / 1e6;
+  usage->maxrss = rusage.ru_maxrss;
+  usage->status = (WIFEXITED (status)) ? WEXITSTATUS (status) : -1;
+
+  if (usage->status)
+  {
+    ms_log (2, "%s %s exited with status %d\n", indexprog, sink, usage->status);
+    return -1;
+  }
+
+  return 0;
+} /* End of RunIndex() */
+
+/***************************************************************************
+ * WriteResult():
+ *
+ * Write the result of a phase as a JSON object on one line, including
+ * the corpus parameters.  The maximum resident set size is reported
+ * in kilobytes.  For indexing phases the statistics written by
+ * mseedindex are included as the "mseedindex" object, and the best
+ * throughput of the phase is tracked for comparison with a baseline.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+WriteResult (const char *phase, const char *sink, int run, const Usage *usage)
+{
+  yyjson_mut_doc *doc;
+  yyjson_mut_val *root;
+  yyjson_doc *stats = NULL;
+  char statsfile[1100];
+  char *serialized;
+  long maxrss = usage->maxrss;
+  double rate = (usage->wall > 0.0) ? corpusrecords / usage->wall : 0.0;
+  size_t idx;
+  int rv = 0;
+
+#if defined(__APPLE__)
+  maxrss /= 1024; /* Reported in bytes */
+#endif
+
+  if (!(doc = yyjson_mut_doc_new (NULL)) || !(root = yyjson_mut_obj (doc)))
+  {
+    ms_log (2, "Cannot create JSON document\n");
+    yyjson_mut_doc_free (doc);
+    return -1;
+  }
+
+  yyjson_mut_doc_set_root (doc, root);
+
+  yyjson_mut_obj_add_str (doc, root, "benchmark", PACKAGE);
+  yyjson_mut_obj_add_str (doc, root, "phase", phase);
+  if (sink)
+    yyjson_mut_obj_add_str (doc, root, "sink", sink);
+  yyjson_mut_obj_add_int (doc, root, "run", run);
+
+  yyjson_mut_obj_add_val (doc, root, "corpus", AddCorpus (doc, yyjson_mut_obj (doc)));
+
+  yyjson_mut_obj_add_real (doc, root, "wall_seconds", usage->wall);
+  yyjson_mut_obj_add_real (doc, root, "user_seconds", usage->user);
+  yyjson_mut_obj_add_real (doc, root, "system_seconds", usage->system);
+  yyjson_mut_obj_add_int (doc, root, "max_rss_kb", maxrss);
+  yyjson_mut_obj_add_real (doc, root, "records_per_second", rate);
+  yyjson_mut_obj_add_real (doc, root, "mb_per_second",
+                           (usage->wall > 0.0) ? corpusbytes / 1048576.0 / usage->wall : 0.0);
+
+  if (sink)
+  {
+    snprintf (statsfile, sizeof (statsfile), "%s/stats.json", corpusdir);
+
+    if ((stats = yyjson_read_file (statsfile, 0, NULL, NULL)))
+      yyjson_mut_obj_add_val (doc, root, "mseedindex",
+                              yyjson_val_mut_copy (doc, yyjson_doc_get_root (stats)));
+    else
+      ms_log (1, "Warning: cannot read mseedindex statistics from %s\n", statsfile);
+
+    for (idx = 0; idx < sizeof (best) / sizeof (best[0]); idx++)
+      if (!strcmp (best[idx].phase, phase) && !strcmp (best[idx].sink, sink) &&
+          rate > best[idx].rate)
+        best[idx].rate = rate;
+  }
+
+  if (!(serialized = yyjson_mut_write (doc, 0, NULL)))
+  {
+    ms_log (2, "Cannot serialize JSON\n");
+    rv = -1;
+  }
+  else if (fprintf (output, "%s\n", serialized) < 0 || fflush (output))
+  {
+    ms_log (2, "Cannot write to %s: %s\n", outputfile, strerror (errno));
+    rv = -1;
+  }
+
+  free (serialized);
+  yyjson_doc_free (stats);
+  yyjson_mut_doc_free (doc);
+
+  return rv;
+} /* End of WriteResult() */
+
+/***************************************************************************
+ * AddCorpus():
+ *
+ * Add the corpus parameters and totals to a JSON object, either of the
+ * generated corpus or of the template.
+ *
+ * Returns the object
+ ***************************************************************************/
+static yyjson_mut_val *
+AddCorpus (yyjson_mut_doc *doc, yyjson_mut_val *corpus)
+{
+  const char *basename;
+
+  yyjson_mut_obj_add_int (doc, corpus, "files", filecount);
+
+  if (templatefile)
+  {
+    basename = strrchr (templatefile, '/');
+    yyjson_mut_obj_add_str (doc, corpus, "template", (basename) ? basename + 1 : templatefile);
+  }
+  else
+  {
+    yyjson_mut_obj_add_int (doc, corpus, "channels", channelcount);
+    yyjson_mut_obj_add_int (doc, corpus, "format", msformat);
+    if (reclen > 0)
+      yyjson_mut_obj_add_int (doc, corpus, "record_length", reclen);
+    else
+      yyjson_mut_obj_add_str (doc, corpus, "record_length", "variable");
+    yyjson_mut_obj_add_int (doc, corpus, "interleave", interleave);
+    yyjson_mut_obj_add_real (doc, corpus, "gap_probability", gapprob);
+    yyjson_mut_obj_add_real (doc, corpus, "out_of_order_probability", oooprob);
+    yyjson_mut_obj_add_uint (doc, corpus, "seed", seed);
+  }
+
+  yyjson_mut_obj_add_int (doc, corpus, "records", corpusrecords);
+  yyjson_mut_obj_add_int (doc, corpus, "bytes", corpusbytes);
+
+  return corpus;
+} /* End of AddCorpus() */
+
+/***************************************************************************
+ * LoadBaseline():
+ *
+ * Find the best throughput of each indexing phase among the baseline
+ * results of the same phase, sink and corpus.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+LoadBaseline (void)
+{
+  yyjson_mut_doc *doc;
+  yyjson_mut_val *corpus;
+  yyjson_doc *line;
+  yyjson_val *root;
+  double rate;
+  char *buffer = NULL;
+  size_t buffersize = 0;
+  size_t idx;
+  FILE *fp;
+
+  if (!(fp = fopen (baselinefile, "r")))
+  {
+    ms_log (2, "Cannot open baseline %s: %s\n", baselinefile, strerror (errno));
+    return -1;
+  }
+
+  if (!(doc = yyjson_mut_doc_new (NULL)) || !(corpus = AddCorpus (doc, yyjson_mut_obj (doc))))
+  {
+    ms_log (2, "Cannot create JSON document\n");
+    yyjson_mut_doc_free (doc);
+    fclose (fp);
+    return -1;
+  }
+
+  while (getline (&buffer, &buffersize, fp) > 0)
+  {
+    if (!(line = yyjson_read (buffer, strlen (buffer), 0)))
+      continue;
+
+    root = yyjson_doc_get_root (line);
+    rate = yyjson_get_num (yyjson_obj_get (root, "records_per_second"));
+
+    if (yyjson_equals_str (yyjson_obj_get (root, "benchmark"), PACKAGE) &&
+        yyjson_mut_equals (corpus, yyjson_val_mut_copy (doc, yyjson_obj_get (root, "corpus"))))
+    {
+      for (idx = 0; idx < sizeof (best) / sizeof (best[0]); idx++)
+        if (yyjson_equals_str (yyjson_obj_get (root, "phase"), best[idx].phase) &&
+            yyjson_equals_str (yyjson_obj_get (root, "sink"), best[idx].sink) &&
+            rate > best[idx].baseline)
+          best[idx].baseline = rate;
+    }
+
+    yyjson_doc_free (line);
+  }
+
+  free (buffer);
+  fclose (fp);
+  yyjson_mut_doc_free (doc);
+
+  return 0;
+} /* End of LoadBaseline() */
+
+/***************************************************************************
+ * Regressed():
+ *
+ * Returns the number of phases run that are slower than the baseline
+ * tolerance allows
+ ***************************************************************************/
+static int
+Regressed (void)
+{
+  size_t idx;
+  int count = 0;
+
+  for (idx = 0; idx < sizeof (best) / sizeof (best[0]); idx++)
+    if (best[idx].rate > 0.0 && best[idx].baseline > 0.0 &&
+        best[idx].rate < best[idx].baseline * (1.0 - tolerance / 100.0))
+      count++;
+
+  return count;
+} /* End of Regressed() */
+
+/***************************************************************************
+ * CheckBaseline():
+ *
+ * Report the best throughput of each indexing phase compared to the
+ * baseline on standard error.  A phase without a baseline result is
+ * reported but does not fail.
+ *
+ * Returns 0 when no phase is slower than the tolerance allows, and -1
+ * on regression
+ ***************************************************************************/
+static int
+CheckBaseline (void)
+{
+  double change;
+  size_t idx;
+  int regressions;
+
+  for (idx = 0; idx < sizeof (best) / sizeof (best[0]); idx++)
+  {
+    if (best[idx].rate <= 0.0)
+      continue;
+
+    if (best[idx].baseline <= 0.0)
+    {
+      ms_log (1, "%-7s %-6s %12.0f records/s  no baseline for this corpus\n",
+              best[idx].phase, best[idx].sink, best[idx].rate);
+      continue;
+    }
+
+    change = 100.0 * (best[idx].rate - best[idx].baseline) / best[idx].baseline;
+
+    ms_log (1, "%-7s %-6s %12.0f records/s  baseline %12.0f  %+6.1f%%%s\n",
+            best[idx].phase, best[idx].sink, best[idx].rate, best[idx].baseline, change,
+            (change < -tolerance) ? "  REGRESSED" : "");
+  }
+
+  if ((regressions = Regressed ()))
+  {
+    ms_log (2, "%d phases slower than baseline %s by more than %g%%\n",
+            regressions, baselinefile, tolerance);
+    return -1;
+  }
+
+  return 0;
+} /* End of CheckBaseline() */
+
+/***************************************************************************
+ * RemoveCorpus():
+ *
+ * Remove the generated files, sinks and the corpus directory.
+ ***************************************************************************/
+static void
+RemoveCorpus (void)
+{
+  char path[1024];
+  int idx;
+
+  for (idx = 0; idx < filecount; idx++)
+  {
+    snprintf (path, sizeof (path), "%s/corpus-%03d.mseed", corpusdir, idx);
+    unlink (path);
+  }
+
+  snprintf (path, sizeof (path), "%s/files.list", corpusdir);
+  unlink (path);
+  snprintf (path, sizeof (path), "%s/bench.sqlite", corpusdir);
+  unlink (path);
+  snprintf (path, sizeof (path), "%s/bench.json", corpusdir);
+  unlink (path);
+  snprintf (path, sizeof (path), "%s/stats.json", corpusdir);
+  unlink (path);
+
+  rmdir (corpusdir);
+} /* End of RemoveCorpus() */
+
+/***************************************************************************
+ * Random():
+ *
+ * Return the next value of a xorshift64* generator.
+ ***************************************************************************/
+static uint64_t
+Random (void)
+{
+  randstate ^= randstate >> 12;
+  randstate ^= randstate << 25;
+  randstate ^= randstate >> 27;
+
+  return randstate * UINT64_C (2685821657736338717);
+} /* End of Random() */
+
+/***************************************************************************
+ * RandomUnit():
+ *
+ * Return a random value in the range [0,1).
+ ***************************************************************************/
+static double
+RandomUnit (void)
+{
+  return (Random () >> 11) * (1.0 / 9007199254740992.0);
+} /* End of RandomUnit() */
+
+/***************************************************************************
+ * TimeDiff():
+ *
+ * Return the difference between two times in seconds.
+ ***************************************************************************/
+static double
+TimeDiff (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+} /* End of TimeDiff() */
+
+/***************************************************************************
+ * ProcessParam():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+ProcessParam (int argcount, char **argvec)
+{
+  char *value;
+  int optind;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      PrintUsage ();
+      exit (0);
+    }
+    else if (strncmp (argvec[optind], "-v", 2) == 0)
+    {
+      verbose += strspn (&argvec[optind][1], "v");
+    }
+    else if (strcmp (argvec[optind], "-d") == 0)
+    {
+      corpusdir = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-files") == 0)
+    {
+      filecount = atoi (GetOptValue (argcount, argvec, optind++));
+    }
+    else if (strcmp (argvec[optind], "-size") == 0)
+    {
+      filesize = GetOptSize (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-channels") == 0)
+    {
+      channelcount = atoi (GetOptValue (argcount, argvec, optind++));
+    }
+    else if (strcmp (argvec[optind], "-format") == 0)
+    {
+      msformat = atoi (GetOptValue (argcount, argvec, optind++));
+    }
+    else if (strcmp (argvec[optind], "-reclen") == 0)
+    {
+      value = GetOptValue (argcount, argvec, optind++);
+      reclen = (strcmp (value, "var") == 0) ? 0 : atoi (value);
+    }
+    else if (strcmp (argvec[optind], "-interleave") == 0)
+    {
+      interleave = atoi (GetOptValue (argcount, argvec, optind++));
+    }
+    else if (strcmp (argvec[optind], "-rate") == 0)
+    {
+      samprate = strtod (GetOptValue (argcount, argvec, optind++), NULL);
+    }
+    else if (strcmp (argvec[optind], "-gaps") == 0)
+    {
+      gapprob = strtod (GetOptValue (argcount, argvec, optind++), NULL);
+    }
+    else if (strcmp (argvec[optind], "-ooo") == 0)
+    {
+      oooprob = strtod (GetOptValue (argcount, argvec, optind++), NULL);
+    }
+    else if (strcmp (argvec[optind], "-seed") == 0)
+    {
+      seed = strtoull (GetOptValue (argcount, argvec, optind++), NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-index") == 0)
+    {
+      indexprog = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-sink") == 0)
+    {
+      value = GetOptValue (argcount, argvec, optind++);
+      sinksqlite = (strcmp (value, "sqlite") == 0 || strcmp (value, "both") == 0);
+      sinkjson = (strcmp (value, "json") == 0 || strcmp (value, "both") == 0);
+
+      if (!sinksqlite && !sinkjson)
+      {
+        ms_log (2, "Unrecognized sink: %s\n", value);
+        exit (1);
+      }
+    }
+    else if (strcmp (argvec[optind], "-repeat") == 0)
+    {
+      repeat = atoi (GetOptValue (argcount, argvec, optind++));
+    }
+    else if (strcmp (argvec[optind], "-gen") == 0)
+    {
+      generateonly = 1;
+      keepcorpus = 1;
+    }
+    else if (strcmp (argvec[optind], "-keep") == 0)
+    {
+      keepcorpus = 1;
+    }
+    else if (strcmp (argvec[optind], "-o") == 0)
+    {
+      outputfile = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-template") == 0)
+    {
+      templatefile = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-baseline") == 0)
+    {
+      baselinefile = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-tolerance") == 0)
+    {
+      tolerance = strtod (GetOptValue (argcount, argvec, optind++), NULL);
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      exit (1);
+    }
+  }
+
+  if (msformat != 2 && msformat != 3)
+  {
+    ms_log (2, "Format version must be 2 or 3\n");
+    return -1;
+  }
+
+  if (reclen == 0 && msformat == 2)
+  {
+    ms_log (2, "Variable record lengths require format version 3\n");
+    return -1;
+  }
+
+  if (reclen != 0 && (reclen < 128 || reclen > 65536 ||
+                      (msformat == 2 && (reclen & (reclen - 1)))))
+  {
+    ms_log (2, "Invalid record length for format version %d: %d\n", msformat, reclen);
+    return -1;
+  }
+
+  if (filecount < 1 || filecount > 1000 || channelcount < 1 || filesize < 1 ||
+      samprate <= 0.0 || repeat < 1 || interleave < 0 || tolerance < 0.0)
+  {
+    ms_log (2, "Invalid corpus parameters, try -h for usage\n");
+    return -1;
+  }
+
+  /* Report the program version */
+  if (verbose)
+    ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+
+  return 0;
+} /* End of ProcessParam() */
+
+/***************************************************************************
+ * GetOptSize():
+ *
+ * Parse a size option value in bytes with an optional k, M or G suffix.
+ *
+ * Returns the size in bytes, exits on error.
+ ***************************************************************************/
+static int64_t
+GetOptSize (int argcount, char **argvec, int argopt)
+{
+  char *value = GetOptValue (argcount, argvec, argopt);
+  char *endptr = NULL;
+  int64_t size;
+
+  size = strtoll (value, &endptr, 10);
+
+  if (*endptr == 'k' || *endptr == 'K')
+    size *= 1024;
+  else if (*endptr == 'm' || *endptr == 'M')
+    size *= 1048576;
+  else if (*endptr == 'g' || *endptr == 'G')
+    size *= 1073741824;
+  else if (*endptr != '\0')
+  {
+    ms_log (2, "Invalid size for %s: %s\n", argvec[argopt], value);
+    exit (1);
+  }
+
+  return size;
+} /* End of GetOptSize() */
+
+/***************************************************************************
+ * GetOptValue():
+ *
+ * Return the value to a command line option; checking that the value is
+ * itself not an option (starting with '-') and is not past the end of
+ * the argument list.
+ *
+ * argcount: total arguments in argvec
+ * argvec: list of arguments
+ * argopt: index of option to process, value is expected to be at argopt+1
+ *
+ * Returns value on success and exits with error message on failure
+ ***************************************************************************/
+static char *
+GetOptValue (int argcount, char **argvec, int argopt)
+{
+  if (argvec == NULL || argvec[argopt] == NULL)
+  {
+    ms_log (2, "GetOptValue(): NULL option requested\n");
+    exit (1);
+    return 0;
+  }
+
+  if ((argopt + 1) < argcount && *argvec[argopt + 1] != '-')
+    return argvec[argopt + 1];
+
+  ms_log (2, "Option %s requires a value, try -h for usage\n", argvec[argopt]);
+  exit (1);
+  return 0;
+} /* End of GetOptValue() */
+
+/***************************************************************************
+ * PrintUsage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+PrintUsage (void)
+{
+  fprintf (stderr, "%s - End-to-end benchmark of mseedindex version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr,
+           " ## General options ##\n"
+           " -V             Report program version\n"
+           " -h             Show this usage message\n"
+           " -v             Be more verbose, multiple flags can be used\n"
+           "\n"
+           " ## Corpus options ##\n"
+           " -d dir         Directory for corpus and sinks, currently: %s\n"
+           " -files count   Number of files, currently: %d\n"
+           " -size bytes    Size of each file, k, M and G suffixes allowed\n"
+           " -channels count  Number of channels, currently: %d\n"
+           " -format 2|3    miniSEED format version, currently: %d\n"
+           " -reclen bytes  Record length, or 'var' for variable lengths (version 3)\n"
+           " -interleave n  Records of a channel before the next, 0 for channel sequential\n"
+           " -rate hz       Sample rate, currently: %g\n"
+           " -gaps prob     Probability of a gap before each block of samples\n"
+           " -ooo prob      Probability of swapping a record with the following record\n"
+           " -seed value    Seed of the pseudo-random generator, currently: %" PRIu64 "\n"
+           " -template file Build files by repeating the records of a miniSEED file\n"
+           "\n"
+           " ## Run options ##\n"
+           " -index path    mseedindex program to run, currently: %s\n"
+           " -sink name     Sinks to index to: sqlite, json or both (default)\n"
+           " -repeat count  Number of times to run each sink\n"
+           " -gen           Only generate the corpus, and keep it\n"
+           " -keep          Keep the corpus and sinks after running\n"
+           " -o file        Append results to file, default is standard output\n"
+           " -baseline file Compare throughput with results of a previous run\n"
+           " -tolerance pct Tolerated throughput loss relative to the baseline, currently: %g\n"
+           "\n"
+           "Results are written as one JSON object per line for each phase.\n"
+           "\n",
+           corpusdir, filecount, channelcount, msformat, samprate, seed, indexprog, tolerance);
+} /* End of PrintUsage() */
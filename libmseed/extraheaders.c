@@ -105,6 +105,54 @@ parse_json (char *jsonstring, size_t length, LM_PARSED_JSON *parsed)
   return parsed;
 }
 
+/***************************************************************************
+ * Internal routine to copy a JSON value into a buffer of the
+ * specified type, as described for mseh_get_ptr_r().
+ *
+ * Returns 0 on success, 1 when not found and 2 when of a different type
+ ***************************************************************************/
+static int
+get_value (yyjson_val *extravalue, void *value, char type, uint32_t maxlength)
+{
+  const char *stringvalue = NULL;
+
+  if (extravalue == NULL)
+  {
+    return 1;
+  }
+  else if (type == 'n' && yyjson_is_num (extravalue))
+  {
+    if (value)
+      *((double *)value) = unsafe_yyjson_get_num (extravalue);
+  }
+  else if (type == 'i' && yyjson_is_int (extravalue))
+  {
+    if (value)
+      *((int64_t *)value) = unsafe_yyjson_get_int (extravalue);
+  }
+  else if (type == 's' && yyjson_is_str (extravalue))
+  {
+    if (value)
+    {
+      stringvalue = unsafe_yyjson_get_str (extravalue);
+      strncpy ((char *)value, stringvalue, maxlength - 1);
+      ((char *)value)[maxlength - 1] = '\0';
+    }
+  }
+  else if (type == 'b' && yyjson_is_bool(extravalue))
+  {
+    if (value)
+      *((int *)value) = (unsafe_yyjson_get_bool (extravalue)) ? 1 : 0;
+  }
+  /* Return wrong type indicator if a value was requested */
+  else if (value)
+  {
+    return 2;
+  }
+
+  return 0;
+} /* End of get_value() */
+
 /**********************************************************************/ /**
  * @brief Search for and return an extra header value.
  *
@@ -155,7 +203,6 @@ mseh_get_ptr_r (const MS3Record *msr, const char *ptr,
 
   yyjson_alc alc = {_priv_malloc, _priv_realloc, _priv_free, NULL};
   yyjson_val *extravalue  = NULL;
-  const char *stringvalue = NULL;
 
   int retval = 0;
 
@@ -221,48 +268,168 @@ mseh_get_ptr_r (const MS3Record *msr, const char *ptr,
   /* Get target value */
   extravalue = yyjson_doc_ptr_get(parsed->doc, ptr);
 
-  if (extravalue == NULL)
-  {
-    retval = 1;
-  }
-  else if (type == 'n' && yyjson_is_num (extravalue))
+  retval = get_value (extravalue, value, type, maxlength);
+
+  /* Free parse state if not being retained */
+  if (parsestate == NULL)
   {
-    if (value)
-      *((double *)value) = unsafe_yyjson_get_num (extravalue);
+    mseh_free_parsestate (&parsed);
   }
-  else if (type == 'i' && yyjson_is_int (extravalue))
+
+  return retval;
+} /* End of mseh_get_ptr_r() */
+
+/**********************************************************************/ /**
+ * @brief Search for and return multiple extra header values.
+ *
+ * Each entry in \a queries specifies a value as a JSON Pointer (RFC
+ * 6901), a buffer and expected type, with the same meanings as for
+ * mseh_get_ptr_r().  The result for each entry is set in its \c retval:
+ * 0 when found, 1 when not found and 2 when of a different type.
+ *
+ * The JSON is parsed once for all queries.  Pointers are resolved one
+ * path element at a time, re-using the values resolved for the leading
+ * elements shared with the previous query.  Ordering queries so that
+ * pointers with common prefixes are adjacent, e.g. sorted, avoids
+ * repeated searches of the same objects.
+ *
+ * The \a parsestate parameter is used as for mseh_get_ptr_r().
+ *
+ * @param[in] msr Parsed miniSEED record to search
+ * @param[in,out] queries Array of values to search for
+ * @param[in] count Number of entries in \a queries
+ * @param[in] parsestate Parsed state for multiple operations, can be NULL
+ *
+ * @returns The number of values found on success, otherwise a
+ * (negative) libmseed error code.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mseh_get_ptr_r()
+ * \sa mseh_free_parsestate()
+ ***************************************************************************/
+int
+mseh_get_ptrs_r (const MS3Record *msr, MSEHQuery *queries, int count,
+                 LM_PARSED_JSON **parsestate)
+{
+  /* Maximum number of path elements retained from the previous query */
+#define MAXDEPTH 16
+  struct
+  {
+    size_t end;      /* Offset in pointer following the element */
+    yyjson_val *val; /* Value resolved by the pointer up to end */
+  } level[MAXDEPTH];
+  int levels = 0;
+
+  const char *prevptr = NULL;
+  const char *ptr;
+  yyjson_val *extravalue;
+  size_t length;
+  size_t common;
+  size_t start;
+  size_t end;
+  int found = 0;
+  int keep;
+  int idx;
+
+  if (!msr || (!queries && count > 0))
   {
-    if (value)
-      *((int64_t *)value) = unsafe_yyjson_get_int (extravalue);
+    ms_log (2, "%s() Required input not defined: 'msr' or 'queries'\n", __func__);
+    return MS_GENERROR;
   }
-  else if (type == 's' && yyjson_is_str (extravalue))
+
+  for (idx = 0; idx < count; idx++)
   {
-    if (value)
+    /* Detect invalid JSON Pointer, i.e. with no root '/' designation */
+    if (!queries[idx].ptr || queries[idx].ptr[0] != '/')
     {
-      stringvalue = unsafe_yyjson_get_str (extravalue);
-      strncpy ((char *)value, stringvalue, maxlength - 1);
-      ((char *)value)[maxlength - 1] = '\0';
+      ms_log (2, "%s() Unsupported ptr notation: %s\n", __func__,
+              (queries[idx].ptr) ? queries[idx].ptr : "NULL");
+      return MS_GENERROR;
     }
+
+    queries[idx].retval = 1;
   }
-  else if (type == 'b' && yyjson_is_bool(extravalue))
+
+  /* Nothing can be found in no headers, otherwise parse once and search */
+  if (!msr->extralength || count <= 0)
   {
-    if (value)
-      *((int *)value) = (unsafe_yyjson_get_bool (extravalue)) ? 1 : 0;
+    return 0;
   }
-  /* Return wrong type indicator if a value was requested */
-  else if (value)
+  else
   {
-    retval = 2;
-  }
+    LM_PARSED_JSON *parsed = NULL;
 
-  /* Free parse state if not being retained */
-  if (parsestate == NULL)
-  {
-    mseh_free_parsestate (&parsed);
+    /* Use a local parse state for all queries if none is supplied */
+    if (parsestate == NULL)
+      parsestate = &parsed;
+
+    /* Parse or update the state, e.g. after changes, with a search for the first value */
+    if (mseh_get_ptr_r (msr, queries[0].ptr, NULL, 0, 0, parsestate) < 0)
+    {
+      if (parsestate == &parsed)
+        mseh_free_parsestate (&parsed);
+      return MS_GENERROR;
+    }
+
+    for (idx = 0; idx < count; idx++)
+    {
+      ptr = queries[idx].ptr;
+      length = strlen (ptr);
+
+      /* Determine the length of the prefix shared with the previous pointer */
+      common = 0;
+      if (prevptr)
+        while (ptr[common] && ptr[common] == prevptr[common])
+          common++;
+
+      /* Keep resolved elements of the previous pointer that are complete elements of this pointer */
+      for (keep = 0; keep < levels; keep++)
+        if (level[keep].end > common ||
+            (ptr[level[keep].end] != '/' && ptr[level[keep].end] != '\0'))
+          break;
+
+      levels = keep;
+      extravalue = (levels) ? level[levels - 1].val : yyjson_doc_get_root ((*parsestate)->doc);
+      start = (levels) ? level[levels - 1].end : 0;
+
+      /* Resolve the remaining elements one at a time */
+      while (extravalue && start < length)
+      {
+        for (end = start + 1; ptr[end] && ptr[end] != '/'; end++)
+          ;
+
+        extravalue = yyjson_ptr_getn (extravalue, ptr + start, end - start);
+
+        if (extravalue && levels < MAXDEPTH)
+        {
+          level[levels].end = end;
+          level[levels].val = extravalue;
+          levels++;
+        }
+
+        start = end;
+      }
+
+      queries[idx].retval = get_value (extravalue, queries[idx].value,
+                                       queries[idx].type, queries[idx].maxlength);
+
+      if (queries[idx].retval == 0)
+        found++;
+
+      prevptr = ptr;
+    }
+
+    /* Free parse state if not being retained */
+    if (parsestate == &parsed)
+    {
+      mseh_free_parsestate (&parsed);
+    }
   }
+#undef MAXDEPTH
 
-  return retval;
-} /* End of mseh_get_ptr_r() */
+  return found;
+} /* End of mseh_get_ptrs_r() */
 
 /**********************************************************************/ /**
  * @brief Set the value of extra header values
@@ -1116,6 +1283,8 @@ mseh_replace (MS3Record *msr, char *jsonstring)
     /* Serialize new JSON string */
     serialized = yyjson_write_opts (doc, write_flg, &alc, &serialsize, &write_err);
 
+    yyjson_doc_free (doc);
+
     if (serialized == NULL)
     {
       ms_log (2, "%s() Cannot write extra header JSON: %s\n",
@@ -27,7 +27,10 @@
 #include <time.h>
 
 #include "libmseed.h"
+#include "mseedformat.h"
 #include "msio.h"
+#include "selection.h"
+#include "unpack.h"
 
 /* Skip length in bytes when skipping non-data */
 #define SKIPLEN 1
@@ -35,10 +38,17 @@
 /* Initialize the global file reading parameters */
 MS3FileParam gMS3FileParam = MS3FileParam_INITIALIZER;
 
+/* Read size when unselected records may be skipped by seeking */
+#define SEEKREADSIZE 65536
+
 /* Stream state flags */
 #define MSFP_RANGEAPPLIED 0x0001  //!< Byte ranging has been applied
+#define MSFP_SKIPPED      0x0002  //!< Records have been skipped by selection
+#define MSFP_NOSEEK       0x0004  //!< Seeking failed, stream is not seekable
 
 static char *parse_pathname_range (const char *string, int64_t *start, int64_t *end);
+static int header_sid (const char *record, uint64_t recbuflen, uint8_t formatversion,
+                       char *sid, int sidlen, uint8_t *pubversion);
 
 /*****************************************************************/ /**
  * @brief Run-time test for URL support in libmseed.
@@ -55,6 +65,36 @@ libmseed_url_support (void)
 #endif
 } /* End of libmseed_url_support() */
 
+/*****************************************************************/ /**
+ * @brief Run-time test for gzip support in libmseed.
+ *
+ * @returns 0 when no gzip suported is included, non-zero otherwise.
+ *********************************************************************/
+int
+libmseed_gzip_support (void)
+{
+#if defined(LIBMSEED_ZLIB)
+  return 1;
+#else
+  return 0;
+#endif
+} /* End of libmseed_gzip_support() */
+
+/*****************************************************************/ /**
+ * @brief Run-time test for zstd support in libmseed.
+ *
+ * @returns 0 when no zstd suported is included, non-zero otherwise.
+ *********************************************************************/
+int
+libmseed_zstd_support (void)
+{
+#if defined(LIBMSEED_ZSTD)
+  return 1;
+#else
+  return 0;
+#endif
+} /* End of libmseed_zstd_support() */
+
 /*****************************************************************/ /**
  * @brief Initialize ::MS3FileParam parameters for a file descriptor
  *
@@ -221,7 +261,16 @@ ms3_shift_msfp (MS3FileParam *msfp, int shift)
  *
  * If \a selections is not NULL, the ::MS3Selections will be used to
  * limit what is returned to the caller.  Any data not matching the
- * selections will be skipped.
+ * selections will be skipped.  The selections are compiled for fast
+ * matching on first use and retained in the ::MS3FileParam until
+ * different selections are supplied or the stream is closed, the
+ * selections must not be modified while reading a stream.
+ *
+ * When reading a local file with selections, records with a source
+ * identifier and publication version that cannot match any selection
+ * are identified from the fixed header and skipped by seeking past
+ * them, without reading the remainder of the record.  Reading a stream
+ * where all records are skipped is not an error.
  *
  * After reading all the records in a stream the calling program should
  * call this routine a final time with \a mspath set to NULL.  This
@@ -260,6 +309,11 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
   MS3FileParam *msfp;
   uint32_t pflags = flags;
   char *pathname_range = NULL;
+  char sid[LM_SIDLEN];
+  uint8_t pubversion;
+  uint8_t formatversion;
+  int64_t reclen;
+  int seekskip = 0;
 
   int parseval  = 0;
   int readsize  = 0;
@@ -302,6 +356,9 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
     if (msfp->readbuffer != NULL)
       libmseed_memory.free (msfp->readbuffer);
 
+    if (msfp->selectmatcher != NULL)
+      lm_selectmatcher_free ((LMSelectMatcher *)msfp->selectmatcher);
+
     /* If the parameters are the global parameters reset them */
     if (*ppmsfp == &gMS3FileParam)
     {
@@ -374,6 +431,23 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
   if ((flags & MSF_UNPACKDATA) && selections)
     pflags &= ~(MSF_UNPACKDATA);
 
+  /* Compile selections for matching, replacing those compiled for different selections */
+  if (selections && (!msfp->selectmatcher ||
+                     lm_selectmatcher_selections ((LMSelectMatcher *)msfp->selectmatcher) != selections))
+  {
+    lm_selectmatcher_free ((LMSelectMatcher *)msfp->selectmatcher);
+
+    if ((msfp->selectmatcher = lm_selectmatcher_compile (selections)) == NULL)
+    {
+      msr3_free (ppmsr);
+      return MS_GENERROR;
+    }
+  }
+
+  /* Skip unselected records by seeking in local files */
+  if (selections && msfp->input.type == LMIO_FILE && !(msfp->flags & MSFP_NOSEEK))
+    seekskip = 1;
+
   /* Read data and search for records until input stream ends or end offset is reached */
   for (;;)
   {
@@ -400,9 +474,12 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
         ms3_shift_msfp (msfp, msfp->readoffset);
       }
 
-      /* Determine read size */
+      /* Determine read size, limiting read ahead when records may be skipped */
       readsize = (MAXRECLEN - msfp->readlength);
 
+      if (seekskip && readsize > SEEKREADSIZE)
+        readsize = (parseval > SEEKREADSIZE) ? parseval : SEEKREADSIZE;
+
       /* Read data into record buffer */
       readcount = (int)msio_fread (&msfp->input, msfp->readbuffer + msfp->readlength, readsize);
 
@@ -417,6 +494,47 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
       msfp->readlength += readcount;
     }
 
+    /* Skip records with a source ID and version that cannot be selected */
+    if (seekskip && MSFPBUFLEN (msfp) >= MINRECLEN &&
+        (reclen = ms3_detect (MSFPREADPTR (msfp), MSFPBUFLEN (msfp), &formatversion)) >= MINRECLEN &&
+        reclen <= MAXRECLEN &&
+        !header_sid (MSFPREADPTR (msfp), MSFPBUFLEN (msfp), formatversion, sid, sizeof (sid), &pubversion) &&
+        !lm_selectmatcher_match ((LMSelectMatcher *)msfp->selectmatcher, sid, NSTUNSET, NSTUNSET,
+                                 pubversion, NULL))
+    {
+      /* Seek past records not entirely in the buffer */
+      if (reclen > MSFPBUFLEN (msfp))
+      {
+        if (lmp_fseek64 ((FILE *)msfp->input.handle, msfp->streampos + reclen, SEEK_SET))
+        {
+          if (verbose > 1)
+            ms_log (0, "Cannot seek in %s, reading all records\n", msfp->path);
+
+          msfp->flags |= MSFP_NOSEEK;
+          seekskip = 0;
+          continue;
+        }
+
+        msfp->readlength = 0;
+        msfp->readoffset = 0;
+      }
+      else
+      {
+        msfp->readoffset += (int)reclen;
+      }
+
+      if (verbose > 1)
+      {
+        ms_log (0, "Skipping (selection) record for %s (%" PRId64 " bytes) starting at offset %" PRId64 "\n",
+                sid, reclen, msfp->streampos);
+      }
+
+      msfp->streampos += reclen;
+      msfp->flags |= MSFP_SKIPPED;
+      parseval = 0;
+      continue;
+    }
+
     /* Attempt to parse record from buffer */
     if (MSFPBUFLEN (msfp) >= MINRECLEN)
     {
@@ -431,8 +549,8 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
       {
         /* Test against selections if supplied */
         if (selections &&
-            !ms3_matchselect (selections, (*ppmsr)->sid, (*ppmsr)->starttime,
-                              msr3_endtime (*ppmsr), (*ppmsr)->pubversion, NULL))
+            !lm_selectmatcher_match ((LMSelectMatcher *)msfp->selectmatcher, (*ppmsr)->sid, (*ppmsr)->starttime,
+                                     msr3_endtime (*ppmsr), (*ppmsr)->pubversion, NULL))
         {
           if (verbose > 1)
           {
@@ -443,6 +561,7 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
           /* Skip record length bytes, update reading offset and file position */
           msfp->readoffset += (*ppmsr)->reclen;
           msfp->streampos += (*ppmsr)->reclen;
+          msfp->flags |= MSFP_SKIPPED;
         }
         else
         {
@@ -545,7 +664,7 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
     /* Finished when at end-of-stream and buffer contains less than MINRECLEN */
     if (msio_feof (&msfp->input) && MSFPBUFLEN (msfp) < MINRECLEN)
     {
-      if (msfp->recordcount == 0)
+      if (msfp->recordcount == 0 && !(msfp->flags & MSFP_SKIPPED))
       {
         ms_log (2, "%s: No data records read, not SEED?\n", msfp->path);
         retcode = MS_NOTSEED;
@@ -655,6 +774,9 @@ ms3_readtracelist_timewin (MS3TraceList **ppmstl, const char *mspath,
  * If the ::MSF_RECORDLIST flag is set in \a flags, a ::MS3RecordList
  * will be built for each ::MS3TraceSeg.  The ::MS3RecordPtr entries
  * contain the location of the data record, bit flags, extra headers, etc.
+ * Record lists are not supported for gzip or zstd compressed files, as
+ * the records cannot be read from the file at their (uncompressed)
+ * offsets, an error is returned for such files.
  *
  * @param[out] ppmstl Pointer-to-pointer to a ::MS3TraceList to populate
  * @param[in] mspath File to read
@@ -707,6 +829,15 @@ ms3_readtracelist_selection (MS3TraceList **ppmstl, const char *mspath,
   while ((retcode = ms3_readmsr_selection (&msfp, &msr, mspath,
                                            flags, selections, verbose)) == MS_NOERROR)
   {
+    /* Records in compressed files cannot be read at their offsets */
+    if ((flags & MSF_RECORDLIST) &&
+        (msfp->input.type == LMIO_GZIP || msfp->input.type == LMIO_ZSTD))
+    {
+      ms_log (2, "%s: Record lists are not supported for compressed files\n", mspath);
+      retcode = MS_GENERROR;
+      break;
+    }
+
     seg = mstl3_addmsr_recordptr (*ppmstl, msr, (flags & MSF_RECORDLIST) ? &recordptr : NULL,
                                   splitversion, 1, flags, tolerance);
 
@@ -835,6 +966,45 @@ ms3_url_addheader (const char *header)
 #endif
 } /* End of ms3_url_addheader() */
 
+/*****************************************************************/ /**
+ * @brief Read URLs using parallel HTTP range requests.
+ *
+ * Sets the global number of concurrent connections and the size of
+ * each range request used to read URL-based resources.  The length
+ * of a resource is determined with a HEAD request, ranges of \a
+ * chunksize bytes are then requested concurrently over up to \a
+ * connections connections and returned to the reader in order.
+ *
+ * Resources are read with a single request when \a connections is
+ * less than 2, the server does not report \c Accept-Ranges: \c bytes
+ * or a content length, or the resource (or requested range) is not
+ * larger than \a chunksize.
+ *
+ * Memory use per open URL is \a connections times \a chunksize.
+ *
+ * An error will be returned when the library was not compiled with
+ * URL support.
+ *
+ * @param[in] connections Maximum concurrent range requests, 0 or 1 to disable
+ * @param[in] chunksize Size of each range request in bytes, 0 for default of 4 MiB
+ *
+ * @returns 0 on succes and a negative library error code on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+ms3_url_parallel (int connections, uint64_t chunksize)
+{
+#if !defined(LIBMSEED_URL)
+  (void)connections; /* Unused */
+  (void)chunksize; /* Unused */
+  ms_log (2, "URL support not included in library\n");
+  return -1;
+#else
+  return msio_url_parallel (connections, chunksize);
+#endif
+} /* End of ms3_url_parallel() */
+
 /*****************************************************************/ /**
  * @brief Free all set headers for URL-based requests.
  *
@@ -854,6 +1024,103 @@ ms3_url_freeheaders (void)
 #endif
 } /* End of ms3_url_freeheaders() */
 
+/*****************************************************************/ /**
+ * @brief Set the number of threads used to decompress BGZF files.
+ *
+ * Files compressed in BGZF format are made of independent blocks of
+ * up to 64 KiB, batches of these blocks are decompressed concurrently
+ * using up to \a nthreads threads.  General gzip files are always
+ * decompressed in a single thread.  The default is a single thread.
+ *
+ * Memory use per open BGZF file is about 1 MiB per thread.
+ *
+ * An error will be returned when the library was not compiled with
+ * gzip support.
+ *
+ * @param[in] nthreads Number of decompression threads, 0 for all processors
+ *
+ * @returns 0 on succes and a negative library error code on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+ms3_gzip_threads (int nthreads)
+{
+#if !defined(LIBMSEED_ZLIB)
+  (void)nthreads; /* Unused */
+  ms_log (2, "gzip support not included in library\n");
+  return -1;
+#else
+  return msio_gzip_threads (nthreads);
+#endif
+} /* End of ms3_gzip_threads() */
+
+/*****************************************************************/ /**
+ * @brief Write the block index of a BGZF file.
+ *
+ * Write the offsets of all blocks in a BGZF compressed file that has
+ * been read to the end with ms3_readmsr_r() or similar, and not yet
+ * closed, to \a indexpath.  The file must have been read from the
+ * beginning.
+ *
+ * The index format is compatible with the \c .gzi files written by
+ * \c bgzip.  When a file is opened for reading at an offset, e.g. \c
+ * path@offset, an index at \c path.gzi is used to start decompression
+ * at the block containing the offset instead of the file beginning.
+ *
+ * @param[in] msfp ::MS3FileParam of a BGZF file read to the end
+ * @param[in] indexpath File to write the index to
+ *
+ * @returns 0 on succes and a negative library error code on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+ms3_gzip_writeindex (MS3FileParam *msfp, const char *indexpath)
+{
+  if (!msfp || !indexpath)
+  {
+    ms_log (2, "%s(): Required input not defined: 'msfp' or 'indexpath'\n", __func__);
+    return -1;
+  }
+
+  return msio_gzip_writeindex (&msfp->input, indexpath);
+} /* End of ms3_gzip_writeindex() */
+
+/*****************************************************************/ /**
+ * @brief Set the number of threads used to decompress seekable zstd files.
+ *
+ * Files in the zstd seekable format are made of independent frames
+ * listed in a seek table at the end of the file, batches of these
+ * frames are decompressed concurrently using up to \a nthreads
+ * threads.  Other zstd files, and seekable files with frames larger
+ * than 64 MiB, are decompressed in a single thread.  The default is a
+ * single thread.
+ *
+ * Memory use per open seekable zstd file is about 2 MiB per thread,
+ * or twice the largest frame size if larger.
+ *
+ * An error will be returned when the library was not compiled with
+ * zstd support.
+ *
+ * @param[in] nthreads Number of decompression threads, 0 for all processors
+ *
+ * @returns 0 on succes and a negative library error code on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+ms3_zstd_threads (int nthreads)
+{
+#if !defined(LIBMSEED_ZSTD)
+  (void)nthreads; /* Unused */
+  ms_log (2, "zstd support not included in library\n");
+  return -1;
+#else
+  return msio_zstd_threads (nthreads);
+#endif
+} /* End of ms3_zstd_threads() */
+
 
 /***************************************************************************
  *
@@ -997,6 +1264,60 @@ mstl3_writemseed (MS3TraceList *mstl, const char *mspath, int8_t overwrite,
 } /* End of mstl3_writemseed() */
 
 
+/***************************************************************************
+ * header_sid:
+ *
+ * Determine the source identifier and publication version of a record
+ * from the fixed section of the header, which must be in the buffer.
+ *
+ * Returns 0 on success and -1 if they cannot be determined.
+ ***************************************************************************/
+static int
+header_sid (const char *record, uint64_t recbuflen, uint8_t formatversion,
+            char *sid, int sidlen, uint8_t *pubversion)
+{
+  uint8_t sidlength;
+
+  if (formatversion == 3)
+  {
+    if (recbuflen < MS3FSDH_LENGTH)
+      return -1;
+
+    sidlength = *pMS3FSDH_SIDLENGTH (record);
+
+    if (sidlength >= sidlen || recbuflen < (uint64_t)MS3FSDH_LENGTH + sidlength)
+      return -1;
+
+    memcpy (sid, pMS3FSDH_SID (record), sidlength);
+    sid[sidlength] = '\0';
+
+    *pubversion = *pMS3FSDH_PUBVERSION (record);
+
+    return 0;
+  }
+  else if (formatversion == 2)
+  {
+    if (recbuflen < MS2FSDH_LENGTH || !ms2_recordsid (record, sid, sidlen))
+      return -1;
+
+    /* Map data quality indicator to publication version, as msr3_unpack_mseed2() */
+    if (*pMS2FSDH_DATAQUALITY (record) == 'M')
+      *pubversion = 4;
+    else if (*pMS2FSDH_DATAQUALITY (record) == 'Q')
+      *pubversion = 3;
+    else if (*pMS2FSDH_DATAQUALITY (record) == 'D')
+      *pubversion = 2;
+    else if (*pMS2FSDH_DATAQUALITY (record) == 'R')
+      *pubversion = 1;
+    else
+      *pubversion = 0;
+
+    return 0;
+  }
+
+  return -1;
+} /* End of header_sid() */
+
 /*****************************************************************/ /**
  * Parse a range from the end of a string.
  *
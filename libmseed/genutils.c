@@ -29,6 +29,10 @@
 
 static nstime_t ms_time2nstime_int (int year, int day, int hour,
                                     int min, int sec, uint32_t nsec);
+static int isotimestr2nstime (const char *timestr, nstime_t *nstime);
+static int nstime2calendar (int64_t isec, struct tm *tms);
+static char *datetime2timestr (const struct tm *tms, int nanosec, int subdigits,
+                               char *timestr, ms_timeformat_t timeformat);
 
 /** @cond UNDOCUMENTED */
 
@@ -120,6 +124,31 @@ static const int monthdays_leap[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30,
 /* Check that a year is in a valid range */
 #define VALIDYEAR(year) (year >= 1678 && year <= 2262)
 
+/* Thread-local storage for calendar conversion cache, see logging.c */
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  #define lm_thread_local __declspec( thread )
+#elif __STDC_VERSION__ >= 201112L
+  #define lm_thread_local _Thread_local
+#else
+  #define lm_thread_local __thread
+#endif
+#else
+  #define lm_thread_local
+#endif
+
+/* Cache of day number (days since 1970-01-01) to calendar date, direct-mapped by day */
+#define CALENDARCACHESIZE 64
+static lm_thread_local struct
+{
+  int64_t day;
+  int16_t year;
+  int16_t yday;
+  int8_t month;
+  int8_t mday;
+  int8_t valid;
+} calendarcache[CALENDARCACHESIZE];
+
 /* Check that a month is in a valid range */
 #define VALIDMONTH(month) (month >= 1 && month <= 12)
 
@@ -959,6 +988,34 @@ ms_nstime2timestr (nstime_t nstime, char *timestr,
   microsec = nanosec / 1000;
   submicro = nanosec - (microsec * 1000);
 
+  /* Format date-time strings without the generic conversion and snprintf() when possible */
+  if (timeformat == ISOMONTHDAY || timeformat == ISOMONTHDAY_Z ||
+      timeformat == ISOMONTHDAY_DOY || timeformat == ISOMONTHDAY_DOY_Z ||
+      timeformat == ISOMONTHDAY_SPACE || timeformat == ISOMONTHDAY_SPACE_Z ||
+      timeformat == SEEDORDINAL)
+  {
+    int subdigits = -1;
+
+    if (subseconds == NONE ||
+        (subseconds == MICRO_NONE && microsec == 0) ||
+        (subseconds == NANO_NONE && nanosec == 0) ||
+        (subseconds == NANO_MICRO_NONE && nanosec == 0))
+      subdigits = 0;
+    else if (subseconds == MICRO ||
+             (subseconds == MICRO_NONE && microsec) ||
+             (subseconds == NANO_MICRO && submicro == 0) ||
+             (subseconds == NANO_MICRO_NONE && submicro == 0))
+      subdigits = 6;
+    else if (subseconds == NANO ||
+             (subseconds == NANO_NONE && nanosec) ||
+             (subseconds == NANO_MICRO && submicro) ||
+             (subseconds == NANO_MICRO_NONE && submicro))
+      subdigits = 9;
+
+    if (subdigits >= 0 && !nstime2calendar (isec, &tms))
+      return datetime2timestr (&tms, nanosec, subdigits, timestr, timeformat);
+  }
+
   /* Calculate date-time parts if needed by format */
   if (timeformat == ISOMONTHDAY || timeformat == ISOMONTHDAY_Z ||
       timeformat == ISOMONTHDAY_DOY || timeformat == ISOMONTHDAY_DOY_Z ||
@@ -1123,6 +1180,174 @@ ms_nstime2timestr (nstime_t nstime, char *timestr,
   return timestr;
 } /* End of ms_nstime2timestr() */
 
+/***************************************************************************
+ * INTERNAL Convert epoch seconds to date-time components.
+ *
+ * Day numbers are converted to calendar dates with integer arithmetic
+ * (days since the epoch to proleptic Gregorian civil date) and cached
+ * per thread by day, as sequential conversions are usually for the
+ * same or a few days.
+ *
+ * Only the tm_year, tm_mon, tm_mday, tm_yday, tm_hour, tm_min and
+ * tm_sec fields are set.
+ *
+ * Returns 0 on success and -1 when the year is outside of 1000-9999,
+ * for which the caller must use the general conversion.
+ ***************************************************************************/
+static int
+nstime2calendar (int64_t isec, struct tm *tms)
+{
+  int64_t day;
+  int64_t secofday;
+  int64_t era;
+  int64_t yoe;
+  int64_t doe;
+  int64_t doy;
+  int64_t mp;
+  int64_t year;
+  int month;
+  int idx;
+
+  /* Years 1000 through 9999, in days relative to the epoch */
+  if (isec < -30610224000LL || isec >= 253402300800LL)
+    return -1;
+
+  day = isec / 86400;
+  secofday = isec - day * 86400;
+
+  if (secofday < 0)
+  {
+    day -= 1;
+    secofday += 86400;
+  }
+
+  idx = (int)(day & (CALENDARCACHESIZE - 1));
+
+  if (!calendarcache[idx].valid || calendarcache[idx].day != day)
+  {
+    /* Civil date from days, with years starting on March 1 */
+    doe = day + 719468;
+    era = (doe >= 0 ? doe : doe - 146096) / 146097;
+    doe = doe - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    year = yoe + era * 400;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    month = (int)(mp < 10 ? mp + 3 : mp - 9);
+
+    if (month <= 2)
+      year += 1;
+
+    calendarcache[idx].day = day;
+    calendarcache[idx].year = (int16_t)year;
+    calendarcache[idx].month = (int8_t)month;
+    calendarcache[idx].mday = (int8_t)(doy - (153 * mp + 2) / 5 + 1);
+
+    /* Day of year from January 1 */
+    if (month <= 2)
+      calendarcache[idx].yday = (int16_t)(doy - 306 + 1);
+    else
+      calendarcache[idx].yday = (int16_t)(doy + 59 + (LEAPYEAR (year) ? 1 : 0) + 1);
+
+    calendarcache[idx].valid = 1;
+  }
+
+  tms->tm_year = calendarcache[idx].year - 1900;
+  tms->tm_mon = calendarcache[idx].month - 1;
+  tms->tm_mday = calendarcache[idx].mday;
+  tms->tm_yday = calendarcache[idx].yday - 1;
+  tms->tm_hour = (int)(secofday / 3600);
+  tms->tm_min = (int)((secofday / 60) % 60);
+  tms->tm_sec = (int)(secofday % 60);
+
+  return 0;
+} /* End of nstime2calendar() */
+
+/***************************************************************************
+ * INTERNAL Write zero-padded decimal digits of a non-negative value.
+ *
+ * Returns a pointer to the character following the digits.
+ ***************************************************************************/
+static inline char *
+putdigits (char *cp, int value, int digits)
+{
+  char *end = cp + digits;
+
+  while (digits-- > 0)
+  {
+    cp[digits] = (char)('0' + value % 10);
+    value /= 10;
+  }
+
+  return end;
+}
+
+/***************************************************************************
+ * INTERNAL Format date-time components as a time string.
+ *
+ * Produces the same output as the snprintf() formatting in
+ * ms_nstime2timestr() for years 1000-9999, with \a subdigits of 0
+ * (none), 6 (microseconds) or 9 (nanoseconds).
+ *
+ * Returns \a timestr.
+ ***************************************************************************/
+static char *
+datetime2timestr (const struct tm *tms, int nanosec, int subdigits,
+                  char *timestr, ms_timeformat_t timeformat)
+{
+  char *cp = timestr;
+
+  cp = putdigits (cp, tms->tm_year + 1900, 4);
+
+  if (timeformat == SEEDORDINAL)
+  {
+    *cp++ = ',';
+    cp = putdigits (cp, tms->tm_yday + 1, 3);
+    *cp++ = ',';
+  }
+  else
+  {
+    *cp++ = '-';
+    cp = putdigits (cp, tms->tm_mon + 1, 2);
+    *cp++ = '-';
+    cp = putdigits (cp, tms->tm_mday, 2);
+    *cp++ = (timeformat == ISOMONTHDAY_SPACE || timeformat == ISOMONTHDAY_SPACE_Z) ? ' ' : 'T';
+  }
+
+  cp = putdigits (cp, tms->tm_hour, 2);
+  *cp++ = ':';
+  cp = putdigits (cp, tms->tm_min, 2);
+  *cp++ = ':';
+  cp = putdigits (cp, tms->tm_sec, 2);
+
+  if (subdigits == 6)
+  {
+    *cp++ = '.';
+    cp = putdigits (cp, nanosec / 1000, 6);
+  }
+  else if (subdigits == 9)
+  {
+    *cp++ = '.';
+    cp = putdigits (cp, nanosec, 9);
+  }
+
+  if (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_DOY_Z ||
+      timeformat == ISOMONTHDAY_SPACE_Z)
+    *cp++ = 'Z';
+
+  if (timeformat == ISOMONTHDAY_DOY || timeformat == ISOMONTHDAY_DOY_Z)
+  {
+    *cp++ = ' ';
+    *cp++ = '(';
+    cp = putdigits (cp, tms->tm_yday + 1, 3);
+    *cp++ = ')';
+  }
+
+  *cp = '\0';
+
+  return timestr;
+} /* End of datetime2timestr() */
+
 /**********************************************************************/ /**
  * @brief Convert an ::nstime_t to a time string with 'Z' suffix
  *
@@ -1296,6 +1521,10 @@ ms_timestr2nstime (const char *timestr)
     return NSTERROR;
   }
 
+  /* Fast path for canonical "YYYY-MM-DDTHH:MM:SS[.FFFFFFFFF][Z]" strings */
+  if (!isotimestr2nstime (timestr, &nstime))
+    return nstime;
+
   /* Determine first delimiter,
    * delimiter count before date-time separator,
    * number-like character count,
@@ -1406,6 +1635,106 @@ ms_timestr2nstime (const char *timestr)
 } /* End of ms_timestr2nstime() */
 
 
+/***************************************************************************
+ * INTERNAL Convert a canonical ISO month-day time string to nstime_t.
+ *
+ * Only strings in the layout "YYYY-MM-DDTHH:MM:SS[.FFFFFFFFF][Z]", with
+ * 'T' or space separating date and time, 1 to 9 fractional digits and
+ * values in range are converted.  The digits are validated 8 bytes at
+ * a time and converted from fixed positions.
+ *
+ * The result is identical to ms_mdtimestr2nstime() for such strings.
+ *
+ * Returns 0 on success and -1 if the string is not in the canonical
+ * layout, in which case the general parser should be used.  No
+ * messages are logged.
+ ***************************************************************************/
+static int
+isotimestr2nstime (const char *timestr, nstime_t *nstime)
+{
+  char digits[24];
+  uint64_t word;
+  uint32_t nsec = 0;
+  int year, mon, mday, yday;
+  int hour, min, sec;
+  int length;
+  int idx;
+
+  /* Require the fixed portion and check the delimiters */
+  for (length = 0; length < 19; length++)
+    if (timestr[length] == '\0')
+      return -1;
+
+  if (timestr[4] != '-' || timestr[7] != '-' ||
+      (timestr[10] != 'T' && timestr[10] != ' ') ||
+      timestr[13] != ':' || timestr[16] != ':')
+    return -1;
+
+  /* Copy with delimiters and padding replaced by '0' to validate all digits together */
+  memcpy (digits, timestr, 19);
+  memset (digits + 19, '0', sizeof (digits) - 19);
+  digits[4] = digits[7] = digits[10] = digits[13] = digits[16] = '0';
+
+  for (idx = 0; idx < (int)sizeof (digits); idx += 8)
+  {
+    memcpy (&word, digits + idx, 8);
+
+    /* Each byte must be 0x30-0x39: high nibble 3, and still 3 after adding 6 */
+    if ((word & 0xF0F0F0F0F0F0F0F0ULL) != 0x3030303030303030ULL ||
+        ((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) != 0x3030303030303030ULL)
+      return -1;
+  }
+
+  /* Optional fractional seconds of 1 to 9 digits */
+  length = 19;
+  if (timestr[length] == '.')
+  {
+    for (idx = 0, length++; timestr[length] >= '0' && timestr[length] <= '9'; idx++, length++)
+    {
+      if (idx >= 9)
+        return -1;
+
+      nsec = nsec * 10 + (uint32_t)(timestr[length] - '0');
+    }
+
+    if (idx == 0)
+      return -1;
+
+    for (; idx < 9; idx++)
+      nsec *= 10;
+  }
+
+  /* Optional 'Z' designator, then the end */
+  if (timestr[length] == 'Z' || timestr[length] == 'z')
+    length++;
+
+  if (timestr[length] != '\0')
+    return -1;
+
+#define DIGIT(I) (digits[I] - '0')
+  year = DIGIT (0) * 1000 + DIGIT (1) * 100 + DIGIT (2) * 10 + DIGIT (3);
+  mon  = DIGIT (5) * 10 + DIGIT (6);
+  mday = DIGIT (8) * 10 + DIGIT (9);
+  hour = DIGIT (11) * 10 + DIGIT (12);
+  min  = DIGIT (14) * 10 + DIGIT (15);
+  sec  = DIGIT (17) * 10 + DIGIT (18);
+#undef DIGIT
+
+  /* Leave out of range values to the general parser for reporting */
+  if (!VALIDYEAR (year) || !VALIDMONTH (mon) || mday < 1 ||
+      !VALIDMONTHDAY (year, mon, mday) || !VALIDHOUR (hour) ||
+      !VALIDMIN (min) || !VALIDSEC (sec))
+    return -1;
+
+  yday = mday;
+  for (idx = 0; idx < mon - 1; idx++)
+    yday += (LEAPYEAR (year)) ? monthdays_leap[idx] : monthdays[idx];
+
+  *nstime = ms_time2nstime_int (year, yday, hour, min, sec, nsec);
+
+  return 0;
+} /* End of isotimestr2nstime() */
+
 /**********************************************************************/ /**
  * @brief Convert a time string (year-month-day) to a high precision
  * epoch time.
@@ -394,6 +394,17 @@ extern int msr3_pack_header3 (const MS3Record *msr, char *record, uint32_t recbu
 
 extern int msr3_pack_header2 (const MS3Record *msr, char *record, uint32_t recbuflen, int8_t verbose);
 
+/** @brief Opaque streaming packer for continuous data, see msr3_streampack_init() */
+typedef struct MS3StreamPacker_s MS3StreamPacker;
+
+extern MS3StreamPacker *msr3_streampack_init (const MS3Record *msr,
+                                              void (*record_handler) (char *, int, void *),
+                                              void *handlerdata, int8_t verbose);
+extern int64_t msr3_streampack_add (MS3StreamPacker *packer, nstime_t starttime,
+                                    const void *samples, uint32_t count);
+extern int64_t msr3_streampack_flush (MS3StreamPacker *packer);
+extern void msr3_streampack_free (MS3StreamPacker **ppacker);
+
 extern int64_t msr3_unpack_data (MS3Record *msr, int8_t verbose);
 
 extern int msr3_data_bounds (const MS3Record *msr, uint32_t *dataoffset, uint32_t *datasize);
@@ -579,6 +590,7 @@ typedef struct MS3TraceList {
   uint32_t           numtraceids;    //!< Number of traces IDs in list
   struct MS3TraceID  traces;         //!< Head node of trace skip list, first entry at \a traces.next[0]
   uint64_t           prngstate;      //!< INTERNAL: State for Pseudo RNG
+  void              *pool;           //!< INTERNAL: Memory pool for entries, see mstl3_pool_enable()
 } MS3TraceList;
 
 /** @brief Callback functions that return time and sample rate tolerances
@@ -621,6 +633,7 @@ typedef struct MS3Tolerance
 
 extern MS3TraceList* mstl3_init (MS3TraceList *mstl);
 extern void          mstl3_free (MS3TraceList **ppmstl, int8_t freeprvtptr);
+extern int           mstl3_pool_enable (MS3TraceList *mstl, size_t slabsize);
 extern MS3TraceID*   mstl3_findID (MS3TraceList *mstl, const char *sid, uint8_t pubversion, MS3TraceID **prev);
 
 /** @def mstl3_addmsr
@@ -631,6 +644,8 @@ extern MS3TraceID*   mstl3_findID (MS3TraceList *mstl, const char *sid, uint8_t
 extern MS3TraceSeg*  mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **pprecptr,
                                              int8_t splitversion, int8_t autoheal, uint32_t flags,
                                              const MS3Tolerance *tolerance);
+extern int           mstl3_merge (MS3TraceList *dst, MS3TraceList *src, int8_t splitversion,
+                                  const MS3Tolerance *tolerance, uint32_t flags);
 extern int64_t       mstl3_readbuffer (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
                                        int8_t splitversion, uint32_t flags,
                                        const MS3Tolerance *tolerance, int8_t verbose);
@@ -638,13 +653,26 @@ extern int64_t       mstl3_readbuffer_selection (MS3TraceList **ppmstl, const ch
                                                  int8_t splitversion, uint32_t flags,
                                                  const MS3Tolerance *tolerance, const MS3Selections *selections,
                                                  int8_t verbose);
+extern int64_t       mstl3_readbuffer_parallel (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
+                                                int8_t splitversion, uint32_t flags,
+                                                const MS3Tolerance *tolerance, const MS3Selections *selections,
+                                                int nthreads, int8_t verbose);
 extern int64_t mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output,
                                         uint64_t outputsize, int8_t verbose);
+extern int64_t mstl3_unpack_recordlist_parallel (MS3TraceID *id, MS3TraceSeg *seg, void *output,
+                                                 uint64_t outputsize, int nthreads, int8_t verbose);
+extern int64_t mstl3_unpack_recordlist_coalesced (MS3TraceID *id, MS3TraceSeg *seg, void *output,
+                                                  uint64_t outputsize, uint64_t maxgap, int nthreads,
+                                                  int8_t verbose);
 extern int mstl3_convertsamples (MS3TraceSeg *seg, char type, int8_t truncate);
 extern int mstl3_resize_buffers (MS3TraceList *mstl);
 extern int64_t mstl3_pack (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
                            void *handlerdata, int reclen, int8_t encoding,
                            int64_t *packedsamples, uint32_t flags, int8_t verbose, char *extra);
+extern int64_t mstl3_pack_parallel (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
+                                    void *handlerdata, int reclen, int8_t encoding,
+                                    int64_t *packedsamples, uint32_t flags, int8_t verbose,
+                                    char *extra, int nthreads);
 extern void mstl3_printtracelist (const MS3TraceList *mstl, ms_timeformat_t timeformat,
                                   int8_t details, int8_t gaps, int8_t versions);
 extern void mstl3_printsynclist (const MS3TraceList *mstl, const char *dccid, ms_subseconds_t subseconds);
@@ -672,11 +700,33 @@ extern void mstl3_printgaplist (const MS3TraceList *mstl, ms_timeformat_t timefo
     - set the User-Agent header with @ref ms3_url_useragent()
     - set username and password for authentication with @ref ms3_url_userpassword()
     - set arbitrary headers with @ref ms3_url_addheader()
+    - read with parallel range requests with @ref ms3_url_parallel()
     - disable TLS/SSL peer and host verficiation by setting **LIBMSEED_SSL_NOVERIFY** environment variable
 
     Diagnostics: Setting environment variable **LIBMSEED_URL_DEBUG** enables
     detailed verbosity of URL protocol exchanges.
 
+    Reading gzip compressed files is supported by building the library
+    with the \b LIBMSEED_ZLIB variable defined, which requires zlib.
+    Compressed files are detected by content and decompressed
+    transparently, all stream positions and offsets refer to the
+    uncompressed data.  Files compressed in BGZF format (e.g. with \c
+    bgzip) are decompressed in parallel with @ref ms3_gzip_threads() and
+    can be read from an offset efficiently using a block index written
+    with @ref ms3_gzip_writeindex().  The function @ref
+    libmseed_gzip_support() can be used as a run-time test to determine
+    if gzip support is included in the library.
+
+    Reading zstd compressed files is supported by building the library
+    with the \b LIBMSEED_ZSTD variable defined, which requires the zstd
+    library.  Files in the zstd seekable format, which ends with a
+    table of frame sizes, are decompressed in parallel with @ref
+    ms3_zstd_threads() and read from an offset by starting at the frame
+    containing the offset.  Other zstd files are decompressed as a
+    single stream.  The function @ref libmseed_zstd_support() can be
+    used as a run-time test to determine if zstd support is included in
+    the library.
+
     \sa ms3_readmsr()
     \sa ms3_readmsr_selection()
     \sa ms3_readtracelist()
@@ -693,7 +743,10 @@ typedef struct LMIO
     LMIO_NULL = 0,   //!< IO handle type is undefined
     LMIO_FILE = 1,   //!< IO handle is FILE-type
     LMIO_URL  = 2,   //!< IO handle is URL-type
-    LMIO_FD   = 3    //!< IO handle is a provided file descriptor
+    LMIO_FD   = 3,   //!< IO handle is a provided file descriptor
+    LMIO_URLRANGES = 4, //!< IO handle is URL-type using parallel range requests
+    LMIO_GZIP = 5,     //!< IO handle is a gzip compressed file
+    LMIO_ZSTD = 6      //!< IO handle is a zstd compressed file
   } type;            //!< IO handle type
   void *handle;      //!< Primary IO handle, either file or URL
   void *handle2;     //!< Secondary IO handle for URL
@@ -727,6 +780,7 @@ typedef struct MS3FileParam
   int readoffset;      //!< INTERNAL: Read offset in read buffer
   uint32_t flags;      //!< INTERNAL: Stream reading state flags
   LMIO input;          //!< INTERNAL: IO handle, file or URL
+  void *selectmatcher; //!< INTERNAL: Compiled selections, allocated internally
 } MS3FileParam;
 
 /** @def MS3FileParam_INITIALIZER
@@ -735,7 +789,8 @@ typedef struct MS3FileParam
   {                                                               \
     .path = "", .startoffset = 0, .endoffset = 0, .streampos = 0, \
     .recordcount = 0, .readbuffer = NULL, .readlength = 0,        \
-    .readoffset = 0, .flags = 0, .input = LMIO_INITIALIZER        \
+    .readoffset = 0, .flags = 0, .input = LMIO_INITIALIZER,       \
+    .selectmatcher = NULL                                         \
   }
 
 extern int ms3_readmsr (MS3Record **ppmsr, const char *mspath, uint32_t flags, int8_t verbose);
@@ -753,12 +808,18 @@ extern int ms3_readtracelist_selection (MS3TraceList **ppmstl, const char *mspat
 extern int ms3_url_useragent (const char *program, const char *version);
 extern int ms3_url_userpassword (const char *userpassword);
 extern int ms3_url_addheader (const char *header);
+extern int ms3_url_parallel (int connections, uint64_t chunksize);
 extern void ms3_url_freeheaders (void);
 extern int64_t msr3_writemseed (MS3Record *msr, const char *mspath, int8_t overwrite,
                                 uint32_t flags, int8_t verbose);
 extern int64_t mstl3_writemseed (MS3TraceList *mst, const char *mspath, int8_t overwrite,
                                  int maxreclen, int8_t encoding, uint32_t flags, int8_t verbose);
 extern int libmseed_url_support (void);
+extern int ms3_gzip_threads (int nthreads);
+extern int ms3_gzip_writeindex (MS3FileParam *msfp, const char *indexpath);
+extern int libmseed_gzip_support (void);
+extern int ms3_zstd_threads (int nthreads);
+extern int libmseed_zstd_support (void);
 extern MS3FileParam *ms3_mstl_init_fd (int fd);
 /** @} */
 
@@ -909,6 +970,20 @@ typedef struct MSEHRecenter
  */
 typedef struct LM_PARSED_JSON_s LM_PARSED_JSON;
 
+/**
+ * @brief Container for one value of a batch extra header query
+ *
+ * @see mseh_get_ptrs_r()
+ */
+typedef struct MSEHQuery
+{
+  const char *ptr;    /**< Header value desired, as JSON Pointer */
+  void *value;        /**< Buffer for value, of type \a type, can be NULL */
+  char type;          /**< Type of value expected, as for mseh_get_ptr_r() */
+  uint32_t maxlength; /**< Maximum length of string value */
+  int retval;         /**< Result: 0 = found, 1 = not found, 2 = different type */
+} MSEHQuery;
+
 /** @def mseh_get
     @brief A simple wrapper to access any type of extra header */
 #define mseh_get(msr, ptr, valueptr, type, maxlength) \
@@ -968,6 +1043,9 @@ extern int mseh_get_ptr_r (const MS3Record *msr, const char *ptr,
 #define mseh_set_boolean(msr, ptr, valueptr)   \
   mseh_set_ptr_r (msr, ptr, valueptr, 'b', NULL)
 
+extern int mseh_get_ptrs_r (const MS3Record *msr, MSEHQuery *queries, int count,
+                            LM_PARSED_JSON **parsestate);
+
 extern int mseh_set_ptr_r (MS3Record *msr, const char *ptr,
                            void *value, char type,
                            LM_PARSED_JSON **parsestate);
@@ -1259,6 +1337,8 @@ extern int ms_bigendianhost (void);
 extern int64_t lmp_ftell64 (FILE *stream);
 /** Portable version of POSIX fseeko() to set position in large files */
 extern int lmp_fseek64 (FILE *stream, int64_t offset, int whence);
+/** Portable version of POSIX pread() to read from a file offset without seeking */
+extern int64_t lmp_pread (FILE *stream, void *buffer, size_t size, int64_t offset);
 /** Portable version of POSIX nanosleep() to sleep for nanoseconds */
 extern uint64_t lmp_nanosleep (uint64_t nanoseconds);
 
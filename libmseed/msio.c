@@ -1,5 +1,5 @@
 /***************************************************************************
- * I/O handling routines, for files and URLs.
+ * I/O handling routines, for files, gzip compressed files and URLs.
  *
  * This file is part of the miniSEED Library.
  *
@@ -25,6 +25,12 @@
 
 #include "msio.h"
 
+#if defined(LMP_WIN)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
 /* Include libcurl library header if URL supported is requested */
 #if defined(LIBMSEED_URL)
 
@@ -57,6 +63,44 @@ struct header_callback_parameters
   int64_t *endoffset;
 };
 
+/* Parallel range requests, enabled when connections > 1 */
+static int gURLconnections = 0;
+static uint64_t gURLchunksize = 0;
+
+/* Default size of each range request */
+#define LM_URL_DEFAULT_CHUNKSIZE 4194304
+
+/* States of a range request slot */
+#define RANGESLOT_IDLE   0
+#define RANGESLOT_ACTIVE 1
+#define RANGESLOT_DONE   2
+
+/* A range request and its receive buffer */
+struct url_rangeslot_s
+{
+  CURL *easy;
+  char *buffer;
+  uint64_t start;    /* Offset of range in resource */
+  uint64_t length;   /* Length of range requested */
+  uint64_t received; /* Bytes received into buffer */
+  uint64_t consumed; /* Bytes returned to reader */
+  int state;
+};
+
+/* State for reading a URL with parallel range requests.
+ * Ranges are assigned to slots in order, so the slot following
+ * the head slot always holds the next range in resource order. */
+struct url_ranges_s
+{
+  CURLM *multi;
+  struct url_rangeslot_s *slots;
+  int nslots;
+  int head;           /* Slot with the range currently being read */
+  uint64_t chunksize; /* Size of each range */
+  uint64_t next;      /* Offset of next range to request */
+  uint64_t end;       /* Last offset to read, inclusive */
+};
+
 /*********************************************************************
  * Callback fired when recv'ing data using libcurl.
  *
@@ -157,7 +201,1570 @@ header_callback (char *buffer, size_t size, size_t num, void *userdata)
   return size;
 }
 
-#endif /* defined(LIBMSEED_URL) */
+/*********************************************************************
+ * Callback fired when receiving headers of a HEAD request, sets the
+ * flag at userdata if the server accepts byte ranges.
+ *
+ * Returns number of bytes processed for success.
+ *********************************************************************/
+static size_t
+acceptranges_callback (char *buffer, size_t size, size_t num, void *userdata)
+{
+  int *acceptranges = (int *)userdata;
+
+  if (!buffer || !userdata)
+    return 0;
+
+  size *= num;
+
+  /* Detect: "Accept-Ranges: bytes" */
+  if (size >= 20 && strncasecmp (buffer, "Accept-Ranges:", 14) == 0)
+  {
+    buffer += 14;
+    while (*buffer == ' ')
+      buffer++;
+
+    if (strncasecmp (buffer, "bytes", 5) == 0)
+      *acceptranges = 1;
+  }
+
+  return size;
+}
+
+/*********************************************************************
+ * Initialize and configure a libcurl easy handle for a URL with the
+ * options common to all requests.
+ *
+ * Returns configured handle on success and NULL on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static CURL *
+url_easy_init (const char *path)
+{
+  CURL *handle;
+
+  /* Check for URL debugging environment variable */
+  if (libmseed_url_debug < 0)
+  {
+    if (getenv ("LIBMSEED_URL_DEBUG"))
+      libmseed_url_debug = 1;
+    else
+      libmseed_url_debug = 0;
+  }
+
+  /* Check for SSL peer/host verify environment variable */
+  if (libmseed_ssl_noverify < 0)
+  {
+    if (getenv ("LIBMSEED_SSL_NOVERIFY"))
+      libmseed_ssl_noverify = 1;
+    else
+      libmseed_ssl_noverify = 0;
+  }
+
+  /* Configure the libcurl easy handle, duplicate global options if present */
+  handle = (gCURLeasy) ? curl_easy_duphandle (gCURLeasy) : curl_easy_init ();
+
+  if (handle == NULL)
+  {
+    ms_log (2, "Cannot initialize CURL handle\n");
+    return NULL;
+  }
+
+  /* URL debug */
+  if (libmseed_url_debug && curl_easy_setopt (handle, CURLOPT_VERBOSE, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_VERBOSE\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  /* SSL peer and host verification */
+  if (libmseed_ssl_noverify &&
+      (curl_easy_setopt (handle, CURLOPT_SSL_VERIFYPEER, 0L) != CURLE_OK ||
+       curl_easy_setopt (handle, CURLOPT_SSL_VERIFYHOST, 0L) != CURLE_OK))
+  {
+    ms_log (2, "Cannot set CURLOPT_SSL_VERIFYPEER and/or CURLOPT_SSL_VERIFYHOST\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  /* Set URL */
+  if (curl_easy_setopt (handle, CURLOPT_URL, path) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_URL\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  /* Set default User-Agent header, can be overridden via custom header */
+  if (curl_easy_setopt (handle, CURLOPT_USERAGENT,
+                        "libmseed/" LIBMSEED_VERSION " libcurl/" LIBCURL_VERSION) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set default CURLOPT_USERAGENT\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  /* Disable signals */
+  if (curl_easy_setopt (handle, CURLOPT_NOSIGNAL, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_NOSIGNAL\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  /* Return failure codes on errors */
+  if (curl_easy_setopt (handle, CURLOPT_FAILONERROR, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_FAILONERROR\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  /* Follow HTTP redirects */
+  if (curl_easy_setopt (handle, CURLOPT_FOLLOWLOCATION, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_FOLLOWLOCATION\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  /* Set custom headers */
+  if (gCURLheaders && curl_easy_setopt (handle, CURLOPT_HTTPHEADER, gCURLheaders) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_HTTPHEADER\n");
+    curl_easy_cleanup (handle);
+    return NULL;
+  }
+
+  return handle;
+} /* End of url_easy_init() */
+
+/*********************************************************************
+ * Callback fired when recv'ing data for a range request, data are
+ * added to the buffer of the range slot.
+ *
+ * Returns number of bytes added, or 0 to abort the transfer if more
+ * data are received than requested, e.g. the range was ignored.
+ *********************************************************************/
+static size_t
+range_recv_callback (char *buffer, size_t size, size_t num, void *userdata)
+{
+  struct url_rangeslot_s *slot = (struct url_rangeslot_s *)userdata;
+
+  if (!buffer || !userdata)
+    return 0;
+
+  size *= num;
+
+  if (slot->received + size > slot->length)
+    return 0;
+
+  memcpy (slot->buffer + slot->received, buffer, size);
+  slot->received += size;
+
+  return size;
+}
+
+/*********************************************************************
+ * Request the next range of the resource with a slot.
+ *
+ * Returns 0 on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+url_range_request (struct url_ranges_s *ranges, struct url_rangeslot_s *slot)
+{
+  char rangestr[42];
+
+  slot->start = ranges->next;
+  slot->length = ranges->end - ranges->next + 1;
+  if (slot->length > ranges->chunksize)
+    slot->length = ranges->chunksize;
+  slot->received = 0;
+  slot->consumed = 0;
+
+  snprintf (rangestr, sizeof (rangestr), "%" PRIu64 "-%" PRIu64,
+            slot->start, slot->start + slot->length - 1);
+
+  if (curl_easy_setopt (slot->easy, CURLOPT_RANGE, rangestr) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_RANGE to '%s'\n", rangestr);
+    return -1;
+  }
+
+  if (curl_multi_add_handle (ranges->multi, slot->easy) != CURLM_OK)
+  {
+    ms_log (2, "Cannot add CURL handle to multi handle\n");
+    return -1;
+  }
+
+  ranges->next += slot->length;
+  slot->state = RANGESLOT_ACTIVE;
+
+  return 0;
+} /* End of url_range_request() */
+
+/*********************************************************************
+ * Free parallel range request state and all associated handles.
+ *********************************************************************/
+static void
+url_ranges_free (struct url_ranges_s *ranges)
+{
+  int idx;
+
+  if (!ranges)
+    return;
+
+  for (idx = 0; idx < ranges->nslots; idx++)
+  {
+    if (ranges->slots[idx].easy)
+    {
+      if (ranges->slots[idx].state == RANGESLOT_ACTIVE)
+        curl_multi_remove_handle (ranges->multi, ranges->slots[idx].easy);
+
+      curl_easy_cleanup (ranges->slots[idx].easy);
+    }
+
+    if (ranges->slots[idx].buffer)
+      libmseed_memory.free (ranges->slots[idx].buffer);
+  }
+
+  if (ranges->multi)
+    curl_multi_cleanup (ranges->multi);
+
+  if (ranges->slots)
+    libmseed_memory.free (ranges->slots);
+
+  libmseed_memory.free (ranges);
+} /* End of url_ranges_free() */
+
+/*********************************************************************
+ * Open a URL for reading with parallel range requests.
+ *
+ * The length of the resource and support for byte ranges are
+ * determined with a HEAD request.  If the HEAD request fails, the
+ * server does not accept byte ranges, the length is unknown or the
+ * requested range is not larger than a single chunk, the caller
+ * should use a single request.
+ *
+ * If 'startoffset' or 'endoffset' are non-zero they limit the range
+ * read and are set to the actual range that will be read.
+ *
+ * Returns 1 when parallel reading is set up, 0 when a single request
+ * should be used, and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+url_ranges_open (LMIO *io, const char *path, int64_t *startoffset, int64_t *endoffset)
+{
+  struct url_ranges_s *ranges = NULL;
+  CURL *head = NULL;
+  CURLcode result;
+  curl_off_t contentlength = -1;
+  uint64_t start = 0;
+  uint64_t end;
+  uint64_t chunks;
+  int acceptranges = 0;
+  int idx;
+
+  if ((head = url_easy_init (path)) == NULL)
+    return -1;
+
+  if (curl_easy_setopt (head, CURLOPT_NOBODY, 1L) != CURLE_OK ||
+      curl_easy_setopt (head, CURLOPT_HEADERFUNCTION, acceptranges_callback) != CURLE_OK ||
+      curl_easy_setopt (head, CURLOPT_HEADERDATA, (void *)&acceptranges) != CURLE_OK)
+  {
+    ms_log (2, "Cannot configure HEAD request\n");
+    curl_easy_cleanup (head);
+    return -1;
+  }
+
+  /* A failed HEAD request, e.g. servers or presigned URLs rejecting
+   * HEAD with 403 or 405, means ranges are not available.  Any error
+   * for the resource itself is reported by the single request. */
+  result = curl_easy_perform (head);
+
+  if (result == CURLE_OK)
+    curl_easy_getinfo (head, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentlength);
+
+  curl_easy_cleanup (head);
+
+  if (result != CURLE_OK)
+    return 0;
+
+  if (!acceptranges || contentlength <= 0)
+    return 0;
+
+  if (startoffset && *startoffset > 0)
+    start = (uint64_t)*startoffset;
+
+  end = (uint64_t)contentlength - 1;
+  if (endoffset && *endoffset > 0 && (uint64_t)*endoffset < end)
+    end = (uint64_t)*endoffset;
+
+  if (start > end || (end - start + 1) <= gURLchunksize)
+    return 0;
+
+  if ((ranges = (struct url_ranges_s *)libmseed_memory.malloc (sizeof (struct url_ranges_s))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return -1;
+  }
+
+  memset (ranges, 0, sizeof (struct url_ranges_s));
+  ranges->chunksize = gURLchunksize;
+  ranges->next = start;
+  ranges->end = end;
+
+  /* No more connections than chunks */
+  chunks = (end - start + gURLchunksize) / gURLchunksize;
+  ranges->nslots = ((uint64_t)gURLconnections < chunks) ? gURLconnections : (int)chunks;
+
+  if ((ranges->multi = curl_multi_init ()) == NULL)
+  {
+    ms_log (2, "Cannot initialize CURL multi handle\n");
+    url_ranges_free (ranges);
+    return -1;
+  }
+
+  if ((ranges->slots = (struct url_rangeslot_s *)libmseed_memory.malloc (ranges->nslots * sizeof (struct url_rangeslot_s))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    url_ranges_free (ranges);
+    return -1;
+  }
+
+  memset (ranges->slots, 0, ranges->nslots * sizeof (struct url_rangeslot_s));
+
+  for (idx = 0; idx < ranges->nslots; idx++)
+  {
+    struct url_rangeslot_s *slot = &ranges->slots[idx];
+
+    if ((slot->easy = url_easy_init (path)) == NULL)
+    {
+      url_ranges_free (ranges);
+      return -1;
+    }
+
+    if ((slot->buffer = (char *)libmseed_memory.malloc (gURLchunksize)) == NULL)
+    {
+      ms_log (2, "Cannot allocate memory\n");
+      url_ranges_free (ranges);
+      return -1;
+    }
+
+    if (curl_easy_setopt (slot->easy, CURLOPT_WRITEFUNCTION, range_recv_callback) != CURLE_OK ||
+        curl_easy_setopt (slot->easy, CURLOPT_WRITEDATA, (void *)slot) != CURLE_OK ||
+        curl_easy_setopt (slot->easy, CURLOPT_PRIVATE, (void *)slot) != CURLE_OK)
+    {
+      ms_log (2, "Cannot configure range request\n");
+      url_ranges_free (ranges);
+      return -1;
+    }
+
+    if (url_range_request (ranges, slot))
+    {
+      url_ranges_free (ranges);
+      return -1;
+    }
+  }
+
+  if (startoffset && *startoffset > 0)
+    *startoffset = (int64_t)start;
+  if (endoffset && *endoffset > 0)
+    *endoffset = (int64_t)end;
+
+  io->type = LMIO_URLRANGES;
+  io->handle = ranges;
+  io->handle2 = NULL;
+  io->still_running = 1;
+
+  return 1;
+} /* End of url_ranges_open() */
+
+/*********************************************************************
+ * Read data from parallel range requests in resource order.
+ *
+ * Data are returned as soon as they are available from the range
+ * that is next in order, while other ranges continue to transfer.
+ *
+ * Returns the number of bytes read on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int64_t
+url_ranges_read (LMIO *io, void *buffer, size_t size)
+{
+  struct url_ranges_s *ranges = (struct url_ranges_s *)io->handle;
+  struct url_rangeslot_s *slot;
+  struct url_rangeslot_s *done;
+  CURLMsg *msg;
+  long response_code;
+  uint64_t available;
+  size_t read = 0;
+  int running;
+  int queued;
+
+  while (read < size)
+  {
+    slot = &ranges->slots[ranges->head];
+
+    /* All ranges have been consumed */
+    if (slot->state == RANGESLOT_IDLE)
+    {
+      io->still_running = 0;
+      break;
+    }
+
+    /* Copy available data of next range in order */
+    available = slot->received - slot->consumed;
+    if (available > 0)
+    {
+      if (available > size - read)
+        available = size - read;
+
+      memcpy ((char *)buffer + read, slot->buffer + slot->consumed, available);
+      slot->consumed += available;
+      read += available;
+      continue;
+    }
+
+    /* Re-use slot of completed and consumed range for the next range */
+    if (slot->state == RANGESLOT_DONE)
+    {
+      slot->state = RANGESLOT_IDLE;
+
+      if (ranges->next <= ranges->end && url_range_request (ranges, slot))
+        return -1;
+
+      ranges->head = (ranges->head + 1) % ranges->nslots;
+      continue;
+    }
+
+    /* Return data already read instead of waiting */
+    if (read > 0)
+      break;
+
+    /* Transfer data and check for completed ranges */
+    if (curl_multi_perform (ranges->multi, &running) != CURLM_OK)
+    {
+      ms_log (2, "Error with curl_multi_perform()\n");
+      return -1;
+    }
+
+    while ((msg = curl_multi_info_read (ranges->multi, &queued)))
+    {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char **)&done);
+      curl_easy_getinfo (msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
+
+      if (msg->data.result != CURLE_OK || response_code != 206 || done->received != done->length)
+      {
+        ms_log (2, "Range request %" PRIu64 "-%" PRIu64 " failed: %s (response code %ld)\n",
+                done->start, done->start + done->length - 1,
+                curl_easy_strerror (msg->data.result), response_code);
+        return -1;
+      }
+
+      curl_multi_remove_handle (ranges->multi, done->easy);
+      done->state = RANGESLOT_DONE;
+    }
+
+    /* Wait for activity if the next range has no data */
+    if (slot->received == slot->consumed && slot->state == RANGESLOT_ACTIVE)
+      curl_multi_wait (ranges->multi, NULL, 0, 1000, NULL);
+  }
+
+  return (int64_t)read;
+} /* End of url_ranges_read() */
+
+#endif /* defined(LIBMSEED_URL) */
+
+/* Include zlib library header if gzip support is requested */
+#if defined(LIBMSEED_ZLIB)
+
+#include <zlib.h>
+
+#include "threadutils.h"
+
+/* Number of threads used to decompress BGZF blocks */
+static int gGZIPthreads = 1;
+
+/* Maximum size of a BGZF block, compressed or uncompressed */
+#define BGZF_MAXBLOCK 65536
+
+/* Fixed BGZF block header and footer lengths */
+#define BGZF_HEADER 18
+#define BGZF_FOOTER 8
+
+/* BGZF blocks decompressed per thread in each batch */
+#define BGZF_BATCHPERTHREAD 8
+
+/* Buffer size for decompressing general gzip streams */
+#define GZIP_BUFSIZE 262144
+
+/* A BGZF block in a batch */
+struct bgzf_block_s
+{
+  const unsigned char *cdata; /* Compressed (deflate) data */
+  uint32_t clength;           /* Length of compressed data */
+  uint32_t crc;               /* CRC-32 of uncompressed data */
+  uint32_t isize;             /* Length of uncompressed data */
+  uint64_t outoffset;         /* Offset of uncompressed data in output buffer */
+  uint64_t coffset;           /* Compressed offset of block in file */
+  int error;
+};
+
+/* Block table entry, compressed and uncompressed offsets of a block */
+struct gzip_offsets_s
+{
+  uint64_t coffset;
+  uint64_t uoffset;
+};
+
+/* State for reading a gzip compressed file */
+struct lm_gzip_s
+{
+  FILE *fp;
+  int bgzf;                   /* Input is BGZF, blocked gzip */
+  z_stream zs;                /* Stream for general gzip */
+  int zsinit;
+  unsigned char *inbuf;       /* Compressed input */
+  size_t insize;
+  unsigned char *outbuf;      /* Uncompressed output */
+  size_t outsize;
+  size_t outlen;              /* Uncompressed bytes in output buffer */
+  size_t outpos;              /* Bytes of output buffer consumed */
+  uint64_t coffset;           /* Compressed offset of next block */
+  uint64_t uoffset;           /* Uncompressed offset of next block */
+  int eof;                    /* Input is exhausted */
+  struct bgzf_block_s *blocks;
+  int maxblocks;
+  struct gzip_offsets_s *table; /* Offsets of all blocks read */
+  size_t tablecount;
+  size_t tablemax;
+  int tablevalid;             /* Table covers all blocks from the start */
+};
+
+/*********************************************************************
+ * Read a little-endian 16-bit value
+ *********************************************************************/
+static inline uint32_t
+gzip_le16 (const unsigned char *ptr)
+{
+  return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8);
+}
+
+/*********************************************************************
+ * Read a little-endian 32-bit value
+ *********************************************************************/
+static inline uint32_t
+gzip_le32 (const unsigned char *ptr)
+{
+  return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+         ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+/*********************************************************************
+ * Determine the total BGZF block size from a block header.
+ *
+ * Returns block size on success and 0 if the header is not a BGZF
+ * block header.
+ *********************************************************************/
+static uint32_t
+bgzf_blocksize (const unsigned char *header)
+{
+  /* gzip ID, deflate method, FEXTRA flag, 6 byte extra with "BC" subfield of length 2 */
+  if (header[0] != 31 || header[1] != 139 || header[2] != 8 || !(header[3] & 4) ||
+      gzip_le16 (header + 10) != 6 || header[12] != 'B' || header[13] != 'C' ||
+      gzip_le16 (header + 14) != 2)
+    return 0;
+
+  return gzip_le16 (header + 16) + 1;
+} /* End of bgzf_blocksize() */
+
+/*********************************************************************
+ * Add an entry to the block table, on allocation failure the table is
+ * marked invalid.
+ *********************************************************************/
+static void
+gzip_table_add (struct lm_gzip_s *gz, uint64_t coffset, uint64_t uoffset)
+{
+  struct gzip_offsets_s *newtable;
+
+  if (!gz->tablevalid)
+    return;
+
+  if (gz->tablecount == gz->tablemax)
+  {
+    gz->tablemax = (gz->tablemax) ? gz->tablemax * 2 : 1024;
+    newtable = (struct gzip_offsets_s *)libmseed_memory.realloc (gz->table, gz->tablemax * sizeof (struct gzip_offsets_s));
+
+    if (newtable == NULL)
+    {
+      gz->tablevalid = 0;
+      return;
+    }
+
+    gz->table = newtable;
+  }
+
+  gz->table[gz->tablecount].coffset = coffset;
+  gz->table[gz->tablecount].uoffset = uoffset;
+  gz->tablecount++;
+} /* End of gzip_table_add() */
+
+/*********************************************************************
+ * Decompress a single BGZF block of a batch, run in parallel by
+ * lm_parallel_run().  Errors are flagged in the block entry.
+ *********************************************************************/
+static void
+bgzf_inflate_task (void *context, int taskindex)
+{
+  struct lm_gzip_s *gz = (struct lm_gzip_s *)context;
+  struct bgzf_block_s *block = &gz->blocks[taskindex];
+  unsigned char *output = gz->outbuf + block->outoffset;
+  z_stream zs;
+  int rv;
+
+  if (block->isize == 0)
+    return;
+
+  memset (&zs, 0, sizeof (zs));
+
+  /* Raw deflate data, the gzip header and footer are parsed separately */
+  if (inflateInit2 (&zs, -15) != Z_OK)
+  {
+    block->error = 1;
+    return;
+  }
+
+  zs.next_in = (unsigned char *)block->cdata;
+  zs.avail_in = block->clength;
+  zs.next_out = output;
+  zs.avail_out = block->isize;
+
+  rv = inflate (&zs, Z_FINISH);
+  inflateEnd (&zs);
+
+  if (rv != Z_STREAM_END || zs.avail_out != 0 ||
+      crc32 (crc32 (0L, Z_NULL, 0), output, block->isize) != block->crc)
+    block->error = 1;
+} /* End of bgzf_inflate_task() */
+
+/*********************************************************************
+ * Read and decompress a batch of BGZF blocks into the output buffer.
+ *
+ * Returns 0 on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+bgzf_read_batch (struct lm_gzip_s *gz)
+{
+  unsigned char *ptr = gz->inbuf;
+  uint64_t outoffset = 0;
+  uint32_t blocksize;
+  int nblocks = 0;
+  int idx;
+
+  while (nblocks < gz->maxblocks)
+  {
+    size_t readcount = fread (ptr, 1, BGZF_HEADER, gz->fp);
+
+    if (readcount == 0 && feof (gz->fp))
+    {
+      gz->eof = 1;
+      break;
+    }
+
+    if (readcount != BGZF_HEADER || (blocksize = bgzf_blocksize (ptr)) == 0 ||
+        blocksize < BGZF_HEADER + BGZF_FOOTER)
+    {
+      ms_log (2, "Invalid BGZF block at compressed offset %" PRIu64 "\n", gz->coffset);
+      return -1;
+    }
+
+    if (fread (ptr + BGZF_HEADER, 1, blocksize - BGZF_HEADER, gz->fp) != blocksize - BGZF_HEADER)
+    {
+      ms_log (2, "Truncated BGZF block at compressed offset %" PRIu64 "\n", gz->coffset);
+      return -1;
+    }
+
+    gz->blocks[nblocks].cdata = ptr + BGZF_HEADER;
+    gz->blocks[nblocks].clength = blocksize - BGZF_HEADER - BGZF_FOOTER;
+    gz->blocks[nblocks].crc = gzip_le32 (ptr + blocksize - 8);
+    gz->blocks[nblocks].isize = gzip_le32 (ptr + blocksize - 4);
+    gz->blocks[nblocks].outoffset = outoffset;
+    gz->blocks[nblocks].coffset = gz->coffset;
+    gz->blocks[nblocks].error = 0;
+
+    if (gz->blocks[nblocks].isize > BGZF_MAXBLOCK)
+    {
+      ms_log (2, "Invalid BGZF block size at compressed offset %" PRIu64 "\n", gz->coffset);
+      return -1;
+    }
+
+    /* Record offsets of blocks with data */
+    if (gz->blocks[nblocks].isize > 0)
+      gzip_table_add (gz, gz->coffset, gz->uoffset);
+
+    gz->coffset += blocksize;
+    gz->uoffset += gz->blocks[nblocks].isize;
+    outoffset += gz->blocks[nblocks].isize;
+    ptr += blocksize;
+    nblocks++;
+  }
+
+  if (nblocks > 0 && lm_parallel_run (gGZIPthreads, nblocks, bgzf_inflate_task, gz) < 0)
+  {
+    ms_log (2, "Cannot run parallel decompression\n");
+    return -1;
+  }
+
+  for (idx = 0; idx < nblocks; idx++)
+  {
+    if (gz->blocks[idx].error)
+    {
+      ms_log (2, "Cannot decompress BGZF block at compressed offset %" PRIu64 "\n",
+              gz->blocks[idx].coffset);
+      return -1;
+    }
+  }
+
+  gz->outlen = (size_t)outoffset;
+  gz->outpos = 0;
+
+  return 0;
+} /* End of bgzf_read_batch() */
+
+/*********************************************************************
+ * Decompress general gzip input into the output buffer, concatenated
+ * gzip members are decompressed as a single stream.
+ *
+ * Returns 0 on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+gzip_read_stream (struct lm_gzip_s *gz)
+{
+  int rv;
+
+  gz->zs.next_out = gz->outbuf;
+  gz->zs.avail_out = (uInt)gz->outsize;
+
+  while (gz->zs.avail_out > 0 && !gz->eof)
+  {
+    if (gz->zs.avail_in == 0)
+    {
+      gz->zs.next_in = gz->inbuf;
+      gz->zs.avail_in = (uInt)fread (gz->inbuf, 1, gz->insize, gz->fp);
+
+      if (gz->zs.avail_in == 0)
+      {
+        if (ferror (gz->fp))
+        {
+          ms_log (2, "Error reading gzip input (%s)\n", strerror (errno));
+          return -1;
+        }
+
+        ms_log (2, "Truncated gzip input\n");
+        return -1;
+      }
+    }
+
+    rv = inflate (&gz->zs, Z_NO_FLUSH);
+
+    if (rv == Z_STREAM_END)
+    {
+      /* Check for another member following this one */
+      if (gz->zs.avail_in == 0)
+      {
+        gz->zs.next_in = gz->inbuf;
+        gz->zs.avail_in = (uInt)fread (gz->inbuf, 1, gz->insize, gz->fp);
+      }
+
+      if (gz->zs.avail_in == 0)
+        gz->eof = 1;
+      else if (inflateReset (&gz->zs) != Z_OK)
+        return -1;
+    }
+    else if (rv != Z_OK)
+    {
+      ms_log (2, "Cannot decompress gzip input: %s\n", (gz->zs.msg) ? gz->zs.msg : "unknown error");
+      return -1;
+    }
+  }
+
+  gz->outlen = gz->outsize - gz->zs.avail_out;
+  gz->outpos = 0;
+  gz->uoffset += gz->outlen;
+
+  return 0;
+} /* End of gzip_read_stream() */
+
+/*********************************************************************
+ * Read uncompressed data from a gzip file.
+ *
+ * Returns the number of bytes read on success and -1 on error.
+ *********************************************************************/
+static int64_t
+gzip_read (struct lm_gzip_s *gz, void *buffer, size_t size)
+{
+  size_t read = 0;
+  size_t count;
+
+  while (read < size)
+  {
+    if (gz->outpos == gz->outlen)
+    {
+      if (gz->eof)
+        break;
+
+      if ((gz->bgzf) ? bgzf_read_batch (gz) : gzip_read_stream (gz))
+        return -1;
+
+      continue;
+    }
+
+    count = gz->outlen - gz->outpos;
+    if (count > size - read)
+      count = size - read;
+
+    if (buffer)
+      memcpy ((char *)buffer + read, gz->outbuf + gz->outpos, count);
+
+    gz->outpos += count;
+    read += count;
+  }
+
+  return (int64_t)read;
+} /* End of gzip_read() */
+
+/*********************************************************************
+ * Free gzip reading state and close the file.
+ *********************************************************************/
+static void
+gzip_free (struct lm_gzip_s *gz)
+{
+  if (!gz)
+    return;
+
+  if (gz->fp)
+    fclose (gz->fp);
+
+  if (gz->zsinit)
+    inflateEnd (&gz->zs);
+
+  if (gz->inbuf)
+    libmseed_memory.free (gz->inbuf);
+  if (gz->outbuf)
+    libmseed_memory.free (gz->outbuf);
+  if (gz->blocks)
+    libmseed_memory.free (gz->blocks);
+  if (gz->table)
+    libmseed_memory.free (gz->table);
+
+  libmseed_memory.free (gz);
+} /* End of gzip_free() */
+
+/*********************************************************************
+ * Position a BGZF file at the block containing an uncompressed
+ * offset using a block index file in the format written by
+ * msio_gzip_writeindex().
+ *
+ * Returns 0 on success and -1 if the index cannot be used.
+ *********************************************************************/
+static int
+bgzf_seek_index (struct lm_gzip_s *gz, const char *path, uint64_t offset)
+{
+  char indexpath[1024];
+  FILE *fp;
+  uint64_t count;
+  uint64_t entry[2];
+  uint64_t coffset = 0;
+  uint64_t uoffset = 0;
+  int swapflag = ms_bigendianhost ();
+
+  snprintf (indexpath, sizeof (indexpath), "%s.gzi", path);
+
+  if ((fp = fopen (indexpath, "rb")) == NULL)
+    return -1;
+
+  if (fread (&count, sizeof (count), 1, fp) != 1)
+  {
+    fclose (fp);
+    return -1;
+  }
+
+  if (swapflag)
+    ms_gswap8 (&count);
+
+  /* Find the last block starting at or before the offset, entries are in order */
+  while (count-- > 0 && fread (entry, sizeof (entry), 1, fp) == 1)
+  {
+    if (swapflag)
+    {
+      ms_gswap8 (&entry[0]);
+      ms_gswap8 (&entry[1]);
+    }
+
+    if (entry[1] > offset)
+      break;
+
+    coffset = entry[0];
+    uoffset = entry[1];
+  }
+
+  fclose (fp);
+
+  if (coffset > 0 && lmp_fseek64 (gz->fp, (int64_t)coffset, SEEK_SET))
+    return -1;
+
+  gz->coffset = coffset;
+  gz->uoffset = uoffset;
+  gz->tablevalid = (coffset == 0);
+
+  return 0;
+} /* End of bgzf_seek_index() */
+
+/*********************************************************************
+ * Open a gzip compressed file for reading if the file at 'fp' starts
+ * with a gzip header.  On success the IO handle takes ownership of
+ * 'fp'.
+ *
+ * If 'startoffset' is non-zero the stream is positioned at this
+ * uncompressed offset, for BGZF input using an index file at
+ * 'path'.gzi if present.
+ *
+ * Returns 1 when the file is gzip compressed and opened, 0 when the
+ * file is not gzip compressed and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+gzip_open (LMIO *io, FILE *fp, const char *path, int64_t *startoffset)
+{
+  struct lm_gzip_s *gz;
+  unsigned char header[BGZF_HEADER];
+  size_t readcount;
+  uint64_t skip;
+  int nthreads;
+
+  /* Detection requires rewinding, leave non-seekable streams alone */
+  if (lmp_ftell64 (fp) != 0)
+    return 0;
+
+  readcount = fread (header, 1, sizeof (header), fp);
+
+  if (lmp_fseek64 (fp, 0, SEEK_SET))
+  {
+    ms_log (2, "Cannot seek in %s\n", path);
+    return -1;
+  }
+
+  if (readcount < 2 || header[0] != 31 || header[1] != 139)
+    return 0;
+
+  if ((gz = (struct lm_gzip_s *)libmseed_memory.malloc (sizeof (struct lm_gzip_s))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return -1;
+  }
+
+  memset (gz, 0, sizeof (struct lm_gzip_s));
+  gz->tablevalid = 1;
+  gz->bgzf = (readcount == BGZF_HEADER && bgzf_blocksize (header) > 0);
+
+  if (gz->bgzf)
+  {
+    nthreads = lm_thread_count (gGZIPthreads);
+    gz->maxblocks = nthreads * BGZF_BATCHPERTHREAD;
+    gz->insize = (size_t)gz->maxblocks * BGZF_MAXBLOCK;
+    gz->outsize = gz->insize;
+    gz->blocks = (struct bgzf_block_s *)libmseed_memory.malloc (gz->maxblocks * sizeof (struct bgzf_block_s));
+  }
+  else
+  {
+    gz->insize = GZIP_BUFSIZE;
+    gz->outsize = GZIP_BUFSIZE;
+
+    /* Automatic gzip header detection with maximum window */
+    if (inflateInit2 (&gz->zs, 15 + 16) != Z_OK)
+    {
+      ms_log (2, "Cannot initialize gzip decompression\n");
+      gzip_free (gz);
+      return -1;
+    }
+
+    gz->zsinit = 1;
+  }
+
+  gz->inbuf = (unsigned char *)libmseed_memory.malloc (gz->insize);
+  gz->outbuf = (unsigned char *)libmseed_memory.malloc (gz->outsize);
+
+  if (gz->inbuf == NULL || gz->outbuf == NULL || (gz->bgzf && gz->blocks == NULL))
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    gzip_free (gz);
+    return -1;
+  }
+
+  gz->fp = fp;
+
+  /* Position at uncompressed start offset, seeking with a block index if available */
+  if (startoffset && *startoffset > 0)
+  {
+    if (gz->bgzf)
+      bgzf_seek_index (gz, path, (uint64_t)*startoffset);
+
+    skip = (uint64_t)*startoffset - gz->uoffset;
+
+    if (gzip_read (gz, NULL, (size_t)skip) != (int64_t)skip)
+    {
+      ms_log (2, "Cannot position %s at uncompressed offset %" PRId64 "\n", path, *startoffset);
+      gz->fp = NULL;
+      gzip_free (gz);
+      return -1;
+    }
+  }
+
+  io->type = LMIO_GZIP;
+  io->handle = gz;
+  io->handle2 = NULL;
+
+  return 1;
+} /* End of gzip_open() */
+
+#endif /* defined(LIBMSEED_ZLIB) */
+
+/* Include zstd library header if zstd support is requested */
+#if defined(LIBMSEED_ZSTD)
+
+#include <zstd.h>
+
+#include "threadutils.h"
+
+/* Number of threads used to decompress seekable zstd frames */
+static int gZSTDthreads = 1;
+
+/* Little-endian magic numbers of zstd frames and the seekable format */
+#define ZSTD_FRAMEMAGIC 0xFD2FB528
+#define ZSTD_SKIPPABLEMAGIC 0x184D2A5E
+#define ZSTD_SEEKABLEMAGIC 0x8F92EAB1
+
+/* Seek table footer length: frame count, descriptor and magic */
+#define ZSTD_SEEKFOOTER 9
+
+/* Decompressed bytes per thread in each batch of seekable frames */
+#define ZSTD_BATCHBYTES 1048576
+
+/* Frames larger than this are decompressed as a single stream */
+#define ZSTD_MAXFRAME 67108864
+
+/* A frame of a seekable zstd file */
+struct zstd_frame_s
+{
+  uint64_t coffset; /* Compressed offset of frame in file */
+  uint64_t uoffset; /* Uncompressed offset of frame data */
+  uint32_t csize;   /* Compressed size of frame */
+  uint32_t dsize;   /* Decompressed size of frame */
+  int error;
+};
+
+/* State for reading a zstd compressed file */
+struct lm_zstd_s
+{
+  FILE *fp;
+  struct zstd_frame_s *frames; /* Frames from seek table, NULL if not seekable */
+  uint32_t framecount;
+  uint32_t nextframe;          /* Next frame to read */
+  int parallel;                /* Decompress batches of frames in parallel */
+  ZSTD_DCtx *dctx;             /* Context for streaming decompression */
+  ZSTD_inBuffer input;         /* Streaming input position in input buffer */
+  size_t pending;              /* Frame incomplete when non-zero */
+  int inputend;                /* Streaming input is exhausted */
+  unsigned char *inbuf;        /* Compressed input */
+  size_t insize;
+  unsigned char *outbuf;       /* Uncompressed output */
+  size_t outsize;
+  size_t outlen;               /* Uncompressed bytes in output buffer */
+  size_t outpos;               /* Bytes of output buffer consumed */
+  uint64_t uoffset;            /* Uncompressed offset of output buffer end */
+  int eof;                     /* Input is exhausted */
+};
+
+/*********************************************************************
+ * Read a little-endian 32-bit value
+ *********************************************************************/
+static inline uint32_t
+zstd_le32 (const unsigned char *ptr)
+{
+  return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+         ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+/*********************************************************************
+ * Read the seek table of a file in the zstd seekable format, a
+ * skippable frame at the end of the file listing the compressed and
+ * decompressed size of each frame.
+ *
+ * The file is left at an unspecified position.
+ *
+ * Returns 1 when a valid seek table is read, 0 when the file is not
+ * in seekable format and -1 on error.
+ *********************************************************************/
+static int
+zstd_read_seektable (struct lm_zstd_s *zs)
+{
+  unsigned char footer[ZSTD_SEEKFOOTER];
+  unsigned char header[8];
+  unsigned char entry[12];
+  uint64_t coffset = 0;
+  uint64_t uoffset = 0;
+  int64_t filesize;
+  int64_t tablesize;
+  uint32_t framecount;
+  uint32_t entrysize;
+  uint32_t idx;
+
+  if (lmp_fseek64 (zs->fp, 0, SEEK_END) || (filesize = lmp_ftell64 (zs->fp)) < ZSTD_SEEKFOOTER + 8)
+    return 0;
+
+  if (lmp_fseek64 (zs->fp, filesize - ZSTD_SEEKFOOTER, SEEK_SET) ||
+      fread (footer, 1, ZSTD_SEEKFOOTER, zs->fp) != ZSTD_SEEKFOOTER)
+    return 0;
+
+  /* Reserved descriptor bits must be zero, bit 7 flags checksums in entries */
+  if (zstd_le32 (footer + 5) != ZSTD_SEEKABLEMAGIC || (footer[4] & 0x7F) != 0)
+    return 0;
+
+  framecount = zstd_le32 (footer);
+  entrysize = (footer[4] & 0x80) ? 12 : 8;
+  tablesize = (int64_t)framecount * entrysize + ZSTD_SEEKFOOTER;
+
+  if (framecount == 0 || tablesize + 8 > filesize)
+    return 0;
+
+  if (lmp_fseek64 (zs->fp, filesize - tablesize - 8, SEEK_SET) ||
+      fread (header, 1, sizeof (header), zs->fp) != sizeof (header) ||
+      zstd_le32 (header) != ZSTD_SKIPPABLEMAGIC || zstd_le32 (header + 4) != (uint64_t)tablesize)
+    return 0;
+
+  if ((zs->frames = (struct zstd_frame_s *)libmseed_memory.malloc (framecount * sizeof (struct zstd_frame_s))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return -1;
+  }
+
+  for (idx = 0; idx < framecount; idx++)
+  {
+    if (fread (entry, 1, entrysize, zs->fp) != entrysize)
+      break;
+
+    zs->frames[idx].coffset = coffset;
+    zs->frames[idx].uoffset = uoffset;
+    zs->frames[idx].csize = zstd_le32 (entry);
+    zs->frames[idx].dsize = zstd_le32 (entry + 4);
+    zs->frames[idx].error = 0;
+
+    if (zs->frames[idx].csize == 0)
+      break;
+
+    coffset += zs->frames[idx].csize;
+    uoffset += zs->frames[idx].dsize;
+  }
+
+  /* Frames must fill the file up to the seek table */
+  if (idx != framecount || coffset != (uint64_t)(filesize - tablesize - 8))
+  {
+    libmseed_memory.free (zs->frames);
+    zs->frames = NULL;
+    return 0;
+  }
+
+  zs->framecount = framecount;
+
+  return 1;
+} /* End of zstd_read_seektable() */
+
+/*********************************************************************
+ * Decompress a single frame of a batch, run in parallel by
+ * lm_parallel_run().  Errors are flagged in the frame entry.
+ *********************************************************************/
+static void
+zstd_decompress_task (void *context, int taskindex)
+{
+  struct lm_zstd_s *zs = (struct lm_zstd_s *)context;
+  struct zstd_frame_s *first = &zs->frames[zs->nextframe];
+  struct zstd_frame_s *frame = first + taskindex;
+  size_t rv;
+
+  rv = ZSTD_decompress (zs->outbuf + (frame->uoffset - first->uoffset), frame->dsize,
+                        zs->inbuf + (frame->coffset - first->coffset), frame->csize);
+
+  if (ZSTD_isError (rv) || rv != frame->dsize)
+    frame->error = 1;
+} /* End of zstd_decompress_task() */
+
+/*********************************************************************
+ * Read and decompress a batch of seekable zstd frames into the output
+ * buffer.  Frames are contiguous in the file and are read together.
+ *
+ * Returns 0 on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+zstd_read_batch (struct lm_zstd_s *zs)
+{
+  struct zstd_frame_s *first = &zs->frames[zs->nextframe];
+  uint64_t clength = 0;
+  uint64_t ulength = 0;
+  uint32_t nframes = 0;
+  uint32_t idx;
+
+  if (zs->nextframe >= zs->framecount)
+  {
+    zs->eof = 1;
+    return 0;
+  }
+
+  /* Add frames while they fit in the buffers, the buffers fit the largest frame */
+  while (zs->nextframe + nframes < zs->framecount)
+  {
+    struct zstd_frame_s *frame = first + nframes;
+
+    if (clength + frame->csize > zs->insize || ulength + frame->dsize > zs->outsize)
+      break;
+
+    frame->error = 0;
+    clength += frame->csize;
+    ulength += frame->dsize;
+    nframes++;
+  }
+
+  if (fread (zs->inbuf, 1, (size_t)clength, zs->fp) != (size_t)clength)
+  {
+    ms_log (2, "Truncated zstd frame at compressed offset %" PRIu64 "\n", first->coffset);
+    return -1;
+  }
+
+  if (lm_parallel_run (gZSTDthreads, (int)nframes, zstd_decompress_task, zs) < 0)
+  {
+    ms_log (2, "Cannot run parallel decompression\n");
+    return -1;
+  }
+
+  for (idx = 0; idx < nframes; idx++)
+  {
+    if (first[idx].error)
+    {
+      ms_log (2, "Cannot decompress zstd frame at compressed offset %" PRIu64 "\n",
+              first[idx].coffset);
+      return -1;
+    }
+  }
+
+  zs->nextframe += nframes;
+  zs->eof = (zs->nextframe >= zs->framecount);
+  zs->outlen = (size_t)ulength;
+  zs->outpos = 0;
+  zs->uoffset += ulength;
+
+  return 0;
+} /* End of zstd_read_batch() */
+
+/*********************************************************************
+ * Decompress zstd input as a single stream into the output buffer,
+ * consecutive frames are decompressed and skippable frames, e.g. a
+ * seek table, are ignored.
+ *
+ * Returns 0 on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+zstd_read_stream (struct lm_zstd_s *zs)
+{
+  ZSTD_outBuffer output;
+  size_t produced;
+  size_t rv;
+
+  output.dst = zs->outbuf;
+  output.size = zs->outsize;
+  output.pos = 0;
+
+  while (output.pos < output.size && !zs->eof)
+  {
+    if (zs->input.pos == zs->input.size && !zs->inputend)
+    {
+      zs->input.size = fread (zs->inbuf, 1, zs->insize, zs->fp);
+      zs->input.pos = 0;
+
+      if (zs->input.size == 0)
+      {
+        if (ferror (zs->fp))
+        {
+          ms_log (2, "Error reading zstd input (%s)\n", strerror (errno));
+          return -1;
+        }
+
+        zs->inputend = 1;
+      }
+    }
+
+    produced = output.pos;
+    rv = ZSTD_decompressStream (zs->dctx, &output, &zs->input);
+
+    if (ZSTD_isError (rv))
+    {
+      ms_log (2, "Cannot decompress zstd input: %s\n", ZSTD_getErrorName (rv));
+      return -1;
+    }
+
+    /* End of stream when no input remains and nothing is left to flush,
+     * the last frame must have been completed by a previous call */
+    if (zs->inputend && output.pos == produced)
+    {
+      if (zs->pending)
+      {
+        ms_log (2, "Truncated zstd input\n");
+        return -1;
+      }
+
+      zs->eof = 1;
+    }
+    else
+    {
+      zs->pending = rv;
+    }
+  }
+
+  zs->outlen = output.pos;
+  zs->outpos = 0;
+  zs->uoffset += zs->outlen;
+
+  return 0;
+} /* End of zstd_read_stream() */
+
+/*********************************************************************
+ * Read uncompressed data from a zstd file.
+ *
+ * Returns the number of bytes read on success and -1 on error.
+ *********************************************************************/
+static int64_t
+zstd_read (struct lm_zstd_s *zs, void *buffer, size_t size)
+{
+  size_t read = 0;
+  size_t count;
+
+  while (read < size)
+  {
+    if (zs->outpos == zs->outlen)
+    {
+      if (zs->eof)
+        break;
+
+      if ((zs->parallel) ? zstd_read_batch (zs) : zstd_read_stream (zs))
+        return -1;
+
+      continue;
+    }
+
+    count = zs->outlen - zs->outpos;
+    if (count > size - read)
+      count = size - read;
+
+    if (buffer)
+      memcpy ((char *)buffer + read, zs->outbuf + zs->outpos, count);
+
+    zs->outpos += count;
+    read += count;
+  }
+
+  return (int64_t)read;
+} /* End of zstd_read() */
+
+/*********************************************************************
+ * Free zstd reading state and close the file.
+ *********************************************************************/
+static void
+zstd_free (struct lm_zstd_s *zs)
+{
+  if (!zs)
+    return;
+
+  if (zs->fp)
+    fclose (zs->fp);
+
+  if (zs->dctx)
+    ZSTD_freeDCtx (zs->dctx);
+
+  if (zs->frames)
+    libmseed_memory.free (zs->frames);
+  if (zs->inbuf)
+    libmseed_memory.free (zs->inbuf);
+  if (zs->outbuf)
+    libmseed_memory.free (zs->outbuf);
+
+  libmseed_memory.free (zs);
+} /* End of zstd_free() */
+
+/*********************************************************************
+ * Open a zstd compressed file for reading if the file at 'fp' starts
+ * with a zstd frame.  On success the IO handle takes ownership of
+ * 'fp'.
+ *
+ * Files in the zstd seekable format, with a seek table of frame sizes
+ * at the end, are decompressed in batches of frames in parallel.
+ * Other zstd files are decompressed as a single stream.
+ *
+ * If 'startoffset' is non-zero the stream is positioned at this
+ * uncompressed offset, for seekable input starting decompression at
+ * the frame containing the offset.
+ *
+ * Returns 1 when the file is zstd compressed and opened, 0 when the
+ * file is not zstd compressed and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+static int
+zstd_open (LMIO *io, FILE *fp, const char *path, int64_t *startoffset)
+{
+  struct lm_zstd_s *zs;
+  unsigned char header[4];
+  size_t readcount;
+  uint64_t maxcsize = 0;
+  uint64_t maxdsize = 0;
+  uint64_t batchsize;
+  uint64_t coffset = 0;
+  uint64_t skip;
+  uint32_t idx;
+  int rv;
+
+  /* Detection requires rewinding, leave non-seekable streams alone */
+  if (lmp_ftell64 (fp) != 0)
+    return 0;
+
+  readcount = fread (header, 1, sizeof (header), fp);
+
+  if (lmp_fseek64 (fp, 0, SEEK_SET))
+  {
+    ms_log (2, "Cannot seek in %s\n", path);
+    return -1;
+  }
+
+  if (readcount != sizeof (header) || zstd_le32 (header) != ZSTD_FRAMEMAGIC)
+    return 0;
+
+  if ((zs = (struct lm_zstd_s *)libmseed_memory.malloc (sizeof (struct lm_zstd_s))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return -1;
+  }
+
+  memset (zs, 0, sizeof (struct lm_zstd_s));
+  zs->fp = fp;
+
+  if ((rv = zstd_read_seektable (zs)) < 0)
+  {
+    zs->fp = NULL;
+    zstd_free (zs);
+    return -1;
+  }
+
+  /* Position at the frame containing the start offset when seekable */
+  if (zs->frames && startoffset && *startoffset > 0)
+  {
+    while (zs->nextframe + 1 < zs->framecount &&
+           zs->frames[zs->nextframe + 1].uoffset <= (uint64_t)*startoffset)
+      zs->nextframe++;
+
+    coffset = zs->frames[zs->nextframe].coffset;
+    zs->uoffset = zs->frames[zs->nextframe].uoffset;
+  }
+
+  if (lmp_fseek64 (fp, (int64_t)coffset, SEEK_SET))
+  {
+    ms_log (2, "Cannot seek in %s\n", path);
+    zs->fp = NULL;
+    zstd_free (zs);
+    return -1;
+  }
+
+  for (idx = 0; idx < zs->framecount; idx++)
+  {
+    if (zs->frames[idx].csize > maxcsize)
+      maxcsize = zs->frames[idx].csize;
+    if (zs->frames[idx].dsize > maxdsize)
+      maxdsize = zs->frames[idx].dsize;
+  }
+
+  /* Parallel decompression of seekable frames of limited size */
+  zs->parallel = (zs->frames && maxcsize <= ZSTD_MAXFRAME && maxdsize <= ZSTD_MAXFRAME);
+
+  if (zs->parallel)
+  {
+    batchsize = (uint64_t)lm_thread_count (gZSTDthreads) * ZSTD_BATCHBYTES;
+    zs->insize = (size_t)((maxcsize > batchsize) ? maxcsize : batchsize);
+    zs->outsize = (size_t)((maxdsize > batchsize) ? maxdsize : batchsize);
+  }
+  else
+  {
+    zs->insize = ZSTD_DStreamInSize ();
+    zs->outsize = ZSTD_DStreamOutSize ();
+
+    if ((zs->dctx = ZSTD_createDCtx ()) == NULL)
+    {
+      ms_log (2, "Cannot initialize zstd decompression\n");
+      zs->fp = NULL;
+      zstd_free (zs);
+      return -1;
+    }
+  }
+
+  zs->inbuf = (unsigned char *)libmseed_memory.malloc (zs->insize);
+  zs->outbuf = (unsigned char *)libmseed_memory.malloc (zs->outsize);
+  zs->input.src = zs->inbuf;
+
+  if (zs->inbuf == NULL || zs->outbuf == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    zs->fp = NULL;
+    zstd_free (zs);
+    return -1;
+  }
+
+  /* Skip to the uncompressed start offset */
+  if (startoffset && *startoffset > 0)
+  {
+    skip = (uint64_t)*startoffset - zs->uoffset;
+
+    if (zstd_read (zs, NULL, (size_t)skip) != (int64_t)skip)
+    {
+      ms_log (2, "Cannot position %s at uncompressed offset %" PRId64 "\n", path, *startoffset);
+      zs->fp = NULL;
+      zstd_free (zs);
+      return -1;
+    }
+  }
+
+  io->type = LMIO_ZSTD;
+  io->handle = zs;
+  io->handle2 = NULL;
+
+  return 1;
+} /* End of zstd_open() */
+
+#endif /* defined(LIBMSEED_ZSTD) */
 
 
 /***************************************************************************
@@ -209,86 +1816,21 @@ msio_fopen (LMIO *io, const char *path, const char *mode,
     long response_code;
     struct header_callback_parameters hcp;
 
-    io->type = LMIO_URL;
-
-    /* Check for URL debugging environment variable */
-    if (libmseed_url_debug < 0)
-    {
-      if (getenv ("LIBMSEED_URL_DEBUG"))
-        libmseed_url_debug = 1;
-      else
-        libmseed_url_debug = 0;
-    }
-
-    /* Check for SSL peer/host verify environment variable */
-    if (libmseed_ssl_noverify < 0)
-    {
-      if (getenv ("LIBMSEED_SSL_NOVERIFY"))
-        libmseed_ssl_noverify = 1;
-      else
-        libmseed_ssl_noverify = 0;
-    }
-
-    /* Configure the libcurl easy handle, duplicate global options if present */
-    io->handle = (gCURLeasy) ? curl_easy_duphandle (gCURLeasy) : curl_easy_init ();
-
-    if (io->handle == NULL)
-    {
-      ms_log (2, "Cannot initialize CURL handle\n");
-      return -1;
-    }
-
-    /* URL debug */
-    if (libmseed_url_debug && curl_easy_setopt (io->handle, CURLOPT_VERBOSE, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_VERBOSE\n");
-      return -1;
-    }
-
-    /* SSL peer and host verification */
-    if (libmseed_ssl_noverify &&
-        (curl_easy_setopt (io->handle, CURLOPT_SSL_VERIFYPEER, 0L) != CURLE_OK ||
-         curl_easy_setopt (io->handle, CURLOPT_SSL_VERIFYHOST, 0L) != CURLE_OK))
-    {
-      ms_log (2, "Cannot set CURLOPT_SSL_VERIFYPEER and/or CURLOPT_SSL_VERIFYHOST\n");
-      return -1;
-    }
-
-    /* Set URL */
-    if (curl_easy_setopt (io->handle, CURLOPT_URL, path) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_URL\n");
-      return -1;
-    }
-
-    /* Set default User-Agent header, can be overridden via custom header */
-    if (curl_easy_setopt (io->handle, CURLOPT_USERAGENT,
-                          "libmseed/" LIBMSEED_VERSION " libcurl/" LIBCURL_VERSION) != CURLE_OK)
+    /* Try parallel range requests if configured, fall back to a single stream */
+    if (gURLconnections > 1)
     {
-      ms_log (2, "Cannot set default CURLOPT_USERAGENT\n");
-      return -1;
-    }
+      int rv = url_ranges_open (io, path, startoffset, endoffset);
 
-    /* Disable signals */
-    if (curl_easy_setopt (io->handle, CURLOPT_NOSIGNAL, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_NOSIGNAL\n");
-      return -1;
+      if (rv < 0)
+        return -1;
+      else if (rv > 0)
+        return 0;
     }
 
-    /* Return failure codes on errors */
-    if (curl_easy_setopt (io->handle, CURLOPT_FAILONERROR, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_FAILONERROR\n");
-      return -1;
-    }
+    io->type = LMIO_URL;
 
-    /* Follow HTTP redirects */
-    if (curl_easy_setopt (io->handle, CURLOPT_FOLLOWLOCATION, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_FOLLOWLOCATION\n");
+    if ((io->handle = url_easy_init (path)) == NULL)
       return -1;
-    }
 
     /* Configure write callback for recv'ed data */
     if (curl_easy_setopt (io->handle, CURLOPT_WRITEFUNCTION, recv_callback) != CURLE_OK)
@@ -356,13 +1898,6 @@ msio_fopen (LMIO *io, const char *path, const char *mode,
       }
     }
 
-    /* Set custom headers */
-    if (gCURLheaders && curl_easy_setopt (io->handle, CURLOPT_HTTPHEADER, gCURLheaders) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_HTTPHEADER\n");
-      return -1;
-    }
-
     /* Set connection as still running */
     io->still_running = 1;
 
@@ -393,6 +1928,32 @@ msio_fopen (LMIO *io, const char *path, const char *mode,
       return -1;
     }
 
+#if defined(LIBMSEED_ZLIB)
+    /* Read gzip compressed files transparently, offsets are in uncompressed data */
+    if (mode[0] == 'r')
+    {
+      int rv = gzip_open (io, io->handle, path, startoffset);
+
+      if (rv < 0)
+        return -1;
+      else if (rv > 0)
+        return 0;
+    }
+#endif
+
+#if defined(LIBMSEED_ZSTD)
+    /* Read zstd compressed files transparently, offsets are in uncompressed data */
+    if (mode[0] == 'r')
+    {
+      int rv = zstd_open (io, io->handle, path, startoffset);
+
+      if (rv < 0)
+        return -1;
+      else if (rv > 0)
+        return 0;
+    }
+#endif
+
     /* Seek to position if start offset is provided */
     if (startoffset && *startoffset > 0)
     {
@@ -451,6 +2012,33 @@ msio_fclose (LMIO *io)
     curl_multi_cleanup (io->handle2);
 #endif
   }
+  else if (io->type == LMIO_URLRANGES)
+  {
+#if !defined(LIBMSEED_URL)
+    ms_log (2, "URL support not included in library\n");
+    return -1;
+#else
+    url_ranges_free ((struct url_ranges_s *)io->handle);
+#endif
+  }
+  else if (io->type == LMIO_GZIP)
+  {
+#if !defined(LIBMSEED_ZLIB)
+    ms_log (2, "gzip support not included in library\n");
+    return -1;
+#else
+    gzip_free ((struct lm_gzip_s *)io->handle);
+#endif
+  }
+  else if (io->type == LMIO_ZSTD)
+  {
+#if !defined(LIBMSEED_ZSTD)
+    ms_log (2, "zstd support not included in library\n");
+    return -1;
+#else
+    zstd_free ((struct lm_zstd_s *)io->handle);
+#endif
+  }
 
   io->type = LMIO_NULL;
   io->handle = NULL;
@@ -579,6 +2167,39 @@ msio_fread (LMIO *io, void *buffer, size_t size)
 
 #endif /* defined(LIBMSEED_URL) */
   }
+  /* Read from URL with parallel range requests */
+  else if (io->type == LMIO_URLRANGES)
+  {
+#if !defined(LIBMSEED_URL)
+    ms_log (2, "URL support not included in library\n");
+    return -1;
+#else
+    if (size == 0)
+      return 0;
+
+    return (size_t)url_ranges_read (io, buffer, size);
+#endif
+  }
+  /* Read from gzip compressed file */
+  else if (io->type == LMIO_GZIP)
+  {
+#if !defined(LIBMSEED_ZLIB)
+    ms_log (2, "gzip support not included in library\n");
+    return -1;
+#else
+    return (size_t)gzip_read ((struct lm_gzip_s *)io->handle, buffer, size);
+#endif
+  }
+  /* Read from zstd compressed file */
+  else if (io->type == LMIO_ZSTD)
+  {
+#if !defined(LIBMSEED_ZSTD)
+    ms_log (2, "zstd support not included in library\n");
+    return -1;
+#else
+    return (size_t)zstd_read ((struct lm_zstd_s *)io->handle, buffer, size);
+#endif
+  }
 
   return read;
 } /* End of msio_fread() */
@@ -604,7 +2225,7 @@ msio_feof (LMIO *io)
     if (feof ((FILE *)io->handle))
       return 1;
   }
-  else if (io->type == LMIO_URL)
+  else if (io->type == LMIO_URL || io->type == LMIO_URLRANGES)
   {
 #if !defined(LIBMSEED_URL)
     ms_log (2, "URL support not included in library\n");
@@ -617,6 +2238,32 @@ msio_feof (LMIO *io)
       return 1;
 #endif
   }
+  else if (io->type == LMIO_GZIP)
+  {
+#if !defined(LIBMSEED_ZLIB)
+    ms_log (2, "gzip support not included in library\n");
+    return -1;
+#else
+    struct lm_gzip_s *gz = (struct lm_gzip_s *)io->handle;
+
+    /* End when input is exhausted and all uncompressed data consumed */
+    if (gz->eof && gz->outpos == gz->outlen)
+      return 1;
+#endif
+  }
+  else if (io->type == LMIO_ZSTD)
+  {
+#if !defined(LIBMSEED_ZSTD)
+    ms_log (2, "zstd support not included in library\n");
+    return -1;
+#else
+    struct lm_zstd_s *zs = (struct lm_zstd_s *)io->handle;
+
+    /* End when input is exhausted and all uncompressed data consumed */
+    if (zs->eof && zs->outpos == zs->outlen)
+      return 1;
+#endif
+  }
 
   return 0;
 } /* End of msio_feof() */
@@ -742,6 +2389,36 @@ msio_url_addheader (const char *header)
   return 0;
 } /* End of msio_url_addheader() */
 
+/*********************************************************************
+ * msio_url_parallel:
+ *
+ * Set global parallel range request parameters for URL-based IO.
+ *
+ * Returns 0 on succes non-zero otherwise.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+msio_url_parallel (int connections, uint64_t chunksize)
+{
+  if (connections < 0)
+  {
+    ms_log (2, "%s(): Connection count cannot be negative: %d\n", __func__, connections);
+    return -1;
+  }
+
+#if !defined(LIBMSEED_URL)
+  (void)chunksize; /* Unused */
+  ms_log (2, "URL support not included in library\n");
+  return -1;
+#else
+  gURLconnections = connections;
+  gURLchunksize = (chunksize) ? chunksize : LM_URL_DEFAULT_CHUNKSIZE;
+#endif
+
+  return 0;
+} /* End of msio_url_parallel() */
+
 /*********************************************************************
  * msio_url_freeheaders:
  *
@@ -762,6 +2439,161 @@ msio_url_freeheaders (void)
 #endif
 } /* End of msio_url_freeheaders() */
 
+/*********************************************************************
+ * msio_gzip_threads:
+ *
+ * Set the global number of threads used to decompress BGZF blocks, 0
+ * means all available processors.
+ *
+ * Returns 0 on succes non-zero otherwise.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+msio_gzip_threads (int nthreads)
+{
+  if (nthreads < 0)
+  {
+    ms_log (2, "%s(): Thread count cannot be negative: %d\n", __func__, nthreads);
+    return -1;
+  }
+
+#if !defined(LIBMSEED_ZLIB)
+  ms_log (2, "gzip support not included in library\n");
+  return -1;
+#else
+  gGZIPthreads = nthreads;
+#endif
+
+  return 0;
+} /* End of msio_gzip_threads() */
+
+/*********************************************************************
+ * msio_zstd_threads:
+ *
+ * Set the global number of threads used to decompress frames of
+ * seekable zstd files, 0 means all available processors.
+ *
+ * Returns 0 on succes non-zero otherwise.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+msio_zstd_threads (int nthreads)
+{
+  if (nthreads < 0)
+  {
+    ms_log (2, "%s(): Thread count cannot be negative: %d\n", __func__, nthreads);
+    return -1;
+  }
+
+#if !defined(LIBMSEED_ZSTD)
+  ms_log (2, "zstd support not included in library\n");
+  return -1;
+#else
+  gZSTDthreads = nthreads;
+#endif
+
+  return 0;
+} /* End of msio_zstd_threads() */
+
+/*********************************************************************
+ * msio_gzip_writeindex:
+ *
+ * Write the block index of a BGZF file that has been read completely
+ * from the beginning to 'indexpath'.  The format is the same as the
+ * .gzi index written by bgzip: a little-endian 64-bit count of
+ * entries followed by pairs of little-endian 64-bit compressed and
+ * uncompressed offsets for each block after the first.
+ *
+ * Returns 0 on succes non-zero otherwise.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+msio_gzip_writeindex (LMIO *io, const char *indexpath)
+{
+#if !defined(LIBMSEED_ZLIB)
+  (void)io; /* Unused */
+  (void)indexpath; /* Unused */
+  ms_log (2, "gzip support not included in library\n");
+  return -1;
+#else
+  struct lm_gzip_s *gz;
+  FILE *fp;
+  uint64_t values[2];
+  uint64_t count;
+  size_t idx;
+  int swapflag = ms_bigendianhost ();
+
+  if (!io || !indexpath)
+  {
+    ms_log (2, "%s(): Required input not defined: 'io' or 'indexpath'\n", __func__);
+    return -1;
+  }
+
+  gz = (struct lm_gzip_s *)io->handle;
+
+  if (io->type != LMIO_GZIP || !gz->bgzf)
+  {
+    ms_log (2, "%s(): Input is not BGZF compressed\n", __func__);
+    return -1;
+  }
+
+  if (!gz->tablevalid || !gz->eof)
+  {
+    ms_log (2, "%s(): Input was not read completely from the beginning\n", __func__);
+    return -1;
+  }
+
+  if ((fp = fopen (indexpath, "wb")) == NULL)
+  {
+    ms_log (2, "Cannot open %s for writing (%s)\n", indexpath, strerror (errno));
+    return -1;
+  }
+
+  /* The first block, at offset 0, is implied */
+  count = (gz->tablecount > 0) ? gz->tablecount - 1 : 0;
+
+  if (swapflag)
+    ms_gswap8 (&count);
+
+  if (fwrite (&count, sizeof (count), 1, fp) != 1)
+  {
+    ms_log (2, "Cannot write to %s (%s)\n", indexpath, strerror (errno));
+    fclose (fp);
+    return -1;
+  }
+
+  for (idx = 1; idx < gz->tablecount; idx++)
+  {
+    values[0] = gz->table[idx].coffset;
+    values[1] = gz->table[idx].uoffset;
+
+    if (swapflag)
+    {
+      ms_gswap8 (&values[0]);
+      ms_gswap8 (&values[1]);
+    }
+
+    if (fwrite (values, sizeof (values), 1, fp) != 1)
+    {
+      ms_log (2, "Cannot write to %s (%s)\n", indexpath, strerror (errno));
+      fclose (fp);
+      return -1;
+    }
+  }
+
+  if (fclose (fp))
+  {
+    ms_log (2, "Cannot close %s (%s)\n", indexpath, strerror (errno));
+    return -1;
+  }
+
+  return 0;
+#endif
+} /* End of msio_gzip_writeindex() */
+
 /***************************************************************************
  * lmp_ftell64:
  *
@@ -796,6 +2628,82 @@ lmp_fseek64 (FILE *stream, int64_t offset, int whence)
 } /* End of lmp_fseeko() */
 
 
+/***************************************************************************
+ * lmp_pread:
+ *
+ * Read up to size bytes from an absolute offset in the file underlying
+ * the specified stream using the system's closest match to the POSIX
+ * pread().  The stream buffer is bypassed and, except on Windows, the
+ * file position is not changed, allowing concurrent reads of the same
+ * file from multiple threads.
+ *
+ * Reading is repeated until size bytes are read, the end of the file
+ * is reached or an error occurs.
+ *
+ * Returns the number of bytes read or -1 on error.
+ ***************************************************************************/
+int64_t
+lmp_pread (FILE *stream, void *buffer, size_t size, int64_t offset)
+{
+  size_t total = 0;
+
+#if defined(LMP_WIN)
+  HANDLE handle = (HANDLE)_get_osfhandle (_fileno (stream));
+  OVERLAPPED overlapped;
+  DWORD request;
+  DWORD nread;
+
+  if (handle == INVALID_HANDLE_VALUE)
+    return -1;
+
+  while (total < size)
+  {
+    memset (&overlapped, 0, sizeof (overlapped));
+    overlapped.Offset = (DWORD) ((uint64_t) (offset + total) & 0xFFFFFFFF);
+    overlapped.OffsetHigh = (DWORD) ((uint64_t) (offset + total) >> 32);
+
+    request = (size - total > 0x40000000) ? 0x40000000 : (DWORD) (size - total);
+
+    if (!ReadFile (handle, (char *)buffer + total, request, &nread, &overlapped))
+    {
+      if (GetLastError () == ERROR_HANDLE_EOF)
+        break;
+
+      return -1;
+    }
+
+    if (nread == 0)
+      break;
+
+    total += nread;
+  }
+#else
+  ssize_t nread;
+  int fd = fileno (stream);
+
+  while (total < size)
+  {
+    nread = pread (fd, (char *)buffer + total, size - total, (off_t) (offset + total));
+
+    if (nread < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      return -1;
+    }
+
+    if (nread == 0)
+      break;
+
+    total += (size_t)nread;
+  }
+#endif
+
+  return (int64_t)total;
+} /* End of lmp_pread() */
+
+
 /***************************************************************************
  * @brief Sleep for a specified number of nanoseconds
  *
@@ -35,7 +35,11 @@ extern int msio_feof (LMIO *io);
 extern int msio_url_useragent (const char *program, const char *version);
 extern int msio_url_userpassword (const char *userpassword);
 extern int msio_url_addheader (const char *header);
+extern int msio_url_parallel (int connections, uint64_t chunksize);
 extern void msio_url_freeheaders (void);
+extern int msio_gzip_threads (int nthreads);
+extern int msio_gzip_writeindex (LMIO *io, const char *indexpath);
+extern int msio_zstd_threads (int nthreads);
 
 #ifdef __cplusplus
 }
@@ -578,6 +578,438 @@ msr3_pack_header3 (const MS3Record *msr, char *record, uint32_t recbuflen, int8_
   return (MS3FSDH_LENGTH + (int)sidlength + msr->extralength);
 } /* End of msr3_pack_header3() */
 
+/* Internal state of a streaming packer, see msr3_streampack_init() */
+struct MS3StreamPacker_s
+{
+  char sid[LM_SIDLEN];
+  double samprate;
+  char sampletype;
+  uint8_t encoding;
+  int8_t swapflag;
+  int8_t verbose;
+  int samplesize;
+  int dataoffset;          /* Offset to data in record, after all headers */
+  uint32_t maxdatabytes;   /* Maximum encoded data bytes per record */
+  uint32_t maxsamples;     /* Maximum samples that can fit in a record */
+  char *record;            /* Record buffer with packed headers */
+  char *encoded;           /* Separate encoded data buffer for alignment */
+  char *samples;           /* Sample buffer */
+  uint32_t capacity;       /* Sample buffer capacity in samples */
+  uint32_t bufstart;       /* Index of first buffered sample */
+  uint32_t buffered;       /* Number of buffered samples */
+  nstime_t halfperiod;     /* Half of the sample period, continuity tolerance */
+  nstime_t segstart;       /* Time of first sample of continuous series */
+  int64_t segpacked;       /* Samples packed since segstart */
+  void (*record_handler) (char *, int, void *);
+  void *handlerdata;
+};
+
+/**********************************************************************/ /**
+ * @brief Initialize a streaming packer for a single channel
+ *
+ * A streaming packer produces miniSEED version 3 records from a
+ * continuous series of data samples that arrive in arbitrary
+ * increments, e.g. from a real-time source.  Samples added with
+ * msr3_streampack_add() are buffered and each record is passed to \a
+ * record_handler() as soon as it is filled.  This is an alternative
+ * to repeated calls to mstl3_pack() or msr3_pack() that avoids
+ * re-deriving header state and re-allocating buffers for each call.
+ *
+ * All buffers are allocated by this function: the record buffer with
+ * the fixed header, SID and extra headers already packed, an encoding
+ * buffer and a sample buffer sized to a small multiple of the samples
+ * that fit in a record.  Adding samples and producing records does
+ * not allocate memory.
+ *
+ * The template \a msr provides the header values used for all
+ * records: ::MS3Record.sid, ::MS3Record.samprate,
+ * ::MS3Record.pubversion, ::MS3Record.flags, ::MS3Record.extra and
+ * ::MS3Record.extralength, and the packing parameters
+ * ::MS3Record.reclen, ::MS3Record.encoding and ::MS3Record.sampletype.
+ * The ::MS3Record.starttime is the time of the first sample to be
+ * added.  Defaults for record length and encoding are used when set
+ * to -1, see msr3_pack().  The template is not referenced after this
+ * function returns.
+ *
+ * The \a record_handler() is called with the same arguments as for
+ * msr3_pack(), the record buffer is re-used when it returns.
+ *
+ * Records are identical to those produced by msr3_pack() for the
+ * same series of samples with the ::MSF_FLUSHDATA flag when all
+ * samples are added with a single call and then flushed.
+ *
+ * Only miniSEED version 3 is supported, a template with
+ * ::MS3Record.formatversion of 2 is an error.
+ *
+ * @param[in] msr ::MS3Record template for header values and packing parameters
+ * @param[in] record_handler() Callback function called for each record
+ * @param[in] handlerdata A pointer that will be provided to the \a record_handler()
+ * @param[in] verbose Controls logging verbosity, 0 is no diagnostic output
+ *
+ * @returns a pointer to a new ::MS3StreamPacker on success and NULL on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa msr3_streampack_add()
+ * \sa msr3_streampack_flush()
+ * \sa msr3_streampack_free()
+ ***************************************************************************/
+MS3StreamPacker *
+msr3_streampack_init (const MS3Record *msr, void (*record_handler) (char *, int, void *),
+                      void *handlerdata, int8_t verbose)
+{
+  MS3StreamPacker *packer = NULL;
+  uint32_t maxreclen;
+
+  if (!msr)
+  {
+    ms_log (2, "%s(): Required input not defined: 'msr'\n", __func__);
+    return NULL;
+  }
+
+  if (!record_handler)
+  {
+    ms_log (2, "callback record_handler() function pointer not set!\n");
+    return NULL;
+  }
+
+  if (msr->formatversion == 2)
+  {
+    ms_log (2, "%s: Streaming packer only supports miniSEED version 3\n", msr->sid);
+    return NULL;
+  }
+
+  if ((msr->reclen != -1) && (msr->reclen < MINRECLEN || msr->reclen > MAXRECLEN))
+  {
+    ms_log (2, "%s: Record length is out of range: %d\n", msr->sid, msr->reclen);
+    return NULL;
+  }
+
+  if (msr->samprate == 0.0)
+  {
+    ms_log (2, "%s: Sample rate is required for streaming\n", msr->sid);
+    return NULL;
+  }
+
+  maxreclen = (msr->reclen < 0) ? MS_PACK_DEFAULT_RECLEN : msr->reclen;
+
+  if (maxreclen < (MS3FSDH_LENGTH + strlen(msr->sid) + msr->extralength))
+  {
+    ms_log (2, "%s: Record length (%u) is not large enough for header (%u), SID (%"PRIsize_t"), and extra (%d)\n",
+            msr->sid, maxreclen, MS3FSDH_LENGTH, strlen(msr->sid), msr->extralength);
+    return NULL;
+  }
+
+  packer = (MS3StreamPacker *)libmseed_memory.malloc (sizeof (MS3StreamPacker));
+
+  if (packer == NULL)
+  {
+    ms_log (2, "%s: Cannot allocate memory\n", msr->sid);
+    return NULL;
+  }
+
+  memset (packer, 0, sizeof (MS3StreamPacker));
+
+  memcpy (packer->sid, msr->sid, sizeof (packer->sid));
+  packer->samprate = msr->samprate;
+  packer->sampletype = msr->sampletype;
+  packer->encoding = (msr->encoding < 0) ? MS_PACK_DEFAULT_ENCODING : msr->encoding;
+  packer->swapflag = (ms_bigendianhost ()) ? 1 : 0;
+  packer->verbose = verbose;
+  packer->segstart = msr->starttime;
+  packer->halfperiod = (nstime_t)(NSTMODULUS / (2.0 * msr3_sampratehz (msr)));
+  packer->record_handler = record_handler;
+  packer->handlerdata = handlerdata;
+
+  if (!(packer->samplesize = ms_samplesize (msr->sampletype)))
+  {
+    ms_log (2, "%s: Unknown sample type '%c'\n", msr->sid, msr->sampletype);
+    msr3_streampack_free (&packer);
+    return NULL;
+  }
+
+  if ((packer->record = (char *)libmseed_memory.malloc (maxreclen)) == NULL)
+  {
+    ms_log (2, "%s: Cannot allocate memory\n", msr->sid);
+    msr3_streampack_free (&packer);
+    return NULL;
+  }
+
+  memset (packer->record, 0, MS3FSDH_LENGTH);
+
+  /* Pack fixed header and extra headers once, returned size is data offset */
+  if ((packer->dataoffset = msr3_pack_header3 (msr, packer->record, maxreclen, verbose)) < 0)
+  {
+    ms_log (2, "%s: Cannot pack miniSEED version 3 header\n", msr->sid);
+    msr3_streampack_free (&packer);
+    return NULL;
+  }
+
+  /* Determine the max data bytes and sample count */
+  packer->maxdatabytes = maxreclen - packer->dataoffset;
+
+  if (packer->encoding == DE_STEIM1)
+    packer->maxsamples = (uint32_t)(packer->maxdatabytes / 64) * STEIM1_FRAME_MAX_SAMPLES;
+  else if (packer->encoding == DE_STEIM2)
+    packer->maxsamples = (uint32_t)(packer->maxdatabytes / 64) * STEIM2_FRAME_MAX_SAMPLES;
+  else
+    packer->maxsamples = packer->maxdatabytes / packer->samplesize;
+
+  if (packer->maxsamples == 0)
+  {
+    ms_log (2, "%s: Record length (%u) leaves no space for data samples\n", msr->sid, maxreclen);
+    msr3_streampack_free (&packer);
+    return NULL;
+  }
+
+  /* Room for a full record of samples beyond the maximum left buffered */
+  packer->capacity = packer->maxsamples * 2 + 1;
+
+  packer->encoded = (char *)libmseed_memory.malloc (packer->maxdatabytes);
+  packer->samples = (char *)libmseed_memory.malloc ((size_t)packer->capacity * packer->samplesize);
+
+  if (packer->encoded == NULL || packer->samples == NULL)
+  {
+    ms_log (2, "%s: Cannot allocate memory\n", msr->sid);
+    msr3_streampack_free (&packer);
+    return NULL;
+  }
+
+  return packer;
+} /* End of msr3_streampack_init() */
+
+/***************************************************************************
+ * msr3_streampack_record:
+ *
+ * Pack a single record from up to 'available' buffered samples and
+ * send it to the record handler.
+ *
+ * Returns the number of samples packed on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+static int64_t
+msr3_streampack_record (MS3StreamPacker *packer, uint32_t available)
+{
+  char *record = packer->record;
+  int64_t packsamples;
+  uint32_t datalength;
+  uint32_t reclen;
+  uint32_t crc;
+  nstime_t starttime;
+  uint16_t year;
+  uint16_t day;
+  uint8_t hour;
+  uint8_t min;
+  uint8_t sec;
+  uint32_t nsec;
+
+  packsamples = msr_pack_data (packer->encoded,
+                               packer->samples + (size_t)packer->bufstart * packer->samplesize,
+                               available, packer->maxdatabytes,
+                               packer->sampletype, packer->encoding, packer->swapflag,
+                               &datalength, packer->sid, packer->verbose);
+
+  if (packsamples <= 0)
+  {
+    ms_log (2, "%s: Error packing data samples\n", packer->sid);
+    return -1;
+  }
+
+  /* Record start time relative to start of series, as msr3_pack() */
+  starttime = ms_sampletime (packer->segstart, packer->segpacked, packer->samprate);
+
+  if (ms_nstime2time (starttime, &year, &day, &hour, &min, &sec, &nsec))
+  {
+    ms_log (2, "%s: Cannot convert record starttime: %" PRId64 "\n", packer->sid, starttime);
+    return -1;
+  }
+
+  reclen = packer->dataoffset + datalength;
+
+  memcpy (record + packer->dataoffset, packer->encoded, datalength);
+
+  *pMS3FSDH_NSEC (record) = HO4u (nsec, packer->swapflag);
+  *pMS3FSDH_YEAR (record) = HO2u (year, packer->swapflag);
+  *pMS3FSDH_DAY (record) = HO2u (day, packer->swapflag);
+  *pMS3FSDH_HOUR (record) = hour;
+  *pMS3FSDH_MIN (record) = min;
+  *pMS3FSDH_SEC (record) = sec;
+  *pMS3FSDH_NUMSAMPLES(record) = HO4u ((uint32_t)packsamples, packer->swapflag);
+  *pMS3FSDH_DATALENGTH(record) = HO4u (datalength, packer->swapflag);
+
+  /* Calculate CRC (with CRC field set to 0) and set */
+  memset (pMS3FSDH_CRC(record), 0, sizeof(uint32_t));
+  crc = ms_crc32c ((const uint8_t*)record, reclen, 0);
+  *pMS3FSDH_CRC(record) = HO4u (crc, packer->swapflag);
+
+  if (packer->verbose >= 1)
+    ms_log (0, "%s: Packed %" PRId64 " samples into %u byte record\n", packer->sid, packsamples, reclen);
+
+  packer->record_handler (record, reclen, packer->handlerdata);
+
+  packer->segpacked += packsamples;
+  packer->buffered -= (uint32_t)packsamples;
+  packer->bufstart = (packer->buffered) ? packer->bufstart + (uint32_t)packsamples : 0;
+
+  return packsamples;
+} /* End of msr3_streampack_record() */
+
+/**********************************************************************/ /**
+ * @brief Add data samples to a streaming packer
+ *
+ * Append \a count samples of the type specified in the template to
+ * msr3_streampack_init() to the series buffered by \a packer.  Every
+ * record that is filled is packed and passed to the record handler
+ * before this function returns, fewer than a record of samples
+ * remain buffered.
+ *
+ * The \a starttime is the time of the first sample in \a samples.  If
+ * set to ::NSTUNSET the samples are assumed to continue the series.
+ * If the time is not within half a sample period of the next
+ * expected sample time, any buffered samples are flushed and a new
+ * series is started at \a starttime.
+ *
+ * @param[in] packer ::MS3StreamPacker to add samples to
+ * @param[in] starttime Time of first sample or ::NSTUNSET if continuous
+ * @param[in] samples Array of data samples
+ * @param[in] count Number of data samples in \a samples
+ *
+ * @returns the number of records created on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int64_t
+msr3_streampack_add (MS3StreamPacker *packer, nstime_t starttime,
+                     const void *samples, uint32_t count)
+{
+  int64_t recordcnt = 0;
+  int64_t flushed;
+  nstime_t nexttime;
+  uint32_t bufend;
+  uint32_t copycount;
+
+  if (!packer || (!samples && count > 0))
+  {
+    ms_log (2, "%s(): Required input not defined: 'packer' or 'samples'\n", __func__);
+    return -1;
+  }
+
+  /* Start a new series when samples are not continuous with buffered series */
+  if (starttime != NSTUNSET)
+  {
+    nexttime = ms_sampletime (packer->segstart, packer->segpacked + packer->buffered,
+                              packer->samprate);
+
+    if (starttime < nexttime - packer->halfperiod || starttime > nexttime + packer->halfperiod)
+    {
+      if ((flushed = msr3_streampack_flush (packer)) < 0)
+        return -1;
+
+      recordcnt += flushed;
+      packer->segstart = starttime;
+      packer->segpacked = 0;
+    }
+  }
+
+  while (count > 0)
+  {
+    /* Move buffered samples to the front when the end of the buffer is reached */
+    bufend = packer->bufstart + packer->buffered;
+
+    if (bufend == packer->capacity)
+    {
+      memmove (packer->samples,
+               packer->samples + (size_t)packer->bufstart * packer->samplesize,
+               (size_t)packer->buffered * packer->samplesize);
+      packer->bufstart = 0;
+      bufend = packer->buffered;
+    }
+
+    copycount = packer->capacity - bufend;
+    if (copycount > count)
+      copycount = count;
+
+    memcpy (packer->samples + (size_t)bufend * packer->samplesize, samples,
+            (size_t)copycount * packer->samplesize);
+
+    samples = (const char *)samples + (size_t)copycount * packer->samplesize;
+    packer->buffered += copycount;
+    count -= copycount;
+
+    /* Pack records while more than a full record of samples is buffered */
+    while (packer->buffered > packer->maxsamples)
+    {
+      if (msr3_streampack_record (packer, packer->buffered) < 0)
+        return -1;
+
+      recordcnt++;
+    }
+  }
+
+  return recordcnt;
+} /* End of msr3_streampack_add() */
+
+/**********************************************************************/ /**
+ * @brief Pack all buffered samples of a streaming packer
+ *
+ * All buffered samples are packed into records, the last of which
+ * will usually not be filled.  Samples subsequently added continue
+ * the same series unless a discontinuous start time is specified.
+ *
+ * @param[in] packer ::MS3StreamPacker to flush
+ *
+ * @returns the number of records created on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int64_t
+msr3_streampack_flush (MS3StreamPacker *packer)
+{
+  int64_t recordcnt = 0;
+
+  if (!packer)
+  {
+    ms_log (2, "%s(): Required input not defined: 'packer'\n", __func__);
+    return -1;
+  }
+
+  while (packer->buffered > 0)
+  {
+    if (msr3_streampack_record (packer, packer->buffered) < 0)
+      return -1;
+
+    recordcnt++;
+  }
+
+  return recordcnt;
+} /* End of msr3_streampack_flush() */
+
+/**********************************************************************/ /**
+ * @brief Free a streaming packer and all associated buffers
+ *
+ * Buffered samples are discarded, call msr3_streampack_flush() first
+ * to pack them.
+ *
+ * @param[in] ppacker Pointer to ::MS3StreamPacker to free, set to NULL
+ ***************************************************************************/
+void
+msr3_streampack_free (MS3StreamPacker **ppacker)
+{
+  if (ppacker == NULL || *ppacker == NULL)
+    return;
+
+  if ((*ppacker)->record)
+    libmseed_memory.free ((*ppacker)->record);
+  if ((*ppacker)->encoded)
+    libmseed_memory.free ((*ppacker)->encoded);
+  if ((*ppacker)->samples)
+    libmseed_memory.free ((*ppacker)->samples);
+
+  libmseed_memory.free (*ppacker);
+  *ppacker = NULL;
+} /* End of msr3_streampack_free() */
+
 /***************************************************************************
  * msr3_pack_mseed2:
  *
@@ -25,9 +25,12 @@
 #include <time.h>
 
 #include "libmseed.h"
+#include "selection.h"
 
 static int ms_isinteger (const char *string);
 static int ms_globmatch (const char *string, const char *pattern);
+static int ms_matchselecttime (const MS3SelectTime *selecttime,
+                               nstime_t starttime, nstime_t endtime);
 
 /**********************************************************************/ /**
  * @brief Test the specified parameters for a matching selection entry
@@ -88,16 +91,7 @@ ms3_matchselect (const MS3Selections *selections, const char *sid, nstime_t star
         findst = findsl->timewindows;
         while (findst)
         {
-          if (starttime != NSTERROR && starttime != NSTUNSET &&
-              findst->starttime != NSTERROR && findst->starttime != NSTUNSET &&
-              (starttime < findst->starttime && !(starttime <= findst->starttime && endtime >= findst->starttime)))
-          {
-            findst = findst->next;
-            continue;
-          }
-          else if (endtime != NSTERROR && endtime != NSTUNSET &&
-                   findst->endtime != NSTERROR && findst->endtime != NSTUNSET &&
-                   (endtime > findst->endtime && !(starttime <= findst->endtime && endtime >= findst->endtime)))
+          if (!ms_matchselecttime (findst, starttime, endtime))
           {
             findst = findst->next;
             continue;
@@ -742,6 +736,512 @@ ms3_printselections (const MS3Selections *selections)
   }
 } /* End of ms3_printselections() */
 
+/* Time window of a compiled selection, with list position */
+struct lm_selectwindow
+{
+  nstime_t starttime;
+  nstime_t endtime;
+  const MS3SelectTime *selecttime;
+  size_t order;
+};
+
+/* Compiled selection entry */
+struct lm_selectentry
+{
+  const MS3Selections *selection;
+  struct lm_selectwindow *windows;     /* Closed windows sorted by start time */
+  nstime_t *maxendtime;                /* Running maximum of closed window end times */
+  size_t windowcount;                  /* Number of closed windows */
+  struct lm_selectwindow *openwindows; /* Windows with an open or invalid time, in list order */
+  size_t openwindowcount;              /* Number of open windows */
+  int32_t next;                        /* Next entry in hash chain or trie node, -1 if last */
+};
+
+/* Node of prefix trie for glob patterns */
+struct lm_selectnode
+{
+  int32_t child;   /* First child node, -1 if none */
+  int32_t sibling; /* Next sibling node, -1 if none */
+  int32_t first;   /* First entry with pattern prefix ending at this node, -1 if none */
+  char c;          /* Character of prefix */
+};
+
+struct LMSelectMatcher
+{
+  const MS3Selections *selections;
+  struct lm_selectentry *entries; /* Entries in selection list order */
+  size_t entrycount;
+  int32_t *buckets; /* Hash table of exact source ID patterns */
+  uint32_t bucketmask;
+  struct lm_selectnode *nodes; /* Prefix trie of glob patterns, node 0 is root */
+  size_t nodecount;
+  struct lm_selectwindow *windowstore;
+  nstime_t *maxendstore;
+};
+
+/* Test for an open or invalid time value */
+#define LM_SELECT_OPENTIME(X) ((X) == NSTERROR || (X) == NSTUNSET)
+
+/***************************************************************************
+ * ms_matchselecttime:
+ *
+ * Test if a time range matches a selection time window, either
+ * intersecting the window or with open or unset window boundaries.
+ *
+ * Returns 1 if matching and 0 otherwise.
+ ***************************************************************************/
+static int
+ms_matchselecttime (const MS3SelectTime *selecttime, nstime_t starttime, nstime_t endtime)
+{
+  if (starttime != NSTERROR && starttime != NSTUNSET &&
+      selecttime->starttime != NSTERROR && selecttime->starttime != NSTUNSET &&
+      (starttime < selecttime->starttime && !(starttime <= selecttime->starttime && endtime >= selecttime->starttime)))
+  {
+    return 0;
+  }
+  else if (endtime != NSTERROR && endtime != NSTUNSET &&
+           selecttime->endtime != NSTERROR && selecttime->endtime != NSTUNSET &&
+           (endtime > selecttime->endtime && !(starttime <= selecttime->endtime && endtime >= selecttime->endtime)))
+  {
+    return 0;
+  }
+
+  return 1;
+} /* End of ms_matchselecttime() */
+
+/* FNV-1a hash of a source ID pattern */
+static uint32_t
+lm_select_hash (const char *string)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*string)
+  {
+    hash ^= (uint8_t)*string++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/* Order windows by start time and list position */
+static int
+lm_select_windowcmp (const void *a, const void *b)
+{
+  const struct lm_selectwindow *wa = (const struct lm_selectwindow *)a;
+  const struct lm_selectwindow *wb = (const struct lm_selectwindow *)b;
+
+  if (wa->starttime != wb->starttime)
+    return (wa->starttime < wb->starttime) ? -1 : 1;
+
+  return (wa->order < wb->order) ? -1 : (wa->order > wb->order);
+}
+
+/***************************************************************************
+ * lm_selectmatcher_compile:
+ *
+ * Compile a ::MS3Selections list into a structure optimized for
+ * matching with lm_selectmatcher_match():
+ *
+ *  - Exact source ID patterns, without globbing characters, are stored
+ *    in a hash table.
+ *  - Glob patterns are stored in a prefix trie by the literal prefix
+ *    before the first globbing character, limiting the patterns that
+ *    are tested to those with a prefix of the source ID.
+ *  - Closed time windows are sorted by start time with a running
+ *    maximum of end times, allowing intersecting windows to be found
+ *    with a binary search.
+ *
+ * The compiled matcher references, but does not copy, the selection
+ * entries.  The selections must not be modified or freed while the
+ * compiled matcher is in use.
+ *
+ * Returns a compiled matcher on success and NULL on error.
+ ***************************************************************************/
+LMSelectMatcher *
+lm_selectmatcher_compile (const MS3Selections *selections)
+{
+  LMSelectMatcher *matcher = NULL;
+  const MS3Selections *select;
+  const MS3SelectTime *selecttime;
+  struct lm_selectentry *entry;
+  struct lm_selectwindow *window;
+  struct lm_selectnode *node;
+  size_t totalwindows = 0;
+  size_t totalprefix = 0;
+  size_t windowoffset = 0;
+  size_t buckets;
+  size_t order;
+  size_t idx;
+  int32_t nodeidx;
+  int32_t childidx;
+  int32_t *tail;
+  const char *cp;
+
+  if (!selections)
+  {
+    ms_log (2, "%s(): Required input not defined: 'selections'\n", __func__);
+    return NULL;
+  }
+
+  if ((matcher = (LMSelectMatcher *)libmseed_memory.malloc (sizeof (LMSelectMatcher))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return NULL;
+  }
+  memset (matcher, 0, sizeof (LMSelectMatcher));
+
+  matcher->selections = selections;
+
+  /* Count entries, windows and glob pattern prefix lengths */
+  for (select = selections; select; select = select->next)
+  {
+    matcher->entrycount++;
+
+    for (selecttime = select->timewindows; selecttime; selecttime = selecttime->next)
+      totalwindows++;
+
+    totalprefix += strlen (select->sidpattern);
+  }
+
+  if (matcher->entrycount > INT32_MAX || totalprefix >= INT32_MAX)
+  {
+    ms_log (2, "%s(): Too many selections to compile\n", __func__);
+    libmseed_memory.free (matcher);
+    return NULL;
+  }
+
+  for (buckets = 16; buckets < matcher->entrycount * 2; buckets *= 2)
+    ;
+  matcher->bucketmask = (uint32_t) (buckets - 1);
+
+  matcher->entries = (struct lm_selectentry *)libmseed_memory.malloc (matcher->entrycount * sizeof (struct lm_selectentry));
+  matcher->buckets = (int32_t *)libmseed_memory.malloc (buckets * sizeof (int32_t));
+  matcher->nodes = (struct lm_selectnode *)libmseed_memory.malloc ((totalprefix + 1) * sizeof (struct lm_selectnode));
+  matcher->windowstore = (struct lm_selectwindow *)libmseed_memory.malloc ((totalwindows + 1) * sizeof (struct lm_selectwindow));
+  matcher->maxendstore = (nstime_t *)libmseed_memory.malloc ((totalwindows + 1) * sizeof (nstime_t));
+
+  if (!matcher->entries || !matcher->buckets || !matcher->nodes ||
+      !matcher->windowstore || !matcher->maxendstore)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    lm_selectmatcher_free (matcher);
+    return NULL;
+  }
+
+  for (idx = 0; idx < buckets; idx++)
+    matcher->buckets[idx] = -1;
+
+  /* Initialize root node */
+  matcher->nodes[0].child = -1;
+  matcher->nodes[0].sibling = -1;
+  matcher->nodes[0].first = -1;
+  matcher->nodes[0].c = '\0';
+  matcher->nodecount = 1;
+
+  for (select = selections, idx = 0; select; select = select->next, idx++)
+  {
+    entry = &matcher->entries[idx];
+    entry->selection = select;
+    entry->windows = matcher->windowstore + windowoffset;
+    entry->maxendtime = matcher->maxendstore + windowoffset;
+    entry->windowcount = 0;
+    entry->openwindowcount = 0;
+    entry->next = -1;
+
+    /* Separate closed windows from those with open or invalid times */
+    for (selecttime = select->timewindows, order = 0; selecttime; selecttime = selecttime->next, order++)
+    {
+      if (!LM_SELECT_OPENTIME (selecttime->starttime) && !LM_SELECT_OPENTIME (selecttime->endtime))
+      {
+        window = &entry->windows[entry->windowcount++];
+        window->starttime = selecttime->starttime;
+        window->endtime = selecttime->endtime;
+        window->selecttime = selecttime;
+        window->order = order;
+      }
+    }
+
+    entry->openwindows = entry->windows + entry->windowcount;
+
+    for (selecttime = select->timewindows, order = 0; selecttime; selecttime = selecttime->next, order++)
+    {
+      if (LM_SELECT_OPENTIME (selecttime->starttime) || LM_SELECT_OPENTIME (selecttime->endtime))
+      {
+        window = &entry->openwindows[entry->openwindowcount++];
+        window->starttime = selecttime->starttime;
+        window->endtime = selecttime->endtime;
+        window->selecttime = selecttime;
+        window->order = order;
+      }
+    }
+
+    windowoffset += entry->windowcount + entry->openwindowcount;
+
+    if (entry->windowcount > 1)
+      qsort (entry->windows, entry->windowcount, sizeof (struct lm_selectwindow), lm_select_windowcmp);
+
+    for (order = 0; order < entry->windowcount; order++)
+    {
+      entry->maxendtime[order] = entry->windows[order].endtime;
+
+      if (order > 0 && entry->maxendtime[order - 1] > entry->maxendtime[order])
+        entry->maxendtime[order] = entry->maxendtime[order - 1];
+    }
+
+    /* Add exact patterns to the end of the hash chain */
+    if (strpbrk (select->sidpattern, "*?[\\") == NULL)
+    {
+      tail = &matcher->buckets[lm_select_hash (select->sidpattern) & matcher->bucketmask];
+    }
+    /* Add glob patterns to the trie node of their literal prefix */
+    else
+    {
+      nodeidx = 0;
+
+      for (cp = select->sidpattern; *cp && !strchr ("*?[\\", *cp); cp++)
+      {
+        for (childidx = matcher->nodes[nodeidx].child; childidx >= 0;
+             childidx = matcher->nodes[childidx].sibling)
+        {
+          if (matcher->nodes[childidx].c == *cp)
+            break;
+        }
+
+        if (childidx < 0)
+        {
+          childidx = (int32_t)matcher->nodecount++;
+          node = &matcher->nodes[childidx];
+          node->child = -1;
+          node->sibling = matcher->nodes[nodeidx].child;
+          node->first = -1;
+          node->c = *cp;
+          matcher->nodes[nodeidx].child = childidx;
+        }
+
+        nodeidx = childidx;
+      }
+
+      tail = &matcher->nodes[nodeidx].first;
+    }
+
+    while (*tail >= 0)
+      tail = &matcher->entries[*tail].next;
+
+    *tail = (int32_t)idx;
+  }
+
+  return matcher;
+} /* End of lm_selectmatcher_compile() */
+
+/***************************************************************************
+ * lm_select_matchentry:
+ *
+ * Test a compiled selection entry for a matching time window.  The
+ * first matching window in list order is returned via \a ppselecttime,
+ * or NULL if the selection has no time windows.
+ *
+ * Returns 1 if matching and 0 otherwise.
+ ***************************************************************************/
+static int
+lm_select_matchentry (const struct lm_selectentry *entry, nstime_t starttime,
+                      nstime_t endtime, const MS3SelectTime **ppselecttime)
+{
+  const MS3SelectTime *selecttime;
+  const struct lm_selectwindow *match = NULL;
+  size_t low;
+  size_t high;
+  size_t mid;
+  size_t idx;
+
+  /* If no time selection, this is a match */
+  if (!entry->selection->timewindows)
+  {
+    *ppselecttime = NULL;
+    return 1;
+  }
+
+  /* Search windows in list order for open or inverted time ranges */
+  if (LM_SELECT_OPENTIME (starttime) || LM_SELECT_OPENTIME (endtime) || starttime > endtime)
+  {
+    for (selecttime = entry->selection->timewindows; selecttime; selecttime = selecttime->next)
+    {
+      if (ms_matchselecttime (selecttime, starttime, endtime))
+      {
+        *ppselecttime = selecttime;
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+
+  /* Find closed windows starting at or before the end time */
+  low = 0;
+  high = entry->windowcount;
+  while (low < high)
+  {
+    mid = low + (high - low) / 2;
+
+    if (entry->windows[mid].starttime <= endtime)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  /* Search for intersecting windows while any preceding window ends at or after the start time */
+  for (idx = low; idx > 0 && entry->maxendtime[idx - 1] >= starttime; idx--)
+  {
+    if (entry->windows[idx - 1].endtime >= starttime &&
+        (!match || entry->windows[idx - 1].order < match->order))
+      match = &entry->windows[idx - 1];
+  }
+
+  for (idx = 0; idx < entry->openwindowcount; idx++)
+  {
+    if (match && entry->openwindows[idx].order > match->order)
+      break;
+
+    if (ms_matchselecttime (entry->openwindows[idx].selecttime, starttime, endtime))
+    {
+      match = &entry->openwindows[idx];
+      break;
+    }
+  }
+
+  *ppselecttime = (match) ? match->selecttime : NULL;
+
+  return (match) ? 1 : 0;
+} /* End of lm_select_matchentry() */
+
+/***************************************************************************
+ * lm_selectmatcher_match:
+ *
+ * Search a compiled selection list for an entry matching the provided
+ * parameters.  The result is identical to ms3_matchselect() for the
+ * selections the matcher was compiled from: the first matching entry
+ * in list order, and the first matching time window of that entry.
+ *
+ * Returns a pointer to the matching ::MS3Selections entry and NULL for
+ * no match.
+ ***************************************************************************/
+const MS3Selections *
+lm_selectmatcher_match (const LMSelectMatcher *matcher, const char *sid, nstime_t starttime,
+                        nstime_t endtime, int pubversion, const MS3SelectTime **ppselecttime)
+{
+  const struct lm_selectentry *entry;
+  const MS3SelectTime *selecttime = NULL;
+  const MS3SelectTime *matchst = NULL;
+  int32_t match = -1;
+  int32_t entryidx;
+  int32_t nodeidx;
+  const char *cp;
+
+  if (!matcher || !sid)
+  {
+    if (ppselecttime)
+      *ppselecttime = NULL;
+
+    return NULL;
+  }
+
+  /* Search exact patterns */
+  for (entryidx = matcher->buckets[lm_select_hash (sid) & matcher->bucketmask];
+       entryidx >= 0; entryidx = matcher->entries[entryidx].next)
+  {
+    entry = &matcher->entries[entryidx];
+
+    if (strcmp (sid, entry->selection->sidpattern) ||
+        (entry->selection->pubversion > 0 && entry->selection->pubversion != pubversion))
+      continue;
+
+    if (lm_select_matchentry (entry, starttime, endtime, &selecttime))
+    {
+      match = entryidx;
+      matchst = selecttime;
+      break;
+    }
+  }
+
+  /* Search glob patterns with a literal prefix of the source ID,
+   * ignoring entries later in the list than a current match */
+  nodeidx = 0;
+  cp = sid;
+  while (nodeidx >= 0)
+  {
+    for (entryidx = matcher->nodes[nodeidx].first;
+         entryidx >= 0 && (match < 0 || entryidx < match);
+         entryidx = matcher->entries[entryidx].next)
+    {
+      entry = &matcher->entries[entryidx];
+
+      if ((entry->selection->pubversion > 0 && entry->selection->pubversion != pubversion) ||
+          !ms_globmatch (sid, entry->selection->sidpattern))
+        continue;
+
+      if (lm_select_matchentry (entry, starttime, endtime, &selecttime))
+      {
+        match = entryidx;
+        matchst = selecttime;
+        break;
+      }
+    }
+
+    if (!*cp)
+      break;
+
+    for (nodeidx = matcher->nodes[nodeidx].child; nodeidx >= 0;
+         nodeidx = matcher->nodes[nodeidx].sibling)
+    {
+      if (matcher->nodes[nodeidx].c == *cp)
+        break;
+    }
+
+    cp++;
+  }
+
+  if (ppselecttime)
+    *ppselecttime = matchst;
+
+  return (match >= 0) ? matcher->entries[match].selection : NULL;
+} /* End of lm_selectmatcher_match() */
+
+/***************************************************************************
+ * lm_selectmatcher_selections:
+ *
+ * Returns the selection list a matcher was compiled from.
+ ***************************************************************************/
+const MS3Selections *
+lm_selectmatcher_selections (const LMSelectMatcher *matcher)
+{
+  return (matcher) ? matcher->selections : NULL;
+} /* End of lm_selectmatcher_selections() */
+
+/***************************************************************************
+ * lm_selectmatcher_free:
+ *
+ * Free all memory associated with a compiled selection matcher.
+ ***************************************************************************/
+void
+lm_selectmatcher_free (LMSelectMatcher *matcher)
+{
+  if (!matcher)
+    return;
+
+  if (matcher->entries)
+    libmseed_memory.free (matcher->entries);
+  if (matcher->buckets)
+    libmseed_memory.free (matcher->buckets);
+  if (matcher->nodes)
+    libmseed_memory.free (matcher->nodes);
+  if (matcher->windowstore)
+    libmseed_memory.free (matcher->windowstore);
+  if (matcher->maxendstore)
+    libmseed_memory.free (matcher->maxendstore);
+
+  libmseed_memory.free (matcher);
+} /* End of lm_selectmatcher_free() */
+
 /***************************************************************************
  * ms_isinteger:
  *
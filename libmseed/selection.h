@@ -0,0 +1,44 @@
+/***************************************************************************
+ * Interface declarations for compiled selection matching in selection.c
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2024 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef SELECTION_H
+#define SELECTION_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libmseed.h"
+
+/* Opaque compiled selection matcher */
+typedef struct LMSelectMatcher LMSelectMatcher;
+
+extern LMSelectMatcher *lm_selectmatcher_compile (const MS3Selections *selections);
+extern const MS3Selections *lm_selectmatcher_match (const LMSelectMatcher *matcher, const char *sid,
+                                                    nstime_t starttime, nstime_t endtime,
+                                                    int pubversion, const MS3SelectTime **ppselecttime);
+extern const MS3Selections *lm_selectmatcher_selections (const LMSelectMatcher *matcher);
+extern void lm_selectmatcher_free (LMSelectMatcher *matcher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
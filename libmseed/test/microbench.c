@@ -0,0 +1,709 @@
+/***************************************************************************
+ * Microbenchmarks of frequently called libmseed routines.
+ *
+ * Each benchmark runs a routine on fixed inputs generated in memory.
+ * The number of iterations per batch is calibrated so that a batch
+ * runs for at least the minimum batch time, followed by a warmup
+ * period.  Then a number of batches are timed and the time per
+ * operation is reported as the minimum, median, mean and standard
+ * deviation over the batches.
+ *
+ * Usage: microbench [-s batches] [-t msec] [-w msec] [-j]
+ *                   [-b baseline] [-p percent] [filter ...]
+ *
+ *   -s batches  Number of timed batches, default 15
+ *   -t msec     Minimum time of a batch in milliseconds, default 20
+ *   -w msec     Warmup time in milliseconds, default 100
+ *   -j          Print results as JSON lines instead of a table
+ *   -b baseline Compare with a baseline of JSON lines from a previous run
+ *   -p percent  Tolerated slowdown relative to the baseline, default 25
+ *   filter      Only run benchmarks with names containing a filter
+ *
+ * With a baseline, the minimum time per operation of each benchmark is
+ * compared to that of the baseline, as the minimum is least affected
+ * by other activity on the host.  Benchmarks slower than the
+ * tolerance allows are run again after the others, up to MAXRETRIES
+ * times, to rule out a transient disturbance, and the exit status is 1
+ * if any remains slower.  Results are printed when all are complete.
+ *
+ * The Steim routines operate on frames in host byte order.
+ ***************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libmseed.h>
+#include <packdata.h>
+#include <unpackdata.h>
+#include <yyjson.h>
+
+#define SAMPLECOUNT 4000     /* Samples in the generated time series */
+#define RECORDLENGTH 4096    /* Length of generated records */
+#define TRACERECORDS 1000    /* Records added to a trace list per iteration */
+#define TRACEIDS 250         /* Source identifiers of the many-IDs trace list */
+#define MAXBATCHES 1000
+#define MAXBASELINES 100
+#define MAXRETRIES 2
+
+typedef struct Benchmark
+{
+  const char *name;
+  const char *unit;                 /* Items processed by an operation */
+  int64_t items;                    /* Items per operation */
+  void (*run) (int64_t iterations); /* Run the operation iterations times */
+} Benchmark;
+
+typedef struct Result
+{
+  int64_t iterations; /* Per batch */
+  int batches;
+  double minimum;     /* Nanoseconds per operation */
+  double median;
+  double mean;
+  double stddev;
+} Result;
+
+typedef struct Baseline
+{
+  char name[64];
+  double minimum; /* Nanoseconds per operation */
+} Baseline;
+
+static Baseline baselines[MAXBASELINES];
+static int baselinecount = 0;
+
+/* Accumulates results so operations are not optimized away */
+static volatile uint64_t sink;
+
+static int32_t samples[SAMPLECOUNT];
+static int32_t steim1frames[SAMPLECOUNT + 16];
+static int32_t steim2frames[SAMPLECOUNT + 16];
+static int64_t steim1bytes;
+static int64_t steim2bytes;
+static int32_t decoded[SAMPLECOUNT];
+
+/* Records, indexed by format version 2 or 3, plain or with blockettes/extra headers */
+static char records[2][2][RECORDLENGTH];
+static MS3Record *parsemsr = NULL;
+
+static MS3Record traceinorder[TRACERECORDS];
+static MS3Record traceoutoforder[TRACERECORDS];
+static MS3Record tracemanyids[TRACERECORDS];
+
+static uint64_t randomstate = 0x2545F4914F6CDD1DULL;
+
+static uint64_t
+Random (void)
+{
+  randomstate ^= randomstate >> 12;
+  randomstate ^= randomstate << 25;
+  randomstate ^= randomstate >> 27;
+  return randomstate * 0x2545F4914F6CDD1DULL;
+}
+
+static double
+Now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Record handler for msr3_pack(), keep the first record */
+static void
+KeepRecord (char *record, int reclen, void *handlerdata)
+{
+  char *buffer = handlerdata;
+
+  if (buffer[0] == '\0')
+    memcpy (buffer, record, (reclen < RECORDLENGTH) ? reclen : RECORDLENGTH);
+}
+
+/* Pack a record of Steim2 encoded samples */
+static int
+PackRecord (char *buffer, uint8_t formatversion, const char *extra)
+{
+  MS3Record *msr;
+  int64_t packedsamples;
+
+  if (!(msr = msr3_init (NULL)))
+    return -1;
+
+  strcpy (msr->sid, "FDSN:XX_TEST_00_B_H_Z");
+  msr->formatversion = formatversion;
+  msr->reclen = RECORDLENGTH;
+  msr->encoding = DE_STEIM2;
+  msr->starttime = ms_timestr2nstime ("2024-01-01T00:00:00.000000Z");
+  msr->samprate = 100.0;
+  msr->pubversion = 1;
+  msr->datasamples = samples;
+  msr->numsamples = SAMPLECOUNT;
+  msr->sampletype = 'i';
+
+  if (extra)
+  {
+    msr->extra = (char *)extra;
+    msr->extralength = (uint16_t)strlen (extra);
+  }
+
+  buffer[0] = '\0';
+  msr3_pack (msr, KeepRecord, buffer, &packedsamples, MSF_FLUSHDATA, 0);
+
+  msr->datasamples = NULL;
+  msr->extra = NULL;
+  msr3_free (&msr);
+
+  return (buffer[0]) ? 0 : -1;
+}
+
+/* Initialize a record header for adding to a trace list */
+static void
+TraceRecord (MS3Record *msr, int id, int sequence)
+{
+  memset (msr, 0, sizeof (MS3Record));
+
+  snprintf (msr->sid, sizeof (msr->sid), "FDSN:XX_S%03d_00_B_H_Z", id);
+  msr->formatversion = 3;
+  msr->reclen = 512;
+  msr->pubversion = 1;
+  msr->samprate = 100.0;
+  msr->samplecnt = 400;
+  msr->starttime = ms_timestr2nstime ("2024-01-01T00:00:00.000000Z") +
+                   (nstime_t)sequence * 4 * NSTMODULUS;
+}
+
+static int
+GenerateInputs (void)
+{
+  const char *extra = "{\"FDSN\":{\"Time\":{\"Quality\":80},"
+                      "\"Event\":{\"Detection\":[{\"Type\":\"MURDOCK\",\"SignalAmplitude\":80,"
+                      "\"SignalPeriod\":0.4,\"BackgroundEstimate\":18,\"Wave\":\"DILATATION\","
+                      "\"Units\":\"COUNTS\",\"OnsetTime\":\"2024-01-01T00:00:10.000000Z\","
+                      "\"MEDSNR\":[1,3,2,1,4,0],\"MEDLookback\":2,\"MEDPickAlgorithm\":0,"
+                      "\"Detector\":\"Z_SPWWSS\"}]}}}";
+  uint32_t byteswritten;
+  int64_t swap;
+  int idx;
+
+  /* Sine with noise, differences of mixed widths exercise all Steim sub-frame types */
+  for (idx = 0; idx < SAMPLECOUNT; idx++)
+    samples[idx] = (int32_t)(20000.0 * sin (idx * 0.05)) + (int32_t)(Random () % 512) - 256;
+
+  if (msr_encode_steim1 (samples, SAMPLECOUNT, steim1frames, sizeof (steim1frames), 0,
+                         &byteswritten, 0) != SAMPLECOUNT)
+    return -1;
+  steim1bytes = byteswritten;
+
+  if (msr_encode_steim2 (samples, SAMPLECOUNT, steim2frames, sizeof (steim2frames), 0,
+                         &byteswritten, "steim2", 0) != SAMPLECOUNT)
+    return -1;
+  steim2bytes = byteswritten;
+
+  /* Verify the frames decode to the samples */
+  if (msr_decode_steim1 (steim1frames, steim1bytes, SAMPLECOUNT, decoded, sizeof (decoded),
+                         "steim1", 0) != SAMPLECOUNT ||
+      memcmp (decoded, samples, sizeof (samples)))
+    return -1;
+
+  if (msr_decode_steim2 (steim2frames, steim2bytes, SAMPLECOUNT, decoded, sizeof (decoded),
+                         "steim2", 0) != SAMPLECOUNT ||
+      memcmp (decoded, samples, sizeof (samples)))
+    return -1;
+
+  if (PackRecord (records[0][0], 2, NULL) || PackRecord (records[0][1], 2, extra) ||
+      PackRecord (records[1][0], 3, NULL) || PackRecord (records[1][1], 3, extra))
+    return -1;
+
+  /* Verify the records parse, with blockettes or extra headers as expected */
+  for (idx = 0; idx < 4; idx++)
+  {
+    if (msr3_parse (records[idx / 2][idx % 2], RECORDLENGTH, &parsemsr, MSF_VALIDATECRC, 0) ||
+        parsemsr->formatversion != idx / 2 + 2 || (parsemsr->extralength > 0) != idx % 2)
+      return -1;
+  }
+
+  /* One identifier in time order, the same records shuffled, and many identifiers */
+  for (idx = 0; idx < TRACERECORDS; idx++)
+  {
+    TraceRecord (&traceinorder[idx], 0, idx);
+    TraceRecord (&traceoutoforder[idx], 0, idx);
+    TraceRecord (&tracemanyids[idx], idx % TRACEIDS, idx / TRACEIDS);
+  }
+
+  for (idx = TRACERECORDS - 1; idx > 0; idx--)
+  {
+    MS3Record tmp;
+
+    swap = (int64_t)(Random () % (uint64_t)(idx + 1));
+    tmp = traceoutoforder[idx];
+    traceoutoforder[idx] = traceoutoforder[swap];
+    traceoutoforder[swap] = tmp;
+  }
+
+  return 0;
+}
+
+static void
+RunDetect (const char *record, int64_t iterations)
+{
+  uint8_t formatversion;
+
+  while (iterations-- > 0)
+    sink += (uint64_t)ms3_detect (record, RECORDLENGTH, &formatversion);
+}
+
+static void
+RunParse (const char *record, uint32_t flags, int64_t iterations)
+{
+  while (iterations-- > 0)
+    sink += (uint64_t)msr3_parse (record, RECORDLENGTH, &parsemsr, flags, 0);
+}
+
+static void
+RunTraceList (const MS3Record *msrs, int64_t iterations)
+{
+  MS3TraceList *mstl;
+  int idx;
+
+  while (iterations-- > 0)
+  {
+    mstl = mstl3_init (NULL);
+
+    for (idx = 0; idx < TRACERECORDS; idx++)
+      sink += (uint64_t)(uintptr_t)mstl3_addmsr (mstl, &msrs[idx], 0, 1, 0, NULL);
+
+    sink += mstl->numtraceids;
+    mstl3_free (&mstl, 0);
+  }
+}
+
+static void
+DetectV2 (int64_t iterations) { RunDetect (records[0][0], iterations); }
+static void
+DetectV3 (int64_t iterations) { RunDetect (records[1][0], iterations); }
+static void
+ParseV2 (int64_t iterations) { RunParse (records[0][0], 0, iterations); }
+static void
+ParseV2Blockettes (int64_t iterations) { RunParse (records[0][1], 0, iterations); }
+static void
+ParseV3 (int64_t iterations) { RunParse (records[1][0], 0, iterations); }
+static void
+ParseV3ExtraHeaders (int64_t iterations) { RunParse (records[1][1], 0, iterations); }
+static void
+ParseV3CRC (int64_t iterations) { RunParse (records[1][0], MSF_VALIDATECRC, iterations); }
+static void
+TraceInOrder (int64_t iterations) { RunTraceList (traceinorder, iterations); }
+static void
+TraceOutOfOrder (int64_t iterations) { RunTraceList (traceoutoforder, iterations); }
+static void
+TraceManyIDs (int64_t iterations) { RunTraceList (tracemanyids, iterations); }
+
+static void
+CRC32C (int64_t iterations)
+{
+  while (iterations-- > 0)
+    sink += ms_crc32c ((const uint8_t *)records[1][0], RECORDLENGTH, 0);
+}
+
+static void
+DecodeSteim1 (int64_t iterations)
+{
+  while (iterations-- > 0)
+    sink += (uint64_t)msr_decode_steim1 (steim1frames, steim1bytes, SAMPLECOUNT, decoded,
+                                         sizeof (decoded), "steim1", 0);
+}
+
+static void
+DecodeSteim2 (int64_t iterations)
+{
+  while (iterations-- > 0)
+    sink += (uint64_t)msr_decode_steim2 (steim2frames, steim2bytes, SAMPLECOUNT, decoded,
+                                         sizeof (decoded), "steim2", 0);
+}
+
+static void
+EncodeSteim1 (int64_t iterations)
+{
+  static int32_t frames[SAMPLECOUNT + 16];
+  uint32_t byteswritten;
+
+  while (iterations-- > 0)
+    sink += (uint64_t)msr_encode_steim1 (samples, SAMPLECOUNT, frames, sizeof (frames), 0,
+                                         &byteswritten, 0);
+}
+
+static void
+EncodeSteim2 (int64_t iterations)
+{
+  static int32_t frames[SAMPLECOUNT + 16];
+  uint32_t byteswritten;
+
+  while (iterations-- > 0)
+    sink += (uint64_t)msr_encode_steim2 (samples, SAMPLECOUNT, frames, sizeof (frames), 0,
+                                         &byteswritten, "steim2", 0);
+}
+
+static void
+TimeStringISO (int64_t iterations)
+{
+  char timestr[40];
+  nstime_t nstime = ms_timestr2nstime ("2024-02-29T12:34:56.123456789Z");
+
+  while (iterations-- > 0)
+    sink += (uint64_t)(uintptr_t)ms_nstime2timestr (nstime + iterations, timestr,
+                                                    ISOMONTHDAY_Z, NANO_MICRO_NONE);
+}
+
+static void
+TimeStringOrdinal (int64_t iterations)
+{
+  char timestr[40];
+  nstime_t nstime = ms_timestr2nstime ("2024-02-29T12:34:56.123456Z");
+
+  while (iterations-- > 0)
+    sink += (uint64_t)(uintptr_t)ms_nstime2timestr (nstime + iterations * 1000, timestr,
+                                                    SEEDORDINAL, NANO_MICRO_NONE);
+}
+
+static void
+SIDToNSLC (int64_t iterations)
+{
+  char net[11], sta[11], loc[11], chan[11];
+
+  while (iterations-- > 0)
+    sink += (uint64_t)ms_sid2nslc ("FDSN:XX_TEST_00_B_H_Z", net, sta, loc, chan);
+}
+
+static Benchmark benchmarks[] = {
+    {"ms3_detect/v2", "records", 1, DetectV2},
+    {"ms3_detect/v3", "records", 1, DetectV3},
+    {"msr3_parse/v2", "records", 1, ParseV2},
+    {"msr3_parse/v2-blockettes", "records", 1, ParseV2Blockettes},
+    {"msr3_parse/v3", "records", 1, ParseV3},
+    {"msr3_parse/v3-extraheaders", "records", 1, ParseV3ExtraHeaders},
+    {"msr3_parse/v3-crc", "records", 1, ParseV3CRC},
+    {"mstl3_addmsr/in-order", "records", TRACERECORDS, TraceInOrder},
+    {"mstl3_addmsr/out-of-order", "records", TRACERECORDS, TraceOutOfOrder},
+    {"mstl3_addmsr/many-ids", "records", TRACERECORDS, TraceManyIDs},
+    {"ms_crc32c/4096", "bytes", RECORDLENGTH, CRC32C},
+    {"steim1/decode", "samples", SAMPLECOUNT, DecodeSteim1},
+    {"steim1/encode", "samples", SAMPLECOUNT, EncodeSteim1},
+    {"steim2/decode", "samples", SAMPLECOUNT, DecodeSteim2},
+    {"steim2/encode", "samples", SAMPLECOUNT, EncodeSteim2},
+    {"ms_nstime2timestr/isomonthday", "strings", 1, TimeStringISO},
+    {"ms_nstime2timestr/seedordinal", "strings", 1, TimeStringOrdinal},
+    {"ms_sid2nslc", "identifiers", 1, SIDToNSLC},
+};
+
+static int
+CompareDouble (const void *a, const void *b)
+{
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+static void
+RunBenchmark (const Benchmark *bm, int batches, double batchtime, double warmuptime,
+              Result *result)
+{
+  double times[MAXBATCHES];
+  double start;
+  double elapsed;
+  double sum = 0.0;
+  double squares = 0.0;
+  int64_t iterations = 1;
+  int idx;
+
+  /* Calibrate iterations per batch, which is also the start of the warmup */
+  start = Now ();
+  for (;;)
+  {
+    elapsed = Now ();
+    bm->run (iterations);
+    elapsed = Now () - elapsed;
+
+    if (elapsed >= batchtime)
+      break;
+
+    iterations *= 2;
+  }
+
+  while (Now () - start < warmuptime)
+    bm->run (iterations);
+
+  for (idx = 0; idx < batches; idx++)
+  {
+    elapsed = Now ();
+    bm->run (iterations);
+    times[idx] = (Now () - elapsed) / iterations;
+
+    sum += times[idx];
+  }
+
+  result->iterations = iterations;
+  result->batches = batches;
+  result->mean = sum / batches;
+
+  for (idx = 0; idx < batches; idx++)
+    squares += (times[idx] - result->mean) * (times[idx] - result->mean);
+
+  result->stddev = (batches > 1) ? sqrt (squares / (batches - 1)) : 0.0;
+
+  qsort (times, batches, sizeof (double), CompareDouble);
+
+  result->minimum = times[0];
+  result->median = (batches % 2) ? times[batches / 2]
+                                 : (times[batches / 2 - 1] + times[batches / 2]) / 2.0;
+}
+
+/* Load baseline results from JSON lines, returns the count or -1 on error */
+static int
+LoadBaseline (const char *filename)
+{
+  char line[2048];
+  yyjson_doc *doc;
+  yyjson_val *root;
+  const char *name;
+  double minimum;
+  FILE *fp;
+
+  if (!(fp = fopen (filename, "r")))
+  {
+    fprintf (stderr, "Cannot open baseline %s\n", filename);
+    return -1;
+  }
+
+  while (fgets (line, sizeof (line), fp) && baselinecount < MAXBASELINES)
+  {
+    if (!(doc = yyjson_read (line, strlen (line), 0)))
+      continue;
+
+    root = yyjson_doc_get_root (doc);
+    name = yyjson_get_str (yyjson_obj_get (root, "benchmark"));
+    minimum = yyjson_get_num (yyjson_obj_get (root, "min_ns"));
+
+    if (name && minimum > 0.0)
+    {
+      snprintf (baselines[baselinecount].name, sizeof (baselines[baselinecount].name), "%s", name);
+      baselines[baselinecount].minimum = minimum;
+      baselinecount++;
+    }
+
+    yyjson_doc_free (doc);
+  }
+
+  fclose (fp);
+
+  return baselinecount;
+}
+
+/* Find the baseline minimum of a benchmark, 0 if none */
+static double
+BaselineMinimum (const char *name)
+{
+  int idx;
+
+  for (idx = 0; idx < baselinecount; idx++)
+    if (!strcmp (baselines[idx].name, name))
+      return baselines[idx].minimum;
+
+  return 0.0;
+}
+
+static int
+Selected (const char *name, int filtercount, char **filters)
+{
+  int idx;
+
+  if (filtercount == 0)
+    return 1;
+
+  for (idx = 0; idx < filtercount; idx++)
+    if (strstr (name, filters[idx]))
+      return 1;
+
+  return 0;
+}
+
+/* Print the table header, with baseline columns if comparing */
+static void
+PrintHeader (int comparing)
+{
+  printf ("%-30s %12s %12s %12s %10s %14s%s\n", "benchmark", "median ns/op", "min ns/op",
+          "mean ns/op", "stddev %", "items/s",
+          (comparing) ? "             baseline min   change" : "");
+}
+
+/* Print a result as a table row or JSON line, with the baseline change if any */
+static void
+PrintResult (const Benchmark *bm, const Result *result, double baseline, double tolerance,
+             int json, int tabular)
+{
+  double change = (baseline > 0.0) ? 100.0 * (result->minimum - baseline) / baseline : 0.0;
+  int regressed = (baseline > 0.0 && change > tolerance);
+
+  if (json)
+  {
+    printf ("{\"benchmark\":\"%s\",\"unit\":\"%s\",\"items_per_op\":%" PRId64
+            ",\"iterations\":%" PRId64 ",\"batches\":%d,\"median_ns\":%.3f,\"min_ns\":%.3f"
+            ",\"mean_ns\":%.3f,\"stddev_ns\":%.3f,\"items_per_second\":%.1f",
+            bm->name, bm->unit, bm->items, result->iterations, result->batches,
+            result->median, result->minimum, result->mean, result->stddev,
+            bm->items * 1e9 / result->median);
+
+    if (baseline > 0.0)
+      printf (",\"baseline_min_ns\":%.3f,\"change_percent\":%.2f,\"regressed\":%s",
+              baseline, change, (regressed) ? "true" : "false");
+
+    printf ("}\n");
+  }
+  else
+  {
+    printf ("%-30s %12.1f %12.1f %12.1f %10.2f %14.4g %-11s", bm->name, result->median,
+            result->minimum, result->mean, 100.0 * result->stddev / result->mean,
+            bm->items * 1e9 / result->median, bm->unit);
+
+    if (baseline > 0.0)
+      printf (" %12.1f %+7.1f%%%s", baseline, change, (regressed) ? "  REGRESSED" : "");
+    else if (tabular)
+      printf (" %12s", "none");
+
+    printf ("\n");
+  }
+
+  fflush (stdout);
+}
+
+int
+main (int argc, char **argv)
+{
+  static Result results[sizeof (benchmarks) / sizeof (benchmarks[0])];
+  static double baseline[sizeof (benchmarks) / sizeof (benchmarks[0])];
+  static int selected[sizeof (benchmarks) / sizeof (benchmarks[0])];
+  Result retry;
+  const char *baselinefile = NULL;
+  double tolerance = 25.0;
+  int batches = 15;
+  double batchtime = 20.0;
+  double warmuptime = 100.0;
+  int json = 0;
+  int regressions = 0;
+  int compared = 0;
+  int retries;
+  int argidx;
+  size_t count = sizeof (benchmarks) / sizeof (benchmarks[0]);
+  size_t idx;
+
+  for (argidx = 1; argidx < argc && argv[argidx][0] == '-'; argidx++)
+  {
+    if (!strcmp (argv[argidx], "-s") && argidx + 1 < argc)
+      batches = atoi (argv[++argidx]);
+    else if (!strcmp (argv[argidx], "-t") && argidx + 1 < argc)
+      batchtime = strtod (argv[++argidx], NULL);
+    else if (!strcmp (argv[argidx], "-w") && argidx + 1 < argc)
+      warmuptime = strtod (argv[++argidx], NULL);
+    else if (!strcmp (argv[argidx], "-j"))
+      json = 1;
+    else if (!strcmp (argv[argidx], "-b") && argidx + 1 < argc)
+      baselinefile = argv[++argidx];
+    else if (!strcmp (argv[argidx], "-p") && argidx + 1 < argc)
+      tolerance = strtod (argv[++argidx], NULL);
+    else
+    {
+      fprintf (stderr, "Usage: %s [-s batches] [-t msec] [-w msec] [-j] [-b baseline] [-p percent] [filter ...]\n",
+               argv[0]);
+      return 1;
+    }
+  }
+
+  if (baselinefile && LoadBaseline (baselinefile) < 0)
+    return 1;
+
+  if (batches < 1 || batches > MAXBATCHES || batchtime <= 0.0 || warmuptime < 0.0)
+  {
+    fprintf (stderr, "Batches must be 1 to %d, batch time positive and warmup not negative\n",
+             MAXBATCHES);
+    return 1;
+  }
+
+  if (GenerateInputs ())
+  {
+    fprintf (stderr, "Cannot generate benchmark inputs\n");
+    return 1;
+  }
+
+  if (!json && !baselinefile)
+    PrintHeader (0);
+
+  for (idx = 0; idx < count; idx++)
+  {
+    if (!(selected[idx] = Selected (benchmarks[idx].name, argc - argidx, argv + argidx)))
+      continue;
+
+    RunBenchmark (&benchmarks[idx], batches, batchtime * 1e6, warmuptime * 1e6, &results[idx]);
+
+    if (baselinefile)
+      baseline[idx] = BaselineMinimum (benchmarks[idx].name);
+    else
+      PrintResult (&benchmarks[idx], &results[idx], 0.0, tolerance, json, 0);
+  }
+
+  if (!baselinefile)
+  {
+    msr3_free (&parsemsr);
+    return 0;
+  }
+
+  /* Run benchmarks slower than the tolerance again after the others,
+   * keeping the fastest run, to rule out a transient disturbance */
+  for (retries = 0; retries < MAXRETRIES; retries++)
+  {
+    for (idx = 0; idx < count; idx++)
+    {
+      if (!selected[idx] || baseline[idx] <= 0.0 ||
+          results[idx].minimum <= baseline[idx] * (1.0 + tolerance / 100.0))
+        continue;
+
+      fprintf (stderr, "Running %s again, %.1f ns/op versus baseline %.1f\n",
+               benchmarks[idx].name, results[idx].minimum, baseline[idx]);
+
+      RunBenchmark (&benchmarks[idx], batches, batchtime * 1e6, warmuptime * 1e6, &retry);
+
+      if (retry.minimum < results[idx].minimum)
+        results[idx] = retry;
+    }
+  }
+
+  if (!json)
+    PrintHeader (1);
+
+  for (idx = 0; idx < count; idx++)
+  {
+    if (!selected[idx])
+      continue;
+
+    PrintResult (&benchmarks[idx], &results[idx], baseline[idx], tolerance, json, !json);
+
+    if (baseline[idx] > 0.0)
+    {
+      compared++;
+
+      if (results[idx].minimum > baseline[idx] * (1.0 + tolerance / 100.0))
+        regressions++;
+    }
+  }
+
+  msr3_free (&parsemsr);
+
+  fprintf (stderr, "%d of %d benchmarks compared to %s slower by more than %g%%\n",
+           regressions, compared, baselinefile, tolerance);
+
+  return (regressions) ? 1 : 0;
+}
@@ -207,6 +207,96 @@ TEST (extraheaders, replace)
   msr3_free (&msr);
 }
 
+TEST (extraheaders, batch)
+{
+  MS3Record *msr = NULL;
+  LM_PARSED_JSON *parsestate = NULL;
+  int64_t getint;
+  int64_t quality = 0;
+  double correction = 0.0;
+  char type[100] = "";
+  char detector[100] = "";
+  int begin = 0;
+  int64_t wrongtype = 0;
+  int rv;
+  int idx;
+
+  MSEHQuery queries[] = {
+      {"/FDSN/Event/Begin", &begin, 'b', 0, -1},
+      {"/FDSN/Event/Detection/0/Detector", detector, 's', sizeof (detector), -1},
+      {"/FDSN/Event/Detection/0/Type", type, 's', sizeof (type), -1},
+      {"/FDSN/Event/Detection/1/Type", NULL, 's', 0, -1},
+      {"/FDSN/Time/Correction", &correction, 'n', 0, -1},
+      {"/FDSN/Time/Quality", &quality, 'i', 0, -1},
+      {"/FDSN/Time/QualityX", NULL, 'i', 0, -1},
+      {"/FDSN/Time", &wrongtype, 'i', 0, -1},
+      {"/Missing/Time/Quality", NULL, 'i', 0, -1},
+  };
+  int expected[] = {0, 0, 0, 1, 0, 0, 1, 2, 1};
+
+  msr = msr3_init (msr);
+  REQUIRE (msr != NULL, "msr3_init() returned unexpected NULL");
+
+  msr->extralength = strlen (testheaders);
+  msr->extra = malloc (msr->extralength);
+  REQUIRE (msr->extra != NULL, "Error allocating memory for msr->extra");
+  memcpy (msr->extra, testheaders, msr->extralength);
+
+  /* Batch query */
+  rv = mseh_get_ptrs_r (msr, queries, sizeof (queries) / sizeof (queries[0]), NULL);
+  CHECK (rv == 5, "mseh_get_ptrs_r() returned unexpected count");
+  for (idx = 0; idx < (int)(sizeof (queries) / sizeof (queries[0])); idx++)
+    CHECK (queries[idx].retval == expected[idx], "mseh_get_ptrs_r() returned unexpected result");
+  CHECK (begin == 1, "/FDSN/Event/Begin is not expected True");
+  CHECK_STREQ (detector, "Z_SPWWSS");
+  CHECK_STREQ (type, "MURDOCK");
+  CHECK (correction == 1.234, "/FDSN/Time/Correction is not expected 1.234");
+  CHECK (quality == 100, "/FDSN/Time/Quality is not expected 100");
+
+  /* Batch query with a parse state retained for later queries */
+  quality = 0;
+  rv = mseh_get_ptrs_r (msr, queries, sizeof (queries) / sizeof (queries[0]), &parsestate);
+  CHECK (rv == 5, "mseh_get_ptrs_r() returned unexpected count");
+  CHECK (quality == 100, "/FDSN/Time/Quality is not expected 100");
+  REQUIRE (parsestate != NULL, "mseh_get_ptrs_r() did not set parse state");
+
+  /* Values set with the parse state are returned by later queries */
+  getint = 50;
+  rv = mseh_set_ptr_r (msr, "/FDSN/Time/Quality", &getint, 'i', &parsestate);
+  CHECK (rv == 0, "mseh_set_ptr_r() returned unexpected error");
+
+  rv = mseh_get_ptrs_r (msr, queries, sizeof (queries) / sizeof (queries[0]), &parsestate);
+  CHECK (rv == 5, "mseh_get_ptrs_r() returned unexpected count");
+  CHECK (quality == 50, "/FDSN/Time/Quality is not expected 50");
+
+  rv = mseh_serialize (msr, &parsestate);
+  CHECK (rv > 0, "mseh_serialize() returned unexpected error");
+  mseh_free_parsestate (&parsestate);
+
+  /* Queries without a parse state use the current headers */
+  rv = mseh_get_int64 (msr, "/FDSN/Time/Quality", &getint);
+  CHECK (rv == 0, "mseh_get_int64() returned unexpected non-match");
+  CHECK (getint == 50, "/FDSN/Time/Quality is not expected 50");
+
+  rv = mseh_replace (msr, "{\"FDSN\":{\"Time\":{\"Quality\":25}}}");
+  CHECK (rv > 0, "mseh_replace() returned unexpected error");
+
+  rv = mseh_get_int64 (msr, "/FDSN/Time/Quality", &getint);
+  CHECK (rv == 0, "mseh_get_int64() returned unexpected non-match");
+  CHECK (getint == 25, "/FDSN/Time/Quality is not expected 25");
+
+  rv = mseh_exists (msr, "/FDSN/Event/Begin");
+  CHECK (!rv, "mseh_exists() returned unexpected true after replacement");
+
+  /* Direct changes to the headers are used */
+  msr->extra[msr->extralength - 5] = '7';
+  rv = mseh_get_int64 (msr, "/FDSN/Time/Quality", &getint);
+  CHECK (rv == 0, "mseh_get_int64() returned unexpected non-match");
+  CHECK (getint == 75, "/FDSN/Time/Quality is not expected 75");
+
+  msr3_free (&msr);
+}
+
 TEST (extraheaders, internal)
 {
   MS3Record *msr = NULL;
@@ -0,0 +1,167 @@
+#include <tau/tau.h>
+#include <libmseed.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define GZIPREFFILE "data/testdata-3channel-signal.mseed3"
+#define GZIPTESTFILE "data/testdata-3channel-signal.mseed3.gz"
+#define BGZFTESTFILE "data/testdata-3channel-signal.mseed3.bgz"
+#define BGZFCOPYFILE "testdata-gzip.mseed3.bgz"
+
+/* Read all records from a path and compare them to the reference data at their offsets */
+static int64_t
+compare_gzip_records (const char *path, const char *refdata, int64_t reflength,
+                      int64_t *mismatches, const char *indexpath)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  int64_t records = 0;
+  int rv;
+
+  *mismatches = 0;
+
+  while ((rv = ms3_readmsr_r (&msfp, &msr, path, MSF_PNAMERANGE, 0)) == MS_NOERROR)
+  {
+    if (msfp->streampos > reflength ||
+        memcmp (msr->record, refdata + msfp->streampos - msr->reclen, msr->reclen))
+      (*mismatches)++;
+
+    records++;
+  }
+
+  if (rv == MS_ENDOFFILE && indexpath && ms3_gzip_writeindex (msfp, indexpath))
+    rv = MS_GENERROR;
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  return (rv == MS_ENDOFFILE) ? records : -1;
+}
+
+TEST (gzip, read)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  FILE *fp;
+  char refdata[65536];
+  char buffer[65536];
+  char path[256];
+  int64_t filerecords = 0;
+  int64_t records;
+  int64_t mismatches;
+  int64_t offset = 0;
+  size_t length;
+  size_t bgzflength;
+
+  /* Skip when the library does not include gzip support */
+  if (!libmseed_gzip_support ())
+    return;
+
+  fp = fopen (GZIPREFFILE, "rb");
+  REQUIRE (fp != NULL, "Cannot open reference file");
+  length = fread (refdata, 1, sizeof (refdata), fp);
+  fclose (fp);
+  REQUIRE (length > 0 && length < sizeof (refdata), "Unexpected reference file length");
+
+  /* Count records and note a record offset for reading from an offset */
+  while (ms3_readmsr_r (&msfp, &msr, GZIPREFFILE, 0, 0) == MS_NOERROR)
+  {
+    if (filerecords == 40)
+      offset = msfp->streampos - msr->reclen;
+    filerecords++;
+  }
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+  REQUIRE (filerecords > 40, "Unexpected reference file record count");
+
+  /* General gzip with multiple members */
+  records = compare_gzip_records (GZIPTESTFILE, refdata, length, &mismatches, NULL);
+  CHECK (records == filerecords, "gzip read record count mismatch");
+  CHECK (mismatches == 0, "gzip read record content mismatch");
+
+  snprintf (path, sizeof (path), GZIPTESTFILE "@%" PRId64, offset);
+  records = compare_gzip_records (path, refdata, length, &mismatches, NULL);
+  CHECK (records == filerecords - 40, "gzip read from offset record count mismatch");
+  CHECK (mismatches == 0, "gzip read from offset record content mismatch");
+
+  /* An index cannot be written for general gzip */
+  CHECK (compare_gzip_records (GZIPTESTFILE, refdata, length, &mismatches, "testdata-gzip.gzi") == -1,
+         "ms3_gzip_writeindex() did not return error for general gzip");
+
+  /* BGZF decompressed in parallel, writing a block index for a copy of the file */
+  fp = fopen (BGZFTESTFILE, "rb");
+  REQUIRE (fp != NULL, "Cannot open BGZF test file");
+  bgzflength = fread (buffer, 1, sizeof (buffer), fp);
+  fclose (fp);
+
+  fp = fopen (BGZFCOPYFILE, "wb");
+  REQUIRE (fp != NULL, "Cannot open BGZF copy for writing");
+  REQUIRE (fwrite (buffer, 1, bgzflength, fp) == bgzflength, "Cannot write BGZF copy");
+  fclose (fp);
+
+  CHECK (ms3_gzip_threads (4) == 0, "ms3_gzip_threads() returned unexpected error");
+
+  records = compare_gzip_records (BGZFCOPYFILE, refdata, length, &mismatches, BGZFCOPYFILE ".gzi");
+  CHECK (records == filerecords, "BGZF read record count mismatch");
+  CHECK (mismatches == 0, "BGZF read record content mismatch");
+
+  /* Read from an offset using the block index */
+  snprintf (path, sizeof (path), BGZFCOPYFILE "@%" PRId64, offset);
+  records = compare_gzip_records (path, refdata, length, &mismatches, NULL);
+  CHECK (records == filerecords - 40, "BGZF read from offset record count mismatch");
+  CHECK (mismatches == 0, "BGZF read from offset record content mismatch");
+
+  /* Read from an offset without the block index */
+  snprintf (path, sizeof (path), BGZFTESTFILE "@%" PRId64, offset);
+  records = compare_gzip_records (path, refdata, length, &mismatches, NULL);
+  CHECK (records == filerecords - 40, "BGZF read from offset without index record count mismatch");
+  CHECK (mismatches == 0, "BGZF read from offset without index record content mismatch");
+
+  ms3_gzip_threads (1);
+}
+
+TEST (gzip, recordlist)
+{
+  MS3TraceList *refmstl = NULL;
+  MS3TraceList *mstl = NULL;
+  MS3TraceID *refid;
+  MS3TraceID *id;
+  int64_t refsamples = 0;
+  int64_t samples = 0;
+  int rv;
+
+  /* Skip when the library does not include gzip support */
+  if (!libmseed_gzip_support ())
+    return;
+
+  /* Record lists cannot refer to records in compressed files */
+  rv = ms3_readtracelist (&mstl, BGZFTESTFILE, NULL, 0, MSF_RECORDLIST, 0);
+  CHECK (rv == MS_GENERROR, "ms3_readtracelist() did not return error for record list of compressed file");
+  mstl3_free (&mstl, 0);
+
+  /* Data unpacked while reading match the uncompressed file */
+  rv = ms3_readtracelist (&refmstl, GZIPREFFILE, NULL, 0, MSF_UNPACKDATA, 0);
+  REQUIRE (rv == MS_NOERROR, "ms3_readtracelist() returned unexpected error for reference file");
+  rv = ms3_readtracelist (&mstl, BGZFTESTFILE, NULL, 0, MSF_UNPACKDATA, 0);
+  REQUIRE (rv == MS_NOERROR, "ms3_readtracelist() returned unexpected error for compressed file");
+
+  CHECK (mstl->numtraceids == refmstl->numtraceids, "Trace ID count mismatch");
+
+  for (refid = refmstl->traces.next[0], id = mstl->traces.next[0];
+       refid && id; refid = refid->next[0], id = id->next[0])
+  {
+    CHECK_STREQ (id->sid, refid->sid);
+    CHECK (id->numsegments == refid->numsegments, "Segment count mismatch");
+    CHECK (id->first->numsamples == refid->first->numsamples, "Sample count mismatch");
+    CHECK (!memcmp (id->first->datasamples, refid->first->datasamples,
+                    id->first->numsamples * ms_samplesize (id->first->sampletype)),
+           "Sample values mismatch");
+
+    refsamples += refid->first->numsamples;
+    samples += id->first->numsamples;
+  }
+
+  CHECK (samples > 0 && samples == refsamples, "Total sample count mismatch");
+
+  mstl3_free (&refmstl, 0);
+  mstl3_free (&mstl, 0);
+}
@@ -398,6 +398,90 @@ TEST (read, selection)
   ms3_freeselections (selections);
 }
 
+TEST (read, selection_skip)
+{
+  MS3Record *msr = NULL;
+  MS3FileParam *msfp = NULL;
+  MS3Selections *selections = NULL;
+  MS3Selections *noselections = NULL;
+  char buffer[65536];
+  size_t length;
+  int64_t expectedcount;
+  int64_t expectedoffsets;
+  int64_t count;
+  int64_t offsets;
+  FILE *in;
+  FILE *out;
+  int idx;
+  int copy;
+  int rv;
+
+  char *path[2] = {"data/testdata-3channel-signal.mseed2",
+                   "data/testdata-3channel-signal.mseed3"};
+  char *tmppath = "selection-skip.tmp";
+
+  rv = ms3_addselect (&selections, "FDSN:IU_COLA_*_L_H_Z", NSTUNSET, NSTUNSET, 0);
+  REQUIRE (rv == 0, "ms3_addselect() returned an unexpected error");
+
+  rv = ms3_addselect (&noselections, "FDSN:XX_*", NSTUNSET, NSTUNSET, 0);
+  REQUIRE (rv == 0, "ms3_addselect() returned an unexpected error");
+
+  for (idx = 0; idx < 2; idx++)
+  {
+    /* Create a file larger than a selection read, so records are skipped by seeking */
+    out = fopen (tmppath, "wb");
+    REQUIRE (out != NULL, "Cannot open temporary file");
+    for (copy = 0; copy < 4; copy++)
+    {
+      in = fopen (path[idx], "rb");
+      REQUIRE (in != NULL, "Cannot open test file");
+      while ((length = fread (buffer, 1, sizeof (buffer), in)) > 0)
+        fwrite (buffer, 1, length, out);
+      fclose (in);
+    }
+    fclose (out);
+
+    /* Expected records from reading all records */
+    expectedcount = 0;
+    expectedoffsets = 0;
+    while ((rv = ms3_readmsr_r (&msfp, &msr, tmppath, 0, 0)) == MS_NOERROR)
+    {
+      if (msr3_matchselect (selections, msr, NULL))
+      {
+        expectedcount++;
+        expectedoffsets += msfp->streampos - msr->reclen;
+      }
+    }
+    CHECK (rv == MS_ENDOFFILE, "ms3_readmsr_r() did not return expected MS_ENDOFFILE");
+    ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+    count = 0;
+    offsets = 0;
+    while ((rv = ms3_readmsr_selection (&msfp, &msr, tmppath, MSF_UNPACKDATA, selections, 0)) == MS_NOERROR)
+    {
+      CHECK (msr->numsamples == msr->samplecnt, "Selection read, unexpected number of decoded samples");
+      count++;
+      offsets += msfp->streampos - msr->reclen;
+    }
+    CHECK (rv == MS_ENDOFFILE, "ms3_readmsr_selection() did not return expected MS_ENDOFFILE");
+    ms3_readmsr_selection (&msfp, &msr, NULL, 0, NULL, 0);
+
+    CHECK (expectedcount > 0, "No records matched selection");
+    CHECK (count == expectedcount, "Selection read, unexpected number of records");
+    CHECK (offsets == expectedoffsets, "Selection read, unexpected record offsets");
+
+    /* All records skipped is not an error */
+    rv = ms3_readmsr_selection (&msfp, &msr, tmppath, 0, noselections, 0);
+    CHECK (rv == MS_ENDOFFILE, "ms3_readmsr_selection() did not return expected MS_ENDOFFILE");
+    ms3_readmsr_selection (&msfp, &msr, NULL, 0, NULL, 0);
+
+    remove (tmppath);
+  }
+
+  ms3_freeselections (selections);
+  ms3_freeselections (noselections);
+}
+
 TEST (read, oddball)
 {
   MS3Record *msr = NULL;
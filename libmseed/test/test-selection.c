@@ -67,4 +67,106 @@ TEST (selection, error)
 
   match = ms3_matchselect (selections, "FDSN:YY_STA1__L_H_Z", NSTUNSET, NSTUNSET, 1, NULL);
   REQUIRE (match == NULL, "ms3_matchselect() did not return expected NULL");
-}
\ No newline at end of file
+}
+/* Count records in a buffer matching selections, one at a time */
+static int64_t
+count_matching (const char *buffer, uint64_t bufferlength, const MS3Selections *selections)
+{
+  MS3Record *msr   = NULL;
+  uint64_t offset  = 0;
+  int64_t matching = 0;
+
+  while ((bufferlength - offset) > MINRECLEN &&
+         msr3_parse (buffer + offset, bufferlength - offset, &msr, 0, 0) == 0)
+  {
+    if (ms3_matchselect (selections, msr->sid, msr->starttime, msr3_endtime (msr),
+                         msr->pubversion, NULL))
+      matching++;
+
+    offset += msr->reclen;
+  }
+
+  msr3_free (&msr);
+
+  return matching;
+}
+
+TEST (selection, compiled)
+{
+  MS3Selections *selections = NULL;
+  MS3TraceList *mstl        = NULL;
+  MS3TraceID *id            = NULL;
+  MS3TraceSeg *seg          = NULL;
+  char *buffer              = NULL;
+  char sidpattern[100];
+  uint64_t bufferlength;
+  int64_t expected;
+  int64_t reccount;
+  nstime_t starttime;
+  FILE *fp;
+  int idx;
+  int rv;
+
+  char *path = "data/testdata-3channel-signal.mseed3";
+
+  fp = fopen (path, "rb");
+  REQUIRE (fp != NULL, "Cannot open test file");
+  fseek (fp, 0, SEEK_END);
+  bufferlength = (uint64_t)ftell (fp);
+  rewind (fp);
+  buffer = (char *)malloc (bufferlength);
+  REQUIRE (buffer != NULL, "Cannot allocate buffer");
+  REQUIRE (fread (buffer, 1, bufferlength, fp) == bufferlength, "Cannot read test file");
+  fclose (fp);
+
+  starttime = ms_timestr2nstime ("2010-02-27T06:50:00Z");
+
+  /* Many non-matching exact and glob patterns */
+  for (idx = 0; idx < 500; idx++)
+  {
+    snprintf (sidpattern, sizeof (sidpattern), "FDSN:IU_S%d_00_B_H_Z", idx);
+    rv = ms3_addselect (&selections, sidpattern, NSTUNSET, NSTUNSET, 0);
+    REQUIRE (rv == 0, "ms3_addselect() did not return expected 0");
+
+    snprintf (sidpattern, sizeof (sidpattern), "FDSN:IU_COLA_%d_*", idx);
+    rv = ms3_addselect (&selections, sidpattern, NSTUNSET, NSTUNSET, 0);
+    REQUIRE (rv == 0, "ms3_addselect() did not return expected 0");
+  }
+
+  /* Exact pattern with many time windows, some intersecting the data */
+  for (idx = 0; idx < 200; idx++)
+  {
+    rv = ms3_addselect (&selections, "FDSN:IU_COLA_00_L_H_Z",
+                        starttime + (nstime_t)idx * 30 * NSTMODULUS,
+                        starttime + (nstime_t)idx * 30 * NSTMODULUS + (nstime_t)5 * NSTMODULUS, 0);
+    REQUIRE (rv == 0, "ms3_addselect() did not return expected 0");
+  }
+
+  /* Glob pattern with an open time window */
+  rv = ms3_addselect (&selections, "FDSN:IU_COLA_00_L_H_[12]", starttime + (nstime_t)600 * NSTMODULUS, NSTUNSET, 0);
+  REQUIRE (rv == 0, "ms3_addselect() did not return expected 0");
+
+  /* Glob pattern with a non-matching publication version */
+  rv = ms3_addselect (&selections, "*_L_H_?", NSTUNSET, NSTUNSET, 9);
+  REQUIRE (rv == 0, "ms3_addselect() did not return expected 0");
+
+  expected = count_matching (buffer, bufferlength, selections);
+  CHECK (expected > 0, "No records matched selections");
+
+  reccount = mstl3_readbuffer_selection (&mstl, buffer, bufferlength, 0, 0, NULL, selections, 0);
+  CHECK (reccount == expected, "mstl3_readbuffer_selection() did not return expected record count");
+  mstl3_free (&mstl, 0);
+
+  rv = ms3_readtracelist_selection (&mstl, path, NULL, selections, 0, MSF_RECORDLIST, 0);
+  REQUIRE (rv == MS_NOERROR, "ms3_readtracelist_selection() did not return expected MS_NOERROR");
+
+  reccount = 0;
+  for (id = mstl->traces.next[0]; id; id = id->next[0])
+    for (seg = id->first; seg; seg = seg->next)
+      reccount += seg->recordlist->recordcnt;
+  CHECK (reccount == expected, "ms3_readtracelist_selection() did not read expected record count");
+  mstl3_free (&mstl, 0);
+
+  ms3_freeselections (selections);
+  free (buffer);
+}
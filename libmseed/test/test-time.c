@@ -111,4 +111,160 @@ TEST (time, nstime)
 
   nstime = ms_timestr2nstime ("20040512T000000");
   CHECK (nstime == NSTERROR, "Failed to produce error for time string: '20040512T000000'");
-}
\ No newline at end of file
+}
+/* Reference time string using ms_nstime2time() and snprintf() */
+static void
+reference_timestr (nstime_t nstime, char *timestr, ms_timeformat_t timeformat, ms_subseconds_t subseconds)
+{
+  uint16_t year, yday;
+  uint8_t hour, min, sec;
+  uint32_t nsec;
+  int month, mday;
+  int subdigits;
+  char subsec[11] = "";
+  char *sep = (timeformat == ISOMONTHDAY_SPACE || timeformat == ISOMONTHDAY_SPACE_Z) ? " " : "T";
+  char *zone = (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_DOY_Z ||
+                timeformat == ISOMONTHDAY_SPACE_Z) ? "Z" : "";
+
+  ms_nstime2time (nstime, &year, &yday, &hour, &min, &sec, &nsec);
+  ms_doy2md (year, yday, &month, &mday);
+
+  if (subseconds == NONE ||
+      (subseconds == MICRO_NONE && nsec / 1000 == 0) ||
+      ((subseconds == NANO_NONE || subseconds == NANO_MICRO_NONE) && nsec == 0))
+    subdigits = 0;
+  else if (subseconds == MICRO || subseconds == MICRO_NONE ||
+           ((subseconds == NANO_MICRO || subseconds == NANO_MICRO_NONE) && nsec % 1000 == 0))
+    subdigits = 6;
+  else
+    subdigits = 9;
+
+  if (subdigits == 6)
+    snprintf (subsec, sizeof (subsec), ".%06u", (unsigned int)(nsec / 1000));
+  else if (subdigits == 9)
+    snprintf (subsec, sizeof (subsec), ".%09u", (unsigned int)nsec);
+
+  if (timeformat == SEEDORDINAL)
+    sprintf (timestr, "%4d,%03d,%02d:%02d:%02d%s", year, yday, hour, min, sec, subsec);
+  else if (timeformat == ISOMONTHDAY_DOY || timeformat == ISOMONTHDAY_DOY_Z)
+    sprintf (timestr, "%4d-%02d-%02dT%02d:%02d:%02d%s%s (%03d)",
+             year, month, mday, hour, min, sec, subsec, zone, yday);
+  else
+    sprintf (timestr, "%4d-%02d-%02d%s%02d:%02d:%02d%s%s",
+             year, month, mday, sep, hour, min, sec, subsec, zone);
+}
+
+TEST (time, nstime2timestr_reference)
+{
+  char timestr[50];
+  char reference[50];
+  nstime_t nstime;
+  uint64_t state = 88172645463325252ULL;
+  int format;
+  int subseconds;
+  int idx;
+  int mismatches = 0;
+
+  nstime_t fixed[] = {0, -1, 1, -14182939012345679, 951782400000000000, 951868799999999999,
+                      -2208988800000000000, 4102444800000001000, -8000000000000000000,
+                      9000000000000000000, 1084345689123456788, 1084345689123400000};
+
+  /* Fixed values and pseudo-random values across the nstime_t range with varied subseconds */
+  for (idx = 0; idx < 2000; idx++)
+  {
+    if (idx < (int)(sizeof (fixed) / sizeof (fixed[0])))
+    {
+      nstime = fixed[idx];
+    }
+    else
+    {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+
+      nstime = (nstime_t)(state % 18000000000000000000ULL) - 9000000000000000000LL;
+
+      if (idx % 3 == 0)
+        nstime -= nstime % 1000000000;
+      else if (idx % 3 == 1)
+        nstime -= nstime % 1000;
+    }
+
+    for (format = ISOMONTHDAY; format <= SEEDORDINAL; format++)
+    {
+      for (subseconds = NONE; subseconds <= NANO_MICRO_NONE; subseconds++)
+      {
+        reference_timestr (nstime, reference, format, subseconds);
+
+        if (ms_nstime2timestr (nstime, timestr, format, subseconds) == NULL ||
+            strcmp (timestr, reference) != 0)
+        {
+          if (mismatches++ < 5)
+            CHECK_STREQ (timestr, reference);
+        }
+      }
+    }
+  }
+
+  CHECK (mismatches == 0, "ms_nstime2timestr() did not match reference time strings");
+}
+
+TEST (time, timestr2nstime_canonical)
+{
+  char timestr[50];
+  nstime_t nstime;
+  nstime_t parsed;
+  uint64_t state = 88172645463325252ULL;
+  int idx;
+  int mismatches = 0;
+
+  char *subseconds[] = {"", ".1", ".123456", ".123456789", ".000001", ".999999999"};
+  char *suffixes[] = {"", "Z", "z"};
+
+  /* Canonical strings must parse identically with the fast path and the general parser */
+  for (idx = 0; idx < 5000; idx++)
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    nstime = (nstime_t)(state % 18000000000000000000ULL) - 9000000000000000000LL;
+
+    ms_nstime2timestr (nstime, timestr, (idx % 2) ? ISOMONTHDAY : ISOMONTHDAY_SPACE, NONE);
+    strcat (timestr, subseconds[idx % 6]);
+    strcat (timestr, suffixes[idx % 3]);
+
+    parsed = ms_timestr2nstime (timestr);
+
+    if (parsed == NSTERROR || parsed != ms_mdtimestr2nstime (timestr))
+      mismatches++;
+  }
+
+  CHECK (mismatches == 0, "ms_timestr2nstime() did not match ms_mdtimestr2nstime()");
+
+  nstime = ms_timestr2nstime ("2016-12-31T23:59:60.5Z");
+  CHECK (nstime == 1483228800500000000, "Failed to convert time string: '2016-12-31T23:59:60.5Z'");
+
+  /* Non-canonical layouts use the general parser */
+  nstime = ms_timestr2nstime ("2004-05-12T07:08:09.1234567891Z");
+  CHECK (nstime == 1084345689123456789, "Failed to convert time string: '2004-05-12T07:08:09.1234567891Z'");
+
+  nstime = ms_timestr2nstime ("2004-05-12T07:08:09.");
+  CHECK (nstime == 1084345689000000000, "Failed to convert time string: '2004-05-12T07:08:09.'");
+
+  nstime = ms_timestr2nstime ("2004/05/12T07:08:09");
+  CHECK (nstime == 1084345689000000000, "Failed to convert time string: '2004/05/12T07:08:09'");
+
+  /* Out of range values in the canonical layout are errors */
+  nstime = ms_timestr2nstime ("2004-13-12T07:08:09Z");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2004-13-12T07:08:09Z'");
+
+  nstime = ms_timestr2nstime ("2003-02-29T07:08:09Z");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2003-02-29T07:08:09Z'");
+
+  nstime = ms_timestr2nstime ("2004-05-12T24:08:09Z");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2004-05-12T24:08:09Z'");
+
+  nstime = ms_timestr2nstime ("2004-05-12T07:08:09ZZ");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2004-05-12T07:08:09ZZ'");
+}
@@ -181,4 +181,474 @@ TEST (read, recptr_buffer)
   CHECK (int32s[3951] == -146622, "Decoded sample value mismatch");
 
   mstl3_free (&mstl, 1);
-}
\ No newline at end of file
+}
+
+TEST (trace, merge)
+{
+  char buffer[16256];
+  FILE *fp = NULL;
+
+  MS3TraceList *mstl  = NULL;
+  MS3TraceList *mstl2 = NULL;
+  MS3TraceID *id      = NULL;
+  nstime_t starttime;
+  nstime_t endtime;
+  uint32_t flags = 0;
+  MS3Record *msr      = NULL;
+  uint64_t split = 0;
+  int32_t *int32s;
+  int64_t rv;
+  int idx;
+
+  char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+
+  /* Read test data into buffer */
+  fp = fopen (path, "rb");
+  REQUIRE (fp != NULL, "File pointer is unexpected NULL");
+
+  rv = fread (buffer, sizeof(buffer), 1, fp);
+  REQUIRE (rv == 1, "fread() did not read entire file");
+
+  fclose (fp);
+
+  /* Determine the offset after the third record to split the buffer */
+  for (idx = 0; idx < 3; idx++)
+  {
+    REQUIRE (msr3_parse (buffer + split, sizeof(buffer) - split, &msr, 0, 0) == MS_NOERROR,
+             "msr3_parse() did not parse a record");
+    split += msr->reclen;
+  }
+
+  msr3_free (&msr);
+
+  starttime = ms_timestr2nstime ("2010-02-27T06:50:00.069539Z");
+  endtime = ms_timestr2nstime ("2010-02-27T07:55:51.069539Z");
+
+  flags = MSF_UNPACKDATA | MSF_RECORDLIST;
+
+  rv = mstl3_readbuffer (&mstl, buffer, split, 0, flags, 0, 0);
+  CHECK (rv == 3, "mstl3_readbuffer did not return expected 3");
+  REQUIRE (mstl != NULL, "mstl3_readbuffer did not populate 'mstl'");
+
+  rv = mstl3_readbuffer (&mstl2, buffer + split, sizeof(buffer) - split, 0, flags, 0, 0);
+  CHECK (rv == 4, "mstl3_readbuffer did not return expected 4");
+  REQUIRE (mstl2 != NULL, "mstl3_readbuffer did not populate 'mstl2'");
+
+  /* Data split in mixed order results in multiple segments before merge */
+  id = mstl->traces.next[0];
+  REQUIRE (id != NULL, "mstl->traces.next[0] is not populated");
+  CHECK (id->numsegments > 1, "id->numsegments is not expected more than 1");
+
+  rv = mstl3_merge (mstl, mstl2, 0, NULL, 0);
+  CHECK (rv == 0, "mstl3_merge() did not return expected 0");
+
+  /* Source list is emptied */
+  CHECK (mstl2->numtraceids == 0, "mstl2->numtraceids is not expected 0");
+  CHECK (mstl2->traces.next[0] == NULL, "mstl2->traces.next[0] is not expected NULL");
+
+  CHECK (mstl3_merge (mstl, mstl, 0, NULL, 0) != 0, "mstl3_merge() did not fail on same list");
+
+  CHECK (mstl->numtraceids == 1, "mstl->numtraceids is not expected 1");
+
+  id = mstl->traces.next[0];
+
+  REQUIRE (id != NULL, "mstl->traces.next[0] is not populated");
+  REQUIRE (id->first != NULL, "id->first is not populated");
+  CHECK_STREQ (id->sid, "FDSN:XX_TEST_00_L_H_Z");
+  CHECK (id->earliest == starttime, "Earliest time is not expected '2010-02-27T06:50:00.069539Z'");
+  CHECK (id->latest == endtime, "Latest time is not expected '2010-02-27T07:55:51.069539Z'");
+  CHECK (id->numsegments == 1, "id->numsegments is not expected 1");
+  CHECK (id->first == id->last, "id->first is not equal to id->last as expected");
+  CHECK (id->first->starttime == starttime, "Segment start is not expected '2010-02-27T06:50:00.069539Z'");
+  CHECK (id->first->endtime == endtime, "Segment end is not expected '2010-02-27T07:55:51.069539Z'");
+  CHECK (id->first->samplecnt == 3952, "id->first->samplecnt is not expected 3952");
+  CHECK (id->first->numsamples == 3952, "id->first->numsamples is not expected 3952");
+  REQUIRE (id->first->recordlist != NULL, "id->first->recordlist is unexpected NULL");
+  CHECK (id->first->recordlist->recordcnt == 7, "id->first->recordlist->recordcnt is not expected 7");
+  CHECK (id->first->recordlist->last->endtime == endtime, "Last record end is not expected '2010-02-27T07:55:51.069539Z'");
+
+  int32s = (int32_t *)id->first->datasamples;
+  REQUIRE (int32s != NULL, "id->first->datasamples is unexpected NULL");
+  CHECK (int32s[3948] == 28067, "Decoded sample value mismatch");
+  CHECK (int32s[3949] == -9565, "Decoded sample value mismatch");
+  CHECK (int32s[3950] == -71961, "Decoded sample value mismatch");
+  CHECK (int32s[3951] == -146622, "Decoded sample value mismatch");
+
+  mstl3_free (&mstl2, 1);
+  mstl3_free (&mstl, 1);
+}
+
+TEST (trace, merge_bridge_error)
+{
+  MS3TraceList *mstl  = NULL;
+  MS3TraceList *mstl2 = NULL;
+  MS3TraceID *id      = NULL;
+  MS3Record msr;
+  int32_t int32s[10] = {0};
+  float float32s[10] = {0};
+  nstime_t starttime;
+  int rv;
+
+  starttime = ms_timestr2nstime ("2010-02-27T06:50:00Z");
+
+  mstl  = mstl3_init (NULL);
+  mstl2 = mstl3_init (NULL);
+  REQUIRE (mstl != NULL && mstl2 != NULL, "mstl3_init() did not return a list");
+
+  memset (&msr, 0, sizeof (msr));
+  strcpy (msr.sid, "FDSN:XX_TEST__B_H_Z");
+  msr.samprate = 1.0;
+  msr.samplecnt = 10;
+  msr.numsamples = 10;
+
+  /* Two segments with a gap of 10 samples, of different sample types */
+  msr.starttime = starttime;
+  msr.datasamples = int32s;
+  msr.sampletype = 'i';
+  REQUIRE (mstl3_addmsr (mstl, &msr, 0, 1, 0, NULL) != NULL, "mstl3_addmsr() failed");
+
+  msr.starttime = starttime + MS_EPOCH2NSTIME (20);
+  msr.datasamples = float32s;
+  msr.sampletype = 'f';
+  REQUIRE (mstl3_addmsr (mstl, &msr, 0, 1, 0, NULL) != NULL, "mstl3_addmsr() failed");
+
+  /* Segment filling the gap, joining with the second segment fails */
+  msr.starttime = starttime + MS_EPOCH2NSTIME (10);
+  msr.datasamples = int32s;
+  msr.sampletype = 'i';
+  REQUIRE (mstl3_addmsr (mstl2, &msr, 0, 1, 0, NULL) != NULL, "mstl3_addmsr() failed");
+
+  rv = mstl3_merge (mstl, mstl2, 0, NULL, 0);
+  CHECK (rv != 0, "mstl3_merge() did not fail for mismatched sample types");
+
+  /* Destination is left as before the merge */
+  id = mstl->traces.next[0];
+  REQUIRE (id != NULL, "mstl->traces.next[0] is not populated");
+  CHECK (id->numsegments == 2, "id->numsegments is not expected 2");
+  CHECK (id->earliest == starttime, "Earliest time is not expected");
+  CHECK (id->latest == starttime + MS_EPOCH2NSTIME (29), "Latest time is not expected");
+  CHECK (id->first->endtime == starttime + MS_EPOCH2NSTIME (9), "Segment end is not expected");
+  CHECK (id->first->samplecnt == 10, "id->first->samplecnt is not expected 10");
+  CHECK (id->first->numsamples == 10, "id->first->numsamples is not expected 10");
+
+  /* Segment is returned to the source list */
+  CHECK (mstl2->numtraceids == 1, "mstl2->numtraceids is not expected 1");
+  id = mstl2->traces.next[0];
+  REQUIRE (id != NULL && id->first != NULL, "Source segment is not retained");
+  CHECK (id->numsegments == 1, "id->numsegments is not expected 1");
+  CHECK (id->first->starttime == starttime + MS_EPOCH2NSTIME (10), "Segment start is not expected");
+  CHECK (id->first->numsamples == 10, "id->first->numsamples is not expected 10");
+
+  mstl3_free (&mstl2, 1);
+  mstl3_free (&mstl, 1);
+}
+
+TEST (trace, pool)
+{
+  MS3TraceList *mstl  = NULL;
+  MS3TraceList *mstl2 = NULL;
+  MS3TraceID *id      = NULL;
+  uint32_t flags = 0;
+  int32_t *int32s;
+  int64_t unpacked;
+  int rv;
+
+  char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+
+  mstl = mstl3_init (NULL);
+  REQUIRE (mstl != NULL, "mstl3_init() did not return a list");
+
+  /* Small slabs to exercise slab chaining */
+  rv = mstl3_pool_enable (mstl, 512);
+  CHECK (rv == 0, "mstl3_pool_enable() did not return expected 0");
+  CHECK (mstl3_pool_enable (mstl, 512) != 0, "mstl3_pool_enable() did not fail when already enabled");
+
+  flags = MSF_RECORDLIST;
+  rv = ms3_readtracelist (&mstl, path, NULL, 0, flags, 0);
+
+  CHECK (rv == MS_NOERROR, "ms3_readtracelist() did not return expected MS_NOERROR");
+  CHECK (mstl->numtraceids == 1, "mstl->numtraceids is not expected 1");
+
+  id = mstl->traces.next[0];
+
+  REQUIRE (id != NULL, "mstl->traces.next[0] is not populated");
+  REQUIRE (id->first != NULL, "id->first is not populated");
+  REQUIRE (id->first->recordlist != NULL, "id->first->recordlist is not populated");
+  CHECK (id->numsegments == 1, "id->numsegments is not expected 1");
+  CHECK (id->first->samplecnt == 3952, "id->first->samplecnt is not expected 3952");
+  CHECK (id->first->recordlist->recordcnt == 7, "id->first->recordlist->recordcnt is not expected 7");
+
+  unpacked = mstl3_unpack_recordlist (id, id->first, NULL, 0, 0);
+  CHECK (unpacked == 3952, "Return from mstl3_unpack_recordlist is not expected 3952");
+
+  int32s = (int32_t *)id->first->datasamples;
+  REQUIRE (int32s != NULL, "id->first->datasamples is unexpected NULL");
+  CHECK (int32s[3948] == 28067, "Decoded sample value mismatch");
+  CHECK (int32s[3951] == -146622, "Decoded sample value mismatch");
+
+  /* Pooling cannot be enabled on a populated list */
+  mstl2 = mstl3_init (NULL);
+  REQUIRE (mstl2 != NULL, "mstl3_init() did not return a list");
+  rv = ms3_readtracelist (&mstl2, path, NULL, 0, flags, 0);
+  CHECK (rv == MS_NOERROR, "ms3_readtracelist() did not return expected MS_NOERROR");
+  CHECK (mstl3_pool_enable (mstl2, 0) != 0, "mstl3_pool_enable() did not fail for populated list");
+
+  /* Pooled and non-pooled lists cannot be merged */
+  CHECK (mstl3_merge (mstl, mstl2, 0, NULL, 0) != 0, "mstl3_merge() did not fail for mixed pooling");
+  mstl3_free (&mstl2, 1);
+
+  /* Pooled lists can be merged, the same data joins existing coverage */
+  mstl2 = mstl3_init (NULL);
+  REQUIRE (mstl2 != NULL, "mstl3_init() did not return a list");
+  CHECK (mstl3_pool_enable (mstl2, 0) == 0, "mstl3_pool_enable() did not return expected 0");
+  rv = ms3_readtracelist (&mstl2, path, NULL, 0, flags, 0);
+  CHECK (rv == MS_NOERROR, "ms3_readtracelist() did not return expected MS_NOERROR");
+
+  CHECK (mstl3_merge (mstl, mstl2, 0, NULL, 0) == 0, "mstl3_merge() did not return expected 0");
+  CHECK (mstl2->numtraceids == 0, "mstl2->numtraceids is not expected 0");
+  CHECK (mstl->numtraceids == 1, "mstl->numtraceids is not expected 1");
+  CHECK (id->numsegments == 2, "id->numsegments is not expected 2");
+
+  mstl3_free (&mstl2, 1);
+  mstl3_free (&mstl, 1);
+}
+
+TEST (trace, readbuffer_parallel)
+{
+  char *buffer = NULL;
+  size_t filesize[2] = {54784, 56906};
+  size_t buffersize;
+  size_t offset = 0;
+  FILE *fp = NULL;
+  int idx;
+
+  MS3TraceList *serial   = NULL;
+  MS3TraceList *parallel = NULL;
+  MS3TraceID *sid        = NULL;
+  MS3TraceID *pid        = NULL;
+  MS3TraceSeg *sseg      = NULL;
+  MS3TraceSeg *pseg      = NULL;
+  uint32_t flags         = MSF_UNPACKDATA | MSF_RECORDLIST;
+  int64_t srv;
+  int64_t prv;
+
+  char *path[2] = {"data/testdata-3channel-signal.mseed2",
+                   "data/testdata-3channel-signal.mseed3"};
+
+  /* Build a buffer of repeated, overlapping data in both formats */
+  buffersize = (filesize[0] + filesize[1]) * 4;
+  buffer = (char *)malloc (buffersize);
+  REQUIRE (buffer != NULL, "Cannot allocate buffer");
+
+  for (idx = 0; idx < 8; idx++)
+  {
+    fp = fopen (path[idx % 2], "rb");
+    REQUIRE (fp != NULL, "File pointer is unexpected NULL");
+    REQUIRE (fread (buffer + offset, filesize[idx % 2], 1, fp) == 1, "fread() did not read entire file");
+    fclose (fp);
+    offset += filesize[idx % 2];
+  }
+
+  srv = mstl3_readbuffer (&serial, buffer, buffersize, 0, flags, NULL, 0);
+  prv = mstl3_readbuffer_parallel (&parallel, buffer, buffersize, 0, flags, NULL, NULL, 4, 0);
+
+  CHECK (srv == 856, "mstl3_readbuffer() did not return expected 856");
+  CHECK (prv == srv, "mstl3_readbuffer_parallel() did not return the same as mstl3_readbuffer()");
+  REQUIRE (serial != NULL && parallel != NULL, "Trace lists were not populated");
+  CHECK (parallel->numtraceids == serial->numtraceids, "Trace ID counts differ");
+
+  /* Compare trace lists */
+  sid = serial->traces.next[0];
+  pid = parallel->traces.next[0];
+  while (sid && pid)
+  {
+    CHECK_STREQ (pid->sid, sid->sid);
+    CHECK (pid->numsegments == sid->numsegments, "Segment counts differ");
+    CHECK (pid->earliest == sid->earliest, "Earliest times differ");
+    CHECK (pid->latest == sid->latest, "Latest times differ");
+
+    sseg = sid->first;
+    pseg = pid->first;
+    while (sseg && pseg)
+    {
+      CHECK (pseg->starttime == sseg->starttime, "Segment start times differ");
+      CHECK (pseg->endtime == sseg->endtime, "Segment end times differ");
+      CHECK (pseg->samplecnt == sseg->samplecnt, "Segment sample counts differ");
+      REQUIRE (pseg->numsamples == sseg->numsamples, "Segment sample counts differ");
+      CHECK (memcmp (pseg->datasamples, sseg->datasamples,
+                     (size_t)sseg->numsamples * ms_samplesize (sseg->sampletype)) == 0,
+             "Segment data samples differ");
+      REQUIRE (pseg->recordlist != NULL && sseg->recordlist != NULL, "Record lists not populated");
+      CHECK (pseg->recordlist->recordcnt == sseg->recordlist->recordcnt, "Record counts differ");
+
+      sseg = sseg->next;
+      pseg = pseg->next;
+    }
+    CHECK (sseg == NULL && pseg == NULL, "Segment lists differ in length");
+
+    sid = sid->next[0];
+    pid = pid->next[0];
+  }
+  CHECK (sid == NULL && pid == NULL, "Trace ID lists differ in length");
+
+  mstl3_free (&serial, 1);
+  mstl3_free (&parallel, 1);
+  free (buffer);
+}
+
+TEST (read, recptr_coalesced)
+{
+  MS3TraceList *mstl = NULL;
+  MS3TraceID *id     = NULL;
+  MS3TraceSeg *seg   = NULL;
+  char *reference    = NULL;
+  char *coalesced    = NULL;
+  uint64_t datasize;
+  uint8_t samplesize;
+  int64_t unpacked;
+  int64_t coalescedcount;
+  int idx;
+  int rv;
+
+  char *path[2] = {"data/testdata-3channel-signal.mseed2",
+                   "data/testdata-oneseries-mixedlengths-mixedorder.mseed2"};
+
+  for (idx = 0; idx < 2; idx++)
+  {
+    rv = ms3_readtracelist (&mstl, path[idx], NULL, 0, MSF_RECORDLIST, 0);
+    CHECK (rv == MS_NOERROR, "ms3_readtracelist() did not return expected MS_NOERROR");
+    REQUIRE (mstl != NULL, "ms3_readtracelist() did not populate 'mstl'");
+
+    for (id = mstl->traces.next[0]; id; id = id->next[0])
+    {
+      for (seg = id->first; seg; seg = seg->next)
+      {
+        REQUIRE (seg->recordlist != NULL, "seg->recordlist is not populated");
+        REQUIRE (ms_encoding_sizetype ((uint8_t)seg->recordlist->first->msr->encoding, &samplesize, NULL) == 0,
+                 "Cannot determine sample size");
+
+        datasize = seg->samplecnt * samplesize;
+        reference = (char *)malloc (datasize);
+        coalesced = (char *)malloc (datasize);
+        REQUIRE (reference != NULL && coalesced != NULL, "Cannot allocate buffers");
+
+        unpacked = mstl3_unpack_recordlist (id, seg, reference, datasize, 0);
+        CHECK (unpacked == seg->samplecnt, "mstl3_unpack_recordlist() did not unpack all samples");
+
+        /* Only adjacent records coalesced, serial */
+        memset (coalesced, 0, datasize);
+        coalescedcount = mstl3_unpack_recordlist_coalesced (id, seg, coalesced, datasize, 0, 1, 0);
+        CHECK (coalescedcount == unpacked, "mstl3_unpack_recordlist_coalesced() sample count mismatch");
+        CHECK (memcmp (reference, coalesced, datasize) == 0, "Coalesced samples differ (serial)");
+
+        /* Records within a gap coalesced, multiple threads */
+        memset (coalesced, 0, datasize);
+        coalescedcount = mstl3_unpack_recordlist_coalesced (id, seg, coalesced, datasize, 4096, 4, 0);
+        CHECK (coalescedcount == unpacked, "mstl3_unpack_recordlist_coalesced() sample count mismatch");
+        CHECK (memcmp (reference, coalesced, datasize) == 0, "Coalesced samples differ (threaded)");
+
+        free (reference);
+        free (coalesced);
+      }
+    }
+
+    /* Allocated output associated with segment */
+    seg = mstl->traces.next[0]->first;
+    coalescedcount = mstl3_unpack_recordlist_coalesced (mstl->traces.next[0], seg, NULL, 0, 1024, 0, 0);
+    CHECK (coalescedcount == seg->samplecnt, "mstl3_unpack_recordlist_coalesced() did not unpack all samples");
+    CHECK (seg->datasamples != NULL, "seg->datasamples is unexpected NULL");
+    CHECK (seg->numsamples == seg->samplecnt, "seg->numsamples is not expected seg->samplecnt");
+
+    mstl3_free (&mstl, 1);
+  }
+}
+
+TEST (read, recptr_parallel)
+{
+  MS3TraceList *mstl = NULL;
+  MS3TraceID *id     = NULL;
+  MS3TraceSeg *seg   = NULL;
+  char *buffer       = NULL;
+  char *reference    = NULL;
+  char *parallel     = NULL;
+  uint64_t buffersize;
+  uint64_t datasize;
+  uint8_t samplesize;
+  int64_t unpacked;
+  int64_t parallelcount;
+  FILE *fp;
+  int idx;
+  int rv;
+
+  char *path = "data/testdata-3channel-signal.mseed3";
+
+  /* Read file into buffer */
+  fp = fopen (path, "rb");
+  REQUIRE (fp != NULL, "Cannot open test file");
+  fseek (fp, 0, SEEK_END);
+  buffersize = (uint64_t)ftell (fp);
+  rewind (fp);
+  buffer = (char *)malloc (buffersize);
+  REQUIRE (buffer != NULL, "Cannot allocate buffer");
+  REQUIRE (fread (buffer, 1, buffersize, fp) == buffersize, "Cannot read test file");
+  fclose (fp);
+
+  /* Record lists referencing records in a file and in a buffer */
+  for (idx = 0; idx < 2; idx++)
+  {
+    if (idx == 0)
+    {
+      rv = ms3_readtracelist (&mstl, path, NULL, 0, MSF_RECORDLIST, 0);
+      CHECK (rv == MS_NOERROR, "ms3_readtracelist() did not return expected MS_NOERROR");
+    }
+    else
+    {
+      mstl = mstl3_init (NULL);
+      REQUIRE (mstl != NULL, "mstl3_init() returned unexpected NULL");
+      parallelcount = mstl3_readbuffer (&mstl, buffer, buffersize, 0, MSF_RECORDLIST, NULL, 0);
+      CHECK (parallelcount > 0, "mstl3_readbuffer() did not read records");
+    }
+    REQUIRE (mstl != NULL, "Trace list is not populated");
+
+    for (id = mstl->traces.next[0]; id; id = id->next[0])
+    {
+      for (seg = id->first; seg; seg = seg->next)
+      {
+        REQUIRE (seg->recordlist != NULL, "seg->recordlist is not populated");
+        REQUIRE (ms_encoding_sizetype ((uint8_t)seg->recordlist->first->msr->encoding, &samplesize, NULL) == 0,
+                 "Cannot determine sample size");
+
+        datasize = seg->samplecnt * samplesize;
+        reference = (char *)malloc (datasize);
+        parallel = (char *)malloc (datasize);
+        REQUIRE (reference != NULL && parallel != NULL, "Cannot allocate buffers");
+
+        unpacked = mstl3_unpack_recordlist (id, seg, reference, datasize, 0);
+        CHECK (unpacked == seg->samplecnt, "mstl3_unpack_recordlist() did not unpack all samples");
+
+        memset (parallel, 0, datasize);
+        parallelcount = mstl3_unpack_recordlist_parallel (id, seg, parallel, datasize, 1, 0);
+        CHECK (parallelcount == unpacked, "mstl3_unpack_recordlist_parallel() sample count mismatch");
+        CHECK (memcmp (reference, parallel, datasize) == 0, "Parallel samples differ (serial)");
+
+        memset (parallel, 0, datasize);
+        parallelcount = mstl3_unpack_recordlist_parallel (id, seg, parallel, datasize, 4, 0);
+        CHECK (parallelcount == unpacked, "mstl3_unpack_recordlist_parallel() sample count mismatch");
+        CHECK (memcmp (reference, parallel, datasize) == 0, "Parallel samples differ (threaded)");
+
+        free (reference);
+        free (parallel);
+      }
+    }
+
+    /* Allocated output associated with segment */
+    seg = mstl->traces.next[0]->first;
+    parallelcount = mstl3_unpack_recordlist_parallel (mstl->traces.next[0], seg, NULL, 0, 0, 0);
+    CHECK (parallelcount == seg->samplecnt, "mstl3_unpack_recordlist_parallel() did not unpack all samples");
+    CHECK (seg->datasamples != NULL, "seg->datasamples is unexpected NULL");
+
+    mstl3_free (&mstl, 1);
+  }
+
+  free (buffer);
+}
@@ -0,0 +1,369 @@
+#include <tau/tau.h>
+#include <libmseed.h>
+
+#if !defined(_WIN32)
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define URLTESTFILE "data/testdata-3channel-signal.mseed3"
+
+/* A minimal HTTP/1.1 server stand-in serving a single buffer */
+struct httpserver
+{
+  int listenfd;
+  int port;
+  const char *data;
+  size_t length;
+  int acceptranges;
+  int headstatus;
+  int requests;
+  int headrequests;
+  int rangerequests;
+  int stop;
+  pthread_mutex_t lock;
+  pthread_t thread;
+};
+
+/* Handle a single request on a connection, the connection is closed after the response */
+static void
+httpserver_respond (struct httpserver *server, int fd)
+{
+  char request[4096];
+  char header[512];
+  size_t received = 0;
+  ssize_t rv;
+  uint64_t start = 0;
+  uint64_t end = server->length - 1;
+  int isrange = 0;
+  int headerlength;
+  char *range;
+
+  /* Read request headers */
+  while (received < sizeof (request) - 1)
+  {
+    if ((rv = recv (fd, request + received, sizeof (request) - 1 - received, 0)) <= 0)
+      return;
+
+    received += rv;
+    request[received] = '\0';
+
+    if (strstr (request, "\r\n\r\n"))
+      break;
+  }
+
+  server->requests++;
+
+  /* Reject HEAD requests with a configured status */
+  if (strncmp (request, "HEAD ", 5) == 0)
+  {
+    server->headrequests++;
+
+    if (server->headstatus)
+    {
+      headerlength = snprintf (header, sizeof (header),
+                               "HTTP/1.1 %d Method Not Allowed\r\n"
+                               "Content-Length: 0\r\n"
+                               "Connection: close\r\n\r\n",
+                               server->headstatus);
+      send (fd, header, headerlength, 0);
+      return;
+    }
+  }
+
+  if (server->acceptranges && (range = strstr (request, "Range: bytes=")) != NULL)
+  {
+    if (sscanf (range + 13, "%" SCNu64 "-%" SCNu64, &start, &end) == 2 &&
+        start <= end && end < server->length)
+    {
+      isrange = 1;
+      server->rangerequests++;
+    }
+    else
+    {
+      start = 0;
+      end = server->length - 1;
+    }
+  }
+
+  if (isrange)
+    headerlength = snprintf (header, sizeof (header),
+                             "HTTP/1.1 206 Partial Content\r\n"
+                             "Content-Range: bytes %" PRIu64 "-%" PRIu64 "/%" PRIu64 "\r\n"
+                             "Content-Length: %" PRIu64 "\r\n"
+                             "Accept-Ranges: bytes\r\n"
+                             "Connection: close\r\n\r\n",
+                             start, end, (uint64_t)server->length, end - start + 1);
+  else
+    headerlength = snprintf (header, sizeof (header),
+                             "HTTP/1.1 200 OK\r\n"
+                             "Content-Length: %" PRIu64 "\r\n"
+                             "%s"
+                             "Connection: close\r\n\r\n",
+                             (uint64_t)server->length,
+                             (server->acceptranges) ? "Accept-Ranges: bytes\r\n" : "");
+
+  send (fd, header, headerlength, 0);
+
+  if (strncmp (request, "HEAD ", 5) != 0)
+    send (fd, server->data + start, end - start + 1, 0);
+}
+
+static void *
+httpserver_run (void *arg)
+{
+  struct httpserver *server = (struct httpserver *)arg;
+  struct pollfd pfd;
+  int fd;
+
+  pfd.fd = server->listenfd;
+  pfd.events = POLLIN;
+
+  pthread_mutex_lock (&server->lock);
+
+  while (!server->stop)
+  {
+    pthread_mutex_unlock (&server->lock);
+
+    if (poll (&pfd, 1, 50) > 0 &&
+        (fd = accept (server->listenfd, NULL, NULL)) >= 0)
+    {
+      pthread_mutex_lock (&server->lock);
+      httpserver_respond (server, fd);
+      pthread_mutex_unlock (&server->lock);
+      close (fd);
+    }
+
+    pthread_mutex_lock (&server->lock);
+  }
+
+  pthread_mutex_unlock (&server->lock);
+
+  return NULL;
+}
+
+static int
+httpserver_start (struct httpserver *server)
+{
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof (addr);
+
+  if ((server->listenfd = socket (AF_INET, SOCK_STREAM, 0)) < 0)
+    return -1;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = 0;
+
+  if (bind (server->listenfd, (struct sockaddr *)&addr, sizeof (addr)) ||
+      listen (server->listenfd, 16) ||
+      getsockname (server->listenfd, (struct sockaddr *)&addr, &addrlen))
+  {
+    close (server->listenfd);
+    return -1;
+  }
+
+  server->port = ntohs (addr.sin_port);
+  server->stop = 0;
+  pthread_mutex_init (&server->lock, NULL);
+
+  if (pthread_create (&server->thread, NULL, httpserver_run, server))
+  {
+    pthread_mutex_destroy (&server->lock);
+    close (server->listenfd);
+    return -1;
+  }
+
+  return 0;
+}
+
+static void
+httpserver_stop (struct httpserver *server)
+{
+  pthread_mutex_lock (&server->lock);
+  server->stop = 1;
+  pthread_mutex_unlock (&server->lock);
+
+  pthread_join (server->thread, NULL);
+  pthread_mutex_destroy (&server->lock);
+  close (server->listenfd);
+}
+
+/* Set server behavior and reset request counters */
+static void
+httpserver_configure (struct httpserver *server, int acceptranges, int headstatus)
+{
+  pthread_mutex_lock (&server->lock);
+  server->acceptranges = acceptranges;
+  server->headstatus = headstatus;
+  server->requests = 0;
+  server->headrequests = 0;
+  server->rangerequests = 0;
+  pthread_mutex_unlock (&server->lock);
+}
+
+/* Return the value of a server request counter */
+static int
+httpserver_count (struct httpserver *server, int *counter)
+{
+  int count;
+
+  pthread_mutex_lock (&server->lock);
+  count = *counter;
+  pthread_mutex_unlock (&server->lock);
+
+  return count;
+}
+
+/* Read all records from a path and compare them to the file contents at their offsets */
+static int64_t
+compare_url_records (const char *url, const char *filedata, int64_t *mismatches)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  int64_t records = 0;
+  int rv;
+
+  *mismatches = 0;
+
+  while ((rv = ms3_readmsr_r (&msfp, &msr, url, MSF_PNAMERANGE, 0)) == MS_NOERROR)
+  {
+    if (memcmp (msr->record, filedata + msfp->streampos - msr->reclen, msr->reclen))
+      (*mismatches)++;
+
+    records++;
+  }
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  return (rv == MS_ENDOFFILE) ? records : -1;
+}
+
+TEST (url, parallel_ranges)
+{
+  struct httpserver server;
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  FILE *fp;
+  char filedata[65536];
+  char url[256];
+  int64_t filerecords = 0;
+  int64_t records;
+  int64_t mismatches;
+  int64_t offsets[2] = {0, 0};
+  size_t length;
+
+  /* Skip when the library does not include URL support */
+  if (!libmseed_url_support ())
+    return;
+
+  fp = fopen (URLTESTFILE, "rb");
+  REQUIRE (fp != NULL, "Cannot open test file");
+  length = fread (filedata, 1, sizeof (filedata), fp);
+  fclose (fp);
+  REQUIRE (length > 0 && length < sizeof (filedata), "Unexpected test file length");
+
+  /* Count records and note record offsets for a range request */
+  while (ms3_readmsr_r (&msfp, &msr, URLTESTFILE, 0, 0) == MS_NOERROR)
+  {
+    if (filerecords == 10)
+      offsets[0] = msfp->streampos - msr->reclen;
+    if (filerecords == 60)
+      offsets[1] = msfp->streampos - msr->reclen - 1;
+    filerecords++;
+  }
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+  REQUIRE (filerecords > 60, "Unexpected test file record count");
+
+  memset (&server, 0, sizeof (server));
+  server.data = filedata;
+  server.length = length;
+  server.acceptranges = 1;
+  REQUIRE (httpserver_start (&server) == 0, "Cannot start HTTP server");
+
+  snprintf (url, sizeof (url), "http://127.0.0.1:%d/" URLTESTFILE, server.port);
+
+  /* Parallel range requests with chunks that do not align with records */
+  CHECK (ms3_url_parallel (4, 3000) == 0, "ms3_url_parallel() returned unexpected error");
+
+  records = compare_url_records (url, filedata, &mismatches);
+  CHECK (records == filerecords, "Parallel range read record count mismatch");
+  CHECK (mismatches == 0, "Parallel range read record content mismatch");
+  CHECK (httpserver_count (&server, &server.rangerequests) == (int)((length + 2999) / 3000),
+         "Unexpected number of range requests");
+
+  /* Read a range of the resource */
+  snprintf (url, sizeof (url), "http://127.0.0.1:%d/" URLTESTFILE "@%" PRId64 "-%" PRId64,
+            server.port, offsets[0], offsets[1]);
+
+  records = compare_url_records (url, filedata, &mismatches);
+  CHECK (records == 50, "Parallel range read of range record count mismatch");
+  CHECK (mismatches == 0, "Parallel range read of range record content mismatch");
+
+  /* Single request when the server does not accept ranges */
+  snprintf (url, sizeof (url), "http://127.0.0.1:%d/" URLTESTFILE, server.port);
+  httpserver_configure (&server, 0, 0);
+
+  records = compare_url_records (url, filedata, &mismatches);
+  CHECK (records == filerecords, "Fallback read record count mismatch");
+  CHECK (mismatches == 0, "Fallback read record content mismatch");
+  CHECK (httpserver_count (&server, &server.rangerequests) == 0,
+         "Unexpected range requests to server not accepting ranges");
+
+  ms3_url_parallel (0, 0);
+  httpserver_stop (&server);
+}
+
+TEST (url, head_rejected)
+{
+  struct httpserver server;
+  FILE *fp;
+  char filedata[65536];
+  char url[256];
+  int64_t filerecords = 0;
+  int64_t records;
+  int64_t mismatches;
+  size_t length;
+
+  /* Skip when the library does not include URL support */
+  if (!libmseed_url_support ())
+    return;
+
+  fp = fopen (URLTESTFILE, "rb");
+  REQUIRE (fp != NULL, "Cannot open test file");
+  length = fread (filedata, 1, sizeof (filedata), fp);
+  fclose (fp);
+  REQUIRE (length > 0 && length < sizeof (filedata), "Unexpected test file length");
+
+  filerecords = compare_url_records (URLTESTFILE, filedata, &mismatches);
+  REQUIRE (filerecords > 0, "Unexpected test file record count");
+
+  memset (&server, 0, sizeof (server));
+  server.data = filedata;
+  server.length = length;
+  REQUIRE (httpserver_start (&server) == 0, "Cannot start HTTP server");
+
+  snprintf (url, sizeof (url), "http://127.0.0.1:%d/" URLTESTFILE, server.port);
+
+  /* A server rejecting HEAD requests is read with a single request */
+  httpserver_configure (&server, 1, 405);
+  CHECK (ms3_url_parallel (4, 3000) == 0, "ms3_url_parallel() returned unexpected error");
+
+  records = compare_url_records (url, filedata, &mismatches);
+  CHECK (records == filerecords, "Read after rejected HEAD record count mismatch");
+  CHECK (mismatches == 0, "Read after rejected HEAD record content mismatch");
+  CHECK (httpserver_count (&server, &server.headrequests) == 1, "Unexpected number of HEAD requests");
+  CHECK (httpserver_count (&server, &server.rangerequests) == 0,
+         "Unexpected range requests after rejected HEAD");
+
+  ms3_url_parallel (0, 0);
+  httpserver_stop (&server);
+}
+
+#endif /* !defined(_WIN32) */
@@ -273,3 +273,292 @@ TEST (write, trace)
   msr->datasamples = NULL;
   msr3_free (&msr);
 }
+
+/* Collect records into a single buffer */
+struct recordcollection
+{
+  char *buffer;
+  size_t length;
+  int64_t count;
+};
+
+static void
+collect_record (char *record, int reclen, void *handlerdata)
+{
+  struct recordcollection *collection = (struct recordcollection *)handlerdata;
+
+  collection->buffer = realloc (collection->buffer, collection->length + reclen);
+
+  if (collection->buffer)
+  {
+    memcpy (collection->buffer + collection->length, record, reclen);
+    collection->length += reclen;
+    collection->count++;
+  }
+}
+
+/* Populate a trace list with a number of trace IDs of sine data */
+static MS3TraceList *
+build_sine_tracelist (int idcount, int32_t *sinedata)
+{
+  MS3Record *msr = NULL;
+  MS3TraceList *mstl = NULL;
+  int idx;
+
+  if ((msr = msr3_init (NULL)) == NULL || (mstl = mstl3_init (NULL)) == NULL)
+    return NULL;
+
+  msr->pubversion = 1;
+  msr->samprate = 40.0;
+  msr->sampletype = 'i';
+
+  for (idx = 0; idx < idcount; idx++)
+  {
+    snprintf (msr->sid, sizeof (msr->sid), "FDSN:XX_T%03d__B_H_Z", idx);
+    msr->starttime = ms_timestr2nstime ("2012-05-12T00:00:00") + (nstime_t)idx * NSTMODULUS;
+    msr->numsamples = SINE_DATA_SAMPLES - 1 - idx;
+    msr->samplecnt = msr->numsamples;
+    msr->datasamples = sinedata;
+
+    if (mstl3_addmsr (mstl, msr, 0, 1, 0, NULL) == NULL)
+      mstl3_free (&mstl, 0);
+  }
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+
+  return mstl;
+}
+
+TEST (write, trace_parallel)
+{
+  MS3TraceList *serialmstl = NULL;
+  MS3TraceList *parallelmstl = NULL;
+  MS3TraceID *serialid;
+  MS3TraceID *parallelid;
+  struct recordcollection serial = {NULL, 0, 0};
+  struct recordcollection parallel = {NULL, 0, 0};
+  char extra[] = "{\"FDSN\":{\"Time\":{\"Quality\":80}}}";
+  int32_t sinedata[SINE_DATA_SAMPLES];
+  int64_t serialsamples = 0;
+  int64_t parallelsamples = 0;
+  int64_t serialrv;
+  int64_t parallelrv;
+  int idx;
+
+  for (idx = 0; idx < SINE_DATA_SAMPLES; idx++)
+  {
+    sinedata[idx] = (int32_t)(fsinedata[idx]);
+  }
+
+  serialmstl = build_sine_tracelist (37, sinedata);
+  parallelmstl = build_sine_tracelist (37, sinedata);
+  REQUIRE (serialmstl != NULL && parallelmstl != NULL, "build_sine_tracelist() returned unexpected NULL");
+
+  /* Pack complete records only, leaving partial data in the lists */
+  serialrv = mstl3_pack (serialmstl, collect_record, &serial, 256, DE_STEIM2,
+                         &serialsamples, 0, 0, extra);
+  parallelrv = mstl3_pack_parallel (parallelmstl, collect_record, &parallel, 256, DE_STEIM2,
+                                    &parallelsamples, 0, 0, extra, 4);
+
+  CHECK (serialrv > 37, "mstl3_pack() returned unexpected record count");
+  CHECK (parallelrv == serialrv, "mstl3_pack_parallel() record count does not match serial");
+  CHECK (parallelsamples == serialsamples, "mstl3_pack_parallel() sample count does not match serial");
+  REQUIRE (parallel.length == serial.length, "Parallel packed length does not match serial");
+  CHECK (!memcmp (parallel.buffer, serial.buffer, serial.length), "Parallel packed records do not match serial");
+
+  /* Remaining data in the lists must be identical */
+  serialid = serialmstl->traces.next[0];
+  parallelid = parallelmstl->traces.next[0];
+  while (serialid && parallelid)
+  {
+    CHECK (serialid->first->starttime == parallelid->first->starttime, "Remaining segment start mismatch");
+    CHECK (serialid->first->numsamples == parallelid->first->numsamples, "Remaining segment samples mismatch");
+    CHECK (!memcmp (serialid->first->datasamples, parallelid->first->datasamples,
+                    serialid->first->numsamples * sizeof (int32_t)),
+           "Remaining segment data mismatch");
+
+    serialid = serialid->next[0];
+    parallelid = parallelid->next[0];
+  }
+  CHECK (serialid == NULL && parallelid == NULL, "Trace ID lists differ");
+
+  /* Flush remaining data */
+  serial.length = parallel.length = 0;
+  serialrv = mstl3_pack (serialmstl, collect_record, &serial, 256, DE_STEIM2,
+                         &serialsamples, MSF_FLUSHDATA, 0, extra);
+  parallelrv = mstl3_pack_parallel (parallelmstl, collect_record, &parallel, 256, DE_STEIM2,
+                                    &parallelsamples, MSF_FLUSHDATA, 0, extra, 4);
+
+  CHECK (serialrv >= 37, "mstl3_pack() flush returned unexpected record count");
+  CHECK (parallelrv == serialrv, "mstl3_pack_parallel() flush record count does not match serial");
+  CHECK (parallelsamples == serialsamples, "mstl3_pack_parallel() flush sample count does not match serial");
+  REQUIRE (parallel.length == serial.length, "Parallel flushed length does not match serial");
+  CHECK (!memcmp (parallel.buffer, serial.buffer, serial.length), "Parallel flushed records do not match serial");
+
+  free (serial.buffer);
+  free (parallel.buffer);
+  mstl3_free (&serialmstl, 0);
+  mstl3_free (&parallelmstl, 0);
+}
+
+/* Populate a trace list with a number of trace IDs of pseudo-random data */
+static MS3TraceList *
+build_random_tracelist (int idcount, int32_t *data, int64_t samples)
+{
+  MS3Record *msr = NULL;
+  MS3TraceList *mstl = NULL;
+  int idx;
+
+  if ((msr = msr3_init (NULL)) == NULL || (mstl = mstl3_init (NULL)) == NULL)
+    return NULL;
+
+  msr->pubversion = 1;
+  msr->samprate = 100.0;
+  msr->sampletype = 'i';
+  msr->starttime = ms_timestr2nstime ("2012-05-12T00:00:00");
+  msr->numsamples = samples;
+  msr->samplecnt = samples;
+  msr->datasamples = data;
+
+  for (idx = 0; idx < idcount; idx++)
+  {
+    snprintf (msr->sid, sizeof (msr->sid), "FDSN:XX_R%03d__H_H_Z", idx);
+
+    if (mstl3_addmsr (mstl, msr, 0, 1, 0, NULL) == NULL)
+      mstl3_free (&mstl, 0);
+  }
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+
+  return mstl;
+}
+
+TEST (write, trace_parallel_buffered)
+{
+  MS3TraceList *serialmstl = NULL;
+  MS3TraceList *parallelmstl = NULL;
+  struct recordcollection serial = {NULL, 0, 0};
+  struct recordcollection parallel = {NULL, 0, 0};
+  int64_t samples = 512 * 1024;
+  int64_t serialsamples = 0;
+  int64_t parallelsamples = 0;
+  int64_t serialrv;
+  int64_t parallelrv;
+  uint32_t seed = 1;
+  int32_t *data;
+  int64_t idx;
+
+  /* Data of each trace ID packs to more than the buffer limit of a trace ID */
+  data = (int32_t *)malloc (samples * sizeof (int32_t));
+  REQUIRE (data != NULL, "Cannot allocate memory for data");
+
+  for (idx = 0; idx < samples; idx++)
+  {
+    seed = seed * 1103515245 + 12345;
+    data[idx] = (int32_t)seed;
+  }
+
+  serialmstl = build_random_tracelist (9, data, samples);
+  parallelmstl = build_random_tracelist (9, data, samples);
+  REQUIRE (serialmstl != NULL && parallelmstl != NULL, "build_random_tracelist() returned unexpected NULL");
+
+  serialrv = mstl3_pack (serialmstl, collect_record, &serial, 4096, DE_INT32,
+                         &serialsamples, MSF_FLUSHDATA, 0, NULL);
+  parallelrv = mstl3_pack_parallel (parallelmstl, collect_record, &parallel, 4096, DE_INT32,
+                                    &parallelsamples, MSF_FLUSHDATA, 0, NULL, 3);
+
+  CHECK (serialsamples == 9 * samples, "mstl3_pack() packed unexpected sample count");
+  CHECK (parallelrv == serialrv, "mstl3_pack_parallel() record count does not match serial");
+  CHECK (parallelsamples == serialsamples, "mstl3_pack_parallel() sample count does not match serial");
+  REQUIRE (parallel.length == serial.length, "Parallel packed length does not match serial");
+  CHECK (!memcmp (parallel.buffer, serial.buffer, serial.length), "Parallel packed records do not match serial");
+
+  free (serial.buffer);
+  free (parallel.buffer);
+  free (data);
+  mstl3_free (&serialmstl, 0);
+  mstl3_free (&parallelmstl, 0);
+}
+
+TEST (write, streampack)
+{
+  MS3Record *msr = NULL;
+  MS3StreamPacker *packer = NULL;
+  struct recordcollection reference = {NULL, 0, 0};
+  struct recordcollection streamed = {NULL, 0, 0};
+  char extra[] = "{\"FDSN\":{\"Time\":{\"Quality\":80}}}";
+  int32_t sinedata[SINE_DATA_SAMPLES];
+  int64_t packedsamples = 0;
+  int64_t records = 0;
+  int64_t rv;
+  int idx;
+
+  for (idx = 0; idx < SINE_DATA_SAMPLES; idx++)
+  {
+    sinedata[idx] = (int32_t)(fsinedata[idx]);
+  }
+
+  msr = msr3_init (msr);
+  REQUIRE (msr != NULL, "msr3_init() returned unexpected NULL");
+
+  msr->reclen = 256;
+  msr->encoding = DE_STEIM2;
+  msr->pubversion = 1;
+  msr->starttime = ms_timestr2nstime ("2012-05-12T00:00:00");
+  strcpy (msr->sid, "FDSN:XX_TEST__B_H_Z");
+  msr->samprate = 40.0;
+  msr->extra = extra;
+  msr->extralength = (uint16_t)strlen (extra);
+  msr->numsamples = SINE_DATA_SAMPLES - 1;
+  msr->datasamples = sinedata;
+  msr->sampletype = 'i';
+
+  /* Reference records from a single msr3_pack() */
+  rv = msr3_pack (msr, collect_record, &reference, &packedsamples, MSF_FLUSHDATA, 0);
+  REQUIRE (rv > 1, "msr3_pack() returned unexpected value");
+
+  packer = msr3_streampack_init (msr, collect_record, &streamed, 0);
+  REQUIRE (packer != NULL, "msr3_streampack_init() returned unexpected NULL");
+
+  /* Add samples in small increments, continuous series */
+  for (idx = 0; idx < SINE_DATA_SAMPLES - 1; idx += 7)
+  {
+    rv = msr3_streampack_add (packer, (idx == 0) ? msr->starttime : NSTUNSET, sinedata + idx,
+                              (SINE_DATA_SAMPLES - 1 - idx < 7) ? SINE_DATA_SAMPLES - 1 - idx : 7);
+    REQUIRE (rv >= 0, "msr3_streampack_add() returned unexpected error");
+    records += rv;
+  }
+
+  CHECK (records > 0 && records < reference.count, "msr3_streampack_add() created unexpected record count");
+
+  rv = msr3_streampack_flush (packer);
+  CHECK (rv >= 1, "msr3_streampack_flush() returned unexpected value");
+  records += rv;
+
+  CHECK (records == reference.count, "Streamed record count does not match msr3_pack()");
+  REQUIRE (streamed.length == reference.length, "Streamed length does not match msr3_pack()");
+  CHECK (!memcmp (streamed.buffer, reference.buffer, reference.length), "Streamed records do not match msr3_pack()");
+
+  /* A discontinuous start time flushes buffered samples and starts a new series */
+  streamed.length = 0;
+  streamed.count = 0;
+  rv = msr3_streampack_add (packer, NSTUNSET, sinedata, 10);
+  CHECK (rv == 0, "msr3_streampack_add() returned unexpected value for partial record");
+  rv = msr3_streampack_add (packer, msr->starttime + (nstime_t)3600 * NSTMODULUS, sinedata, 10);
+  CHECK (rv == 1, "msr3_streampack_add() did not flush for discontinuous series");
+  rv = msr3_streampack_flush (packer);
+  CHECK (rv == 1, "msr3_streampack_flush() returned unexpected value");
+  CHECK (streamed.count == 2, "Unexpected record count for discontinuous series");
+
+  msr3_streampack_free (&packer);
+  CHECK (packer == NULL, "msr3_streampack_free() did not reset pointer");
+
+  free (reference.buffer);
+  free (streamed.buffer);
+
+  msr->extra = NULL;
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+}
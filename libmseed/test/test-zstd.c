@@ -0,0 +1,141 @@
+#include <tau/tau.h>
+#include <libmseed.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define ZSTDREFFILE "data/testdata-3channel-signal.mseed3"
+#define ZSTDTESTFILE "data/testdata-3channel-signal.mseed3.zst"
+#define SEEKABLETESTFILE "data/testdata-3channel-signal-seekable.mseed3.zst"
+
+/* Read all records from a path and compare them to the reference data at their offsets */
+static int64_t
+compare_zstd_records (const char *path, const char *refdata, int64_t reflength,
+                      int64_t *mismatches)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  int64_t records = 0;
+  int rv;
+
+  *mismatches = 0;
+
+  while ((rv = ms3_readmsr_r (&msfp, &msr, path, MSF_PNAMERANGE, 0)) == MS_NOERROR)
+  {
+    if (msfp->streampos > reflength ||
+        memcmp (msr->record, refdata + msfp->streampos - msr->reclen, msr->reclen))
+      (*mismatches)++;
+
+    records++;
+  }
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  return (rv == MS_ENDOFFILE) ? records : -1;
+}
+
+TEST (zstd, read)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  FILE *fp;
+  char refdata[65536];
+  char path[256];
+  int64_t filerecords = 0;
+  int64_t records;
+  int64_t mismatches;
+  int64_t offset = 0;
+  size_t length;
+
+  /* Skip when the library does not include zstd support */
+  if (!libmseed_zstd_support ())
+    return;
+
+  fp = fopen (ZSTDREFFILE, "rb");
+  REQUIRE (fp != NULL, "Cannot open reference file");
+  length = fread (refdata, 1, sizeof (refdata), fp);
+  fclose (fp);
+  REQUIRE (length > 0 && length < sizeof (refdata), "Unexpected reference file length");
+
+  /* Count records and note a record offset for reading from an offset */
+  while (ms3_readmsr_r (&msfp, &msr, ZSTDREFFILE, 0, 0) == MS_NOERROR)
+  {
+    if (filerecords == 40)
+      offset = msfp->streampos - msr->reclen;
+    filerecords++;
+  }
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+  REQUIRE (filerecords > 40, "Unexpected reference file record count");
+
+  /* General zstd with multiple frames and no seek table */
+  records = compare_zstd_records (ZSTDTESTFILE, refdata, length, &mismatches);
+  CHECK (records == filerecords, "zstd read record count mismatch");
+  CHECK (mismatches == 0, "zstd read record content mismatch");
+
+  snprintf (path, sizeof (path), ZSTDTESTFILE "@%" PRId64, offset);
+  records = compare_zstd_records (path, refdata, length, &mismatches);
+  CHECK (records == filerecords - 40, "zstd read from offset record count mismatch");
+  CHECK (mismatches == 0, "zstd read from offset record content mismatch");
+
+  /* Seekable zstd, frames not aligned with records, decompressed in parallel */
+  CHECK (ms3_zstd_threads (4) == 0, "ms3_zstd_threads() returned unexpected error");
+
+  records = compare_zstd_records (SEEKABLETESTFILE, refdata, length, &mismatches);
+  CHECK (records == filerecords, "Seekable zstd read record count mismatch");
+  CHECK (mismatches == 0, "Seekable zstd read record content mismatch");
+
+  /* Read from an offset starting at the containing frame */
+  snprintf (path, sizeof (path), SEEKABLETESTFILE "@%" PRId64, offset);
+  records = compare_zstd_records (path, refdata, length, &mismatches);
+  CHECK (records == filerecords - 40, "Seekable zstd read from offset record count mismatch");
+  CHECK (mismatches == 0, "Seekable zstd read from offset record content mismatch");
+
+  ms3_zstd_threads (1);
+}
+
+TEST (zstd, recordlist)
+{
+  MS3TraceList *refmstl = NULL;
+  MS3TraceList *mstl = NULL;
+  MS3TraceID *refid;
+  MS3TraceID *id;
+  int64_t refsamples = 0;
+  int64_t samples = 0;
+  int rv;
+
+  /* Skip when the library does not include zstd support */
+  if (!libmseed_zstd_support ())
+    return;
+
+  /* Record lists cannot refer to records in compressed files */
+  rv = ms3_readtracelist (&mstl, SEEKABLETESTFILE, NULL, 0, MSF_RECORDLIST, 0);
+  CHECK (rv == MS_GENERROR, "ms3_readtracelist() did not return error for record list of compressed file");
+  mstl3_free (&mstl, 0);
+
+  /* Data unpacked while reading match the uncompressed file */
+  rv = ms3_readtracelist (&refmstl, ZSTDREFFILE, NULL, 0, MSF_UNPACKDATA, 0);
+  REQUIRE (rv == MS_NOERROR, "ms3_readtracelist() returned unexpected error for reference file");
+  rv = ms3_readtracelist (&mstl, SEEKABLETESTFILE, NULL, 0, MSF_UNPACKDATA, 0);
+  REQUIRE (rv == MS_NOERROR, "ms3_readtracelist() returned unexpected error for compressed file");
+
+  CHECK (mstl->numtraceids == refmstl->numtraceids, "Trace ID count mismatch");
+
+  for (refid = refmstl->traces.next[0], id = mstl->traces.next[0];
+       refid && id; refid = refid->next[0], id = id->next[0])
+  {
+    CHECK_STREQ (id->sid, refid->sid);
+    CHECK (id->numsegments == refid->numsegments, "Segment count mismatch");
+    CHECK (id->first->numsamples == refid->first->numsamples, "Sample count mismatch");
+    CHECK (!memcmp (id->first->datasamples, refid->first->datasamples,
+                    id->first->numsamples * ms_samplesize (id->first->sampletype)),
+           "Sample values mismatch");
+
+    refsamples += refid->first->numsamples;
+    samples += id->first->numsamples;
+  }
+
+  CHECK (samples > 0 && samples == refsamples, "Total sample count mismatch");
+
+  mstl3_free (&refmstl, 0);
+  mstl3_free (&mstl, 0);
+}
@@ -0,0 +1,376 @@
+/***************************************************************************
+ * Internal routines for running tasks in parallel threads.
+ *
+ * Threads are implemented with POSIX threads or, on Windows, native
+ * threads.  If the library is built with LIBMSEED_NO_THREADING
+ * defined, all tasks are run serially in the calling thread.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2024 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "threadutils.h"
+
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  #include <windows.h>
+  #include <process.h>
+#else
+  #include <pthread.h>
+  #include <unistd.h>
+#endif
+#endif
+
+/* Maximum number of threads used when determined automatically */
+#define LM_MAXTHREADS 64
+
+/* Shared state for a set of workers processing tasks */
+struct lm_parallel_s
+{
+  void (*task) (void *context, int taskindex);
+  void *context;
+  int ntasks;
+  int nexttask;
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  CRITICAL_SECTION lock;
+#else
+  pthread_mutex_t lock;
+#endif
+#endif
+};
+
+/* Claim the next task index, returns -1 when all tasks are claimed */
+static int
+lm_nexttask (struct lm_parallel_s *parallel)
+{
+  int taskindex;
+
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  EnterCriticalSection (&parallel->lock);
+#else
+  pthread_mutex_lock (&parallel->lock);
+#endif
+#endif
+
+  taskindex = (parallel->nexttask < parallel->ntasks) ? parallel->nexttask++ : -1;
+
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  LeaveCriticalSection (&parallel->lock);
+#else
+  pthread_mutex_unlock (&parallel->lock);
+#endif
+#endif
+
+  return taskindex;
+}
+
+/* Worker loop, runs tasks until all are claimed */
+static void
+lm_worker (struct lm_parallel_s *parallel)
+{
+  int taskindex;
+
+  while ((taskindex = lm_nexttask (parallel)) >= 0)
+    parallel->task (parallel->context, taskindex);
+}
+
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+static unsigned __stdcall
+lm_worker_thread (void *arg)
+{
+  lm_worker ((struct lm_parallel_s *)arg);
+  return 0;
+}
+#else
+static void *
+lm_worker_thread (void *arg)
+{
+  lm_worker ((struct lm_parallel_s *)arg);
+  return NULL;
+}
+#endif
+#endif
+
+/***************************************************************************
+ * Determine the number of threads to use.
+ *
+ * If \a nthreads is greater than 0 it is returned unchanged, otherwise
+ * the number of online processors is returned (limited to LM_MAXTHREADS).
+ * When built without threading support this always returns 1.
+ ***************************************************************************/
+int
+lm_thread_count (int nthreads)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)nthreads;
+  return 1;
+#else
+  long ncpus = 1;
+
+  if (nthreads > 0)
+    return nthreads;
+
+#if defined(LMP_WIN)
+  SYSTEM_INFO sysinfo;
+  GetSystemInfo (&sysinfo);
+  ncpus = (long)sysinfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+  if (ncpus < 1)
+    ncpus = 1;
+  if (ncpus > LM_MAXTHREADS)
+    ncpus = LM_MAXTHREADS;
+
+  return (int)ncpus;
+#endif
+}
+
+/***************************************************************************
+ * Run \a ntasks tasks using up to \a nthreads threads.
+ *
+ * The \a task function is called once for each task index from 0 to
+ * \a ntasks - 1, with the supplied \a context.  Tasks are claimed by
+ * threads in index order, but may complete in any order.  The calling
+ * thread also runs tasks, so at most \a nthreads - 1 threads are
+ * created.  If thread creation fails the remaining threads, including
+ * the calling thread, complete all tasks.
+ *
+ * All tasks are complete when this function returns.
+ *
+ * Returns the number of threads used on success and -1 on error.
+ ***************************************************************************/
+int
+lm_parallel_run (int nthreads, int ntasks,
+                 void (*task) (void *context, int taskindex),
+                 void *context)
+{
+  struct lm_parallel_s parallel;
+  int nworkers = 0;
+  int idx;
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  HANDLE *threads = NULL;
+#else
+  pthread_t *threads = NULL;
+#endif
+#endif
+
+  if (!task || ntasks < 0)
+    return -1;
+
+  memset (&parallel, 0, sizeof (parallel));
+  parallel.task = task;
+  parallel.context = context;
+  parallel.ntasks = ntasks;
+  parallel.nexttask = 0;
+
+  nthreads = lm_thread_count (nthreads);
+
+  if (nthreads > ntasks)
+    nthreads = ntasks;
+
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  InitializeCriticalSection (&parallel.lock);
+#else
+  if (pthread_mutex_init (&parallel.lock, NULL))
+    return -1;
+#endif
+
+  /* Start worker threads in addition to the calling thread */
+  if (nthreads > 1 &&
+      (threads = libmseed_memory.malloc (sizeof (*threads) * (nthreads - 1))) != NULL)
+  {
+    for (nworkers = 0; nworkers < nthreads - 1; nworkers++)
+    {
+#if defined(LMP_WIN)
+      threads[nworkers] = (HANDLE)_beginthreadex (NULL, 0, lm_worker_thread, &parallel, 0, NULL);
+      if (threads[nworkers] == 0)
+        break;
+#else
+      if (pthread_create (&threads[nworkers], NULL, lm_worker_thread, &parallel))
+        break;
+#endif
+    }
+  }
+#endif
+
+  lm_worker (&parallel);
+
+#if !defined(LIBMSEED_NO_THREADING)
+  for (idx = 0; idx < nworkers; idx++)
+  {
+#if defined(LMP_WIN)
+    WaitForSingleObject (threads[idx], INFINITE);
+    CloseHandle (threads[idx]);
+#else
+    pthread_join (threads[idx], NULL);
+#endif
+  }
+
+  if (threads)
+    libmseed_memory.free (threads);
+
+#if defined(LMP_WIN)
+  DeleteCriticalSection (&parallel.lock);
+#else
+  pthread_mutex_destroy (&parallel.lock);
+#endif
+#else
+  (void)idx;
+#endif
+
+  return nworkers + 1;
+}
+
+/* Mutex with a condition variable, without threading only a placeholder */
+struct lm_sync_s
+{
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  CRITICAL_SECTION lock;
+  CONDITION_VARIABLE cond;
+#else
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+#endif
+  int unused;
+};
+
+/***************************************************************************
+ * Allocate and initialize a mutex with a condition variable.
+ *
+ * Returns a pointer to the lm_sync on success and NULL on error.
+ ***************************************************************************/
+lm_sync *
+lm_sync_init (void)
+{
+  lm_sync *sync;
+
+  if ((sync = libmseed_memory.malloc (sizeof (lm_sync))) == NULL)
+    return NULL;
+
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  InitializeCriticalSection (&sync->lock);
+  InitializeConditionVariable (&sync->cond);
+#else
+  if (pthread_mutex_init (&sync->lock, NULL))
+  {
+    libmseed_memory.free (sync);
+    return NULL;
+  }
+
+  if (pthread_cond_init (&sync->cond, NULL))
+  {
+    pthread_mutex_destroy (&sync->lock);
+    libmseed_memory.free (sync);
+    return NULL;
+  }
+#endif
+#endif
+
+  return sync;
+}
+
+/* Free a mutex with a condition variable */
+void
+lm_sync_free (lm_sync *sync)
+{
+  if (!sync)
+    return;
+
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  DeleteCriticalSection (&sync->lock);
+#else
+  pthread_cond_destroy (&sync->cond);
+  pthread_mutex_destroy (&sync->lock);
+#endif
+#endif
+
+  libmseed_memory.free (sync);
+}
+
+/* Lock the mutex */
+void
+lm_sync_lock (lm_sync *sync)
+{
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  EnterCriticalSection (&sync->lock);
+#else
+  pthread_mutex_lock (&sync->lock);
+#endif
+#else
+  (void)sync;
+#endif
+}
+
+/* Unlock the mutex */
+void
+lm_sync_unlock (lm_sync *sync)
+{
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  LeaveCriticalSection (&sync->lock);
+#else
+  pthread_mutex_unlock (&sync->lock);
+#endif
+#else
+  (void)sync;
+#endif
+}
+
+/* Wait for a broadcast, the mutex must be locked and is locked on return */
+void
+lm_sync_wait (lm_sync *sync)
+{
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  SleepConditionVariableCS (&sync->cond, &sync->lock, INFINITE);
+#else
+  pthread_cond_wait (&sync->cond, &sync->lock);
+#endif
+#else
+  (void)sync;
+#endif
+}
+
+/* Wake all threads waiting with lm_sync_wait() */
+void
+lm_sync_broadcast (lm_sync *sync)
+{
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+  WakeAllConditionVariable (&sync->cond);
+#else
+  pthread_cond_broadcast (&sync->cond);
+#endif
+#else
+  (void)sync;
+#endif
+}
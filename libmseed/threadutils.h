@@ -0,0 +1,49 @@
+/***************************************************************************
+ * Interface declarations for routines in threadutils.c
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2024 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef THREADUTILS_H
+#define THREADUTILS_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libmseed.h"
+
+extern int lm_thread_count (int nthreads);
+extern int lm_parallel_run (int nthreads, int ntasks,
+                            void (*task) (void *context, int taskindex),
+                            void *context);
+
+/* Mutex with a condition variable for coordinating tasks */
+typedef struct lm_sync_s lm_sync;
+
+extern lm_sync *lm_sync_init (void);
+extern void lm_sync_free (lm_sync *sync);
+extern void lm_sync_lock (lm_sync *sync);
+extern void lm_sync_unlock (lm_sync *sync);
+extern void lm_sync_wait (lm_sync *sync);
+extern void lm_sync_broadcast (lm_sync *sync);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
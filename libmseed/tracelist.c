@@ -25,15 +25,50 @@
 #include <time.h>
 
 #include "libmseed.h"
+#include "selection.h"
+#include "threadutils.h"
 
-MS3TraceSeg *mstl3_msr2seg (const MS3Record *msr, nstime_t endtime);
+MS3TraceSeg *mstl3_msr2seg (MS3TraceList *mstl, const MS3Record *msr, nstime_t endtime);
 MS3TraceSeg *mstl3_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t whence);
 MS3TraceSeg *mstl3_addsegtoseg (MS3TraceSeg *seg1, MS3TraceSeg *seg2);
-MS3RecordPtr *mstl3_add_recordptr (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t whence);
-
+MS3RecordPtr *mstl3_add_recordptr (MS3TraceList *mstl, MS3TraceSeg *seg, const MS3Record *msr,
+                                   nstime_t endtime, int8_t whence);
+
+static void mstl3_sortseg (MS3TraceID *id, MS3TraceSeg *seg);
+static int mstl3_mergeseg (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg,
+                           const MS3Tolerance *tolerance);
+static void mstl3_freeseg (MS3TraceList *mstl, MS3TraceSeg *seg, int8_t freeprvtptr);
+static int mstl3_unpack_setup (MS3TraceID *id, MS3TraceSeg *seg, void **output, uint64_t outputsize,
+                               uint8_t *samplesize, char *sampletype, uint64_t *decodedsize);
+static void mstl3_unpack_finish (MS3TraceSeg *seg, void *output, int64_t totalunpackedsamples,
+                                 char sampletype);
+static void *lm_pool_alloc (MS3TraceList *mstl, size_t size);
+static void lm_pool_release (MS3TraceList *mstl, void *ptr);
+static void lm_pool_destroy (MS3TraceList *mstl);
 static uint32_t lm_lcg_r (uint64_t *state);
 static uint8_t lm_random_height (uint8_t maximum, uint64_t *state);
 
+/* Slab of memory from which trace list entries are carved, the usable
+ * space follows the (aligned) header */
+typedef struct LMPoolSlab
+{
+  struct LMPoolSlab *next;
+  size_t size;
+  size_t used;
+} LMPoolSlab;
+
+/* Memory pool of slabs for a MS3TraceList, the current slab is first */
+typedef struct LMPool
+{
+  LMPoolSlab *slabs;
+  size_t slabsize;
+} LMPool;
+
+#define LM_POOL_DEFAULT_SLABSIZE 262144
+#define LM_POOL_ALIGN 16
+#define LM_POOL_ALIGNUP(X) (((X) + (LM_POOL_ALIGN - 1)) & ~((size_t)LM_POOL_ALIGN - 1))
+#define LM_POOL_HEADERSIZE LM_POOL_ALIGNUP (sizeof (LMPoolSlab))
+
 /**********************************************************************/ /**
  * @brief Initialize a ::MS3TraceList container
  *
@@ -91,10 +126,15 @@ mstl3_free (MS3TraceList **ppmstl, int8_t freeprvtptr)
   MS3TraceSeg *nextseg = 0;
   MS3RecordPtr *recordptr;
   MS3RecordPtr *nextrecordptr;
+  int8_t pooled;
 
   if (!ppmstl)
     return;
 
+  /* Entries allocated from a memory pool are released with the pool,
+   * only memory allocated separately is freed while traversing */
+  pooled = ((*ppmstl)->pool) ? 1 : 0;
+
   /* Free any associated traces */
   id = (*ppmstl)->traces.next[0];
   while (id)
@@ -116,28 +156,31 @@ mstl3_free (MS3TraceList **ppmstl, int8_t freeprvtptr)
         libmseed_memory.free (seg->datasamples);
 
       /* Free associated record list and related private pointers */
-      if (seg->recordlist)
+      if (seg->recordlist && (!pooled || freeprvtptr))
       {
         recordptr = seg->recordlist->first;
         while (recordptr)
         {
           nextrecordptr = recordptr->next;
 
-          if (recordptr->msr)
+          if (recordptr->msr && !pooled)
             msr3_free (&recordptr->msr);
 
           if (freeprvtptr && recordptr->prvtptr)
             libmseed_memory.free (recordptr->prvtptr);
 
-          libmseed_memory.free (recordptr);
+          if (!pooled)
+            libmseed_memory.free (recordptr);
 
           recordptr = nextrecordptr;
         }
 
-        libmseed_memory.free (seg->recordlist);
+        if (!pooled)
+          libmseed_memory.free (seg->recordlist);
       }
 
-      libmseed_memory.free (seg);
+      if (!pooled)
+        libmseed_memory.free (seg);
       seg = nextseg;
     }
 
@@ -145,11 +188,14 @@ mstl3_free (MS3TraceList **ppmstl, int8_t freeprvtptr)
     if (freeprvtptr && id->prvtptr)
       libmseed_memory.free (id->prvtptr);
 
-    libmseed_memory.free (id);
+    if (!pooled)
+      libmseed_memory.free (id);
 
     id = nextid;
   }
 
+  lm_pool_destroy (*ppmstl);
+
   libmseed_memory.free (*ppmstl);
 
   *ppmstl = NULL;
@@ -157,6 +203,74 @@ mstl3_free (MS3TraceList **ppmstl, int8_t freeprvtptr)
   return;
 } /* End of mstl3_free() */
 
+/**********************************************************************/ /**
+ * @brief Enable pooled allocation of entries in a ::MS3TraceList
+ *
+ * When enabled, the ::MS3TraceID, ::MS3TraceSeg, ::MS3RecordList and
+ * ::MS3RecordPtr entries (including the ::MS3Record copies referenced
+ * by record pointers) added to the list are carved from slabs of
+ * memory owned by the list instead of being allocated individually.
+ * This reduces the number of allocations when building large lists,
+ * keeps related entries close in memory, and allows mstl3_free() to
+ * release the entries in time proportional to the number of slabs.
+ *
+ * Data sample buffers and memory at \a prvtptr members are always
+ * allocated separately and freed as usual.
+ *
+ * Entries of a pooled list must not be freed individually, and
+ * ::MS3Record structures referenced by ::MS3RecordPtr entries must not
+ * be freed or have their extra headers modified.  Memory for entries
+ * removed from a pooled list, e.g. when segments are healed, is not
+ * reclaimed until the list is freed.
+ *
+ * Pooling can only be enabled for an empty list.
+ *
+ * @param[in] mstl Empty ::MS3TraceList to enable pooling for
+ * @param[in] slabsize Size of each slab in bytes, 0 for a default of 256 KiB
+ *
+ * @returns 0 on success and a negative library error code on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mstl3_free()
+ ***************************************************************************/
+int
+mstl3_pool_enable (MS3TraceList *mstl, size_t slabsize)
+{
+  LMPool *pool = NULL;
+
+  if (!mstl)
+  {
+    ms_log (2, "%s(): Required input not defined: 'mstl'\n", __func__);
+    return MS_GENERROR;
+  }
+
+  if (mstl->pool)
+  {
+    ms_log (2, "%s(): Memory pool is already enabled\n", __func__);
+    return MS_GENERROR;
+  }
+
+  if (mstl->numtraceids > 0 || mstl->traces.next[0])
+  {
+    ms_log (2, "%s(): Memory pool can only be enabled for an empty trace list\n", __func__);
+    return MS_GENERROR;
+  }
+
+  if ((pool = (LMPool *)libmseed_memory.malloc (sizeof (LMPool))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return MS_GENERROR;
+  }
+
+  pool->slabs = NULL;
+  pool->slabsize = (slabsize) ? LM_POOL_ALIGNUP (slabsize) : LM_POOL_DEFAULT_SLABSIZE;
+
+  mstl->pool = pool;
+
+  return 0;
+} /* End of mstl3_pool_enable() */
+
 /**********************************************************************/ /**
  * @brief Find matching ::MS3TraceID in a ::MS3TraceList
  *
@@ -409,7 +523,7 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
   /* If no matching ID was found create new MS3TraceID and MS3TraceSeg entries */
   if (!id)
   {
-    if (!(id = (MS3TraceID *)libmseed_memory.malloc (sizeof (MS3TraceID))))
+    if (!(id = (MS3TraceID *)lm_pool_alloc (mstl, sizeof (MS3TraceID))))
     {
       ms_log (2, "Error allocating memory\n");
       return NULL;
@@ -423,14 +537,14 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
     id->latest = endtime;
     id->numsegments = 1;
 
-    if (!(seg = mstl3_msr2seg (msr, endtime)))
+    if (!(seg = mstl3_msr2seg (mstl, msr, endtime)))
     {
       return NULL;
     }
     id->first = id->last = seg;
 
     /* Add MS3RecordPtr if requested */
-    if (pprecptr && !(*pprecptr = mstl3_add_recordptr (seg, msr, endtime, 1)))
+    if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, seg, msr, endtime, 1)))
     {
       return NULL;
     }
@@ -509,13 +623,13 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
         id->latest = endtime;
 
       /* Add MS3RecordPtr if requested */
-      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (seg, msr, endtime, 1)))
+      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, seg, msr, endtime, 1)))
         return NULL;
     }
     /* Record coverage is after all other coverage */
     else if ((msr->starttime - nsdelta - nstimetol) > id->latest)
     {
-      if (!(seg = mstl3_msr2seg (msr, endtime)))
+      if (!(seg = mstl3_msr2seg (mstl, msr, endtime)))
         return NULL;
 
       /* Add to end of list */
@@ -528,13 +642,13 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
         id->latest = endtime;
 
       /* Add MS3RecordPtr if requested */
-      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (seg, msr, endtime, 0)))
+      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, seg, msr, endtime, 0)))
         return NULL;
     }
     /* Record coverage is before all other coverage */
     else if ((endtime + nsdelta + nstimetol) < id->earliest)
     {
-      if (!(seg = mstl3_msr2seg (msr, endtime)))
+      if (!(seg = mstl3_msr2seg (mstl, msr, endtime)))
         return NULL;
 
       /* Add to beginning of list */
@@ -547,7 +661,7 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
         id->earliest = msr->starttime;
 
       /* Add MS3RecordPtr if requested */
-      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (seg, msr, endtime, 0)))
+      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, seg, msr, endtime, 0)))
         return NULL;
     }
     /* Record coverage fits at beginning of first segment */
@@ -562,7 +676,7 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
         id->earliest = msr->starttime;
 
       /* Add MS3RecordPtr if requested */
-      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (seg, msr, endtime, 2)))
+      if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, seg, msr, endtime, 2)))
         return NULL;
     }
     /* Search complete segment list for matches */
@@ -650,7 +764,7 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
         }
 
         /* Add MS3RecordPtr if requested */
-        if (pprecptr && !(*pprecptr = mstl3_add_recordptr (segbefore, msr, endtime, 1)))
+        if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, segbefore, msr, endtime, 1)))
         {
           return NULL;
         }
@@ -675,16 +789,7 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
             segafter->next->prev = segafter->prev;
 
           /* Free data samples, record list, private data and segment structure */
-          if (segafter->datasamples)
-            libmseed_memory.free (segafter->datasamples);
-
-          if (segafter->recordlist)
-            libmseed_memory.free (segafter->recordlist);
-
-          if (segafter->prvtptr)
-            libmseed_memory.free (segafter->prvtptr);
-
-          libmseed_memory.free (segafter);
+          mstl3_freeseg (mstl, segafter, 1);
 
           id->numsegments -= 1;
         }
@@ -700,7 +805,7 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
         }
 
         /* Add MS3RecordPtr if requested */
-        if (pprecptr && !(*pprecptr = mstl3_add_recordptr (segafter, msr, endtime, 2)))
+        if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, segafter, msr, endtime, 2)))
         {
           return NULL;
         }
@@ -711,13 +816,13 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
       else
       {
         /* Create new segment */
-        if (!(seg = mstl3_msr2seg (msr, endtime)))
+        if (!(seg = mstl3_msr2seg (mstl, msr, endtime)))
         {
           return NULL;
         }
 
         /* Add MS3RecordPtr if requested */
-        if (pprecptr && !(*pprecptr = mstl3_add_recordptr (seg, msr, endtime, 0)))
+        if (pprecptr && !(*pprecptr = mstl3_add_recordptr (mstl, seg, msr, endtime, 0)))
         {
           return NULL;
         }
@@ -761,6 +866,26 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
   } /* End of adding coverage to matching ID */
 
   /* Sort modified segment into place, logic above should limit these to few shifts if any */
+  mstl3_sortseg (id, seg);
+
+  return seg;
+} /* End of mstl3_addmsr_recordptr() */
+
+
+/***************************************************************************
+ * Move a MS3TraceSeg into sorted position within the segment list of
+ * a MS3TraceID.
+ *
+ * Segments are ordered by start time, and for equal start times the
+ * longer segment is first.  Callers are expected to have modified a
+ * single segment in a way that requires few, if any, shifts.
+ ***************************************************************************/
+static void
+mstl3_sortseg (MS3TraceID *id, MS3TraceSeg *seg)
+{
+  MS3TraceSeg *segbefore = NULL;
+  MS3TraceSeg *segafter = NULL;
+
   while (seg->next &&
          (seg->starttime > seg->next->starttime ||
           (seg->starttime == seg->next->starttime && seg->endtime < seg->next->endtime)))
@@ -810,853 +935,2121 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
     if (id->last == seg)
       id->last = segbefore;
   }
+} /* End of mstl3_sortseg() */
 
-  return seg;
-} /* End of mstl3_addmsr_recordptr() */
-
-
-/****************************************************************/ /**
- * @brief Parse miniSEED from a buffer and populate a ::MS3TraceList
- *
- * For a full description of \a tolerance see mstl3_addmsr().
- *
- * If the ::MSF_UNPACKDATA flag is set in \a flags, the data samples
- * will be unpacked.  In most cases the caller probably wants this
- * flag set, without it the trace list will merely be a list of
- * channels.
- *
- * If the ::MSF_RECORDLIST flag is set in \a flags, a ::MS3RecordList
- * will be built for each ::MS3TraceSeg.  The ::MS3RecordPtr entries
- * contain the location of the data record, bit flags, extra headers, etc.
- *
- * @param[in] ppmstl Pointer-to-point to destination MS3TraceList
- * @param[in] buffer Source buffer to read miniSEED records from
- * @param[in] bufferlength Maximum length of \a buffer
- * @param[in] splitversion Flag to control splitting of version/quality
- * @param[in] flags Flags to control parsing and optional functionality:
- * @parblock
- *  - \c ::MSF_RECORDLIST : Build a ::MS3RecordList for each ::MS3TraceSeg
- *  - Flags supported by msr3_parse()
- *  - Flags supported by mstl3_addmsr()
- * @endparblock
- * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
- * @param[in] verbose Controls verbosity, 0 means no diagnostic output
- *
- * @returns The number of records parsed on success, otherwise a
- * negative library error code.
+/**********************************************************************/ /**
+ * @brief Merge all data coverage of one ::MS3TraceList into another
  *
- * \ref MessageOnError - this function logs a message on error
+ * All ::MS3TraceID and ::MS3TraceSeg entries of \a src are moved into
+ * \a dst, leaving \a src as an empty, but still valid, list that must
+ * still be freed by the caller.  This is intended for combining trace
+ * lists that were constructed independently, e.g. in separate threads
+ * or from separate files.
  *
- * \sa mstl3_addmsr()
- *********************************************************************/
-int64_t
-mstl3_readbuffer (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
-                  int8_t splitversion, uint32_t flags,
-                  const MS3Tolerance *tolerance, int8_t verbose)
-{
-  return mstl3_readbuffer_selection (ppmstl, buffer, bufferlength,
-                                     splitversion, flags, tolerance,
-                                     NULL, verbose);
-} /* End of mstl3_readbuffer() */
-
-/****************************************************************/ /**
- * @brief Parse miniSEED from a buffer and populate a ::MS3TraceList
+ * IDs not present in \a dst are spliced into the trace ID skip list
+ * without copying.  Segments for IDs already present in \a dst are
+ * merged with the same time and sample rate tolerance logic used by
+ * mstl3_addmsr() with autohealing, where segments that fit together
+ * are joined.  Any @ref record-list entries are moved to the
+ * destination segment without copying.  Data samples are copied only
+ * when segments are joined.  The cost is proportional to the number
+ * of segments, not the number of records.
  *
- * For a full description of \a tolerance see mstl3_addmsr().
+ * For segments and trace IDs of \a src that are joined with existing
+ * entries, any memory at the ::MS3TraceSeg.prvtptr and
+ * ::MS3TraceID.prvtptr will be freed.
  *
- * If the ::MSF_UNPACKDATA flag is set in \a flags, the data samples
- * will be unpacked.  In most cases the caller probably wants this
- * flag set, without it the trace list will merely be a list of
- * channels.
+ * The \a splitversion flag must match the value used to construct
+ * both lists, see mstl3_addmsr() for details.
  *
- * If the ::MSF_RECORDLIST flag is set in \a flags, a ::MS3RecordList
- * will be built for each ::MS3TraceSeg.  The ::MS3RecordPtr entries
- * contain the location of the data record, bit flags, extra headers, etc.
+ * If a memory pool is enabled for either list, see mstl3_pool_enable(),
+ * it must be enabled for both.  The slabs of the \a src pool are
+ * transferred to the \a dst pool.
  *
- * If \a selections is not NULL, the ::MS3Selections will be used to
- * limit what is returned to the caller.  Any data not matching the
- * selections will be skipped.
+ * On error the contents of the lists may be partially merged, in
+ * which case both should be freed, \a src before \a dst.
  *
- * @param[in] ppmstl Pointer-to-point to destination MS3TraceList
- * @param[in] buffer Source buffer to read miniSEED records from
- * @param[in] bufferlength Maximum length of \a buffer
+ * @param[in] dst Destination ::MS3TraceList to merge data into
+ * @param[in] src Source ::MS3TraceList, empty on return
  * @param[in] splitversion Flag to control splitting of version/quality
- * @param[in] flags Flags to control parsing and optional functionality:
- * @parblock
- *  - \c ::MSF_RECORDLIST : Build a ::MS3RecordList for each ::MS3TraceSeg
- *  - Flags supported by msr3_parse()
- *  - Flags supported by mstl3_addmsr()
- * @endparblock
  * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
- * @param[in] selections Specify limits to which data should be returned, see @ref data-selections
- * @param[in] verbose Controls verbosity, 0 means no diagnostic output
+ * @param[in] flags Flags to control optional functionality (unused)
  *
- * @returns The number of records parsed on success, otherwise a
- * negative library error code.
+ * @returns 0 on success and a negative library error code on error.
  *
  * \ref MessageOnError - this function logs a message on error
  *
  * \sa mstl3_addmsr()
- *********************************************************************/
-int64_t
-mstl3_readbuffer_selection (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
-                            int8_t splitversion, uint32_t flags,
-                            const MS3Tolerance *tolerance, const MS3Selections *selections,
-                            int8_t verbose)
+ ***************************************************************************/
+int
+mstl3_merge (MS3TraceList *dst, MS3TraceList *src, int8_t splitversion,
+             const MS3Tolerance *tolerance, uint32_t flags)
 {
-  MS3Record *msr   = NULL;
+  (void)flags; /* Unused */
+  MS3TraceID *id = NULL;
+  MS3TraceID *srcid = NULL;
+  MS3TraceID *nextsrcid = NULL;
+  MS3TraceID *previd[MSTRACEID_SKIPLIST_HEIGHT] = {NULL};
   MS3TraceSeg *seg = NULL;
-  MS3RecordPtr *recordptr = NULL;
-  uint32_t dataoffset;
-  uint32_t datasize;
-  uint64_t offset  = 0;
-  uint32_t pflags  = flags;
-  int64_t reccount = 0;
-  int parsevalue;
+  MS3TraceSeg *nextseg = NULL;
+  int level;
 
-  if (!ppmstl)
+  if (!dst || !src)
   {
-    ms_log (2, "%s(): Required input not defined: 'ppmstl'\n", __func__);
+    ms_log (2, "%s(): Required input not defined: 'dst' or 'src'\n", __func__);
     return MS_GENERROR;
   }
 
-  /* Initialize MS3TraceList if needed */
-  if (!*ppmstl)
+  if (dst == src)
   {
-    *ppmstl = mstl3_init (*ppmstl);
-
-    if (!*ppmstl)
-      return MS_GENERROR;
+    ms_log (2, "%s(): Cannot merge a trace list into itself\n", __func__);
+    return MS_GENERROR;
   }
 
-  /* Defer data unpacking if selections are used by unsetting MSF_UNPACKDATA */
-  if ((flags & MSF_UNPACKDATA) && selections)
-    pflags &= ~(MSF_UNPACKDATA);
+  /* Entries of pooled lists are owned by the pool and cannot be mixed with others */
+  if ((dst->pool && !src->pool) || (!dst->pool && src->pool))
+  {
+    ms_log (2, "%s(): Cannot merge trace lists with and without memory pools\n", __func__);
+    return MS_GENERROR;
+  }
 
-  while ((bufferlength - offset) > MINRECLEN)
+  /* Transfer ownership of source slabs to the destination pool, behind the current slab */
+  if (src->pool && ((LMPool *)src->pool)->slabs)
   {
-    parsevalue = msr3_parse (buffer + offset, bufferlength - offset, &msr, pflags, verbose);
+    LMPool *dstpool = (LMPool *)dst->pool;
+    LMPool *srcpool = (LMPool *)src->pool;
+    LMPoolSlab *lastslab = srcpool->slabs;
 
-    if (parsevalue < 0)
-    {
-      if (msr)
-        msr3_free (&msr);
+    while (lastslab->next)
+      lastslab = lastslab->next;
 
-      return parsevalue;
+    if (dstpool->slabs)
+    {
+      lastslab->next = dstpool->slabs->next;
+      dstpool->slabs->next = srcpool->slabs;
+    }
+    else
+    {
+      dstpool->slabs = srcpool->slabs;
     }
 
-    if (parsevalue > 0)
-      break;
+    srcpool->slabs = NULL;
+  }
 
-    /* Test data against selections if specified */
-    if (selections)
+  /* Detach all IDs from the source list */
+  srcid = src->traces.next[0];
+
+  for (level = 0; level < MSTRACEID_SKIPLIST_HEIGHT; level++)
+    src->traces.next[level] = NULL;
+
+  src->numtraceids = 0;
+
+  while (srcid)
+  {
+    nextsrcid = srcid->next[0];
+
+    id = mstl3_findID (dst, srcid->sid,
+                       (splitversion) ? srcid->pubversion : 0,
+                       previd);
+
+    /* Splice ID, with all segments, into destination list */
+    if (!id)
     {
-      if (!ms3_matchselect (selections, msr->sid, msr->starttime,
-                            msr3_endtime (msr), msr->pubversion, NULL))
+      if (mstl3_addID (dst, srcid, previd) == NULL)
       {
-        if (verbose > 1)
-        {
-          ms_log (0, "Skipping (selection) record for %s (%d bytes) starting at offset %" PRIu64 "\n",
-                  msr->sid, msr->reclen, offset);
-        }
-
-        offset += msr->reclen;
-        continue;
+        ms_log (2, "%s: Error adding ID to trace list\n", srcid->sid);
+        srcid->next[0] = nextsrcid;
+        nextsrcid = srcid;
+        break;
       }
 
-      /* Unpack data samples if this has been deferred */
-      if ((flags & MSF_UNPACKDATA) && msr->samplecnt > 0)
-      {
-        if (msr3_unpack_data (msr, verbose) != msr->samplecnt)
-        {
-          if (msr)
-            msr3_free (&msr);
+      srcid = nextsrcid;
+      continue;
+    }
 
-          return MS_GENERROR;
-        }
+    /* Merge segments into matching destination ID */
+    seg = srcid->first;
+    while (seg)
+    {
+      nextseg = seg->next;
+
+      seg->prev = NULL;
+      seg->next = NULL;
+
+      if (mstl3_mergeseg (dst, id, seg, tolerance))
+      {
+        /* Return segment to source ID */
+        seg->next = nextseg;
+        if (nextseg)
+          nextseg->prev = seg;
+        srcid->first = seg;
+        break;
       }
-    }
 
-    /* Add record to trace list */
-    seg = mstl3_addmsr_recordptr (*ppmstl, msr, (flags & MSF_RECORDLIST) ? &recordptr : NULL,
-                                  splitversion, 1, flags, tolerance);
+      srcid->first = nextseg;
+      srcid->numsegments--;
+      seg = nextseg;
+    }
 
-    if (seg == NULL)
+    /* Error merging segments */
+    if (seg)
     {
-      if (msr)
-        msr3_free (&msr);
-
-      return MS_GENERROR;
+      srcid->next[0] = nextsrcid;
+      nextsrcid = srcid;
+      break;
     }
 
-    /* Populate remaining fields of record pointer */
-    if (recordptr)
+    /* Track largest publication version */
+    if (srcid->pubversion > id->pubversion)
+      id->pubversion = srcid->pubversion;
+
+    /* Free private pointer data if present and the ID structure */
+    if (srcid->prvtptr)
+      libmseed_memory.free (srcid->prvtptr);
+
+    lm_pool_release (dst, srcid);
+
+    srcid = nextsrcid;
+  }
+
+  /* Re-attach any remaining IDs to the source list on error */
+  if (srcid)
+  {
+    src->traces.next[0] = nextsrcid;
+
+    for (id = nextsrcid; id; id = id->next[0])
     {
-      /* Determine offset to data and length of data payload */
-      if (msr3_data_bounds (msr, &dataoffset, &datasize))
-        return MS_GENERROR;
+      for (level = 1; level < MSTRACEID_SKIPLIST_HEIGHT; level++)
+        id->next[level] = NULL;
 
-      recordptr->bufferptr  = buffer + offset;
-      recordptr->fileptr    = NULL;
-      recordptr->filename   = NULL;
-      recordptr->fileoffset = 0;
-      recordptr->dataoffset = dataoffset;
-      recordptr->prvtptr    = NULL;
+      src->numtraceids++;
     }
 
-    reccount += 1;
-    offset += msr->reclen;
+    return MS_GENERROR;
   }
 
-  if (msr)
-    msr3_free (&msr);
-
-  return reccount;
-} /* End of mstl3_readbuffer_selection() */
+  return 0;
+} /* End of mstl3_merge() */
 
 /***************************************************************************
- * Create an MS3TraceSeg structure from an MS3Record structure.
+ * Merge a single, detached MS3TraceSeg into the segment list of a
+ * MS3TraceID, joining with adjacent segments when they fit within
+ * tolerance.  The segment is either linked into the list or its
+ * coverage is added to existing segments and it is freed.
  *
- * Return a pointer to a MS3TraceSeg otherwise NULL on error.
+ * This follows the same search order and fit criteria as
+ * mstl3_addmsr_recordptr() with autohealing.
+ *
+ * Return 0 on success, otherwise -1 on error with the segment untouched.
  *
  * \ref MessageOnError - this function logs a message on error
  ***************************************************************************/
-MS3TraceSeg *
-mstl3_msr2seg (const MS3Record *msr, nstime_t endtime)
+static int
+mstl3_mergeseg (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg,
+                const MS3Tolerance *tolerance)
 {
-  MS3TraceSeg *seg = 0;
-  size_t datasize = 0;
-  int samplesize;
+  MS3Record msr;
+  MS3TraceSeg *searchseg = NULL;
+  MS3TraceSeg *segbefore = NULL;
+  MS3TraceSeg *segafter = NULL;
+  MS3TraceSeg *followseg = NULL;
+  MS3TraceSeg *resultseg = NULL;
 
-  if (!msr)
-  {
-    ms_log (2, "%s(): Required input not defined: 'msr'\n", __func__);
-    return NULL;
-  }
+  nstime_t pregap;
+  nstime_t postgap;
+  nstime_t nsdelta;
+  nstime_t nstimetol = 0;
+  nstime_t nnstimetol = 0;
+  double sampratetol = -1.0;
+  int8_t whence;
 
-  if (!(seg = (MS3TraceSeg *)libmseed_memory.malloc (sizeof (MS3TraceSeg))))
+  /* An ID without segments simply adopts the segment */
+  if (!id->first)
   {
-    ms_log (2, "Error allocating memory\n");
-    return NULL;
+    id->first = id->last = seg;
+    id->numsegments = 1;
+    id->earliest = seg->starttime;
+    id->latest = seg->endtime;
+    return 0;
   }
-  memset (seg, 0, sizeof (MS3TraceSeg));
 
-  /* Populate MS3TraceSeg */
-  seg->starttime = msr->starttime;
-  seg->endtime = endtime;
-  seg->samprate = msr3_sampratehz(msr);
-  seg->samplecnt = msr->samplecnt;
-  seg->sampletype = msr->sampletype;
-  seg->numsamples = msr->numsamples;
+  /* Populate a record with segment details for tolerance callbacks */
+  memset (&msr, 0, sizeof (MS3Record));
+  memcpy (msr.sid, id->sid, sizeof (msr.sid));
+  msr.pubversion = id->pubversion;
+  msr.starttime = seg->starttime;
+  msr.samprate = seg->samprate;
+  msr.samplecnt = seg->samplecnt;
 
-  /* Allocate space for and copy datasamples */
-  if (msr->datasamples && msr->numsamples)
-  {
-    if (!(samplesize = ms_samplesize (msr->sampletype)))
-    {
-      ms_log (2, "Unknown sample size for sample type: %c\n", msr->sampletype);
-      return NULL;
-    }
+  /* Calculate high-precision sample period, segment rates are always in Hertz */
+  nsdelta = (seg->samprate > 0.0) ? (nstime_t) (NSTMODULUS / seg->samprate) : 0;
 
-    datasize = samplesize * msr->numsamples;
+  /* Calculate high-precision time tolerance */
+  if (tolerance && tolerance->time)
+    nstimetol = (nstime_t) (NSTMODULUS * tolerance->time (&msr));
+  else
+    nstimetol = (nstime_t) (0.5 * nsdelta); /* Default time tolerance is 1/2 sample period */
 
-    if (!(seg->datasamples = libmseed_memory.malloc ((size_t) (datasize))))
-    {
-      ms_log (2, "Error allocating memory\n");
-      return NULL;
-    }
-    seg->datasize = datasize;
+  nnstimetol = (nstimetol) ? -nstimetol : 0;
 
-    /* Copy data samples from MS3Record to MS3TraceSeg */
-    memcpy (seg->datasamples, msr->datasamples, datasize);
-  }
+  /* Calculate sample rate tolerance */
+  if (tolerance && tolerance->samprate)
+    sampratetol = tolerance->samprate (&msr);
 
-  return seg;
-} /* End of mstl3_msr2seg() */
+#define MERGE_RATECHECK(OTHER)                                                                    \
+  ((tolerance && tolerance->samprate)                                                             \
+       ? (sampratetol >= 0.0 && ms_dabs (seg->samprate - (OTHER)->samprate) <= sampratetol)      \
+       : MS_ISRATETOLERABLE (seg->samprate, (OTHER)->samprate))
 
-/***************************************************************************
- * Add data coverage from a MS3Record structure to a MS3TraceSeg structure.
- *
- * Data coverage is added to the beginning or end of MS3TraceSeg
- * according to the whence flag:
- * 1 : add coverage to the end
- * 2 : add coverage to the beginninig
- *
- * Return a pointer to a MS3TraceSeg otherwise, NULL on error.
- *
- * \ref MessageOnError - this function logs a message on error
- ***************************************************************************/
-MS3TraceSeg *
-mstl3_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t whence)
-{
-  int samplesize = 0;
-  void *newdatasamples = NULL;
-  size_t newdatasize = 0;
+  postgap = seg->starttime - id->last->endtime - nsdelta;
+  pregap = id->first->starttime - seg->endtime - nsdelta;
 
-  if (!seg || !msr)
+  /* Search first for the simple scenarios in order of likelihood, as mstl3_addmsr() */
+  if (postgap <= nstimetol && postgap >= nnstimetol && MERGE_RATECHECK (id->last))
   {
-    ms_log (2, "%s(): Required input not defined: 'seg' or 'msr'\n", __func__);
-    return NULL;
+    segbefore = id->last;
   }
-
-  /* Allocate more memory for data samples if included */
-  if (msr->datasamples && msr->numsamples > 0)
+  else if ((seg->starttime - nsdelta - nstimetol) > id->latest)
   {
-    if (msr->sampletype != seg->sampletype)
-    {
-      ms_log (2, "MS3Record sample type (%c) does not match segment sample type (%c)\n",
-              msr->sampletype, seg->sampletype);
-      return NULL;
-    }
-
-    if (!(samplesize = ms_samplesize (msr->sampletype)))
+    followseg = id->last;
+  }
+  else if ((seg->endtime + nsdelta + nstimetol) < id->earliest)
+  {
+    followseg = NULL;
+  }
+  else if (pregap <= nstimetol && pregap >= nnstimetol && MERGE_RATECHECK (id->first))
+  {
+    segafter = id->first;
+  }
+  /* Search complete segment list for matches */
+  else
+  {
+    searchseg = id->first;
+    while (searchseg)
     {
-      ms_log (2, "Unknown sample size for sample type: %c\n", msr->sampletype);
-      return NULL;
-    }
+      /* Segments are sorted by start time, none beyond this point can fit */
+      if (searchseg->starttime > (seg->endtime + nsdelta + nstimetol))
+        break;
 
-    newdatasize = (seg->numsamples + msr->numsamples) * samplesize;
+      /* Segments with the same start time are kept in the order added */
+      if (seg->starttime >= searchseg->starttime)
+        followseg = searchseg;
 
-    if (libmseed_prealloc_block_size)
-    {
-      size_t current_size = seg->datasize;
-      newdatasamples = libmseed_memory_prealloc (seg->datasamples, newdatasize, &current_size);
-      seg->datasize = current_size;
-    }
-    else
-    {
-      newdatasamples = libmseed_memory.realloc (seg->datasamples, newdatasize);
-      seg->datasize = newdatasize;
-    }
+      whence = 0;
 
-    if (!newdatasamples)
-    {
-      ms_log (2, "Error allocating memory\n");
-      seg->datasize = 0;
-      return NULL;
-    }
+      postgap = seg->starttime - searchseg->endtime - nsdelta;
+      if (!segbefore && postgap <= nstimetol && postgap >= nnstimetol)
+        whence = 1;
 
-    seg->datasamples = newdatasamples;
-  }
+      pregap = searchseg->starttime - seg->endtime - nsdelta;
+      if (!segafter && pregap <= nstimetol && pregap >= nnstimetol)
+        whence = 2;
 
-  /* Add coverage to end of segment */
-  if (whence == 1)
-  {
-    seg->endtime = endtime;
-    seg->samplecnt += msr->samplecnt;
+      if (whence && MERGE_RATECHECK (searchseg))
+      {
+        if (whence == 1)
+          segbefore = searchseg;
+        else
+          segafter = searchseg;
 
-    if (msr->datasamples && msr->numsamples > 0)
-    {
-      memcpy ((char *)seg->datasamples + (seg->numsamples * samplesize),
-              msr->datasamples,
-              (size_t) (msr->numsamples * samplesize));
+        /* Done searching if both before and after segments are found */
+        if (segbefore && segafter)
+          break;
+      }
 
-      seg->numsamples += msr->numsamples;
+      searchseg = searchseg->next;
     }
   }
-  /* Add coverage to beginning of segment */
-  else if (whence == 2)
+
+#undef MERGE_RATECHECK
+
+  /* Add segment coverage to end of segment before */
+  if (segbefore)
   {
-    seg->starttime = msr->starttime;
-    seg->samplecnt += msr->samplecnt;
+    /* Retain state of the segment before to restore it if a join fails */
+    nstime_t endtime = segbefore->endtime;
+    int64_t samplecnt = segbefore->samplecnt;
+    int64_t numsamples = segbefore->numsamples;
+    MS3RecordList *recordlist = seg->recordlist;
+    MS3RecordPtr *lastrecord = (segbefore->recordlist) ? segbefore->recordlist->last : NULL;
+    uint64_t recordcnt = (segbefore->recordlist) ? segbefore->recordlist->recordcnt : 0;
+
+    if (!mstl3_addsegtoseg (segbefore, seg))
+      return -1;
 
-    if (msr->datasamples && msr->numsamples > 0)
+    /* Merge two segments that now fit */
+    if (segafter && segafter != segbefore)
     {
-      memmove ((char *)seg->datasamples + (msr->numsamples * samplesize),
-               seg->datasamples,
-               (size_t) (seg->numsamples * samplesize));
+      if (!mstl3_addsegtoseg (segbefore, segafter))
+      {
+        /* Remove coverage of the segment, leaving it and the ID untouched */
+        segbefore->endtime = endtime;
+        segbefore->samplecnt = samplecnt;
+        segbefore->numsamples = numsamples;
 
-      memcpy (seg->datasamples,
-              msr->datasamples,
-              (size_t) (msr->numsamples * samplesize));
+        if (lastrecord)
+        {
+          lastrecord->next = NULL;
+          segbefore->recordlist->last = lastrecord;
+          segbefore->recordlist->recordcnt = recordcnt;
+        }
+        else if (recordlist)
+        {
+          segbefore->recordlist = NULL;
+        }
 
-      seg->numsamples += msr->numsamples;
-    }
-  }
-  else
-  {
-    ms_log (2, "unrecognized whence value: %d\n", whence);
-    return NULL;
-  }
+        seg->recordlist = recordlist;
 
-  return seg;
-} /* End of mstl3_addmsrtoseg() */
+        return -1;
+      }
 
-/***************************************************************************
- * Add data coverage from seg2 to seg1.
- *
- * Return a pointer to a seg1 otherwise NULL on error.
- *
- * \ref MessageOnError - this function logs a message on error
- ***************************************************************************/
-MS3TraceSeg *
-mstl3_addsegtoseg (MS3TraceSeg *seg1, MS3TraceSeg *seg2)
-{
-  int samplesize = 0;
-  void *newdatasamples = NULL;
-  size_t newdatasize = 0;
+      if (segafter == id->last)
+        id->last = segafter->prev;
 
-  if (!seg1 || !seg2)
-  {
-    ms_log (2, "%s(): Required input not defined: 'seg1' or 'seg2'\n", __func__);
-    return NULL;
-  }
+      if (segafter->prev)
+        segafter->prev->next = segafter->next;
+      if (segafter->next)
+        segafter->next->prev = segafter->prev;
 
-  /* Allocate more memory for data samples if included */
-  if (seg2->datasamples && seg2->numsamples > 0)
-  {
-    if (seg2->sampletype != seg1->sampletype)
-    {
-      ms_log (2, "MS3TraceSeg sample types do not match (%c and %c)\n",
-              seg1->sampletype, seg2->sampletype);
-      return NULL;
-    }
+      mstl3_freeseg (mstl, segafter, 1);
 
-    if (!(samplesize = ms_samplesize (seg1->sampletype)))
-    {
-      ms_log (2, "Unknown sample size for sample type: %c\n", seg1->sampletype);
-      return NULL;
+      id->numsegments -= 1;
     }
 
-    newdatasize = (seg1->numsamples + seg2->numsamples) * samplesize;
+    mstl3_freeseg (mstl, seg, 1);
 
-    if (libmseed_prealloc_block_size)
-    {
-      size_t current_size = seg1->datasize;
-      newdatasamples = libmseed_memory_prealloc (seg1->datasamples, newdatasize, &current_size);
-      seg1->datasize = current_size;
-    }
-    else
-    {
-      newdatasamples = libmseed_memory.realloc (seg1->datasamples, newdatasize);
-      seg1->datasize = newdatasize;
-    }
+    resultseg = segbefore;
+  }
+  /* Add segment coverage to beginning of segment after */
+  else if (segafter)
+  {
+    /* Combine into the new segment and move the result into the existing
+     * segment, retaining the identity (and private pointer) of the existing segment */
+    if (!mstl3_addsegtoseg (seg, segafter))
+      return -1;
 
-    if (!newdatasamples)
-    {
-      ms_log (2, "Error allocating memory\n");
-      seg1->datasize = 0;
-      return NULL;
-    }
+    if (segafter->datasamples)
+      libmseed_memory.free (segafter->datasamples);
 
-    seg1->datasamples = newdatasamples;
-  }
+    /* A record list at the existing segment was either moved or spliced */
+    if (segafter->recordlist)
+      lm_pool_release (mstl, segafter->recordlist);
 
-  /* Add seg2 coverage to end of seg1 */
-  seg1->endtime = seg2->endtime;
-  seg1->samplecnt += seg2->samplecnt;
+    segafter->starttime = seg->starttime;
+    segafter->samplecnt = seg->samplecnt;
+    segafter->datasamples = seg->datasamples;
+    segafter->datasize = seg->datasize;
+    segafter->numsamples = seg->numsamples;
+    segafter->recordlist = seg->recordlist;
 
-  if (seg2->datasamples && seg2->numsamples > 0)
-  {
-    memcpy ((char *)seg1->datasamples + (seg1->numsamples * samplesize),
-            seg2->datasamples,
-            (size_t) (seg2->numsamples * samplesize));
+    if (seg->sampletype)
+      segafter->sampletype = seg->sampletype;
 
-    seg1->numsamples += seg2->numsamples;
-  }
+    seg->datasamples = NULL;
+    seg->recordlist = NULL;
+    mstl3_freeseg (mstl, seg, 1);
 
-  /* Add seg2 record list to end of seg1 record list */
-  if (seg2->recordlist)
+    resultseg = segafter;
+  }
+  /* Add segment as new entry */
+  else
   {
-    if (seg1->recordlist == NULL)
+    if (!followseg)
     {
-      seg1->recordlist = seg2->recordlist;
-      seg2->recordlist = NULL;
+      seg->next = id->first;
+      id->first->prev = seg;
+      id->first = seg;
     }
     else
     {
-      seg1->recordlist->last->next = seg2->recordlist->first;
-      seg1->recordlist->last = seg2->recordlist->last;
-      seg1->recordlist->recordcnt += seg2->recordlist->recordcnt;
+      seg->next = followseg->next;
+      seg->prev = followseg;
+      if (followseg->next)
+        followseg->next->prev = seg;
+      followseg->next = seg;
+
+      if (followseg == id->last)
+        id->last = seg;
     }
+
+    id->numsegments++;
+
+    resultseg = seg;
   }
 
-  return seg1;
-} /* End of mstl3_addsegtoseg() */
+  /* Track earliest and latest times */
+  if (resultseg->starttime < id->earliest)
+    id->earliest = resultseg->starttime;
 
-/**********************************************************************/ /**
- * @brief Add a ::MS3RecordPtr to the ::MS3RecordList of a ::MS3TraceSeg
+  if (resultseg->endtime > id->latest)
+    id->latest = resultseg->endtime;
+
+  mstl3_sortseg (id, resultseg);
+
+  return 0;
+} /* End of mstl3_mergeseg() */
+
+/***************************************************************************
+ * Free a MS3TraceSeg whose coverage has been added to another segment.
  *
- * @param[in] seg ::MS3TraceSeg to add record to
- * @param[in] msr ::MS3Record to be added, for record length and start/end times
- * @param[in] endtime Time of last sample in record
- * @param[in] whence Where to add record to list
+ * The data samples, record list container (but not the record
+ * pointers, which are expected to have been moved) and optionally the
+ * private pointer are freed along with the segment.  Entries carved
+ * from the memory pool of the list are released with the pool.
+ ***************************************************************************/
+static void
+mstl3_freeseg (MS3TraceList *mstl, MS3TraceSeg *seg, int8_t freeprvtptr)
+{
+  if (!seg)
+    return;
+
+  if (seg->datasamples)
+    libmseed_memory.free (seg->datasamples);
+
+  if (seg->recordlist)
+    lm_pool_release (mstl, seg->recordlist);
+
+  if (freeprvtptr && seg->prvtptr)
+    libmseed_memory.free (seg->prvtptr);
+
+  lm_pool_release (mstl, seg);
+} /* End of mstl3_freeseg() */
+
+/****************************************************************/ /**
+ * @brief Parse miniSEED from a buffer and populate a ::MS3TraceList
+ *
+ * For a full description of \a tolerance see mstl3_addmsr().
+ *
+ * If the ::MSF_UNPACKDATA flag is set in \a flags, the data samples
+ * will be unpacked.  In most cases the caller probably wants this
+ * flag set, without it the trace list will merely be a list of
+ * channels.
+ *
+ * If the ::MSF_RECORDLIST flag is set in \a flags, a ::MS3RecordList
+ * will be built for each ::MS3TraceSeg.  The ::MS3RecordPtr entries
+ * contain the location of the data record, bit flags, extra headers, etc.
+ *
+ * @param[in] ppmstl Pointer-to-point to destination MS3TraceList
+ * @param[in] buffer Source buffer to read miniSEED records from
+ * @param[in] bufferlength Maximum length of \a buffer
+ * @param[in] splitversion Flag to control splitting of version/quality
+ * @param[in] flags Flags to control parsing and optional functionality:
  * @parblock
- *  - \c 0 : New entry for new list, only when seg->recordlist == NULL
- *  - \c 1 : Add record pointer to end of list
- *  - \c 2 : Add record pointer to beginning of list
+ *  - \c ::MSF_RECORDLIST : Build a ::MS3RecordList for each ::MS3TraceSeg
+ *  - Flags supported by msr3_parse()
+ *  - Flags supported by mstl3_addmsr()
  * @endparblock
+ * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
+ * @param[in] verbose Controls verbosity, 0 means no diagnostic output
  *
- * @returns Pointer to added ::MS3RecordPtr on success and NULL on error.
+ * @returns The number of records parsed on success, otherwise a
+ * negative library error code.
  *
  * \ref MessageOnError - this function logs a message on error
  *
- * \sa mstl3_unpack_recordlist()
- * \sa mstl3_readbuffer()
- * \sa mstl3_readbuffer_selection()
- * \sa ms3_readtracelist()
- * \sa ms3_readtracelist_timewin()
- * \sa ms3_readtracelist_selection()
  * \sa mstl3_addmsr()
+ *********************************************************************/
+int64_t
+mstl3_readbuffer (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
+                  int8_t splitversion, uint32_t flags,
+                  const MS3Tolerance *tolerance, int8_t verbose)
+{
+  return mstl3_readbuffer_selection (ppmstl, buffer, bufferlength,
+                                     splitversion, flags, tolerance,
+                                     NULL, verbose);
+} /* End of mstl3_readbuffer() */
+
+/***************************************************************************
+ * Parse miniSEED from a buffer and populate a MS3TraceList, skipping
+ * records that do not match the compiled selections if not NULL.
+ *
+ * See mstl3_readbuffer_selection() for details.
+ *
+ * Returns the number of records parsed on success, otherwise a
+ * negative library error code.
  ***************************************************************************/
-MS3RecordPtr *
-mstl3_add_recordptr (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t whence)
+static int64_t
+mstl3_readbuffer_matcher (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
+                          int8_t splitversion, uint32_t flags,
+                          const MS3Tolerance *tolerance, const LMSelectMatcher *matcher,
+                          int8_t verbose)
 {
+  MS3Record *msr   = NULL;
+  MS3TraceSeg *seg = NULL;
   MS3RecordPtr *recordptr = NULL;
+  uint32_t dataoffset;
+  uint32_t datasize;
+  uint64_t offset  = 0;
+  uint32_t pflags  = flags;
+  int64_t reccount = 0;
+  int parsevalue;
 
-  if (!seg || !msr)
+  if (!ppmstl)
   {
-    ms_log (2, "%s(): Required input not defined: 'seg' or 'msr'\n", __func__);
-    return NULL;
+    ms_log (2, "%s(): Required input not defined: 'ppmstl'\n", __func__);
+    return MS_GENERROR;
   }
 
-  if (seg->recordlist && whence != 1 && whence != 2)
+  /* Initialize MS3TraceList if needed */
+  if (!*ppmstl)
   {
-    ms_log (2, "Unsupported 'whence' value: %d\n", whence);
-    return NULL;
+    *ppmstl = mstl3_init (*ppmstl);
+
+    if (!*ppmstl)
+      return MS_GENERROR;
   }
 
-  recordptr = (MS3RecordPtr *)libmseed_memory.malloc (sizeof (MS3RecordPtr));
+  /* Defer data unpacking if selections are used by unsetting MSF_UNPACKDATA */
+  if ((flags & MSF_UNPACKDATA) && matcher)
+    pflags &= ~(MSF_UNPACKDATA);
 
-  if (recordptr == NULL)
+  while ((bufferlength - offset) > MINRECLEN)
   {
-    ms_log (2, "Cannot allocate memory\n");
-    return NULL;
-  }
+    parsevalue = msr3_parse (buffer + offset, bufferlength - offset, &msr, pflags, verbose);
 
-  memset (recordptr, 0, sizeof(MS3RecordPtr));
-  recordptr->msr     = msr3_duplicate (msr, 0);
-  recordptr->endtime = endtime;
+    if (parsevalue < 0)
+    {
+      if (msr)
+        msr3_free (&msr);
 
-  if (recordptr->msr == NULL)
-  {
-    ms_log (2, "Cannot duplicate MS3Record\n");
-    libmseed_memory.free (recordptr);
-    return NULL;
-  }
+      return parsevalue;
+    }
 
-  /* If no record list for the segment is present, allocate and add record pointer */
-  if (seg->recordlist == NULL)
-  {
-    seg->recordlist = (MS3RecordList *)libmseed_memory.malloc (sizeof (MS3RecordList));
+    if (parsevalue > 0)
+      break;
 
-    if (seg->recordlist == NULL)
+    /* Test data against selections if specified */
+    if (matcher)
     {
-      ms_log (2, "Cannot allocate memory\n");
-      libmseed_memory.free (recordptr);
-      return NULL;
+      if (!lm_selectmatcher_match (matcher, msr->sid, msr->starttime,
+                                   msr3_endtime (msr), msr->pubversion, NULL))
+      {
+        if (verbose > 1)
+        {
+          ms_log (0, "Skipping (selection) record for %s (%d bytes) starting at offset %" PRIu64 "\n",
+                  msr->sid, msr->reclen, offset);
+        }
+
+        offset += msr->reclen;
+        continue;
+      }
+
+      /* Unpack data samples if this has been deferred */
+      if ((flags & MSF_UNPACKDATA) && msr->samplecnt > 0)
+      {
+        if (msr3_unpack_data (msr, verbose) != msr->samplecnt)
+        {
+          if (msr)
+            msr3_free (&msr);
+
+          return MS_GENERROR;
+        }
+      }
     }
 
-    seg->recordlist->recordcnt = 1;
-    seg->recordlist->first     = recordptr;
-    seg->recordlist->last      = recordptr;
-  }
-  /* Otherwise, add record pointer to existing list */
-  else
-  {
-    /* Beginning of list */
-    if (whence == 2)
+    /* Add record to trace list */
+    seg = mstl3_addmsr_recordptr (*ppmstl, msr, (flags & MSF_RECORDLIST) ? &recordptr : NULL,
+                                  splitversion, 1, flags, tolerance);
+
+    if (seg == NULL)
     {
-      recordptr->next = seg->recordlist->first;
-      seg->recordlist->first = recordptr;
+      if (msr)
+        msr3_free (&msr);
+
+      return MS_GENERROR;
     }
-    /* End of list */
-    else
+
+    /* Populate remaining fields of record pointer */
+    if (recordptr)
     {
-      seg->recordlist->last->next = recordptr;
-      seg->recordlist->last = recordptr;
+      /* Determine offset to data and length of data payload */
+      if (msr3_data_bounds (msr, &dataoffset, &datasize))
+        return MS_GENERROR;
+
+      recordptr->bufferptr  = buffer + offset;
+      recordptr->fileptr    = NULL;
+      recordptr->filename   = NULL;
+      recordptr->fileoffset = 0;
+      recordptr->dataoffset = dataoffset;
+      recordptr->prvtptr    = NULL;
     }
 
-    seg->recordlist->recordcnt += 1;
+    reccount += 1;
+    offset += msr->reclen;
   }
 
-  return recordptr;
-} /* End of mstl3_add_recordptr() */
+  if (msr)
+    msr3_free (&msr);
 
-/**********************************************************************/ /**
- * @brief Convert the data samples associated with an MS3TraceSeg to another
- * data type
+  return reccount;
+} /* End of mstl3_readbuffer_matcher() */
+
+/****************************************************************/ /**
+ * @brief Parse miniSEED from a buffer and populate a ::MS3TraceList
  *
- * Text data samples cannot be converted, if supplied or requested an
- * error will be returned.
+ * For a full description of \a tolerance see mstl3_addmsr().
  *
- * When converting float & double sample types to integer type a
- * simple rounding is applied by adding 0.5 to the sample value before
- * converting (truncating) to integer.  This compensates for common
- * machine representations of floating point values, e.g. "40.0"
- * represented by "39.99999999".
+ * If the ::MSF_UNPACKDATA flag is set in \a flags, the data samples
+ * will be unpacked.  In most cases the caller probably wants this
+ * flag set, without it the trace list will merely be a list of
+ * channels.
  *
- * If the \a truncate flag is true (non-zero) data samples will be
- * truncated to integers even if loss of sample precision is detected.
- * If the truncate flag is false (zero) and loss of precision is
- * detected an error is returned.  Loss of precision is determined by
- * testing that the difference between the floating point value and
- * the (truncated) integer value is greater than 0.000001.
+ * If the ::MSF_RECORDLIST flag is set in \a flags, a ::MS3RecordList
+ * will be built for each ::MS3TraceSeg.  The ::MS3RecordPtr entries
+ * contain the location of the data record, bit flags, extra headers, etc.
  *
- * @param[in] seg The target ::MS3TraceSeg to convert
- * @param[in] type The desired data sample type:
+ * If \a selections is not NULL, the ::MS3Selections will be used to
+ * limit what is returned to the caller.  Any data not matching the
+ * selections will be skipped.
+ *
+ * @param[in] ppmstl Pointer-to-point to destination MS3TraceList
+ * @param[in] buffer Source buffer to read miniSEED records from
+ * @param[in] bufferlength Maximum length of \a buffer
+ * @param[in] splitversion Flag to control splitting of version/quality
+ * @param[in] flags Flags to control parsing and optional functionality:
  * @parblock
- *   - \c 'i' - 32-bit integer data type
- *   - \c 'f' - 32-bit float data type
- *   - \c 'd' - 64-bit float (double) data type
+ *  - \c ::MSF_RECORDLIST : Build a ::MS3RecordList for each ::MS3TraceSeg
+ *  - Flags supported by msr3_parse()
+ *  - Flags supported by mstl3_addmsr()
  * @endparblock
- * @param[in] truncate Control truncation of floating point values to integers
+ * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
+ * @param[in] selections Specify limits to which data should be returned, see @ref data-selections
+ * @param[in] verbose Controls verbosity, 0 means no diagnostic output
  *
- * @returns 0 on success, and -1 on failure.
+ * @returns The number of records parsed on success, otherwise a
+ * negative library error code.
  *
  * \ref MessageOnError - this function logs a message on error
- ***************************************************************************/
-int
-mstl3_convertsamples (MS3TraceSeg *seg, char type, int8_t truncate)
+ *
+ * \sa mstl3_addmsr()
+ *********************************************************************/
+int64_t
+mstl3_readbuffer_selection (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
+                            int8_t splitversion, uint32_t flags,
+                            const MS3Tolerance *tolerance, const MS3Selections *selections,
+                            int8_t verbose)
 {
-  int32_t *idata;
-  float *fdata;
-  double *ddata;
-  int64_t idx;
+  LMSelectMatcher *matcher = NULL;
+  int64_t reccount;
 
-  if (!seg)
-  {
-    ms_log (2, "%s(): Required input not defined: 'seg'\n", __func__);
-    return -1;
-  }
+  /* Compile selections for matching */
+  if (selections && (matcher = lm_selectmatcher_compile (selections)) == NULL)
+    return MS_GENERROR;
 
-  /* No conversion necessary, report success */
-  if (seg->sampletype == type)
-    return 0;
+  reccount = mstl3_readbuffer_matcher (ppmstl, buffer, bufferlength, splitversion,
+                                       flags, tolerance, matcher, verbose);
+
+  lm_selectmatcher_free (matcher);
+
+  return reccount;
+} /* End of mstl3_readbuffer_selection() */
+
+/* Minimum size of buffer partitions for parallel parsing */
+#define LM_PARALLEL_MINCHUNK 65536
+
+/* Partition of a buffer and the trace list parsed from it */
+struct readbuffer_chunk_s
+{
+  const char *buffer;
+  uint64_t length;
+  MS3TraceList *mstl;
+  int64_t reccount;
+};
+
+/* Shared parameters for parsing buffer partitions */
+struct readbuffer_job_s
+{
+  struct readbuffer_chunk_s *chunks;
+  size_t slabsize;
+  int8_t splitversion;
+  uint32_t flags;
+  const MS3Tolerance *tolerance;
+  const LMSelectMatcher *matcher;
+  int8_t verbose;
+};
+
+/* Parse a single buffer partition into its own trace list */
+static void
+mstl3_readbuffer_task (void *context, int taskindex)
+{
+  struct readbuffer_job_s *job = (struct readbuffer_job_s *)context;
+  struct readbuffer_chunk_s *chunk = &job->chunks[taskindex];
+
+  if ((chunk->mstl = mstl3_init (NULL)) == NULL)
+  {
+    chunk->reccount = MS_GENERROR;
+    return;
+  }
+
+  if (job->slabsize && mstl3_pool_enable (chunk->mstl, job->slabsize))
+  {
+    chunk->reccount = MS_GENERROR;
+    return;
+  }
+
+  chunk->reccount = mstl3_readbuffer_matcher (&chunk->mstl, chunk->buffer, chunk->length,
+                                              job->splitversion, job->flags, job->tolerance,
+                                              job->matcher, job->verbose);
+}
+
+/****************************************************************/ /**
+ * @brief Parse miniSEED from a buffer in parallel and populate a ::MS3TraceList
+ *
+ * A parallel variant of mstl3_readbuffer_selection() intended for
+ * large buffers.  Record boundaries are identified with ms3_detect()
+ * and the buffer is partitioned into contiguous runs of records.
+ * Each partition is parsed into a separate ::MS3TraceList by up to \a
+ * nthreads threads, and the lists are then merged into the
+ * destination list with mstl3_merge() in buffer order.
+ *
+ * The resulting trace list is the same as produced by
+ * mstl3_readbuffer_selection() for the same buffer: the same trace
+ * IDs, segments, data samples and record counts.  When data contain
+ * multiple, exactly overlapping copies of the same segment, which of
+ * the equivalent segments each record is associated with may differ.
+ *
+ * If record lengths cannot be determined with ms3_detect(), e.g. for
+ * miniSEED 2 records without a blockette 1000, the remainder of the
+ * buffer from that point is parsed in a single partition.  Small
+ * buffers are parsed serially.
+ *
+ * The \a tolerance callbacks, if provided, may be called concurrently
+ * from multiple threads.  Messages logged from worker threads use the
+ * logging parameters of each thread, see @ref log-threading.
+ *
+ * If a memory pool is enabled for the list at \a ppmstl, see
+ * mstl3_pool_enable(), the partition lists will also use pools.
+ *
+ * If the library is built with \b LIBMSEED_NO_THREADING defined, the
+ * partitions are parsed serially.
+ *
+ * @param[in] ppmstl Pointer-to-point to destination MS3TraceList
+ * @param[in] buffer Source buffer to read miniSEED records from
+ * @param[in] bufferlength Maximum length of \a buffer
+ * @param[in] splitversion Flag to control splitting of version/quality
+ * @param[in] flags Flags to control parsing and optional functionality,
+ * see mstl3_readbuffer_selection()
+ * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
+ * @param[in] selections Specify limits to which data should be returned, see @ref data-selections
+ * @param[in] nthreads Maximum number of threads to use, 0 for the number of processors
+ * @param[in] verbose Controls verbosity, 0 means no diagnostic output
+ *
+ * @returns The number of records parsed on success, otherwise a
+ * negative library error code.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mstl3_readbuffer_selection()
+ * \sa mstl3_merge()
+ *********************************************************************/
+int64_t
+mstl3_readbuffer_parallel (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
+                           int8_t splitversion, uint32_t flags,
+                           const MS3Tolerance *tolerance, const MS3Selections *selections,
+                           int nthreads, int8_t verbose)
+{
+  struct readbuffer_job_s job;
+  struct readbuffer_chunk_s *chunks = NULL;
+  struct readbuffer_chunk_s *newchunks = NULL;
+  int nchunks = 0;
+  int maxchunks = 0;
+  uint64_t target;
+  uint64_t offset = 0;
+  uint64_t chunkstart = 0;
+  int64_t reclen;
+  int64_t reccount = 0;
+  uint8_t formatversion;
+  int idx;
+
+  if (!ppmstl || !buffer)
+  {
+    ms_log (2, "%s(): Required input not defined: 'ppmstl' or 'buffer'\n", __func__);
+    return MS_GENERROR;
+  }
+
+  nthreads = lm_thread_count (nthreads);
+
+  /* Target a few partitions per thread to balance load */
+  target = bufferlength / ((uint64_t)nthreads * 4);
+  if (target < LM_PARALLEL_MINCHUNK)
+    target = LM_PARALLEL_MINCHUNK;
+
+  /* Parse serially when partitioning cannot help */
+  if (nthreads <= 1 || bufferlength < 2 * target)
+  {
+    return mstl3_readbuffer_selection (ppmstl, buffer, bufferlength, splitversion,
+                                       flags, tolerance, selections, verbose);
+  }
+
+  /* Initialize MS3TraceList if needed */
+  if (!*ppmstl)
+  {
+    *ppmstl = mstl3_init (*ppmstl);
+
+    if (!*ppmstl)
+      return MS_GENERROR;
+  }
+
+  /* Identify partitions at record boundaries */
+  while (1)
+  {
+    if ((bufferlength - offset) > MINRECLEN)
+    {
+      reclen = ms3_detect (buffer + offset, bufferlength - offset, &formatversion);
+
+      /* Stop at records of unknown or truncated length, remainder is a single partition */
+      if (reclen <= 0 || (uint64_t)reclen > (bufferlength - offset))
+        offset = bufferlength;
+      else
+        offset += reclen;
+    }
+    else
+    {
+      offset = bufferlength;
+    }
+
+    if ((offset - chunkstart) >= target || (offset == bufferlength && offset > chunkstart))
+    {
+      if (nchunks == maxchunks)
+      {
+        maxchunks = (maxchunks) ? maxchunks * 2 : nthreads * 4 + 1;
+
+        newchunks = (struct readbuffer_chunk_s *)libmseed_memory.realloc (chunks, maxchunks * sizeof (struct readbuffer_chunk_s));
+
+        if (newchunks == NULL)
+        {
+          ms_log (2, "Cannot allocate memory\n");
+          libmseed_memory.free (chunks);
+          return MS_GENERROR;
+        }
+
+        chunks = newchunks;
+      }
+
+      chunks[nchunks].buffer = buffer + chunkstart;
+      chunks[nchunks].length = offset - chunkstart;
+      chunks[nchunks].mstl = NULL;
+      chunks[nchunks].reccount = 0;
+      nchunks++;
+
+      chunkstart = offset;
+    }
+
+    if (offset >= bufferlength)
+      break;
+  }
+
+  job.chunks = chunks;
+  job.slabsize = ((*ppmstl)->pool) ? ((LMPool *)(*ppmstl)->pool)->slabsize : 0;
+  job.splitversion = splitversion;
+  job.flags = flags;
+  job.tolerance = tolerance;
+  job.matcher = NULL;
+  job.verbose = verbose;
+
+  /* Compile selections once for all partitions */
+  if (selections && (job.matcher = lm_selectmatcher_compile (selections)) == NULL)
+    reccount = MS_GENERROR;
+
+  if (reccount >= 0 && lm_parallel_run (nthreads, nchunks, mstl3_readbuffer_task, &job) < 0)
+  {
+    ms_log (2, "%s(): Cannot run parallel parsing\n", __func__);
+    reccount = MS_GENERROR;
+  }
+
+  /* Check for errors, the first in buffer order is returned */
+  for (idx = 0; idx < nchunks && reccount >= 0; idx++)
+  {
+    if (chunks[idx].reccount < 0)
+      reccount = chunks[idx].reccount;
+  }
+
+  /* Merge partition lists in buffer order */
+  for (idx = 0; idx < nchunks && reccount >= 0; idx++)
+  {
+    if (mstl3_merge (*ppmstl, chunks[idx].mstl, splitversion, tolerance, 0))
+    {
+      reccount = MS_GENERROR;
+      break;
+    }
+
+    reccount += chunks[idx].reccount;
+  }
+
+  /* Free partition lists, any not merged due to errors still contain entries */
+  for (idx = 0; idx < nchunks; idx++)
+  {
+    if (chunks[idx].mstl)
+      mstl3_free (&chunks[idx].mstl, 1);
+  }
+
+  libmseed_memory.free (chunks);
+  lm_selectmatcher_free ((LMSelectMatcher *)job.matcher);
+
+  return reccount;
+} /* End of mstl3_readbuffer_parallel() */
+
+/***************************************************************************
+ * Create an MS3TraceSeg structure from an MS3Record structure.
+ *
+ * The segment is allocated from the memory pool of the MS3TraceList
+ * if enabled, the data samples are always allocated separately.
+ *
+ * Return a pointer to a MS3TraceSeg otherwise NULL on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+MS3TraceSeg *
+mstl3_msr2seg (MS3TraceList *mstl, const MS3Record *msr, nstime_t endtime)
+{
+  MS3TraceSeg *seg = 0;
+  size_t datasize = 0;
+  int samplesize;
+
+  if (!msr)
+  {
+    ms_log (2, "%s(): Required input not defined: 'msr'\n", __func__);
+    return NULL;
+  }
+
+  if (!(seg = (MS3TraceSeg *)lm_pool_alloc (mstl, sizeof (MS3TraceSeg))))
+  {
+    ms_log (2, "Error allocating memory\n");
+    return NULL;
+  }
+  memset (seg, 0, sizeof (MS3TraceSeg));
+
+  /* Populate MS3TraceSeg */
+  seg->starttime = msr->starttime;
+  seg->endtime = endtime;
+  seg->samprate = msr3_sampratehz(msr);
+  seg->samplecnt = msr->samplecnt;
+  seg->sampletype = msr->sampletype;
+  seg->numsamples = msr->numsamples;
+
+  /* Allocate space for and copy datasamples */
+  if (msr->datasamples && msr->numsamples)
+  {
+    if (!(samplesize = ms_samplesize (msr->sampletype)))
+    {
+      ms_log (2, "Unknown sample size for sample type: %c\n", msr->sampletype);
+      return NULL;
+    }
+
+    datasize = samplesize * msr->numsamples;
+
+    if (!(seg->datasamples = libmseed_memory.malloc ((size_t) (datasize))))
+    {
+      ms_log (2, "Error allocating memory\n");
+      return NULL;
+    }
+    seg->datasize = datasize;
+
+    /* Copy data samples from MS3Record to MS3TraceSeg */
+    memcpy (seg->datasamples, msr->datasamples, datasize);
+  }
+
+  return seg;
+} /* End of mstl3_msr2seg() */
+
+/***************************************************************************
+ * Add data coverage from a MS3Record structure to a MS3TraceSeg structure.
+ *
+ * Data coverage is added to the beginning or end of MS3TraceSeg
+ * according to the whence flag:
+ * 1 : add coverage to the end
+ * 2 : add coverage to the beginninig
+ *
+ * Return a pointer to a MS3TraceSeg otherwise, NULL on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+MS3TraceSeg *
+mstl3_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t whence)
+{
+  int samplesize = 0;
+  void *newdatasamples = NULL;
+  size_t newdatasize = 0;
+
+  if (!seg || !msr)
+  {
+    ms_log (2, "%s(): Required input not defined: 'seg' or 'msr'\n", __func__);
+    return NULL;
+  }
+
+  /* Allocate more memory for data samples if included */
+  if (msr->datasamples && msr->numsamples > 0)
+  {
+    if (msr->sampletype != seg->sampletype)
+    {
+      ms_log (2, "MS3Record sample type (%c) does not match segment sample type (%c)\n",
+              msr->sampletype, seg->sampletype);
+      return NULL;
+    }
+
+    if (!(samplesize = ms_samplesize (msr->sampletype)))
+    {
+      ms_log (2, "Unknown sample size for sample type: %c\n", msr->sampletype);
+      return NULL;
+    }
+
+    newdatasize = (seg->numsamples + msr->numsamples) * samplesize;
+
+    if (libmseed_prealloc_block_size)
+    {
+      size_t current_size = seg->datasize;
+      newdatasamples = libmseed_memory_prealloc (seg->datasamples, newdatasize, &current_size);
+      seg->datasize = current_size;
+    }
+    else
+    {
+      newdatasamples = libmseed_memory.realloc (seg->datasamples, newdatasize);
+      seg->datasize = newdatasize;
+    }
+
+    if (!newdatasamples)
+    {
+      ms_log (2, "Error allocating memory\n");
+      seg->datasize = 0;
+      return NULL;
+    }
+
+    seg->datasamples = newdatasamples;
+  }
+
+  /* Add coverage to end of segment */
+  if (whence == 1)
+  {
+    seg->endtime = endtime;
+    seg->samplecnt += msr->samplecnt;
+
+    if (msr->datasamples && msr->numsamples > 0)
+    {
+      memcpy ((char *)seg->datasamples + (seg->numsamples * samplesize),
+              msr->datasamples,
+              (size_t) (msr->numsamples * samplesize));
+
+      seg->numsamples += msr->numsamples;
+    }
+  }
+  /* Add coverage to beginning of segment */
+  else if (whence == 2)
+  {
+    seg->starttime = msr->starttime;
+    seg->samplecnt += msr->samplecnt;
+
+    if (msr->datasamples && msr->numsamples > 0)
+    {
+      memmove ((char *)seg->datasamples + (msr->numsamples * samplesize),
+               seg->datasamples,
+               (size_t) (seg->numsamples * samplesize));
+
+      memcpy (seg->datasamples,
+              msr->datasamples,
+              (size_t) (msr->numsamples * samplesize));
+
+      seg->numsamples += msr->numsamples;
+    }
+  }
+  else
+  {
+    ms_log (2, "unrecognized whence value: %d\n", whence);
+    return NULL;
+  }
+
+  return seg;
+} /* End of mstl3_addmsrtoseg() */
+
+/***************************************************************************
+ * Add data coverage from seg2 to seg1.
+ *
+ * Return a pointer to a seg1 otherwise NULL on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+MS3TraceSeg *
+mstl3_addsegtoseg (MS3TraceSeg *seg1, MS3TraceSeg *seg2)
+{
+  int samplesize = 0;
+  void *newdatasamples = NULL;
+  size_t newdatasize = 0;
+
+  if (!seg1 || !seg2)
+  {
+    ms_log (2, "%s(): Required input not defined: 'seg1' or 'seg2'\n", __func__);
+    return NULL;
+  }
+
+  /* Allocate more memory for data samples if included */
+  if (seg2->datasamples && seg2->numsamples > 0)
+  {
+    if (seg2->sampletype != seg1->sampletype)
+    {
+      ms_log (2, "MS3TraceSeg sample types do not match (%c and %c)\n",
+              seg1->sampletype, seg2->sampletype);
+      return NULL;
+    }
+
+    if (!(samplesize = ms_samplesize (seg1->sampletype)))
+    {
+      ms_log (2, "Unknown sample size for sample type: %c\n", seg1->sampletype);
+      return NULL;
+    }
+
+    newdatasize = (seg1->numsamples + seg2->numsamples) * samplesize;
+
+    if (libmseed_prealloc_block_size)
+    {
+      size_t current_size = seg1->datasize;
+      newdatasamples = libmseed_memory_prealloc (seg1->datasamples, newdatasize, &current_size);
+      seg1->datasize = current_size;
+    }
+    else
+    {
+      newdatasamples = libmseed_memory.realloc (seg1->datasamples, newdatasize);
+      seg1->datasize = newdatasize;
+    }
+
+    if (!newdatasamples)
+    {
+      ms_log (2, "Error allocating memory\n");
+      seg1->datasize = 0;
+      return NULL;
+    }
+
+    seg1->datasamples = newdatasamples;
+  }
+
+  /* Add seg2 coverage to end of seg1 */
+  seg1->endtime = seg2->endtime;
+  seg1->samplecnt += seg2->samplecnt;
+
+  if (seg2->datasamples && seg2->numsamples > 0)
+  {
+    memcpy ((char *)seg1->datasamples + (seg1->numsamples * samplesize),
+            seg2->datasamples,
+            (size_t) (seg2->numsamples * samplesize));
+
+    seg1->numsamples += seg2->numsamples;
+  }
+
+  /* Add seg2 record list to end of seg1 record list */
+  if (seg2->recordlist)
+  {
+    if (seg1->recordlist == NULL)
+    {
+      seg1->recordlist = seg2->recordlist;
+      seg2->recordlist = NULL;
+    }
+    else
+    {
+      seg1->recordlist->last->next = seg2->recordlist->first;
+      seg1->recordlist->last = seg2->recordlist->last;
+      seg1->recordlist->recordcnt += seg2->recordlist->recordcnt;
+    }
+  }
+
+  return seg1;
+} /* End of mstl3_addsegtoseg() */
+
+/**********************************************************************/ /**
+ * @brief Add a ::MS3RecordPtr to the ::MS3RecordList of a ::MS3TraceSeg
+ *
+ * If the memory pool of \a mstl is enabled the record pointer, record
+ * list and copy of the record are allocated from the pool.
+ *
+ * @param[in] mstl ::MS3TraceList containing \a seg, or NULL
+ * @param[in] seg ::MS3TraceSeg to add record to
+ * @param[in] msr ::MS3Record to be added, for record length and start/end times
+ * @param[in] endtime Time of last sample in record
+ * @param[in] whence Where to add record to list
+ * @parblock
+ *  - \c 0 : New entry for new list, only when seg->recordlist == NULL
+ *  - \c 1 : Add record pointer to end of list
+ *  - \c 2 : Add record pointer to beginning of list
+ * @endparblock
+ *
+ * @returns Pointer to added ::MS3RecordPtr on success and NULL on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mstl3_unpack_recordlist()
+ * \sa mstl3_readbuffer()
+ * \sa mstl3_readbuffer_selection()
+ * \sa ms3_readtracelist()
+ * \sa ms3_readtracelist_timewin()
+ * \sa ms3_readtracelist_selection()
+ * \sa mstl3_addmsr()
+ ***************************************************************************/
+MS3RecordPtr *
+mstl3_add_recordptr (MS3TraceList *mstl, MS3TraceSeg *seg, const MS3Record *msr,
+                     nstime_t endtime, int8_t whence)
+{
+  MS3RecordPtr *recordptr = NULL;
+
+  if (!seg || !msr)
+  {
+    ms_log (2, "%s(): Required input not defined: 'seg' or 'msr'\n", __func__);
+    return NULL;
+  }
+
+  if (seg->recordlist && whence != 1 && whence != 2)
+  {
+    ms_log (2, "Unsupported 'whence' value: %d\n", whence);
+    return NULL;
+  }
+
+  recordptr = (MS3RecordPtr *)lm_pool_alloc (mstl, sizeof (MS3RecordPtr));
+
+  if (recordptr == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return NULL;
+  }
+
+  memset (recordptr, 0, sizeof(MS3RecordPtr));
+  recordptr->endtime = endtime;
+
+  /* Carve record copy, including extra headers, from pool or duplicate */
+  if (mstl && mstl->pool)
+  {
+    if ((recordptr->msr = (MS3Record *)lm_pool_alloc (mstl, sizeof (MS3Record))) != NULL)
+    {
+      memcpy (recordptr->msr, msr, sizeof (MS3Record));
+
+      recordptr->msr->extra = NULL;
+      recordptr->msr->extralength = 0;
+      recordptr->msr->datasamples = NULL;
+      recordptr->msr->datasize = 0;
+      recordptr->msr->numsamples = 0;
+
+      if (msr->extralength > 0 && msr->extra)
+      {
+        if ((recordptr->msr->extra = (char *)lm_pool_alloc (mstl, msr->extralength)) == NULL)
+        {
+          recordptr->msr = NULL;
+        }
+        else
+        {
+          memcpy (recordptr->msr->extra, msr->extra, msr->extralength);
+          recordptr->msr->extralength = msr->extralength;
+        }
+      }
+    }
+  }
+  else
+  {
+    recordptr->msr = msr3_duplicate (msr, 0);
+  }
+
+  if (recordptr->msr == NULL)
+  {
+    ms_log (2, "Cannot duplicate MS3Record\n");
+    lm_pool_release (mstl, recordptr);
+    return NULL;
+  }
+
+  /* If no record list for the segment is present, allocate and add record pointer */
+  if (seg->recordlist == NULL)
+  {
+    seg->recordlist = (MS3RecordList *)lm_pool_alloc (mstl, sizeof (MS3RecordList));
+
+    if (seg->recordlist == NULL)
+    {
+      ms_log (2, "Cannot allocate memory\n");
+      if (!mstl || !mstl->pool)
+        msr3_free (&recordptr->msr);
+      lm_pool_release (mstl, recordptr);
+      return NULL;
+    }
+
+    seg->recordlist->recordcnt = 1;
+    seg->recordlist->first     = recordptr;
+    seg->recordlist->last      = recordptr;
+  }
+  /* Otherwise, add record pointer to existing list */
+  else
+  {
+    /* Beginning of list */
+    if (whence == 2)
+    {
+      recordptr->next = seg->recordlist->first;
+      seg->recordlist->first = recordptr;
+    }
+    /* End of list */
+    else
+    {
+      seg->recordlist->last->next = recordptr;
+      seg->recordlist->last = recordptr;
+    }
+
+    seg->recordlist->recordcnt += 1;
+  }
+
+  return recordptr;
+} /* End of mstl3_add_recordptr() */
+
+/**********************************************************************/ /**
+ * @brief Convert the data samples associated with an MS3TraceSeg to another
+ * data type
+ *
+ * Text data samples cannot be converted, if supplied or requested an
+ * error will be returned.
+ *
+ * When converting float & double sample types to integer type a
+ * simple rounding is applied by adding 0.5 to the sample value before
+ * converting (truncating) to integer.  This compensates for common
+ * machine representations of floating point values, e.g. "40.0"
+ * represented by "39.99999999".
+ *
+ * If the \a truncate flag is true (non-zero) data samples will be
+ * truncated to integers even if loss of sample precision is detected.
+ * If the truncate flag is false (zero) and loss of precision is
+ * detected an error is returned.  Loss of precision is determined by
+ * testing that the difference between the floating point value and
+ * the (truncated) integer value is greater than 0.000001.
+ *
+ * @param[in] seg The target ::MS3TraceSeg to convert
+ * @param[in] type The desired data sample type:
+ * @parblock
+ *   - \c 'i' - 32-bit integer data type
+ *   - \c 'f' - 32-bit float data type
+ *   - \c 'd' - 64-bit float (double) data type
+ * @endparblock
+ * @param[in] truncate Control truncation of floating point values to integers
+ *
+ * @returns 0 on success, and -1 on failure.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+mstl3_convertsamples (MS3TraceSeg *seg, char type, int8_t truncate)
+{
+  int32_t *idata;
+  float *fdata;
+  double *ddata;
+  int64_t idx;
+
+  if (!seg)
+  {
+    ms_log (2, "%s(): Required input not defined: 'seg'\n", __func__);
+    return -1;
+  }
+
+  /* No conversion necessary, report success */
+  if (seg->sampletype == type)
+    return 0;
 
   if (seg->sampletype == 't' || type == 't' || seg->sampletype == 'a' || type == 'a')
   {
-    ms_log (2, "Cannot convert text samples to/from numeric type\n");
+    ms_log (2, "Cannot convert text samples to/from numeric type\n");
+    return -1;
+  }
+
+  idata = (int32_t *)seg->datasamples;
+  fdata = (float *)seg->datasamples;
+  ddata = (double *)seg->datasamples;
+
+  /* Convert to 32-bit integers */
+  if (type == 'i')
+  {
+    if (seg->sampletype == 'f') /* Convert floats to integers with simple rounding */
+    {
+      for (idx = 0; idx < seg->numsamples; idx++)
+      {
+        /* Check for loss of sub-integer */
+        if (!truncate && (fdata[idx] - (int32_t)fdata[idx]) > 0.000001)
+        {
+          ms_log (2, "Loss of precision when converting floats to integers, loss: %g\n",
+                  (fdata[idx] - (int32_t)fdata[idx]));
+          return -1;
+        }
+
+        idata[idx] = (int32_t) (fdata[idx] + 0.5);
+      }
+    }
+    else if (seg->sampletype == 'd') /* Convert doubles to integers with simple rounding */
+    {
+      for (idx = 0; idx < seg->numsamples; idx++)
+      {
+        /* Check for loss of sub-integer */
+        if (!truncate && (ddata[idx] - (int32_t)ddata[idx]) > 0.000001)
+        {
+          ms_log (2, "Loss of precision when converting doubles to integers, loss: %g\n",
+                  (ddata[idx] - (int32_t)ddata[idx]));
+          return -1;
+        }
+
+        idata[idx] = (int32_t) (ddata[idx] + 0.5);
+      }
+
+      /* Reallocate buffer for reduced size needed, only if not pre-allocating */
+      if (libmseed_prealloc_block_size == 0)
+      {
+        if (!(seg->datasamples = libmseed_memory.realloc (seg->datasamples,
+                                                          (size_t) (seg->numsamples * sizeof (int32_t)))))
+        {
+          ms_log (2, "Cannot re-allocate buffer for sample conversion\n");
+          return -1;
+        }
+        seg->datasize = seg->numsamples * sizeof (int32_t);
+      }
+    }
+
+    seg->sampletype = 'i';
+  } /* Done converting to 32-bit integers */
+
+  /* Convert to 32-bit floats */
+  else if (type == 'f')
+  {
+    if (seg->sampletype == 'i') /* Convert integers to floats */
+    {
+      for (idx = 0; idx < seg->numsamples; idx++)
+        fdata[idx] = (float)idata[idx];
+    }
+    else if (seg->sampletype == 'd') /* Convert doubles to floats */
+    {
+      for (idx = 0; idx < seg->numsamples; idx++)
+        fdata[idx] = (float)ddata[idx];
+
+      /* Reallocate buffer for reduced size needed, only if not pre-allocating */
+      if (libmseed_prealloc_block_size == 0)
+      {
+        if (!(seg->datasamples = libmseed_memory.realloc (seg->datasamples,
+                                                          (size_t) (seg->numsamples * sizeof (float)))))
+        {
+          ms_log (2, "Cannot re-allocate buffer after sample conversion\n");
+          return -1;
+        }
+        seg->datasize = seg->numsamples * sizeof (float);
+      }
+    }
+
+    seg->sampletype = 'f';
+  } /* Done converting to 32-bit floats */
+
+  /* Convert to 64-bit doubles */
+  else if (type == 'd')
+  {
+    if (!(ddata = (double *)libmseed_memory.malloc ((size_t) (seg->numsamples * sizeof (double)))))
+    {
+      ms_log (2, "Cannot allocate buffer for sample conversion to doubles\n");
+      return -1;
+    }
+
+    if (seg->sampletype == 'i') /* Convert integers to doubles */
+    {
+      for (idx = 0; idx < seg->numsamples; idx++)
+        ddata[idx] = (double)idata[idx];
+
+      libmseed_memory.free (idata);
+    }
+    else if (seg->sampletype == 'f') /* Convert floats to doubles */
+    {
+      for (idx = 0; idx < seg->numsamples; idx++)
+        ddata[idx] = (double)fdata[idx];
+
+      libmseed_memory.free (fdata);
+    }
+
+    seg->datasamples = ddata;
+    seg->datasize = seg->numsamples * sizeof (double);
+    seg->sampletype = 'd';
+  } /* Done converting to 64-bit doubles */
+
+  return 0;
+} /* End of mstl3_convertsamples() */
+
+/**********************************************************************/ /**
+ * @brief Resize data sample buffers of ::MS3TraceList to what is needed
+ *
+ * This routine should only be used if pre-allocation of memory, via
+ * ::libmseed_prealloc_block_size, was enabled to allocate the buffers.
+ *
+ * @param[in] mstl ::MS3TraceList to resize buffers
+ *
+ * @returns Return 0 on success, otherwise returns a libmseed error code.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+mstl3_resize_buffers (MS3TraceList *mstl)
+{
+  MS3TraceID *id = NULL;
+  MS3TraceSeg *seg = NULL;
+  uint8_t samplesize = 0;
+  size_t datasize;
+
+  if (!mstl)
+  {
+    ms_log (2, "%s(): Required input not defined: 'mstl'\n", __func__);
+    return MS_GENERROR;
+  }
+
+  /* Loop through trace ID and segment lists */
+  id = mstl->traces.next[0];
+  while (id)
+  {
+    seg = id->first;
+    while (seg)
+    {
+      samplesize = ms_samplesize(seg->sampletype);
+
+      if (samplesize && seg->datasamples && seg->numsamples > 0)
+      {
+        datasize = (size_t) seg->numsamples * samplesize;
+
+        if (seg->datasize > datasize)
+        {
+          seg->datasamples = libmseed_memory.realloc (seg->datasamples, datasize);
+
+          if (seg->datasamples == NULL)
+          {
+            ms_log (2, "%s: Cannot (re)allocate memory\n", id->sid);
+            return MS_GENERROR;
+          }
+
+          seg->datasize = datasize;
+        }
+      }
+
+      seg = seg->next;
+    }
+
+    id = id->next[0];
+  }
+
+  return 0;
+} /* End of mstl3_resize_buffers() */
+
+/**********************************************************************/ /**
+ * @brief Unpack data samples in a @ref record-list associated with a ::MS3TraceList
+ *
+ * Normally a record list is created calling by ms3_readtracelist() or
+ * mstl3_readbuffer() with the ::MSF_RECORDLIST flag.
+ *
+ * Unpacked data samples are written to the provided \a output buffer
+ * (up to \a outputsize bytes).  If \a output is NULL, a buffer will
+ * be allocated and associated with the ::MS3TraceSeg, just as if the
+ * data were unpacked while constructing the @ref trace-list.
+ *
+ * The sample type of the decoded data is stored at
+ * ::MS3TraceSeg.sampletype (i.e. \c seg->sampletype).
+ *
+ * A record pointer entry has multiple ways to identify the location
+ * of a record: memory buffer, open file (FILE *) or file name.  This
+ * routine uses the first populated record location in the following
+ * order:
+ *   -# Buffer pointer (::MS3RecordPtr.bufferptr)
+ *   -# Open file and offset (::MS3RecordPtr.fileptr and ::MS3RecordPtr.fileoffset)
+ *   -# File name and offset (::MS3RecordPtr.filename and ::MS3RecordPtr.fileoffset)
+ *
+ * It would be unusual to build a record list outside of the library,
+ * but should that ever occur note that the record list is assumed to
+ * be in correct time order and represent a contiguous time series.
+ *
+ * @param[in] id ::MS3TraceID for relevant ::MS3TraceSeg
+ * @param[in] seg ::MS3TraceSeg with associated @ref record-list to unpack
+ * @param[out] output Output buffer for data samples, can be NULL
+ * @param[in] outputsize Size of \a output buffer
+ * @param[in] verbose Controls logging verbosity, 0 is no diagnostic output
+ *
+ * @returns the number of samples unpacked or -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mstl3_readbuffer()
+ * \sa mstl3_readbuffer_selection()
+ * \sa ms3_readtracelist()
+ * \sa ms3_readtracelist_selection()
+ ***************************************************************************/
+int64_t
+mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output,
+                         uint64_t outputsize, int8_t verbose)
+{
+  MS3RecordPtr *recordptr = NULL;
+  int64_t unpackedsamples = 0;
+  int64_t totalunpackedsamples = 0;
+
+  char *filebuffer = NULL;
+  int64_t filebuffersize = 0;
+
+  uint64_t outputoffset = 0;
+  uint64_t decodedsize = 0;
+  uint8_t samplesize = 0;
+  char sampletype = 0;
+  char recsampletype = 0;
+
+  FILE *fileptr = NULL;
+  const char *input = NULL;
+
+  /* Linked list of open file pointers */
+  struct filelist_s {
+    const char *filename;
+    FILE *fileptr;
+    struct filelist_s *next;
+  };
+  struct filelist_s *filelist = NULL;
+  struct filelist_s *filelistptr = NULL;
+
+  if (!id || !seg)
+  {
+    ms_log (2, "%s(): Required input not defined: 'id' or 'seg'\n", __func__);
     return -1;
   }
 
-  idata = (int32_t *)seg->datasamples;
-  fdata = (float *)seg->datasamples;
-  ddata = (double *)seg->datasamples;
+  if (!seg->recordlist)
+  {
+    ms_log (2, "Required record list is not present (seg->recordlist)\n");
+    return -1;
+  }
 
-  /* Convert to 32-bit integers */
-  if (type == 'i')
+  recordptr = seg->recordlist->first;
+
+  if (mstl3_unpack_setup (id, seg, &output, outputsize, &samplesize, &sampletype, &decodedsize))
+    return -1;
+
+  /* Iterate through record list and unpack data samples */
+  while (recordptr)
   {
-    if (seg->sampletype == 'f') /* Convert floats to integers with simple rounding */
+    /* Skip records with no samples */
+    if (recordptr->msr->samplecnt == 0)
     {
-      for (idx = 0; idx < seg->numsamples; idx++)
-      {
-        /* Check for loss of sub-integer */
-        if (!truncate && (fdata[idx] - (int32_t)fdata[idx]) > 0.000001)
-        {
-          ms_log (2, "Loss of precision when converting floats to integers, loss: %g\n",
-                  (fdata[idx] - (int32_t)fdata[idx]));
-          return -1;
-        }
+      recordptr = recordptr->next;
+      continue;
+    }
 
-        idata[idx] = (int32_t) (fdata[idx] + 0.5);
-      }
+    if (ms_encoding_sizetype((uint8_t)recordptr->msr->encoding, NULL, &recsampletype))
+    {
+      ms_log (2, "%s: Cannot determine sample type for encoding: %u\n", id->sid, recordptr->msr->encoding);
+
+      totalunpackedsamples = -1;
+      break;
     }
-    else if (seg->sampletype == 'd') /* Convert doubles to integers with simple rounding */
+
+    if (recsampletype != sampletype)
     {
-      for (idx = 0; idx < seg->numsamples; idx++)
+      ms_log (2, "%s: Mixed sample types cannot be decoded together: %c versus %c\n", id->sid, recsampletype, sampletype);
+
+      totalunpackedsamples = -1;
+      break;
+    }
+
+    /* Decode data from buffer */
+    if (recordptr->bufferptr)
+    {
+      input = recordptr->bufferptr + recordptr->dataoffset;
+    }
+    /* Decode data from a file at a byte offset */
+    else if (recordptr->fileptr || recordptr->filename)
+    {
+      if (recordptr->fileptr)
       {
-        /* Check for loss of sub-integer */
-        if (!truncate && (ddata[idx] - (int32_t)ddata[idx]) > 0.000001)
+        fileptr = recordptr->fileptr;
+      }
+      else
+      {
+        /* Search file list for matching entry */
+        filelistptr = filelist;
+        while (filelistptr)
         {
-          ms_log (2, "Loss of precision when converting doubles to integers, loss: %g\n",
-                  (ddata[idx] - (int32_t)ddata[idx]));
-          return -1;
+          if (filelistptr->filename == recordptr->filename)
+            break;
+
+          filelistptr = filelistptr->next;
         }
 
-        idata[idx] = (int32_t) (ddata[idx] + 0.5);
+        /* Add new entry to list and open file if needed */
+        if (filelistptr == NULL)
+        {
+          if ((filelistptr = libmseed_memory.malloc (sizeof (struct filelist_s))) == NULL)
+          {
+            ms_log (2, "%s: Cannot allocate memory for file list entry for %s\n", id->sid, recordptr->filename);
+
+            totalunpackedsamples = -1;
+            break;
+          }
+
+          if ((filelistptr->fileptr = fopen (recordptr->filename, "rb")) == NULL)
+          {
+            ms_log (2, "%s: Cannot open file (%s): %s\n", id->sid, recordptr->filename, strerror(errno));
+
+            totalunpackedsamples = -1;
+            break;
+          }
+
+          filelistptr->filename = recordptr->filename;
+          filelistptr->next = filelist;
+
+          filelist = filelistptr;
+        }
+
+        fileptr = filelistptr->fileptr;
       }
 
-      /* Reallocate buffer for reduced size needed, only if not pre-allocating */
-      if (libmseed_prealloc_block_size == 0)
+      /* Allocate memory if needed, over-allocating (x2) to minimize reallocation */
+      if (recordptr->msr->reclen > filebuffersize)
       {
-        if (!(seg->datasamples = libmseed_memory.realloc (seg->datasamples,
-                                                          (size_t) (seg->numsamples * sizeof (int32_t)))))
+        if ((filebuffer = libmseed_memory.realloc (filebuffer, recordptr->msr->reclen * 2)) == NULL)
         {
-          ms_log (2, "Cannot re-allocate buffer for sample conversion\n");
-          return -1;
+          ms_log (2, "%s: Cannot allocate memory for file read buffer\n", id->sid);
+
+          totalunpackedsamples = -1;
+          break;
         }
-        seg->datasize = seg->numsamples * sizeof (int32_t);
+
+        filebuffersize = recordptr->msr->reclen * 2;
+      }
+
+      /* Seek to record position in file */
+      if (lmp_fseek64 (fileptr, recordptr->fileoffset, SEEK_SET))
+      {
+        ms_log (2, "%s: Cannot seek in file: %s (%s)\n",
+                id->sid,
+                (recordptr->filename) ? recordptr->filename : "",
+                strerror (errno));
+
+        totalunpackedsamples = -1;
+        break;
+      }
+
+      /* Read record into buffer */
+      if (fread (filebuffer, 1, recordptr->msr->reclen, fileptr) != (size_t)recordptr->msr->reclen)
+      {
+        ms_log (2, "%s: Cannot read record from file: %s (%s)\n",
+                id->sid,
+                (recordptr->filename) ? recordptr->filename : "",
+                strerror (errno));
+
+        totalunpackedsamples = -1;
+        break;
+
       }
+
+      input = filebuffer + recordptr->dataoffset;
+    } /* Done reading from file */
+    else
+    {
+      ms_log (2, "%s: No buffer or file pointer for record\n", id->sid);
+
+      totalunpackedsamples = -1;
+      break;
+    }
+
+    /* Decode data from buffer */
+    unpackedsamples = ms_decode_data (input, recordptr->msr->reclen - recordptr->dataoffset,
+                                      (uint8_t)recordptr->msr->encoding, recordptr->msr->samplecnt,
+                                      (unsigned char *)output + outputoffset, decodedsize - outputoffset,
+                                      &sampletype, recordptr->msr->swapflag, id->sid, verbose);
+
+    if (unpackedsamples < 0)
+    {
+      totalunpackedsamples = -1;
+      break;
     }
 
-    seg->sampletype = 'i';
-  } /* Done converting to 32-bit integers */
+    outputoffset += unpackedsamples * samplesize;
+    totalunpackedsamples += unpackedsamples;
+
+    recordptr = recordptr->next;
+  } /* Done with record list entries */
+
+  /* Free file read buffer if used */
+  if (filebuffer)
+    libmseed_memory.free (filebuffer);
+
+  /* Close and free file list if used */
+  while (filelist)
+  {
+    filelistptr = filelist->next;
+    fclose (filelist->fileptr);
+    libmseed_memory.free (filelist);
+    filelist = filelistptr;
+  }
+
+  mstl3_unpack_finish (seg, output, totalunpackedsamples, sampletype);
+
+  return totalunpackedsamples;
+} /* End of mstl3_unpack_recordlist() */
+
+/***************************************************************************
+ * Prepare for unpacking the record list of a MS3TraceSeg.
+ *
+ * Determine the sample size and type from the first record, calculate
+ * the size of decoded data and either check the size of a supplied
+ * output buffer or allocate a buffer and associate it with the segment.
+ *
+ * Return 0 on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+static int
+mstl3_unpack_setup (MS3TraceID *id, MS3TraceSeg *seg, void **output, uint64_t outputsize,
+                    uint8_t *samplesize, char *sampletype, uint64_t *decodedsize)
+{
+  MS3RecordPtr *recordptr = seg->recordlist->first;
+
+  if (ms_encoding_sizetype((uint8_t)recordptr->msr->encoding, samplesize, sampletype))
+  {
+    ms_log (2, "%s: Cannot determine sample size and type for encoding: %u\n",
+            id->sid, recordptr->msr->encoding);
+    return -1;
+  }
 
-  /* Convert to 32-bit floats */
-  else if (type == 'f')
+  /* Calculate buffer size needed for unpacked samples */
+  *decodedsize = seg->samplecnt * *samplesize;
+
+  /* If output buffer is supplied, check needed size */
+  if (*output)
   {
-    if (seg->sampletype == 'i') /* Convert integers to floats */
+    if (*decodedsize > outputsize)
     {
-      for (idx = 0; idx < seg->numsamples; idx++)
-        fdata[idx] = (float)idata[idx];
+      ms_log (2, "%s: Output buffer (%" PRIu64 " bytes) is not large enough for decoded data (%" PRIu64 " bytes)\n",
+              id->sid, *decodedsize, outputsize);
+      return -1;
     }
-    else if (seg->sampletype == 'd') /* Convert doubles to floats */
+  }
+  /* Otherwise check that buffer is not already allocated  */
+  else if (seg->datasamples)
+  {
+    ms_log (2, "%s: Segment data buffer is already allocated, cannot replace\n", id->sid);
+    return -1;
+  }
+  /* Otherwise allocate new buffer */
+  else
+  {
+    if ((*output = libmseed_memory.malloc ((size_t)*decodedsize)) == NULL)
     {
-      for (idx = 0; idx < seg->numsamples; idx++)
-        fdata[idx] = (float)ddata[idx];
-
-      /* Reallocate buffer for reduced size needed, only if not pre-allocating */
-      if (libmseed_prealloc_block_size == 0)
-      {
-        if (!(seg->datasamples = libmseed_memory.realloc (seg->datasamples,
-                                                          (size_t) (seg->numsamples * sizeof (float)))))
-        {
-          ms_log (2, "Cannot re-allocate buffer after sample conversion\n");
-          return -1;
-        }
-        seg->datasize = seg->numsamples * sizeof (float);
-      }
+      ms_log (2, "%s: Cannot allocate memory for segment data samples\n", id->sid);
+      return -1;
     }
 
-    seg->sampletype = 'f';
-  } /* Done converting to 32-bit floats */
+    /* Associate allocated memory with segment */
+    seg->datasamples = *output;
+    seg->datasize = *decodedsize;
+  }
 
-  /* Convert to 64-bit doubles */
-  else if (type == 'd')
+  return 0;
+} /* End of mstl3_unpack_setup() */
+
+/***************************************************************************
+ * Finish unpacking the record list of a MS3TraceSeg.
+ *
+ * If the output buffer was allocated by mstl3_unpack_setup() it is
+ * freed on error, otherwise the sample count is set.  The sample type
+ * is set if any samples were unpacked.
+ ***************************************************************************/
+static void
+mstl3_unpack_finish (MS3TraceSeg *seg, void *output, int64_t totalunpackedsamples,
+                     char sampletype)
+{
+  /* If output buffer was allocated here, do some maintenance */
+  if (output == seg->datasamples)
   {
-    if (!(ddata = (double *)libmseed_memory.malloc ((size_t) (seg->numsamples * sizeof (double)))))
+    /* Free allocated memory on error */
+    if (totalunpackedsamples < 0)
     {
-      ms_log (2, "Cannot allocate buffer for sample conversion to doubles\n");
-      return -1;
+      libmseed_memory.free (output);
+      seg->datasamples = NULL;
+      seg->datasize    = 0;
     }
-
-    if (seg->sampletype == 'i') /* Convert integers to doubles */
+    else
     {
-      for (idx = 0; idx < seg->numsamples; idx++)
-        ddata[idx] = (double)idata[idx];
-
-      libmseed_memory.free (idata);
+      seg->numsamples = totalunpackedsamples;
     }
-    else if (seg->sampletype == 'f') /* Convert floats to doubles */
-    {
-      for (idx = 0; idx < seg->numsamples; idx++)
-        ddata[idx] = (double)fdata[idx];
+  }
 
-      libmseed_memory.free (fdata);
-    }
+  if (totalunpackedsamples > 0)
+    seg->sampletype = sampletype;
+} /* End of mstl3_unpack_finish() */
 
-    seg->datasamples = ddata;
-    seg->datasize = seg->numsamples * sizeof (double);
-    seg->sampletype = 'd';
-  } /* Done converting to 64-bit doubles */
+/* Maximum size of a coalesced read */
+#define LM_UNPACK_MAXSPAN 8388608
 
-  return 0;
-} /* End of mstl3_convertsamples() */
+/* Minimum number of samples decoded together in a batch */
+#define LM_UNPACK_MINBATCH 16384
 
-/**********************************************************************/ /**
- * @brief Resize data sample buffers of ::MS3TraceList to what is needed
- *
- * This routine should only be used if pre-allocation of memory, via
- * ::libmseed_prealloc_block_size, was enabled to allocate the buffers.
- *
- * @param[in] mstl ::MS3TraceList to resize buffers
- *
- * @returns Return 0 on success, otherwise returns a libmseed error code.
- *
- * \ref MessageOnError - this function logs a message on error
- ***************************************************************************/
-int
-mstl3_resize_buffers (MS3TraceList *mstl)
+/* Record to unpack, with the location of its samples in the output */
+struct unpack_record_s
 {
-  MS3TraceID *id = NULL;
-  MS3TraceSeg *seg = NULL;
-  uint8_t samplesize = 0;
-  size_t datasize;
+  MS3RecordPtr *recordptr;
+  FILE *fileptr;         /* File containing record, NULL for records in buffers */
+  uint64_t outputoffset; /* Byte offset of decoded samples in output */
+  size_t index;          /* Position in record list */
+};
 
-  if (!mstl)
+/* Span of records decoded together, read with a single read if coalesced */
+struct unpack_span_s
+{
+  FILE *fileptr;           /* File containing coalesced records, otherwise NULL */
+  int64_t offset;          /* File offset of coalesced span */
+  uint64_t length;         /* Length of coalesced span in bytes */
+  size_t first;            /* Index of first record of span */
+  size_t count;            /* Number of records in span */
+  int64_t samplecnt;       /* Number of samples in span */
+  int64_t unpackedsamples; /* Samples unpacked, -1 on error */
+};
+
+/* Shared parameters for unpacking spans */
+struct unpack_job_s
+{
+  const char *sid;
+  struct unpack_record_s *records;
+  struct unpack_span_s *spans;
+  void *output;
+  uint64_t outputsize;
+  int8_t verbose;
+};
+
+/* Order records by file, file offset and list position */
+static int
+mstl3_unpack_cmp (const void *a, const void *b)
+{
+  const struct unpack_record_s *ra = (const struct unpack_record_s *)a;
+  const struct unpack_record_s *rb = (const struct unpack_record_s *)b;
+
+  if (ra->fileptr != rb->fileptr)
+    return ((uintptr_t)ra->fileptr < (uintptr_t)rb->fileptr) ? -1 : 1;
+
+  if (ra->fileptr && ra->recordptr->fileoffset != rb->recordptr->fileoffset)
+    return (ra->recordptr->fileoffset < rb->recordptr->fileoffset) ? -1 : 1;
+
+  return (ra->index < rb->index) ? -1 : (ra->index > rb->index);
+}
+
+/* Read and decode the records of a single span */
+static void
+mstl3_unpack_span (void *context, int spanindex)
+{
+  struct unpack_job_s *job = (struct unpack_job_s *)context;
+  struct unpack_span_s *span = &job->spans[spanindex];
+  struct unpack_record_s *record;
+  MS3RecordPtr *recordptr;
+  char *readbuffer = NULL;
+  char *newbuffer = NULL;
+  uint64_t readbuffersize = 0;
+  const char *input;
+  char sampletype = 0;
+  int64_t unpackedsamples;
+  size_t idx;
+
+  span->unpackedsamples = 0;
+
+  /* Read coalesced span */
+  if (span->fileptr)
   {
-    ms_log (2, "%s(): Required input not defined: 'mstl'\n", __func__);
-    return MS_GENERROR;
+    if ((readbuffer = (char *)libmseed_memory.malloc ((size_t)span->length)) == NULL)
+    {
+      ms_log (2, "%s: Cannot allocate memory for file read buffer\n", job->sid);
+      span->unpackedsamples = -1;
+      return;
+    }
+
+    if (lmp_pread (span->fileptr, readbuffer, (size_t)span->length, span->offset) != (int64_t)span->length)
+    {
+      ms_log (2, "%s: Cannot read %" PRIu64 " bytes at offset %" PRId64 " from file (%s)\n",
+              job->sid, span->length, span->offset, strerror (errno));
+      libmseed_memory.free (readbuffer);
+      span->unpackedsamples = -1;
+      return;
+    }
   }
 
-  /* Loop through trace ID and segment lists */
-  id = mstl->traces.next[0];
-  while (id)
+  for (idx = span->first; idx < span->first + span->count; idx++)
   {
-    seg = id->first;
-    while (seg)
-    {
-      samplesize = ms_samplesize(seg->sampletype);
+    record = &job->records[idx];
+    recordptr = record->recordptr;
 
-      if (samplesize && seg->datasamples && seg->numsamples > 0)
+    if (span->fileptr)
+    {
+      input = readbuffer + (recordptr->fileoffset - span->offset) + recordptr->dataoffset;
+    }
+    /* Read individual record from file */
+    else if (record->fileptr)
+    {
+      if ((uint64_t)recordptr->msr->reclen > readbuffersize)
       {
-        datasize = (size_t) seg->numsamples * samplesize;
-
-        if (seg->datasize > datasize)
+        if ((newbuffer = (char *)libmseed_memory.realloc (readbuffer, recordptr->msr->reclen)) == NULL)
         {
-          seg->datasamples = libmseed_memory.realloc (seg->datasamples, datasize);
+          ms_log (2, "%s: Cannot allocate memory for file read buffer\n", job->sid);
+          span->unpackedsamples = -1;
+          break;
+        }
 
-          if (seg->datasamples == NULL)
-          {
-            ms_log (2, "%s: Cannot (re)allocate memory\n", id->sid);
-            return MS_GENERROR;
-          }
+        readbuffer = newbuffer;
+        readbuffersize = recordptr->msr->reclen;
+      }
 
-          seg->datasize = datasize;
-        }
+      if (lmp_pread (record->fileptr, readbuffer, recordptr->msr->reclen, recordptr->fileoffset) != recordptr->msr->reclen)
+      {
+        ms_log (2, "%s: Cannot read record from file: %s (%s)\n", job->sid,
+                (recordptr->filename) ? recordptr->filename : "", strerror (errno));
+        span->unpackedsamples = -1;
+        break;
       }
 
-      seg = seg->next;
+      input = readbuffer + recordptr->dataoffset;
+    }
+    else
+    {
+      input = recordptr->bufferptr + recordptr->dataoffset;
     }
 
-    id = id->next[0];
+    unpackedsamples = ms_decode_data (input, recordptr->msr->reclen - recordptr->dataoffset,
+                                      (uint8_t)recordptr->msr->encoding, recordptr->msr->samplecnt,
+                                      (unsigned char *)job->output + record->outputoffset,
+                                      job->outputsize - record->outputoffset,
+                                      &sampletype, recordptr->msr->swapflag, job->sid, job->verbose);
+
+    if (unpackedsamples != recordptr->msr->samplecnt)
+    {
+      if (unpackedsamples >= 0)
+        ms_log (2, "%s: Decoded %" PRId64 " samples, expected %" PRId64 "\n",
+                job->sid, unpackedsamples, recordptr->msr->samplecnt);
+
+      span->unpackedsamples = -1;
+      break;
+    }
+
+    span->unpackedsamples += unpackedsamples;
   }
 
-  return 0;
-} /* End of mstl3_resize_buffers() */
+  if (readbuffer)
+    libmseed_memory.free (readbuffer);
+}
 
-/**********************************************************************/ /**
- * @brief Unpack data samples in a @ref record-list associated with a ::MS3TraceList
- *
- * Normally a record list is created calling by ms3_readtracelist() or
- * mstl3_readbuffer() with the ::MSF_RECORDLIST flag.
- *
- * Unpacked data samples are written to the provided \a output buffer
- * (up to \a outputsize bytes).  If \a output is NULL, a buffer will
- * be allocated and associated with the ::MS3TraceSeg, just as if the
- * data were unpacked while constructing the @ref trace-list.
- *
- * The sample type of the decoded data is stored at
- * ::MS3TraceSeg.sampletype (i.e. \c seg->sampletype).
- *
- * A record pointer entry has multiple ways to identify the location
- * of a record: memory buffer, open file (FILE *) or file name.  This
- * routine uses the first populated record location in the following
- * order:
- *   -# Buffer pointer (::MS3RecordPtr.bufferptr)
- *   -# Open file and offset (::MS3RecordPtr.fileptr and ::MS3RecordPtr.fileoffset)
- *   -# File name and offset (::MS3RecordPtr.filename and ::MS3RecordPtr.fileoffset)
- *
- * It would be unusual to build a record list outside of the library,
- * but should that ever occur note that the record list is assumed to
- * be in correct time order and represent a contiguous time series.
+/***************************************************************************
+ * Unpack the record list of a MS3TraceSeg in spans of records that are
+ * decoded independently, optionally in parallel threads.
  *
- * @param[in] id ::MS3TraceID for relevant ::MS3TraceSeg
- * @param[in] seg ::MS3TraceSeg with associated @ref record-list to unpack
- * @param[out] output Output buffer for data samples, can be NULL
- * @param[in] outputsize Size of \a output buffer
- * @param[in] verbose Controls logging verbosity, 0 is no diagnostic output
+ * The output location of each record is determined from the sample
+ * counts of the preceding records in the list (a prefix sum).  Records
+ * are grouped into spans of consecutive records with roughly equal
+ * numbers of samples.  If \a coalesce is true, records are first sorted
+ * by file and offset and records in files separated by no more than
+ * \a maxgap bytes are grouped and read with a single read.
  *
- * @returns the number of samples unpacked or -1 on error.
+ * Return the number of samples unpacked or -1 on error.
  *
  * \ref MessageOnError - this function logs a message on error
- *
- * \sa mstl3_readbuffer()
- * \sa mstl3_readbuffer_selection()
- * \sa ms3_readtracelist()
- * \sa ms3_readtracelist_selection()
  ***************************************************************************/
-int64_t
-mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output,
-                         uint64_t outputsize, int8_t verbose)
+static int64_t
+mstl3_unpack_spans (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_t outputsize,
+                    int8_t coalesce, uint64_t maxgap, int nthreads, int8_t verbose)
 {
+  struct unpack_job_s job;
+  struct unpack_record_s *records = NULL;
+  struct unpack_record_s *record = NULL;
+  struct unpack_span_s *spans = NULL;
+  struct unpack_span_s *span = NULL;
   MS3RecordPtr *recordptr = NULL;
-  int64_t unpackedsamples = 0;
+  size_t recordcount = 0;
+  size_t spancount = 0;
+  size_t idx;
   int64_t totalunpackedsamples = 0;
-
-  char *filebuffer = NULL;
-  int64_t filebuffersize = 0;
+  int64_t batchsamples;
+  int64_t spanend;
+  int64_t recordend;
 
   uint64_t outputoffset = 0;
   uint64_t decodedsize = 0;
@@ -1664,9 +3057,6 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output,
   char sampletype = 0;
   char recsampletype = 0;
 
-  FILE *fileptr = NULL;
-  const char *input = NULL;
-
   /* Linked list of open file pointers */
   struct filelist_s {
     const char *filename;
@@ -1682,202 +3072,204 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output,
     return -1;
   }
 
-  if (!seg->recordlist)
+  if (!seg->recordlist || !seg->recordlist->first)
   {
     ms_log (2, "Required record list is not present (seg->recordlist)\n");
     return -1;
   }
 
-  recordptr = seg->recordlist->first;
-
-  if (ms_encoding_sizetype((uint8_t)recordptr->msr->encoding, &samplesize, &sampletype))
-  {
-    ms_log (2, "%s: Cannot determine sample size and type for encoding: %u\n",
-            id->sid, recordptr->msr->encoding);
+  if (mstl3_unpack_setup (id, seg, &output, outputsize, &samplesize, &sampletype, &decodedsize))
     return -1;
-  }
-
-  /* Calculate buffer size needed for unpacked samples */
-  decodedsize = seg->samplecnt * samplesize;
 
-  /* If output buffer is supplied, check needed size */
-  if (output)
-  {
-    if (decodedsize > outputsize)
-    {
-      ms_log (2, "%s: Output buffer (%" PRIu64 " bytes) is not large enough for decoded data (%" PRIu64 " bytes)\n",
-              id->sid, decodedsize, outputsize);
-      return -1;
-    }
-  }
-  /* Otherwise check that buffer is not already allocated  */
-  else if (seg->datasamples)
-  {
-    ms_log (2, "%s: Segment data buffer is already allocated, cannot replace\n", id->sid);
-    return -1;
-  }
-  /* Otherwise allocate new buffer */
-  else
+  if ((records = (struct unpack_record_s *)libmseed_memory.malloc (seg->recordlist->recordcnt * sizeof (struct unpack_record_s))) == NULL ||
+      (spans = (struct unpack_span_s *)libmseed_memory.malloc (seg->recordlist->recordcnt * sizeof (struct unpack_span_s))) == NULL)
   {
-    if ((output = libmseed_memory.malloc ((size_t)decodedsize)) == NULL)
-    {
-      ms_log (2, "%s: Cannot allocate memory for segment data samples\n", id->sid);
-      return -1;
-    }
-
-    /* Associate allocated memory with segment */
-    seg->datasamples = output;
-    seg->datasize = decodedsize;
+    ms_log (2, "%s: Cannot allocate memory for record index\n", id->sid);
+    totalunpackedsamples = -1;
+    goto cleanup;
   }
 
-  /* Iterate through record list and unpack data samples */
-  while (recordptr)
+  /* Determine file and output location of each record with samples */
+  for (recordptr = seg->recordlist->first; recordptr; recordptr = recordptr->next)
   {
-    /* Skip records with no samples */
-    if (recordptr->msr->samplecnt == 0)
-    {
-      recordptr = recordptr->next;
+    if (recordptr->msr->samplecnt == 0)
       continue;
+
+    if (recordcount >= (size_t)seg->recordlist->recordcnt)
+    {
+      ms_log (2, "%s: Record list contains more than %" PRIu64 " records\n", id->sid, seg->recordlist->recordcnt);
+      totalunpackedsamples = -1;
+      goto cleanup;
     }
 
-    if (ms_encoding_sizetype((uint8_t)recordptr->msr->encoding, NULL, &recsampletype))
+    if (ms_encoding_sizetype ((uint8_t)recordptr->msr->encoding, NULL, &recsampletype))
     {
       ms_log (2, "%s: Cannot determine sample type for encoding: %u\n", id->sid, recordptr->msr->encoding);
-
       totalunpackedsamples = -1;
-      break;
+      goto cleanup;
     }
 
     if (recsampletype != sampletype)
     {
       ms_log (2, "%s: Mixed sample types cannot be decoded together: %c versus %c\n", id->sid, recsampletype, sampletype);
-
       totalunpackedsamples = -1;
-      break;
+      goto cleanup;
     }
 
-    /* Decode data from buffer */
+    record = &records[recordcount];
+    record->recordptr = recordptr;
+    record->fileptr = NULL;
+    record->outputoffset = outputoffset;
+    record->index = recordcount;
+
     if (recordptr->bufferptr)
     {
-      input = recordptr->bufferptr + recordptr->dataoffset;
+      record->fileptr = NULL;
     }
-    /* Decode data from a file at a byte offset */
-    else if (recordptr->fileptr || recordptr->filename)
+    else if (recordptr->fileptr)
     {
-      if (recordptr->fileptr)
+      record->fileptr = recordptr->fileptr;
+    }
+    else if (recordptr->filename)
+    {
+      /* Search file list for matching entry */
+      for (filelistptr = filelist; filelistptr; filelistptr = filelistptr->next)
       {
-        fileptr = recordptr->fileptr;
+        if (filelistptr->filename == recordptr->filename)
+          break;
       }
-      else
+
+      /* Add new entry to list and open file if needed */
+      if (filelistptr == NULL)
       {
-        /* Search file list for matching entry */
-        filelistptr = filelist;
-        while (filelistptr)
+        if ((filelistptr = libmseed_memory.malloc (sizeof (struct filelist_s))) == NULL)
         {
-          if (filelistptr->filename == recordptr->filename)
-            break;
-
-          filelistptr = filelistptr->next;
+          ms_log (2, "%s: Cannot allocate memory for file list entry for %s\n", id->sid, recordptr->filename);
+          totalunpackedsamples = -1;
+          goto cleanup;
         }
 
-        /* Add new entry to list and open file if needed */
-        if (filelistptr == NULL)
+        if ((filelistptr->fileptr = fopen (recordptr->filename, "rb")) == NULL)
         {
-          if ((filelistptr = libmseed_memory.malloc (sizeof (struct filelist_s))) == NULL)
-          {
-            ms_log (2, "%s: Cannot allocate memory for file list entry for %s\n", id->sid, recordptr->filename);
-
-            totalunpackedsamples = -1;
-            break;
-          }
-
-          if ((filelistptr->fileptr = fopen (recordptr->filename, "rb")) == NULL)
-          {
-            ms_log (2, "%s: Cannot open file (%s): %s\n", id->sid, recordptr->filename, strerror(errno));
-
-            totalunpackedsamples = -1;
-            break;
-          }
-
-          filelistptr->filename = recordptr->filename;
-          filelistptr->next = filelist;
-
-          filelist = filelistptr;
+          ms_log (2, "%s: Cannot open file (%s): %s\n", id->sid, recordptr->filename, strerror(errno));
+          libmseed_memory.free (filelistptr);
+          totalunpackedsamples = -1;
+          goto cleanup;
         }
 
-        fileptr = filelistptr->fileptr;
+        filelistptr->filename = recordptr->filename;
+        filelistptr->next = filelist;
+
+        filelist = filelistptr;
       }
 
-      /* Allocate memory if needed, over-allocating (x2) to minimize reallocation */
-      if (recordptr->msr->reclen > filebuffersize)
-      {
-        if ((filebuffer = libmseed_memory.realloc (filebuffer, recordptr->msr->reclen * 2)) == NULL)
-        {
-          ms_log (2, "%s: Cannot allocate memory for file read buffer\n", id->sid);
+      record->fileptr = filelistptr->fileptr;
+    }
+    else
+    {
+      ms_log (2, "%s: No buffer or file pointer for record\n", id->sid);
+      totalunpackedsamples = -1;
+      goto cleanup;
+    }
 
-          totalunpackedsamples = -1;
-          break;
-        }
+    outputoffset += recordptr->msr->samplecnt * samplesize;
+    recordcount++;
+  }
 
-        filebuffersize = recordptr->msr->reclen * 2;
-      }
+  if (outputoffset > decodedsize)
+  {
+    ms_log (2, "%s: Record sample counts (%" PRIu64 " bytes) exceed segment sample count (%" PRIu64 " bytes)\n",
+            id->sid, outputoffset, decodedsize);
+    totalunpackedsamples = -1;
+    goto cleanup;
+  }
 
-      /* Seek to record position in file */
-      if (lmp_fseek64 (fileptr, recordptr->fileoffset, SEEK_SET))
-      {
-        ms_log (2, "%s: Cannot seek in file: %s (%s)\n",
-                id->sid,
-                (recordptr->filename) ? recordptr->filename : "",
-                strerror (errno));
+  /* Target a few batches per thread, balanced by sample count */
+  batchsamples = (int64_t) (outputoffset / samplesize) / ((int64_t)lm_thread_count (nthreads) * 4);
+  if (batchsamples < LM_UNPACK_MINBATCH)
+    batchsamples = LM_UNPACK_MINBATCH;
 
-        totalunpackedsamples = -1;
-        break;
-      }
+  /* Sort by file and offset, records in buffers retain list order */
+  if (coalesce)
+    qsort (records, recordcount, sizeof (struct unpack_record_s), mstl3_unpack_cmp);
 
-      /* Read record into buffer */
-      if (fread (filebuffer, 1, recordptr->msr->reclen, fileptr) != (size_t)recordptr->msr->reclen)
+  /* Group records into spans */
+  for (idx = 0; idx < recordcount; idx++)
+  {
+    record = &records[idx];
+    recordend = (int64_t)record->recordptr->fileoffset + record->recordptr->msr->reclen;
+
+    if (span && coalesce && record->fileptr)
+    {
+      /* Add record to coalesced span if within gap and maximum span */
+      if (span->fileptr == record->fileptr)
       {
-        ms_log (2, "%s: Cannot read record from file: %s (%s)\n",
-                id->sid,
-                (recordptr->filename) ? recordptr->filename : "",
-                strerror (errno));
+        spanend = span->offset + (int64_t)span->length;
 
-        totalunpackedsamples = -1;
-        break;
+        if (record->recordptr->fileoffset <= spanend + (int64_t)maxgap &&
+            ((recordend > spanend) ? recordend : spanend) - span->offset <= LM_UNPACK_MAXSPAN)
+        {
+          if (recordend > spanend)
+            span->length = (uint64_t) (recordend - span->offset);
 
+          span->count++;
+          span->samplecnt += record->recordptr->msr->samplecnt;
+          continue;
+        }
       }
-
-      input = filebuffer + recordptr->dataoffset;
-    } /* Done reading from file */
-    else
+    }
+    /* Add record to batch of individually read records */
+    else if (span && !span->fileptr && span->samplecnt < batchsamples)
     {
-      ms_log (2, "%s: No buffer or file pointer for record\n", id->sid);
-
-      totalunpackedsamples = -1;
-      break;
+      span->count++;
+      span->samplecnt += record->recordptr->msr->samplecnt;
+      continue;
     }
 
-    /* Decode data from buffer */
-    unpackedsamples = ms_decode_data (input, recordptr->msr->reclen - recordptr->dataoffset,
-                                      (uint8_t)recordptr->msr->encoding, recordptr->msr->samplecnt,
-                                      (unsigned char *)output + outputoffset, decodedsize - outputoffset,
-                                      &sampletype, recordptr->msr->swapflag, id->sid, verbose);
+    span = &spans[spancount++];
+    span->fileptr = (coalesce) ? record->fileptr : NULL;
+    span->offset = (span->fileptr) ? record->recordptr->fileoffset : 0;
+    span->length = (span->fileptr) ? (uint64_t)record->recordptr->msr->reclen : 0;
+    span->first = idx;
+    span->count = 1;
+    span->samplecnt = record->recordptr->msr->samplecnt;
+    span->unpackedsamples = 0;
+  }
 
-    if (unpackedsamples < 0)
+  if (verbose > 1)
+    ms_log (0, "%s: Unpacking %" PRIsize_t " records in %" PRIsize_t " spans\n", id->sid, recordcount, spancount);
+
+  job.sid = id->sid;
+  job.records = records;
+  job.spans = spans;
+  job.output = output;
+  job.outputsize = decodedsize;
+  job.verbose = verbose;
+
+  if (lm_parallel_run (nthreads, (int)spancount, mstl3_unpack_span, &job) < 0)
+  {
+    ms_log (2, "%s: Cannot run parallel unpacking\n", id->sid);
+    totalunpackedsamples = -1;
+    goto cleanup;
+  }
+
+  for (idx = 0; idx < spancount; idx++)
+  {
+    if (spans[idx].unpackedsamples < 0)
     {
       totalunpackedsamples = -1;
       break;
     }
 
-    outputoffset += unpackedsamples * samplesize;
-    totalunpackedsamples += unpackedsamples;
+    totalunpackedsamples += spans[idx].unpackedsamples;
+  }
 
-    recordptr = recordptr->next;
-  } /* Done with record list entries */
+cleanup:
+  if (records)
+    libmseed_memory.free (records);
 
-  /* Free file read buffer if used */
-  if (filebuffer)
-    libmseed_memory.free (filebuffer);
+  if (spans)
+    libmseed_memory.free (spans);
 
   /* Close and free file list if used */
   while (filelist)
@@ -1888,27 +3280,278 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output,
     filelist = filelistptr;
   }
 
-  /* If output buffer was allocated here, do some maintenance */
-  if (output == seg->datasamples)
-  {
-    /* Free allocated memory on error */
-    if (totalunpackedsamples < 0)
-    {
-      libmseed_memory.free (output);
-      seg->datasamples = NULL;
-      seg->datasize    = 0;
-    }
-    else
-    {
-      seg->numsamples = totalunpackedsamples;
+  mstl3_unpack_finish (seg, output, totalunpackedsamples, sampletype);
+
+  return totalunpackedsamples;
+} /* End of mstl3_unpack_spans() */
+
+/**********************************************************************/ /**
+ * @brief Unpack data samples in a @ref record-list using multiple threads
+ *
+ * A multi-threaded variant of mstl3_unpack_recordlist().  The output
+ * position of each record's samples is determined from the sample
+ * counts of the preceding records in the list, allowing records to be
+ * decoded independently.  The records are divided into batches of
+ * consecutive records with roughly equal numbers of samples, which are
+ * decoded concurrently by up to \a nthreads threads directly into the
+ * output buffer.  Records in files are read individually with
+ * positional reads (see lmp_pread()).
+ *
+ * For record lists that reference records in files,
+ * mstl3_unpack_recordlist_coalesced() will usually perform fewer reads.
+ *
+ * The \a output, \a outputsize and return value are the same as for
+ * mstl3_unpack_recordlist().  Unlike mstl3_unpack_recordlist(), each
+ * record must decode to exactly the number of samples indicated in
+ * its header.
+ *
+ * If the library is built with \b LIBMSEED_NO_THREADING defined, the
+ * batches are decoded serially.
+ *
+ * @param[in] id ::MS3TraceID for relevant ::MS3TraceSeg
+ * @param[in] seg ::MS3TraceSeg with associated @ref record-list to unpack
+ * @param[out] output Output buffer for data samples, can be NULL
+ * @param[in] outputsize Size of \a output buffer
+ * @param[in] nthreads Maximum number of threads to use, 0 for the number of processors
+ * @param[in] verbose Controls logging verbosity, 0 is no diagnostic output
+ *
+ * @returns the number of samples unpacked or -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mstl3_unpack_recordlist()
+ * \sa mstl3_unpack_recordlist_coalesced()
+ ***************************************************************************/
+int64_t
+mstl3_unpack_recordlist_parallel (MS3TraceID *id, MS3TraceSeg *seg, void *output,
+                                  uint64_t outputsize, int nthreads, int8_t verbose)
+{
+  return mstl3_unpack_spans (id, seg, output, outputsize, 0, 0, nthreads, verbose);
+} /* End of mstl3_unpack_recordlist_parallel() */
+
+/**********************************************************************/ /**
+ * @brief Unpack data samples in a @ref record-list with coalesced reads
+ *
+ * An alternative to mstl3_unpack_recordlist() that is optimized for
+ * record lists referencing records in files, such as those built by
+ * ms3_readtracelist() with the ::MSF_RECORDLIST flag.  Instead of
+ * seeking to and reading each record individually, the record pointers
+ * are sorted by file and offset and records that are adjacent, or
+ * separated by no more than \a maxgap bytes, are read with a single
+ * positional read (see lmp_pread()).  Records are decoded directly
+ * from the read buffer into their position in the output, which is
+ * determined from the sample counts of the preceding records in the
+ * list.
+ *
+ * The read and decode work may be divided across up to \a nthreads
+ * threads.  Records located in memory buffers (::MS3RecordPtr.bufferptr)
+ * are decoded in batches as with mstl3_unpack_recordlist_parallel().
+ *
+ * The \a output, \a outputsize and return value are the same as for
+ * mstl3_unpack_recordlist().  Unlike mstl3_unpack_recordlist(), each
+ * record must decode to exactly the number of samples indicated in
+ * its header.
+ *
+ * @param[in] id ::MS3TraceID for relevant ::MS3TraceSeg
+ * @param[in] seg ::MS3TraceSeg with associated @ref record-list to unpack
+ * @param[out] output Output buffer for data samples, can be NULL
+ * @param[in] outputsize Size of \a output buffer
+ * @param[in] maxgap Maximum number of bytes between records to read together
+ * @param[in] nthreads Maximum number of threads to use, 0 for the number of processors
+ * @param[in] verbose Controls logging verbosity, 0 is no diagnostic output
+ *
+ * @returns the number of samples unpacked or -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mstl3_unpack_recordlist()
+ * \sa mstl3_unpack_recordlist_parallel()
+ ***************************************************************************/
+int64_t
+mstl3_unpack_recordlist_coalesced (MS3TraceID *id, MS3TraceSeg *seg, void *output,
+                                   uint64_t outputsize, uint64_t maxgap, int nthreads,
+                                   int8_t verbose)
+{
+  return mstl3_unpack_spans (id, seg, output, outputsize, 1, maxgap, nthreads, verbose);
+} /* End of mstl3_unpack_recordlist_coalesced() */
+
+/***************************************************************************
+ * Create an MS3Record template for packing trace list data.
+ *
+ * The record references the \a extra headers of the caller, release
+ * it with mstl3_pack_freemsr() which does not free them.
+ *
+ * Return a pointer to a MS3Record otherwise NULL on error.
+ ***************************************************************************/
+static MS3Record *
+mstl3_pack_initmsr (int reclen, int8_t encoding, char *extra)
+{
+  MS3Record *msr = NULL;
+  size_t extralength;
+
+  msr = msr3_init (NULL);
+
+  if (msr == NULL)
+  {
+    ms_log (2, "Error initializing msr, out of memory?\n");
+    return NULL;
+  }
+
+  msr->reclen = reclen;
+  msr->encoding = encoding;
+
+  if (extra)
+  {
+    extralength = strlen(extra);
+
+    if (extralength > UINT16_MAX)
+    {
+      ms_log (2, "Extra headers are too long: %"PRIsize_t"\n", extralength);
+      msr3_free (&msr);
+      return NULL;
+    }
+
+    msr->extra = extra;
+    msr->extralength = (uint16_t)extralength;
+  }
+
+  return msr;
+} /* End of mstl3_pack_initmsr() */
+
+/***************************************************************************
+ * Free an MS3Record template created by mstl3_pack_initmsr().
+ ***************************************************************************/
+static void
+mstl3_pack_freemsr (MS3Record **ppmsr)
+{
+  /* The record structure never owns the actual data or extra headers so it should not free them */
+  (*ppmsr)->datasamples = NULL;
+  (*ppmsr)->extra = NULL;
+  msr3_free (ppmsr);
+} /* End of mstl3_pack_freemsr() */
+
+/***************************************************************************
+ * Pack all segments of a trace ID into miniSEED records using a
+ * template MS3Record, adjusting the segments for the data packed
+ * unless MSF_MAINTAINMSTL is set.
+ *
+ * Only the trace ID and its segments are modified, allowing
+ * different trace IDs of a list to be packed concurrently.
+ *
+ * Return the number of records created on success and -1 on error.
+ ***************************************************************************/
+static int64_t
+mstl3_pack_id (MS3Record *msr, MS3TraceID *id,
+               void (*record_handler) (char *, int, void *), void *handlerdata,
+               int8_t encoding, int64_t *packedsamples, uint32_t flags, int8_t verbose)
+{
+  MS3TraceSeg *seg = NULL;
+
+  int64_t totalpackedrecords = 0;
+  int64_t totalpackedsamples = 0;
+  int segpackedrecords = 0;
+  int64_t segpackedsamples = 0;
+  int samplesize;
+  size_t bufsize;
+
+  memcpy (msr->sid, id->sid, sizeof(msr->sid));
+  msr->pubversion = id->pubversion;
+
+  /* Loop through segment list */
+  seg = id->first;
+  while (seg)
+  {
+    msr->starttime = seg->starttime;
+    msr->samprate = seg->samprate;
+    msr->samplecnt = seg->samplecnt;
+    msr->datasamples = seg->datasamples;
+    msr->numsamples = seg->numsamples;
+    msr->sampletype = seg->sampletype;
+
+    /* Set encoding for data types with only one encoding, otherwise requested */
+    switch (seg->sampletype)
+    {
+    case 't':
+      msr->encoding = DE_TEXT;
+      break;
+    case 'f':
+      msr->encoding = DE_FLOAT32;
+      break;
+    case 'd':
+      msr->encoding = DE_FLOAT64;
+      break;
+    default:
+      msr->encoding = encoding;
+    }
+
+    segpackedsamples = 0;
+    segpackedrecords = msr3_pack (msr, record_handler, handlerdata, &segpackedsamples, flags, verbose);
+
+    if (verbose > 1)
+    {
+      ms_log (0, "Packed %d records for %s segment\n", segpackedrecords, msr->sid);
+    }
+
+    /* If MSF_MAINTAINMSTL not set, adjust segment start time and reduce data array and sample counts */
+    if (!(flags & MSF_MAINTAINMSTL) && segpackedsamples > 0)
+    {
+      /* Calculate new start time, shortcut when all samples have been packed */
+      if (segpackedsamples == seg->numsamples)
+        seg->starttime = seg->endtime;
+      else
+        seg->starttime = ms_sampletime (seg->starttime, segpackedsamples, seg->samprate);
+
+      if (!(samplesize = ms_samplesize (seg->sampletype)))
+      {
+        ms_log (2, "Unknown sample size for sample type: %c\n", seg->sampletype);
+        return -1;
+      }
+
+      bufsize = (seg->numsamples - segpackedsamples) * samplesize;
+
+      if (bufsize > 0)
+      {
+        memmove (seg->datasamples,
+                 (uint8_t *)seg->datasamples + (segpackedsamples * samplesize),
+                 bufsize);
+
+        /* Reallocate buffer for reduced size needed, only if not pre-allocating */
+        if (libmseed_prealloc_block_size == 0)
+        {
+          seg->datasamples = libmseed_memory.realloc (seg->datasamples, bufsize);
+
+          if (seg->datasamples == NULL)
+          {
+            ms_log (2, "Cannot (re)allocate datasamples buffer\n");
+            return -1;
+          }
+
+          seg->datasize = bufsize;
+        }
+      }
+      else
+      {
+        if (seg->datasamples)
+          libmseed_memory.free (seg->datasamples);
+        seg->datasamples = NULL;
+        seg->datasize = 0;
+      }
+
+      seg->samplecnt -= segpackedsamples;
+      seg->numsamples -= segpackedsamples;
     }
+
+    totalpackedrecords += segpackedrecords;
+    totalpackedsamples += segpackedsamples;
+
+    seg = seg->next;
   }
 
-  if (totalunpackedsamples > 0)
-    seg->sampletype = sampletype;
+  if (packedsamples)
+    *packedsamples = totalpackedsamples;
 
-  return totalunpackedsamples;
-} /* End of mstl3_unpack_recordlist() */
+  return totalpackedrecords;
+} /* End of mstl3_pack_id() */
 
 /**********************************************************************/ /**
  * @brief Pack ::MS3TraceList data into miniSEED records
@@ -1977,15 +3620,11 @@ mstl3_pack (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
 {
   MS3Record *msr = NULL;
   MS3TraceID *id = NULL;
-  MS3TraceSeg *seg = NULL;
 
   int64_t totalpackedrecords = 0;
   int64_t totalpackedsamples = 0;
-  int segpackedrecords = 0;
-  int64_t segpackedsamples = 0;
-  int samplesize;
-  size_t bufsize;
-  size_t extralength;
+  int64_t idpackedrecords;
+  int64_t idpackedsamples;
 
   if (!mstl)
   {
@@ -2002,140 +3641,436 @@ mstl3_pack (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
   if (packedsamples)
     *packedsamples = 0;
 
-  msr = msr3_init (NULL);
+  if ((msr = mstl3_pack_initmsr (reclen, encoding, extra)) == NULL)
+    return -1;
 
-  if (msr == NULL)
+  /* Loop through trace list */
+  id = mstl->traces.next[0];
+  while (id)
   {
-    ms_log (2, "Error initializing msr, out of memory?\n");
-    return -1;
+    idpackedsamples = 0;
+    idpackedrecords = mstl3_pack_id (msr, id, record_handler, handlerdata, encoding,
+                                     &idpackedsamples, flags, verbose);
+
+    if (idpackedrecords < 0)
+    {
+      totalpackedrecords = -1;
+      break;
+    }
+
+    totalpackedrecords += idpackedrecords;
+    totalpackedsamples += idpackedsamples;
+
+    id = id->next[0];
   }
 
-  msr->reclen = reclen;
-  msr->encoding = encoding;
+  mstl3_pack_freemsr (&msr);
 
-  if (extra)
+  if (packedsamples)
+    *packedsamples = totalpackedsamples;
+
+  return totalpackedrecords;
+} /* End of mstl3_pack() */
+
+/* Bytes of packed records buffered for a trace ID while waiting for delivery */
+#define LM_PACK_MAXBUFFER (1024 * 1024)
+
+/* Number of trace IDs packed concurrently or waiting for delivery, per thread */
+#define LM_PACK_WINDOWPERTHREAD 2
+
+struct pack_job_s;
+
+/* Packing state of a single trace ID, with records retained for ordered delivery */
+struct pack_slot_s
+{
+  struct pack_job_s *job;
+  MS3TraceID *id;
+  int64_t index;     /* Position of the trace ID in the list */
+  char *records;     /* Concatenated records waiting for delivery */
+  size_t length;     /* Bytes used in records */
+  size_t size;       /* Bytes allocated for records */
+  int *reclens;      /* Length of each record waiting for delivery */
+  int64_t reccount;  /* Records waiting for delivery */
+  int64_t maxcount;  /* Entries allocated for reclens */
+  int64_t packedrecords;
+  int64_t packedsamples;
+  int8_t done;       /* Packing of the trace ID is complete */
+  int8_t failed;     /* Packing or buffering failed */
+};
+
+/* Shared state for packing trace IDs */
+struct pack_job_s
+{
+  lm_sync *sync;
+  struct pack_slot_s *slots; /* Ring of slots, indexed by trace ID position */
+  int nslots;
+  MS3TraceID *nextid;        /* Next trace ID to pack */
+  int64_t nextindex;         /* Position of next trace ID to pack */
+  int64_t head;              /* Position of trace ID being delivered */
+  int8_t stop;               /* Stop packing more trace IDs after an error */
+  int8_t halt;               /* Stop delivery after an error, records are discarded */
+  void (*record_handler) (char *, int, void *);
+  void *handlerdata;
+  int reclen;
+  int8_t encoding;
+  uint32_t flags;
+  int8_t verbose;
+  char *extra;
+  int64_t totalpackedrecords;
+  int64_t totalpackedsamples;
+};
+
+/* Deliver the records waiting in a slot to the record handler */
+static void
+mstl3_pack_deliver (struct pack_slot_s *slot)
+{
+  int64_t recidx;
+  size_t offset;
+
+  for (recidx = 0, offset = 0; recidx < slot->reccount; recidx++)
   {
-    msr->extra = extra;
-    extralength = strlen(extra);
+    slot->job->record_handler (slot->records + offset, slot->reclens[recidx],
+                               slot->job->handlerdata);
+    offset += slot->reclens[recidx];
+  }
 
-    if (extralength > UINT16_MAX)
+  slot->length = 0;
+  slot->reccount = 0;
+}
+
+/***************************************************************************
+ * Deliver the records of completed trace IDs starting at the head of
+ * delivery, advancing the head past each.  Delivery stops at a trace ID
+ * still being packed, whose packing thread continues the delivery, or
+ * at a failed trace ID, which halts all delivery.
+ *
+ * Must be called with the job locked by the thread that completed the
+ * head trace ID.  The lock is released while records are delivered.
+ ***************************************************************************/
+static void
+mstl3_pack_advance (struct pack_job_s *job)
+{
+  struct pack_slot_s *slot;
+
+  while (!job->halt && job->head < job->nextindex)
+  {
+    slot = &job->slots[job->head % job->nslots];
+
+    if (!slot->done)
+      break;
+
+    if (slot->failed)
     {
-      ms_log (2, "Extra headers are too long: %"PRIsize_t"\n", extralength);
-      return -1;
+      job->halt = 1;
+      job->totalpackedrecords = -1;
+      break;
     }
 
-    msr->extralength = (uint16_t)extralength;
+    lm_sync_unlock (job->sync);
+    mstl3_pack_deliver (slot);
+    lm_sync_lock (job->sync);
+
+    job->totalpackedrecords += slot->packedrecords;
+    job->totalpackedsamples += slot->packedsamples;
+    job->head++;
   }
 
-  /* Loop through trace list */
-  id = mstl->traces.next[0];
-  while (id)
+  lm_sync_broadcast (job->sync);
+}
+
+/***************************************************************************
+ * Internal record handler for parallel packing.
+ *
+ * Records of the trace ID at the head of delivery are passed directly
+ * to the record handler, after any records waiting for it.  Records of
+ * later trace IDs are appended to the buffer of the slot, waiting for
+ * delivery when the buffer is full.  On errors the slot is marked as
+ * failed and further records are ignored.
+ ***************************************************************************/
+static void
+mstl3_pack_store (char *record, int reclen, void *handlerdata)
+{
+  struct pack_slot_s *slot = (struct pack_slot_s *)handlerdata;
+  struct pack_job_s *job = slot->job;
+  size_t newsize;
+  int64_t newcount;
+  void *newptr;
+
+  if (slot->failed || reclen <= 0)
+    return;
+
+  lm_sync_lock (job->sync);
+
+  /* Wait for delivery to reach this trace ID when the buffer is full */
+  while (!job->halt && slot->index != job->head &&
+         slot->length > 0 && slot->length + reclen > LM_PACK_MAXBUFFER)
+    lm_sync_wait (job->sync);
+
+  if (job->halt)
   {
-    memcpy (msr->sid, id->sid, sizeof(msr->sid));
-    msr->pubversion = id->pubversion;
+    lm_sync_unlock (job->sync);
+    return;
+  }
 
-    /* Loop through segment list */
-    seg = id->first;
-    while (seg)
-    {
-      msr->starttime = seg->starttime;
-      msr->samprate = seg->samprate;
-      msr->samplecnt = seg->samplecnt;
-      msr->datasamples = seg->datasamples;
-      msr->numsamples = seg->numsamples;
-      msr->sampletype = seg->sampletype;
+  /* The thread packing the head trace ID delivers its records */
+  if (slot->index == job->head)
+  {
+    lm_sync_unlock (job->sync);
 
-      /* Set encoding for data types with only one encoding, otherwise requested */
-      switch (seg->sampletype)
-      {
-      case 't':
-        msr->encoding = DE_TEXT;
-        break;
-      case 'f':
-        msr->encoding = DE_FLOAT32;
-        break;
-      case 'd':
-        msr->encoding = DE_FLOAT64;
-        break;
-      default:
-        msr->encoding = encoding;
-      }
+    mstl3_pack_deliver (slot);
+    job->record_handler (record, reclen, job->handlerdata);
+    return;
+  }
 
-      segpackedsamples = 0;
-      segpackedrecords = msr3_pack (msr, record_handler, handlerdata, &segpackedsamples, flags, verbose);
+  lm_sync_unlock (job->sync);
 
-      if (verbose > 1)
-      {
-        ms_log (0, "Packed %d records for %s segment\n", segpackedrecords, msr->sid);
-      }
+  if (slot->length + reclen > slot->size)
+  {
+    newsize = (slot->size) ? slot->size * 2 : (size_t)reclen * 8;
+    while (newsize < slot->length + reclen)
+      newsize *= 2;
 
-      /* If MSF_MAINTAINMSTL not set, adjust segment start time and reduce data array and sample counts */
-      if (!(flags & MSF_MAINTAINMSTL) && segpackedsamples > 0)
-      {
-        /* Calculate new start time, shortcut when all samples have been packed */
-        if (segpackedsamples == seg->numsamples)
-          seg->starttime = seg->endtime;
-        else
-          seg->starttime = ms_sampletime (seg->starttime, segpackedsamples, seg->samprate);
+    if ((newptr = libmseed_memory.realloc (slot->records, newsize)) == NULL)
+    {
+      ms_log (2, "Cannot allocate memory for packed records\n");
+      slot->failed = 1;
+      return;
+    }
 
-        if (!(samplesize = ms_samplesize (seg->sampletype)))
-        {
-          ms_log (2, "Unknown sample size for sample type: %c\n", seg->sampletype);
-          return -1;
-        }
+    slot->records = (char *)newptr;
+    slot->size = newsize;
+  }
 
-        bufsize = (seg->numsamples - segpackedsamples) * samplesize;
+  if (slot->reccount == slot->maxcount)
+  {
+    newcount = (slot->maxcount) ? slot->maxcount * 2 : 8;
 
-        if (bufsize > 0)
-        {
-          memmove (seg->datasamples,
-                   (uint8_t *)seg->datasamples + (segpackedsamples * samplesize),
-                   bufsize);
+    if ((newptr = libmseed_memory.realloc (slot->reclens, newcount * sizeof (int))) == NULL)
+    {
+      ms_log (2, "Cannot allocate memory for packed records\n");
+      slot->failed = 1;
+      return;
+    }
 
-          /* Reallocate buffer for reduced size needed, only if not pre-allocating */
-          if (libmseed_prealloc_block_size == 0)
-          {
-            seg->datasamples = libmseed_memory.realloc (seg->datasamples, bufsize);
+    slot->reclens = (int *)newptr;
+    slot->maxcount = newcount;
+  }
 
-            if (seg->datasamples == NULL)
-            {
-              ms_log (2, "Cannot (re)allocate datasamples buffer\n");
-              return -1;
-            }
+  memcpy (slot->records + slot->length, record, reclen);
+  slot->length += reclen;
+  slot->reclens[slot->reccount++] = reclen;
+} /* End of mstl3_pack_store() */
 
-            seg->datasize = bufsize;
-          }
-        }
-        else
-        {
-          if (seg->datasamples)
-            libmseed_memory.free (seg->datasamples);
-          seg->datasamples = NULL;
-          seg->datasize = 0;
-        }
+/* Pack trace IDs in list order until all are claimed or packing stops */
+static void
+mstl3_pack_task (void *context, int taskindex)
+{
+  struct pack_job_s *job = (struct pack_job_s *)context;
+  struct pack_slot_s *slot;
+  MS3Record *msr;
+  int64_t packedrecords;
 
-        seg->samplecnt -= segpackedsamples;
-        seg->numsamples -= segpackedsamples;
-      }
+  (void)taskindex;
+
+  if ((msr = mstl3_pack_initmsr (job->reclen, job->encoding, job->extra)) == NULL)
+  {
+    lm_sync_lock (job->sync);
+    job->stop = 1;
+    job->halt = 1;
+    job->totalpackedrecords = -1;
+    lm_sync_broadcast (job->sync);
+    lm_sync_unlock (job->sync);
+    return;
+  }
 
-      totalpackedrecords += segpackedrecords;
-      totalpackedsamples += segpackedsamples;
+  lm_sync_lock (job->sync);
 
-      seg = seg->next;
+  while (!job->stop && !job->halt && job->nextid)
+  {
+    /* Wait for a slot, limiting the trace IDs ahead of delivery */
+    if (job->nextindex >= job->head + job->nslots)
+    {
+      lm_sync_wait (job->sync);
+      continue;
     }
 
-    id = id->next[0];
+    slot = &job->slots[job->nextindex % job->nslots];
+    slot->id = job->nextid;
+    slot->index = job->nextindex;
+    slot->length = 0;
+    slot->reccount = 0;
+    slot->packedrecords = 0;
+    slot->packedsamples = 0;
+    slot->done = 0;
+    slot->failed = 0;
+
+    job->nextid = job->nextid->next[0];
+    job->nextindex++;
+
+    lm_sync_unlock (job->sync);
+
+    packedrecords = mstl3_pack_id (msr, slot->id, mstl3_pack_store, slot, job->encoding,
+                                   &slot->packedsamples, job->flags, job->verbose);
+
+    lm_sync_lock (job->sync);
+
+    slot->done = 1;
+    slot->packedrecords = packedrecords;
+
+    if (packedrecords < 0)
+      slot->failed = 1;
+
+    if (slot->failed)
+      job->stop = 1;
+
+    if (slot->index == job->head)
+      mstl3_pack_advance (job);
+    else if (job->stop)
+      lm_sync_broadcast (job->sync);
+  }
+
+  lm_sync_unlock (job->sync);
+
+  mstl3_pack_freemsr (&msr);
+}
+
+/**********************************************************************/ /**
+ * @brief Pack ::MS3TraceList data into miniSEED records using multiple threads
+ *
+ * A parallel variant of mstl3_pack() for trace lists containing many
+ * trace IDs.  The segments of different trace IDs are packed
+ * concurrently by up to \a nthreads threads, a value of \c 0 uses
+ * the number of available processors.  The threads are created for
+ * each call and have finished when this function returns.
+ *
+ * Records are passed to \a record_handler() in the same order as
+ * mstl3_pack(): by trace ID in list order and by segment within each
+ * ID.  The records produced, the adjustments to the trace list and
+ * the returned counts are identical to mstl3_pack() for the same
+ * parameters.  The handler may be called from any of the threads,
+ * but is never called concurrently and does not need to be
+ * thread-safe.
+ *
+ * Records of the first trace ID not yet completely delivered are
+ * passed to the handler as they are packed.  The records of up to
+ * two trace IDs per thread following it are packed at the same time
+ * and held in memory, up to 1 MiB for each trace ID, until delivered.
+ * Packing of a trace ID waits when this limit is reached, so memory
+ * use does not grow with the size of the list or of the data.
+ *
+ * Messages logged from worker threads use the logging parameters of
+ * each thread, see @ref log-threading.
+ *
+ * If the library is built with \b LIBMSEED_NO_THREADING defined, or
+ * when only a single thread would be used, the list is packed
+ * serially with mstl3_pack().
+ *
+ * @param[in] mstl ::MS3TraceList containing data to pack
+ * @param[in] record_handler() Callback function called for each record
+ * @param[in] handlerdata A pointer that will be provided to the \a record_handler()
+ * @param[in] reclen Maximum record length to create
+ * @param[in] encoding Encoding for data samples, see msr3_pack()
+ * @param[out] packedsamples The number of samples packed, returned to caller
+ * @param[in] flags Bit flags to control packing, see mstl3_pack()
+ * @param[in] verbose Controls logging verbosity, 0 is no diagnostic output
+ * @param[in] extra If not NULL, add this buffer of extra headers to all records
+ * @param[in] nthreads Maximum number of threads to use, \c 0 for all processors
+ *
+ * @returns the number of records created on success and -1 on error.
+ *
+ * \ref MessageOnError - this function logs a message on error
+ *
+ * \sa mstl3_pack()
+ ***************************************************************************/
+int64_t
+mstl3_pack_parallel (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
+                     void *handlerdata, int reclen, int8_t encoding,
+                     int64_t *packedsamples, uint32_t flags, int8_t verbose,
+                     char *extra, int nthreads)
+{
+  struct pack_job_s job;
+  size_t extralength;
+  int idx;
+
+  if (!mstl)
+  {
+    ms_log (2, "%s(): Required input not defined: 'mstl'\n", __func__);
+    return -1;
+  }
+
+  if (!record_handler)
+  {
+    ms_log (2, "callback record_handler() function pointer not set!\n");
+    return -1;
+  }
+
+  nthreads = lm_thread_count (nthreads);
+
+  /* Pack serially when parallel packing cannot help */
+  if (nthreads <= 1 || mstl->numtraceids <= 1)
+  {
+    return mstl3_pack (mstl, record_handler, handlerdata, reclen, encoding,
+                       packedsamples, flags, verbose, extra);
+  }
+
+  if (packedsamples)
+    *packedsamples = 0;
+
+  if (extra && (extralength = strlen (extra)) > UINT16_MAX)
+  {
+    ms_log (2, "Extra headers are too long: %" PRIsize_t "\n", extralength);
+    return -1;
+  }
+
+  memset (&job, 0, sizeof (job));
+  job.nslots = nthreads * LM_PACK_WINDOWPERTHREAD;
+  job.nextid = mstl->traces.next[0];
+  job.record_handler = record_handler;
+  job.handlerdata = handlerdata;
+  job.reclen = reclen;
+  job.encoding = encoding;
+  job.flags = flags;
+  job.verbose = verbose;
+  job.extra = extra;
+
+  job.slots = (struct pack_slot_s *)libmseed_memory.malloc (job.nslots * sizeof (struct pack_slot_s));
+
+  if (job.slots == NULL || (job.sync = lm_sync_init ()) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    if (job.slots)
+      libmseed_memory.free (job.slots);
+    return -1;
   }
 
-  /* The record structure never owns the actual data so it should not free it */
-  msr->datasamples = NULL;
-  msr3_free (&msr);
+  memset (job.slots, 0, job.nslots * sizeof (struct pack_slot_s));
+
+  for (idx = 0; idx < job.nslots; idx++)
+    job.slots[idx].job = &job;
+
+  /* Each task packs trace IDs until all are packed */
+  if (lm_parallel_run (nthreads, nthreads, mstl3_pack_task, &job) < 0)
+  {
+    ms_log (2, "%s(): Cannot run parallel packing\n", __func__);
+    job.totalpackedrecords = -1;
+  }
+
+  for (idx = 0; idx < job.nslots; idx++)
+  {
+    if (job.slots[idx].records)
+      libmseed_memory.free (job.slots[idx].records);
+    if (job.slots[idx].reclens)
+      libmseed_memory.free (job.slots[idx].reclens);
+  }
+
+  libmseed_memory.free (job.slots);
+  lm_sync_free (job.sync);
 
   if (packedsamples)
-    *packedsamples = totalpackedsamples;
+    *packedsamples = job.totalpackedsamples;
 
-  return totalpackedrecords;
-} /* End of mstl3_pack() */
+  return job.totalpackedrecords;
+} /* End of mstl3_pack_parallel() */
 
 /**********************************************************************/ /**
  * @brief Print trace list summary information for a ::MS3TraceList
@@ -2458,6 +4393,93 @@ mstl3_printgaplist (const MS3TraceList *mstl, ms_timeformat_t timeformat,
   return;
 } /* End of mstl3_printgaplist() */
 
+/* Allocate memory for a trace list entry.
+ *
+ * If the memory pool of the list is enabled the memory is carved from
+ * the current slab, otherwise allocated with the library allocator.
+ * Allocations larger than the slab size are given a dedicated slab
+ * placed behind the current slab, leaving the current slab in use.
+ *
+ * Returns a pointer to the memory or NULL on error.
+ */
+static void *
+lm_pool_alloc (MS3TraceList *mstl, size_t size)
+{
+  LMPool *pool;
+  LMPoolSlab *slab;
+  size_t slabsize;
+  void *ptr;
+
+  if (!mstl || !mstl->pool)
+    return libmseed_memory.malloc (size);
+
+  pool = (LMPool *)mstl->pool;
+  size = LM_POOL_ALIGNUP (size);
+  slab = pool->slabs;
+
+  if (!slab || (slab->size - slab->used) < size)
+  {
+    slabsize = (size > pool->slabsize) ? size : pool->slabsize;
+
+    if ((slab = (LMPoolSlab *)libmseed_memory.malloc (LM_POOL_HEADERSIZE + slabsize)) == NULL)
+      return NULL;
+
+    slab->size = slabsize;
+    slab->used = 0;
+
+    if (size > pool->slabsize && pool->slabs)
+    {
+      slab->next = pool->slabs->next;
+      pool->slabs->next = slab;
+    }
+    else
+    {
+      slab->next = pool->slabs;
+      pool->slabs = slab;
+    }
+  }
+
+  ptr = (char *)slab + LM_POOL_HEADERSIZE + slab->used;
+  slab->used += size;
+
+  return ptr;
+}
+
+/* Release memory for a trace list entry.
+ *
+ * Memory carved from a memory pool is only released when the pool is
+ * destroyed, otherwise it is freed with the library allocator.
+ */
+static void
+lm_pool_release (MS3TraceList *mstl, void *ptr)
+{
+  if (!mstl || !mstl->pool)
+    libmseed_memory.free (ptr);
+}
+
+/* Free all slabs and the memory pool of a trace list, if enabled */
+static void
+lm_pool_destroy (MS3TraceList *mstl)
+{
+  LMPool *pool;
+  LMPoolSlab *slab;
+  LMPoolSlab *nextslab;
+
+  if (!mstl || !mstl->pool)
+    return;
+
+  pool = (LMPool *)mstl->pool;
+
+  for (slab = pool->slabs; slab; slab = nextslab)
+  {
+    nextslab = slab->next;
+    libmseed_memory.free (slab);
+  }
+
+  libmseed_memory.free (pool);
+  mstl->pool = NULL;
+}
+
 /* Pseudo random number generator, as a linear congruential generator (LCG):
  * https://en.wikipedia.org/wiki/Linear_congruential_generator
  *
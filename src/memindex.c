@@ -0,0 +1,1227 @@
+/***************************************************************************
+ * memindex.c - Routines for a memory-resident time series index.
+ *
+ * Rows of a time series index table are loaded into memory, grouped by
+ * channel (NSLC) in a hash table.  The rows of each channel are sorted
+ * by start time and organized as an implicit interval tree: for each
+ * range of rows the middle row is the root and the latest end time of
+ * all rows in the range is maintained, allowing ranges of rows that
+ * end before a query window to be skipped.  The time index and time
+ * spans of each row are decoded when loaded.
+ *
+ * Rows are replaced per file when a file is updated, e.g. after it
+ * was synchronized with the database by mseedindex.
+ *
+ * The client routines use the line protocol of mseedindex-server:
+ *
+ *   QUERY <net> <sta> <loc> <chan> <start> <end>
+ *     Request byte ranges for a selection, NSLC may contain wildcards
+ *     and an empty location is specified as '--'.  Times are integer
+ *     nanoseconds since the epoch or '*' for an open window.
+ *     Response: a line for each row with data in the time window:
+ *       ROW <net> <sta> <loc> <chan> <version> <start> <end> <rate>
+ *           <byteoffset> <bytes> <offset> <length> <filename>
+ *     followed by 'END <count>'.
+ *
+ *   UPDATE <filename>
+ *     Reload rows for a file (and versions of a file) from the database.
+ *     Response: 'OK <rowcount>'
+ *
+ * Errors are returned as 'ERROR <message>'.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "memindex.h"
+
+/* Tolerance for comparing with time spans, which are rounded to microseconds */
+#define SPANTOLERANCE 1000
+
+/* Send without raising SIGPIPE when the server has closed the
+ * connection, the error is returned instead.  Where MSG_NOSIGNAL is not
+ * available (macOS) SO_NOSIGPIPE is set on the socket. */
+#if defined(MSG_NOSIGNAL)
+#define SENDFLAGS MSG_NOSIGNAL
+#else
+#define SENDFLAGS 0
+#endif
+
+struct MemIndexHashEntry
+{
+  char *key;
+  void *value;
+  uint32_t hash;
+  struct MemIndexHashEntry *next;
+};
+
+static MemIndexChannel *GetChannel (MemIndex *index, const TSIndexRow *row);
+static MemIndexFile *GetFile (MemIndex *index, MemIndexChannel *channel, const char *filename);
+static int AddRow (MemIndex *index, TSIndexRow *row);
+static void RemoveFile (MemIndex *index, MemIndexFile *file);
+static void Organize (MemIndex *index);
+static nstime_t BuildMaxEnd (MemIndexChannel *channel, int64_t low, int64_t high);
+static int SearchChannel (MemIndexChannel *channel, int64_t low, int64_t high,
+                          const TSIndexRequest *request, MemIndexResult **results,
+                          int64_t *resultcount, int64_t *resultmax);
+static int RowHasData (const MemIndexRow *row, nstime_t starttime, nstime_t endtime);
+static int CompareRowStart (const void *a, const void *b);
+static int ChannelMatch (const MemIndexChannel *channel, const TSIndexRequest *request);
+static uint32_t HashString (const char *string);
+static void *HashFind (MemIndexHash *hash, const char *key);
+static int HashInsert (MemIndexHash *hash, const char *key, void *value);
+static void HashRemove (MemIndexHash *hash, const char *key);
+static void HashFree (MemIndexHash *hash, void (*freevalue) (void *));
+static void FreeFile (void *value);
+static void FreeChannel (void *value);
+
+/***************************************************************************
+ * memindex_init():
+ *
+ * Allocate and initialize an empty memory index.
+ *
+ * Returns a pointer to the index on success and NULL on error.
+ ***************************************************************************/
+MemIndex *
+memindex_init (void)
+{
+  MemIndex *index;
+
+  if (!(index = calloc (1, sizeof (MemIndex))))
+  {
+    ms_log (2, "Cannot allocate memory for index\n");
+    return NULL;
+  }
+
+  return index;
+} /* End of memindex_init() */
+
+/***************************************************************************
+ * memindex_load():
+ *
+ * Load all rows of an index table into the memory index.
+ *
+ * Returns the number of rows loaded on success and -1 on error.
+ ***************************************************************************/
+int64_t
+memindex_load (MemIndex *index, sqlite3 *dbconn, const char *table)
+{
+  TSIndexRequest *request = NULL;
+  TSIndexRow *rows = NULL;
+  int64_t rowcount;
+  int64_t idx;
+
+  if (!index || !dbconn || !table)
+    return -1;
+
+  if (tsindex_addrequest (&request, NULL, NULL, NULL, NULL, NSTUNSET, NSTUNSET))
+    return -1;
+
+  rowcount = tsindex_query (dbconn, table, request, &rows);
+  tsindex_freerequests (&request);
+
+  if (rowcount < 0)
+    return -1;
+
+  for (idx = 0; idx < rowcount; idx++)
+  {
+    if (AddRow (index, &rows[idx]))
+    {
+      tsindex_freerows (rows, rowcount);
+      return -1;
+    }
+  }
+
+  tsindex_freerows (rows, rowcount);
+
+  Organize (index);
+
+  return rowcount;
+} /* End of memindex_load() */
+
+/***************************************************************************
+ * memindex_updatefile():
+ *
+ * Replace the rows of a file in the memory index with the rows
+ * currently in the index table.  If the filename contains a version
+ * suffix ('#version') the rows of all files with the same base name
+ * are replaced, following the synchronization of versioned files by
+ * mseedindex.
+ *
+ * Returns the number of rows loaded for the file on success and -1 on
+ * error.
+ ***************************************************************************/
+int64_t
+memindex_updatefile (MemIndex *index, sqlite3 *dbconn, const char *table,
+                     const char *filename)
+{
+  MemIndexFile *file;
+  TSIndexRow *rows = NULL;
+  const char *vp;
+  size_t baselength;
+  int64_t rowcount;
+  int64_t idx;
+  uint32_t bucket;
+  struct MemIndexHashEntry *entry;
+  struct MemIndexHashEntry *next;
+
+  if (!index || !dbconn || !table || !filename)
+    return -1;
+
+  if ((rowcount = tsindex_queryfile (dbconn, table, filename, &rows)) < 0)
+    return -1;
+
+  /* Remove current rows of the file or all versions of the file */
+  if ((vp = strrchr (filename, '#')))
+  {
+    baselength = vp - filename;
+
+    for (bucket = 0; bucket < index->files.bucketcount; bucket++)
+    {
+      for (entry = index->files.buckets[bucket]; entry; entry = next)
+      {
+        next = entry->next;
+
+        if (!strncmp (entry->key, filename, baselength))
+          RemoveFile (index, (MemIndexFile *)entry->value);
+      }
+    }
+  }
+  else if ((file = HashFind (&index->files, filename)))
+  {
+    RemoveFile (index, file);
+  }
+
+  for (idx = 0; idx < rowcount; idx++)
+  {
+    if (AddRow (index, &rows[idx]))
+    {
+      tsindex_freerows (rows, rowcount);
+      return -1;
+    }
+  }
+
+  tsindex_freerows (rows, rowcount);
+
+  Organize (index);
+
+  return rowcount;
+} /* End of memindex_updatefile() */
+
+/***************************************************************************
+ * memindex_query():
+ *
+ * Find the rows matching a request selection with data in the request
+ * time window and determine the byte range of each row that contains
+ * the time window.  Rows are excluded when their time spans show that
+ * the time window falls in a gap.
+ *
+ * The results are stored in an array that is reallocated as needed,
+ * 'resultmax' tracks the allocated size, allowing the array to be
+ * reused for multiple queries.  Results refer to rows of the index
+ * and are valid until the index is updated.
+ *
+ * Returns the number of results on success and -1 on error.
+ ***************************************************************************/
+int64_t
+memindex_query (MemIndex *index, const TSIndexRequest *request,
+                MemIndexResult **results, int64_t *resultmax)
+{
+  MemIndexChannel *channel;
+  char key[50];
+  int64_t resultcount = 0;
+  int64_t idx;
+
+  if (!index || !request || !results || !resultmax)
+    return -1;
+
+  /* Direct lookup of channel without wildcards */
+  if (!strpbrk (request->network, "*?[") && !strpbrk (request->station, "*?[") &&
+      !strpbrk (request->location, "*?[") && !strpbrk (request->channel, "*?["))
+  {
+    snprintf (key, sizeof (key), "%s_%s_%s_%s",
+              request->network, request->station, request->location, request->channel);
+
+    if ((channel = HashFind (&index->channels, key)) &&
+        SearchChannel (channel, 0, channel->rowcount, request, results, &resultcount, resultmax))
+      return -1;
+
+    return resultcount;
+  }
+
+  for (idx = 0; idx < index->channelcount; idx++)
+  {
+    channel = index->channellist[idx];
+
+    if (ChannelMatch (channel, request) &&
+        SearchChannel (channel, 0, channel->rowcount, request, results, &resultcount, resultmax))
+      return -1;
+  }
+
+  return resultcount;
+} /* End of memindex_query() */
+
+/***************************************************************************
+ * memindex_free():
+ *
+ * Free all memory associated with an index and set the pointer to NULL.
+ ***************************************************************************/
+void
+memindex_free (MemIndex **index)
+{
+  if (!index || !*index)
+    return;
+
+  HashFree (&(*index)->channels, FreeChannel);
+  HashFree (&(*index)->files, FreeFile);
+  free ((*index)->channellist);
+  free (*index);
+
+  *index = NULL;
+} /* End of memindex_free() */
+
+#if !defined(_WIN32)
+/***************************************************************************
+ * memindex_connect():
+ *
+ * Connect to a server providing a memory index on a Unix domain socket.
+ *
+ * Returns a client connection on success and NULL on error.
+ ***************************************************************************/
+MemIndexClient *
+memindex_connect (const char *socketpath)
+{
+  MemIndexClient *client;
+  struct sockaddr_un addr;
+
+  if (!socketpath)
+    return NULL;
+
+  if (strlen (socketpath) >= sizeof (addr.sun_path))
+  {
+    ms_log (2, "Socket path is too long: %s\n", socketpath);
+    return NULL;
+  }
+
+  if (!(client = calloc (1, sizeof (MemIndexClient))))
+  {
+    ms_log (2, "Cannot allocate memory for client\n");
+    return NULL;
+  }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, socketpath);
+
+  if ((client->fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      connect (client->fd, (struct sockaddr *)&addr, sizeof (addr)))
+  {
+    ms_log (2, "Cannot connect to %s: %s\n", socketpath, strerror (errno));
+    if (client->fd >= 0)
+      close (client->fd);
+    free (client);
+    return NULL;
+  }
+
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+  {
+    int nosigpipe = 1;
+    setsockopt (client->fd, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe, sizeof (nosigpipe));
+  }
+#endif
+
+  /* Responses are read as lines from a stream on a duplicate descriptor */
+  if (!(client->input = fdopen (dup (client->fd), "r")))
+  {
+    ms_log (2, "Cannot open input stream for %s: %s\n", socketpath, strerror (errno));
+    close (client->fd);
+    free (client);
+    return NULL;
+  }
+
+  return client;
+} /* End of memindex_connect() */
+
+/***************************************************************************
+ * SendLine():
+ *
+ * Send a complete request line to the server.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+SendLine (MemIndexClient *client, const char *line, size_t length)
+{
+  ssize_t sent;
+
+  while (length > 0)
+  {
+    if ((sent = send (client->fd, line, length, SENDFLAGS)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      ms_log (2, "Cannot send request to server: %s\n", strerror (errno));
+      return -1;
+    }
+
+    line += sent;
+    length -= sent;
+  }
+
+  return 0;
+} /* End of SendLine() */
+
+/***************************************************************************
+ * memindex_remotequery():
+ *
+ * Query a server for the byte ranges of rows matching a request.  The
+ * returned rows contain the section details without a time index, the
+ * byte range of each row containing the time window is returned as an
+ * offset and length pair in 'ranges'.  Both arrays are allocated, rows
+ * must be freed with tsindex_freerows() and ranges with free().
+ *
+ * Returns the number of rows on success and -1 on error.
+ ***************************************************************************/
+int64_t
+memindex_remotequery (MemIndexClient *client, const TSIndexRequest *request,
+                      TSIndexRow **rows, int64_t **ranges)
+{
+  TSIndexRow *row;
+  void *newptr;
+  char line[2048];
+  char starttimestr[30];
+  char endtimestr[30];
+  char *cp;
+  int64_t rowcount = 0;
+  int64_t rowmax = 0;
+  int64_t endcount;
+  int length;
+  int consumed;
+
+  if (!client || !request || !rows || !ranges)
+    return -1;
+
+  *rows = NULL;
+  *ranges = NULL;
+
+  if (request->starttime == NSTUNSET)
+    strcpy (starttimestr, "*");
+  else
+    snprintf (starttimestr, sizeof (starttimestr), "%" PRId64, (int64_t)request->starttime);
+
+  if (request->endtime == NSTUNSET)
+    strcpy (endtimestr, "*");
+  else
+    snprintf (endtimestr, sizeof (endtimestr), "%" PRId64, (int64_t)request->endtime);
+
+  length = snprintf (line, sizeof (line), "QUERY %s %s %s %s %s %s\n",
+                     request->network, request->station,
+                     (*request->location) ? request->location : "--",
+                     request->channel, starttimestr, endtimestr);
+
+  if (SendLine (client, line, length))
+    return -1;
+
+  while (fgets (line, sizeof (line), client->input))
+  {
+    if ((cp = strchr (line, '\n')))
+      *cp = '\0';
+
+    if (!strncmp (line, "END ", 4))
+    {
+      endcount = strtoll (line + 4, NULL, 10);
+
+      if (endcount != rowcount)
+      {
+        ms_log (2, "Unexpected row count from server, %" PRId64 " != %" PRId64 "\n",
+                rowcount, endcount);
+        break;
+      }
+
+      return rowcount;
+    }
+
+    if (!strncmp (line, "ERROR ", 6))
+    {
+      ms_log (2, "Server error: %s\n", line + 6);
+      break;
+    }
+
+    if (strncmp (line, "ROW ", 4))
+    {
+      ms_log (2, "Unrecognized response from server: %s\n", line);
+      break;
+    }
+
+    if (rowcount == rowmax)
+    {
+      rowmax = (rowmax) ? rowmax * 2 : 64;
+
+      if (!(newptr = realloc (*rows, rowmax * sizeof (TSIndexRow))))
+        break;
+      *rows = newptr;
+
+      if (!(newptr = realloc (*ranges, rowmax * 2 * sizeof (int64_t))))
+        break;
+      *ranges = newptr;
+    }
+
+    row = &(*rows)[rowcount];
+    memset (row, 0, sizeof (TSIndexRow));
+
+    if (sscanf (line + 4, "%10s %10s %10s %10s %d %" SCNd64 " %" SCNd64 " %lf %" SCNd64
+                          " %" SCNd64 " %" SCNd64 " %" SCNd64 " %n",
+                row->network, row->station, row->location, row->channel, &row->version,
+                &row->starttime, &row->endtime, &row->samplerate, &row->byteoffset,
+                &row->bytes, &(*ranges)[rowcount * 2], &(*ranges)[rowcount * 2 + 1],
+                &consumed) != 12 ||
+        line[4 + consumed] == '\0')
+    {
+      ms_log (2, "Cannot parse row from server: %s\n", line);
+      break;
+    }
+
+    if (!strcmp (row->location, "--"))
+      row->location[0] = '\0';
+
+    rowcount++;
+
+    if (!(row->filename = strdup (line + 4 + consumed)))
+      break;
+  }
+
+  tsindex_freerows (*rows, rowcount);
+  free (*ranges);
+  *rows = NULL;
+  *ranges = NULL;
+
+  return -1;
+} /* End of memindex_remotequery() */
+
+/***************************************************************************
+ * memindex_remoteupdate():
+ *
+ * Request a server to update the rows of a file from the database.
+ *
+ * Returns the number of rows loaded by the server on success and -1 on
+ * error.
+ ***************************************************************************/
+int64_t
+memindex_remoteupdate (MemIndexClient *client, const char *filename)
+{
+  char line[2048];
+  char *cp;
+  int length;
+
+  if (!client || !filename)
+    return -1;
+
+  if (strchr (filename, '\n') ||
+      (length = snprintf (line, sizeof (line), "UPDATE %s\n", filename)) >= (int)sizeof (line))
+  {
+    ms_log (2, "Cannot send update for file name: %s\n", filename);
+    return -1;
+  }
+
+  if (SendLine (client, line, length))
+    return -1;
+
+  if (!fgets (line, sizeof (line), client->input))
+  {
+    ms_log (2, "No response from server for update of %s\n", filename);
+    return -1;
+  }
+
+  if ((cp = strchr (line, '\n')))
+    *cp = '\0';
+
+  if (strncmp (line, "OK ", 3))
+  {
+    ms_log (2, "Server cannot update %s: %s\n", filename,
+            (!strncmp (line, "ERROR ", 6)) ? line + 6 : line);
+    return -1;
+  }
+
+  return strtoll (line + 3, NULL, 10);
+} /* End of memindex_remoteupdate() */
+
+/***************************************************************************
+ * memindex_disconnect():
+ *
+ * Close a server connection, free the client and set the pointer to NULL.
+ ***************************************************************************/
+void
+memindex_disconnect (MemIndexClient **client)
+{
+  if (!client || !*client)
+    return;
+
+  if ((*client)->input)
+    fclose ((*client)->input);
+  close ((*client)->fd);
+  free (*client);
+
+  *client = NULL;
+} /* End of memindex_disconnect() */
+#else
+MemIndexClient *
+memindex_connect (const char *socketpath)
+{
+  ms_log (2, "Index server connections are not supported on this platform\n");
+  return NULL;
+}
+
+int64_t
+memindex_remotequery (MemIndexClient *client, const TSIndexRequest *request,
+                      TSIndexRow **rows, int64_t **ranges)
+{
+  return -1;
+}
+
+int64_t
+memindex_remoteupdate (MemIndexClient *client, const char *filename)
+{
+  return -1;
+}
+
+void
+memindex_disconnect (MemIndexClient **client)
+{
+}
+#endif /* !defined(_WIN32) */
+
+/***************************************************************************
+ * GetChannel():
+ *
+ * Find or create the channel for a row.
+ *
+ * Returns a pointer to the channel on success and NULL on error.
+ ***************************************************************************/
+static MemIndexChannel *
+GetChannel (MemIndex *index, const TSIndexRow *row)
+{
+  MemIndexChannel *channel;
+  MemIndexChannel **newlist;
+  char key[50];
+
+  snprintf (key, sizeof (key), "%s_%s_%s_%s",
+            row->network, row->station, row->location, row->channel);
+
+  if ((channel = HashFind (&index->channels, key)))
+    return channel;
+
+  if (index->channelcount == index->channelmax)
+  {
+    index->channelmax = (index->channelmax) ? index->channelmax * 2 : 256;
+
+    if (!(newlist = realloc (index->channellist, index->channelmax * sizeof (MemIndexChannel *))))
+    {
+      ms_log (2, "Cannot allocate memory for channel list\n");
+      return NULL;
+    }
+
+    index->channellist = newlist;
+  }
+
+  if (!(channel = calloc (1, sizeof (MemIndexChannel))))
+  {
+    ms_log (2, "Cannot allocate memory for channel\n");
+    return NULL;
+  }
+
+  strcpy (channel->network, row->network);
+  strcpy (channel->station, row->station);
+  strcpy (channel->location, row->location);
+  strcpy (channel->channel, row->channel);
+  channel->sorted = 1;
+
+  if (HashInsert (&index->channels, key, channel))
+  {
+    free (channel);
+    return NULL;
+  }
+
+  index->channellist[index->channelcount++] = channel;
+
+  return channel;
+} /* End of GetChannel() */
+
+/***************************************************************************
+ * GetFile():
+ *
+ * Find or create a file and add a channel to the channels of the file.
+ *
+ * Returns a pointer to the file on success and NULL on error.
+ ***************************************************************************/
+static MemIndexFile *
+GetFile (MemIndex *index, MemIndexChannel *channel, const char *filename)
+{
+  MemIndexFile *file;
+  MemIndexChannel **newchannels;
+  int idx;
+
+  if (!(file = HashFind (&index->files, filename)))
+  {
+    if (!(file = calloc (1, sizeof (MemIndexFile))) ||
+        !(file->name = strdup (filename)))
+    {
+      ms_log (2, "Cannot allocate memory for file\n");
+      free (file);
+      return NULL;
+    }
+
+    if (HashInsert (&index->files, filename, file))
+    {
+      FreeFile (file);
+      return NULL;
+    }
+  }
+
+  /* Rows of a file are commonly added by channel, check the last channel first */
+  for (idx = file->channelcount - 1; idx >= 0; idx--)
+  {
+    if (file->channels[idx] == channel)
+      return file;
+  }
+
+  if (file->channelcount == file->channelmax)
+  {
+    file->channelmax = (file->channelmax) ? file->channelmax * 2 : 4;
+
+    if (!(newchannels = realloc (file->channels, file->channelmax * sizeof (MemIndexChannel *))))
+    {
+      ms_log (2, "Cannot allocate memory for file channels\n");
+      return NULL;
+    }
+
+    file->channels = newchannels;
+  }
+
+  file->channels[file->channelcount++] = channel;
+
+  return file;
+} /* End of GetFile() */
+
+/***************************************************************************
+ * AddRow():
+ *
+ * Add a row to the index, the decoded time index of the row is moved
+ * to the index and the time spans are decoded.  The channel of the row
+ * is marked for reorganization.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+AddRow (MemIndex *index, TSIndexRow *row)
+{
+  MemIndexChannel *channel;
+  MemIndexRow *newrows;
+  MemIndexRow *memrow;
+
+  if (!(channel = GetChannel (index, row)))
+    return -1;
+
+  if (channel->rowcount == channel->rowmax)
+  {
+    channel->rowmax = (channel->rowmax) ? channel->rowmax * 2 : 8;
+
+    if (!(newrows = realloc (channel->rows, channel->rowmax * sizeof (MemIndexRow))))
+    {
+      ms_log (2, "Cannot allocate memory for channel rows\n");
+      return -1;
+    }
+
+    channel->rows = newrows;
+  }
+
+  memrow = &channel->rows[channel->rowcount];
+  memset (memrow, 0, sizeof (MemIndexRow));
+
+  if (!(memrow->file = GetFile (index, channel, row->filename)))
+    return -1;
+
+  memrow->starttime = row->starttime;
+  memrow->endtime = row->endtime;
+  memrow->byteoffset = row->byteoffset;
+  memrow->bytes = row->bytes;
+  memrow->samplerate = row->samplerate;
+  memrow->version = row->version;
+  memrow->latest = row->latest;
+  memrow->tindex = row->tindex;
+  memrow->tindexcount = row->tindexcount;
+  row->tindex = NULL;
+  row->tindexcount = 0;
+
+  if (row->timespans &&
+      tsindex_parse_timespans (row->timespans, row->timerates, row->samplerate,
+                               &memrow->spans, &memrow->spancount))
+  {
+    ms_log (1, "Warning: cannot parse time spans for %s_%s_%s_%s in %s\n",
+            row->network, row->station, row->location, row->channel, row->filename);
+  }
+
+  channel->rowcount++;
+  channel->sorted = 0;
+  index->rowcount++;
+
+  return 0;
+} /* End of AddRow() */
+
+/***************************************************************************
+ * RemoveFile():
+ *
+ * Remove all rows of a file from the channels of the file and remove
+ * the file from the index.
+ ***************************************************************************/
+static void
+RemoveFile (MemIndex *index, MemIndexFile *file)
+{
+  MemIndexChannel *channel;
+  int64_t from;
+  int64_t to;
+  int idx;
+
+  for (idx = 0; idx < file->channelcount; idx++)
+  {
+    channel = file->channels[idx];
+
+    for (from = 0, to = 0; from < channel->rowcount; from++)
+    {
+      if (channel->rows[from].file == file)
+      {
+        free (channel->rows[from].tindex);
+        free (channel->rows[from].spans);
+        index->rowcount--;
+        continue;
+      }
+
+      if (to != from)
+        channel->rows[to] = channel->rows[from];
+      to++;
+    }
+
+    channel->rowcount = to;
+    channel->sorted = 0;
+  }
+
+  HashRemove (&index->files, file->name);
+  FreeFile (file);
+} /* End of RemoveFile() */
+
+/***************************************************************************
+ * Organize():
+ *
+ * Sort the rows of modified channels by start time and rebuild the
+ * maximum end times of the interval tree.
+ ***************************************************************************/
+static void
+Organize (MemIndex *index)
+{
+  MemIndexChannel *channel;
+  nstime_t *newmaxend;
+  int64_t idx;
+
+  for (idx = 0; idx < index->channelcount; idx++)
+  {
+    channel = index->channellist[idx];
+
+    if (channel->sorted)
+      continue;
+
+    if (channel->rowcount > 1)
+      qsort (channel->rows, channel->rowcount, sizeof (MemIndexRow), CompareRowStart);
+
+    if (channel->rowcount > 0)
+    {
+      if (!(newmaxend = realloc (channel->maxend, channel->rowmax * sizeof (nstime_t))))
+      {
+        ms_log (2, "Cannot allocate memory for channel tree\n");
+        continue;
+      }
+
+      channel->maxend = newmaxend;
+      BuildMaxEnd (channel, 0, channel->rowcount);
+    }
+
+    channel->sorted = 1;
+  }
+} /* End of Organize() */
+
+/***************************************************************************
+ * BuildMaxEnd():
+ *
+ * Determine the latest end time of each range of rows in the implicit
+ * interval tree, stored at the index of the middle (root) row.
+ *
+ * Returns the latest end time of the range.
+ ***************************************************************************/
+static nstime_t
+BuildMaxEnd (MemIndexChannel *channel, int64_t low, int64_t high)
+{
+  int64_t mid;
+  nstime_t maxend;
+  nstime_t subend;
+
+  if (low >= high)
+    return NSTUNSET;
+
+  mid = low + (high - low) / 2;
+  maxend = channel->rows[mid].endtime;
+
+  if ((subend = BuildMaxEnd (channel, low, mid)) != NSTUNSET && subend > maxend)
+    maxend = subend;
+  if ((subend = BuildMaxEnd (channel, mid + 1, high)) != NSTUNSET && subend > maxend)
+    maxend = subend;
+
+  channel->maxend[mid] = maxend;
+
+  return maxend;
+} /* End of BuildMaxEnd() */
+
+/***************************************************************************
+ * SearchChannel():
+ *
+ * Search a range of rows of a channel for rows with data in the
+ * request time window.  Ranges ending before the window are skipped,
+ * and as rows are sorted by start time the rows after a row starting
+ * after the window are skipped.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+SearchChannel (MemIndexChannel *channel, int64_t low, int64_t high,
+               const TSIndexRequest *request, MemIndexResult **results,
+               int64_t *resultcount, int64_t *resultmax)
+{
+  MemIndexResult *newresults;
+  MemIndexRow *row;
+  TSIndexRow tsrow;
+  int64_t mid;
+
+  if (low >= high || !channel->sorted)
+    return 0;
+
+  mid = low + (high - low) / 2;
+
+  if (request->starttime != NSTUNSET && channel->maxend[mid] < request->starttime)
+    return 0;
+
+  if (SearchChannel (channel, low, mid, request, results, resultcount, resultmax))
+    return -1;
+
+  row = &channel->rows[mid];
+
+  if (request->endtime != NSTUNSET && row->starttime > request->endtime)
+    return 0;
+
+  if (RowHasData (row, request->starttime, request->endtime))
+  {
+    memset (&tsrow, 0, sizeof (tsrow));
+    tsrow.starttime = row->starttime;
+    tsrow.endtime = row->endtime;
+    tsrow.byteoffset = row->byteoffset;
+    tsrow.bytes = row->bytes;
+    tsrow.tindex = row->tindex;
+    tsrow.tindexcount = row->tindexcount;
+    tsrow.latest = row->latest;
+
+    if (*resultcount == *resultmax)
+    {
+      *resultmax = (*resultmax) ? *resultmax * 2 : 64;
+
+      if (!(newresults = realloc (*results, *resultmax * sizeof (MemIndexResult))))
+      {
+        ms_log (2, "Cannot allocate memory for results\n");
+        return -1;
+      }
+
+      *results = newresults;
+    }
+
+    if (tsindex_byterange (&tsrow, request->starttime, request->endtime,
+                           &(*results)[*resultcount].offset,
+                           &(*results)[*resultcount].length) == 1)
+    {
+      (*results)[*resultcount].channel = channel;
+      (*results)[*resultcount].row = row;
+      (*resultcount)++;
+    }
+  }
+
+  return SearchChannel (channel, mid + 1, high, request, results, resultcount, resultmax);
+} /* End of SearchChannel() */
+
+/***************************************************************************
+ * RowHasData():
+ *
+ * Returns 1 if the row has data in the time window, otherwise 0.  When
+ * time spans are available they are used to check for data in the
+ * window, otherwise the time range of the row is used.
+ ***************************************************************************/
+static int
+RowHasData (const MemIndexRow *row, nstime_t starttime, nstime_t endtime)
+{
+  int idx;
+
+  if ((endtime != NSTUNSET && row->starttime > endtime) ||
+      (starttime != NSTUNSET && row->endtime < starttime))
+    return 0;
+
+  if (!row->spans)
+    return 1;
+
+  for (idx = 0; idx < row->spancount; idx++)
+  {
+    if ((endtime == NSTUNSET || row->spans[idx].start - SPANTOLERANCE <= endtime) &&
+        (starttime == NSTUNSET || row->spans[idx].end + SPANTOLERANCE >= starttime))
+      return 1;
+  }
+
+  return 0;
+} /* End of RowHasData() */
+
+/***************************************************************************
+ * CompareRowStart():
+ *
+ * Compare rows by start time, then end time, for qsort().
+ ***************************************************************************/
+static int
+CompareRowStart (const void *a, const void *b)
+{
+  const MemIndexRow *rowa = (const MemIndexRow *)a;
+  const MemIndexRow *rowb = (const MemIndexRow *)b;
+
+  if (rowa->starttime != rowb->starttime)
+    return (rowa->starttime < rowb->starttime) ? -1 : 1;
+
+  if (rowa->endtime != rowb->endtime)
+    return (rowa->endtime < rowb->endtime) ? -1 : 1;
+
+  return 0;
+} /* End of CompareRowStart() */
+
+/***************************************************************************
+ * ChannelMatch():
+ *
+ * Returns 1 if the channel matches the request patterns, otherwise 0.
+ ***************************************************************************/
+static int
+ChannelMatch (const MemIndexChannel *channel, const TSIndexRequest *request)
+{
+  return (tsindex_globmatch (channel->network, request->network) &&
+          tsindex_globmatch (channel->station, request->station) &&
+          tsindex_globmatch (channel->location, request->location) &&
+          tsindex_globmatch (channel->channel, request->channel));
+} /* End of ChannelMatch() */
+
+/***************************************************************************
+ * HashString():
+ *
+ * Returns the 32-bit FNV-1a hash of a string.
+ ***************************************************************************/
+static uint32_t
+HashString (const char *string)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*string)
+  {
+    hash ^= (unsigned char)*string++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+} /* End of HashString() */
+
+/***************************************************************************
+ * HashFind():
+ *
+ * Returns the value for a key or NULL if the key is not in the table.
+ ***************************************************************************/
+static void *
+HashFind (MemIndexHash *hash, const char *key)
+{
+  struct MemIndexHashEntry *entry;
+  uint32_t keyhash;
+
+  if (!hash->buckets)
+    return NULL;
+
+  keyhash = HashString (key);
+
+  for (entry = hash->buckets[keyhash % hash->bucketcount]; entry; entry = entry->next)
+  {
+    if (entry->hash == keyhash && !strcmp (entry->key, key))
+      return entry->value;
+  }
+
+  return NULL;
+} /* End of HashFind() */
+
+/***************************************************************************
+ * HashInsert():
+ *
+ * Insert a key and value into the table, the table is grown to keep
+ * the number of entries at or below the number of buckets.  The key
+ * must not already be in the table.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+HashInsert (MemIndexHash *hash, const char *key, void *value)
+{
+  struct MemIndexHashEntry **newbuckets;
+  struct MemIndexHashEntry *entry;
+  struct MemIndexHashEntry *next;
+  uint32_t newcount;
+  uint32_t idx;
+
+  if (hash->count >= hash->bucketcount)
+  {
+    newcount = (hash->bucketcount) ? hash->bucketcount * 2 : 1024;
+
+    if (!(newbuckets = calloc (newcount, sizeof (struct MemIndexHashEntry *))))
+    {
+      ms_log (2, "Cannot allocate memory for hash table\n");
+      return -1;
+    }
+
+    for (idx = 0; idx < hash->bucketcount; idx++)
+    {
+      for (entry = hash->buckets[idx]; entry; entry = next)
+      {
+        next = entry->next;
+        entry->next = newbuckets[entry->hash % newcount];
+        newbuckets[entry->hash % newcount] = entry;
+      }
+    }
+
+    free (hash->buckets);
+    hash->buckets = newbuckets;
+    hash->bucketcount = newcount;
+  }
+
+  if (!(entry = malloc (sizeof (struct MemIndexHashEntry))) ||
+      !(entry->key = strdup (key)))
+  {
+    ms_log (2, "Cannot allocate memory for hash entry\n");
+    free (entry);
+    return -1;
+  }
+
+  entry->value = value;
+  entry->hash = HashString (key);
+  entry->next = hash->buckets[entry->hash % hash->bucketcount];
+  hash->buckets[entry->hash % hash->bucketcount] = entry;
+  hash->count++;
+
+  return 0;
+} /* End of HashInsert() */
+
+/***************************************************************************
+ * HashRemove():
+ *
+ * Remove a key from the table, the value is not freed.
+ ***************************************************************************/
+static void
+HashRemove (MemIndexHash *hash, const char *key)
+{
+  struct MemIndexHashEntry **entryp;
+  struct MemIndexHashEntry *entry;
+  uint32_t keyhash;
+
+  if (!hash->buckets)
+    return;
+
+  keyhash = HashString (key);
+
+  for (entryp = &hash->buckets[keyhash % hash->bucketcount]; *entryp; entryp = &(*entryp)->next)
+  {
+    entry = *entryp;
+
+    if (entry->hash == keyhash && !strcmp (entry->key, key))
+    {
+      *entryp = entry->next;
+      free (entry->key);
+      free (entry);
+      hash->count--;
+      return;
+    }
+  }
+} /* End of HashRemove() */
+
+/***************************************************************************
+ * HashFree():
+ *
+ * Free all entries of a table, values are freed with 'freevalue'.
+ ***************************************************************************/
+static void
+HashFree (MemIndexHash *hash, void (*freevalue) (void *))
+{
+  struct MemIndexHashEntry *entry;
+  struct MemIndexHashEntry *next;
+  uint32_t idx;
+
+  for (idx = 0; idx < hash->bucketcount; idx++)
+  {
+    for (entry = hash->buckets[idx]; entry; entry = next)
+    {
+      next = entry->next;
+      if (freevalue)
+        freevalue (entry->value);
+      free (entry->key);
+      free (entry);
+    }
+  }
+
+  free (hash->buckets);
+  memset (hash, 0, sizeof (MemIndexHash));
+} /* End of HashFree() */
+
+/***************************************************************************
+ * FreeFile():
+ *
+ * Free a file entry.
+ ***************************************************************************/
+static void
+FreeFile (void *value)
+{
+  MemIndexFile *file = (MemIndexFile *)value;
+
+  free (file->name);
+  free (file->channels);
+  free (file);
+} /* End of FreeFile() */
+
+/***************************************************************************
+ * FreeChannel():
+ *
+ * Free a channel and its rows.
+ ***************************************************************************/
+static void
+FreeChannel (void *value)
+{
+  MemIndexChannel *channel = (MemIndexChannel *)value;
+  int64_t idx;
+
+  for (idx = 0; idx < channel->rowcount; idx++)
+  {
+    free (channel->rows[idx].tindex);
+    free (channel->rows[idx].spans);
+  }
+
+  free (channel->rows);
+  free (channel->maxend);
+  free (channel);
+} /* End of FreeChannel() */
@@ -0,0 +1,116 @@
+/***************************************************************************
+ * memindex.h - Interface for a memory-resident time series index.
+ *
+ * A time series index table loaded into memory and organized by
+ * channel, with the time index and time spans of each row decoded for
+ * determining byte ranges of time windows without database queries.
+ *
+ * Also includes the client routines of the line protocol used by
+ * mseedindex-server to provide queries and updates over a socket.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#ifndef MEMINDEX_H
+#define MEMINDEX_H 1
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <sqlite3.h>
+
+#include <libmseed.h>
+
+#include "tsindex.h"
+
+/* A file containing indexed sections, names are shared by rows */
+typedef struct MemIndexFile
+{
+  char *name;
+  struct MemIndexChannel **channels; /* Channels with rows in this file */
+  int channelcount;
+  int channelmax;
+} MemIndexFile;
+
+/* A row (section) of a channel with decoded time index and spans */
+typedef struct MemIndexRow
+{
+  nstime_t starttime;
+  nstime_t endtime;
+  int64_t byteoffset;
+  int64_t bytes;
+  MemIndexFile *file;
+  TSIndexEntry *tindex; /* Decoded time index, NULL if not available */
+  TSIndexSpan *spans;   /* Decoded time spans, NULL if not available */
+  double samplerate;
+  int tindexcount;
+  int spancount;
+  int version;
+  int latest;
+} MemIndexRow;
+
+/* A channel with rows sorted by start time, organized as an implicit
+ * interval tree: the row at the middle of each range of rows is the
+ * root of the range and maxend holds the latest end time in the range. */
+typedef struct MemIndexChannel
+{
+  char network[11];
+  char station[11];
+  char location[11];
+  char channel[11];
+  MemIndexRow *rows;
+  nstime_t *maxend;
+  int64_t rowcount;
+  int64_t rowmax;
+  int sorted; /* Rows are sorted and maxend is current */
+} MemIndexChannel;
+
+/* A result of a query, row and byte range within the row */
+typedef struct MemIndexResult
+{
+  const MemIndexChannel *channel;
+  const MemIndexRow *row;
+  int64_t offset;
+  int64_t length;
+} MemIndexResult;
+
+/* Hash table of string keys to values */
+typedef struct MemIndexHash
+{
+  struct MemIndexHashEntry **buckets;
+  uint32_t bucketcount;
+  uint32_t count;
+} MemIndexHash;
+
+/* A connection to a server providing the memory index */
+typedef struct MemIndexClient
+{
+  int fd;
+  FILE *input;
+} MemIndexClient;
+
+typedef struct MemIndex
+{
+  MemIndexHash channels; /* Keyed by 'NET_STA_LOC_CHA' */
+  MemIndexHash files;    /* Keyed by file name */
+  MemIndexChannel **channellist;
+  int64_t channelcount;
+  int64_t channelmax;
+  int64_t rowcount;
+} MemIndex;
+
+extern MemIndex *memindex_init (void);
+extern int64_t memindex_load (MemIndex *index, sqlite3 *dbconn, const char *table);
+extern int64_t memindex_updatefile (MemIndex *index, sqlite3 *dbconn, const char *table,
+                                    const char *filename);
+extern int64_t memindex_query (MemIndex *index, const TSIndexRequest *request,
+                               MemIndexResult **results, int64_t *resultmax);
+extern void memindex_free (MemIndex **index);
+
+extern MemIndexClient *memindex_connect (const char *socketpath);
+extern int64_t memindex_remotequery (MemIndexClient *client, const TSIndexRequest *request,
+                                     TSIndexRow **rows, int64_t **ranges);
+extern int64_t memindex_remoteupdate (MemIndexClient *client, const char *filename);
+extern void memindex_disconnect (MemIndexClient **client);
+
+#endif /* MEMINDEX_H */
@@ -0,0 +1,894 @@
+/***************************************************************************
+ * mseedindex-fetch.c - Extract miniSEED using a time series index.
+ *
+ * Query a time series index table in an SQLite database, as created by
+ * mseedindex, for sections matching request selections and extract
+ * the miniSEED records with data in the requested time windows.
+ *
+ * The time index of each section is used to determine the minimal
+ * byte range within the section that contains the requested time
+ * window.  The ranges of all requests are planned into reads in file
+ * and offset order, coalescing ranges separated by small gaps.  Only
+ * these reads are performed, using positioned reads, and records are
+ * written to the output if they are in a planned range and contain
+ * data in the time window of the range.
+ *
+ * Files compressed with gzip or zstd are read through the library
+ * reader, for which index byte offsets refer to the uncompressed data.
+ *
+ * Instead of querying the database the byte ranges may be requested
+ * from an mseedindex-server providing the index from memory.
+ *
+ * Alternatively the merged availability, or the gaps, of the selected
+ * channels is determined from the time spans of the index and written
+ * as text instead of extracting data.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#include "memindex.h"
+#include "tsindex.h"
+
+#define VERSION "1.0"
+#define PACKAGE "mseedindex-fetch"
+
+/* Size of read buffer, larger ranges are read in multiple reads */
+#define READBUFSIZE 1048576
+
+static flag verbose = 0;
+static char *table = "tsindex";
+static char *sqlitefile = NULL;
+static char *outputfile = "-";
+static char *socketpath = NULL;
+static flag availmode = 0;        /* 1 = availability extents, 2 = gaps */
+static double timetol = -1.0;     /* Time tolerance for merging availability */
+static double sampratetol = -1.0; /* Sample rate tolerance for merging availability */
+static unsigned long sqlitebusyto = 10000;
+static int64_t gapthreshold = 0;  /* Largest gap between ranges coalesced into a read */
+static flag planonly = 0;         /* Write read plan instead of data */
+static TSIndexRequest *requests = NULL;
+
+/* Statistics of extraction */
+static int64_t totalrows = 0;
+static int64_t totalrangebytes = 0;
+static int64_t totalsectionbytes = 0;
+static int64_t totalreadbytes = 0;
+static int64_t totalrecords = 0;
+static int64_t totaloutputbytes = 0;
+
+/* Currently open file, reads are performed in file order */
+static char *openfilename = NULL;
+static FILE *openfp = NULL;
+static int opencompressed = 0;
+
+static int PlanRequest (sqlite3 *dbconn, MemIndexClient *client,
+                        const TSIndexRequest *request, TSIndexPlan *plan);
+static int FetchPlan (TSIndexPlan *plan, FILE *output);
+static int WriteAvailability (const TSIndexAvailability *availability, void *handlerdata);
+static int ExtractRead (const TSIndexPlan *plan, const TSIndexRead *read, FILE *output);
+static int ExtractCompressedRead (const TSIndexPlan *plan, const TSIndexRead *read, FILE *output);
+static int SelectRecord (const TSIndexPlan *plan, const TSIndexRead *read, int64_t *cursor,
+                         int64_t offset, const MS3Record *msr);
+static int WriteRecord (const char *record, int reclen, FILE *output);
+static int OpenFile (const char *filename);
+static void CloseFile (void);
+static int ProcessParam (int argcount, char **argvec);
+static char *GetOptValue (int argcount, char **argvec, int argopt);
+static nstime_t GetOptTime (int argcount, char **argvec, int argopt);
+static void Usage (void);
+
+int
+main (int argc, char **argv)
+{
+  sqlite3 *dbconn = NULL;
+  MemIndexClient *client = NULL;
+  TSIndexRequest *request;
+  TSIndexPlan plan;
+  FILE *output;
+  int rv = 0;
+
+  /* Set default error message prefix */
+  ms_loginit (NULL, NULL, NULL, "ERROR: ");
+
+  /* Process given parameters (command line and parameter file) */
+  if (ProcessParam (argc, argv) < 0)
+    return 1;
+
+  if (socketpath)
+  {
+    if (!(client = memindex_connect (socketpath)))
+      return 1;
+  }
+  else if (sqlite3_open_v2 (sqlitefile, &dbconn, SQLITE_OPEN_READONLY, NULL))
+  {
+    ms_log (2, "Cannot open SQLite database: %s\n", sqlite3_errmsg (dbconn));
+    sqlite3_close (dbconn);
+    return 1;
+  }
+  else if (sqlitebusyto && sqlite3_busy_timeout (dbconn, (int)sqlitebusyto))
+  {
+    ms_log (2, "Cannot set busy timeout on SQLite database: %s\n", sqlite3_errmsg (dbconn));
+    sqlite3_close (dbconn);
+    return 1;
+  }
+
+  if (!strcmp (outputfile, "-"))
+  {
+    output = stdout;
+  }
+  else if (!(output = fopen (outputfile, "wb")))
+  {
+    ms_log (2, "Cannot open output file %s: %s\n", outputfile, strerror (errno));
+    memindex_disconnect (&client);
+    sqlite3_close (dbconn);
+    return 1;
+  }
+
+  if (availmode)
+    fprintf (output, (availmode == 1) ? "#Network Station Location Channel SampleRate Earliest Latest\n"
+                                      : "#Network Station Location Channel GapStart GapEnd Seconds\n");
+
+  memset (&plan, 0, sizeof (plan));
+
+  for (request = requests; request; request = request->next)
+  {
+    if (availmode)
+      rv = (tsindex_availability (dbconn, table, request, timetol, sampratetol,
+                                  WriteAvailability, output) < 0) ? -1 : 0;
+    else
+      rv = PlanRequest (dbconn, client, request, &plan);
+
+    if (rv)
+      break;
+  }
+
+  if (!rv && !availmode)
+    rv = FetchPlan (&plan, output);
+
+  tsindex_planfree (&plan);
+
+  CloseFile ();
+  memindex_disconnect (&client);
+  sqlite3_close (dbconn);
+  tsindex_freerequests (&requests);
+
+  if (output != stdout && fclose (output))
+  {
+    ms_log (2, "Cannot close output file %s: %s\n", outputfile, strerror (errno));
+    rv = -1;
+  }
+
+  if (verbose && !availmode)
+  {
+    ms_log (1, "Fetched %" PRId64 " records (%" PRId64 " bytes) from %" PRId64 " index rows\n",
+            totalrecords, totaloutputbytes, totalrows);
+    ms_log (1, "Read %" PRId64 " bytes for %" PRId64 " bytes of ranges in %" PRId64 " bytes of selected sections\n",
+            totalreadbytes, totalrangebytes, totalsectionbytes);
+  }
+
+  return (rv) ? 1 : 0;
+} /* End of main() */
+
+/***************************************************************************
+ * PlanRequest():
+ *
+ * Query the index, or the server if connected, for a request and add
+ * the byte ranges of the matching rows to the read plan.  The server
+ * determines the byte ranges of rows.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+PlanRequest (sqlite3 *dbconn, MemIndexClient *client,
+             const TSIndexRequest *request, TSIndexPlan *plan)
+{
+  TSIndexRow *rows = NULL;
+  int64_t *ranges = NULL;
+  int64_t rowcount;
+  int64_t idx;
+  int rv = 0;
+
+  if (client)
+    rowcount = memindex_remotequery (client, request, &rows, &ranges);
+  else
+    rowcount = tsindex_query (dbconn, table, request, &rows);
+
+  if (rowcount < 0)
+    return -1;
+
+  if (verbose >= 2)
+    ms_log (1, "Found %" PRId64 " index rows for %s_%s_%s_%s\n", rowcount,
+            request->network, request->station, request->location, request->channel);
+
+  for (idx = 0; idx < rowcount; idx++)
+  {
+    if (ranges)
+      rv = (tsindex_planrange (plan, rows[idx].filename, ranges[idx * 2], ranges[idx * 2 + 1],
+                               request->starttime, request->endtime)) ? -1 : 1;
+    else
+      rv = tsindex_planrow (plan, &rows[idx], request->starttime, request->endtime);
+
+    if (rv < 0)
+      break;
+
+    if (rv == 1)
+    {
+      totalrows++;
+      totalsectionbytes += rows[idx].bytes;
+      totalrangebytes += plan->ranges[plan->rangecount - 1].length;
+    }
+  }
+
+  tsindex_freerows (rows, rowcount);
+  free (ranges);
+
+  return (rv < 0) ? -1 : 0;
+} /* End of PlanRequest() */
+
+/***************************************************************************
+ * FetchPlan():
+ *
+ * Coalesce the planned ranges into reads and either write the reads
+ * to the output or perform them, extracting the selected records.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+FetchPlan (TSIndexPlan *plan, FILE *output)
+{
+  const TSIndexRead *read;
+  int64_t readcount;
+  int64_t idx;
+  int rv = 0;
+
+  if ((readcount = tsindex_planreads (plan, gapthreshold)) < 0)
+    return -1;
+
+  if (verbose)
+    ms_log (1, "Planned %" PRId64 " reads for %" PRId64 " byte ranges\n",
+            readcount, plan->rangecount);
+
+  for (idx = 0; idx < readcount && rv == 0; idx++)
+  {
+    read = &plan->reads[idx];
+
+    if (planonly)
+    {
+      if (fprintf (output, "%" PRId64 " %" PRId64 " %s\n", read->offset, read->length, read->filename) < 0)
+      {
+        ms_log (2, "Cannot write to %s: %s\n", outputfile, strerror (errno));
+        rv = -1;
+      }
+
+      continue;
+    }
+
+    if (verbose >= 2)
+      ms_log (1, "Reading %s@%" PRId64 ":%" PRId64 " for %" PRId64 " ranges\n",
+              read->filename, read->offset, read->length, read->rangecount);
+
+    if (OpenFile (read->filename))
+      return -1;
+
+    if (opencompressed)
+      rv = ExtractCompressedRead (plan, read, output);
+    else
+      rv = ExtractRead (plan, read, output);
+  }
+
+  return rv;
+} /* End of FetchPlan() */
+
+/***************************************************************************
+ * WriteAvailability():
+ *
+ * Write the merged availability extents, or gaps, of a channel to the
+ * output as text lines.  Called by tsindex_availability() for each
+ * channel.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+WriteAvailability (const TSIndexAvailability *availability, void *handlerdata)
+{
+  FILE *output = (FILE *)handlerdata;
+  const TSIndexSpan *spans;
+  char starttimestr[40];
+  char endtimestr[40];
+  int64_t count;
+  int64_t idx;
+
+  spans = (availmode == 1) ? availability->extents : availability->gaps;
+  count = (availmode == 1) ? availability->extentcount : availability->gapcount;
+
+  for (idx = 0; idx < count; idx++)
+  {
+    ms_nstime2timestr (spans[idx].start, starttimestr, ISOMONTHDAY_Z, NANO_MICRO_NONE);
+    ms_nstime2timestr (spans[idx].end, endtimestr, ISOMONTHDAY_Z, NANO_MICRO_NONE);
+
+    if (availmode == 1)
+      fprintf (output, "%s %s %s %s %.10g %s %s\n",
+               availability->network, availability->station,
+               (*availability->location) ? availability->location : "--",
+               availability->channel, spans[idx].samplerate, starttimestr, endtimestr);
+    else
+      fprintf (output, "%s %s %s %s %s %s %.6f\n",
+               availability->network, availability->station,
+               (*availability->location) ? availability->location : "--",
+               availability->channel, starttimestr, endtimestr,
+               (double)MS_NSTIME2EPOCH (spans[idx].end - spans[idx].start));
+  }
+
+  if (ferror (output))
+  {
+    ms_log (2, "Cannot write to %s: %s\n", outputfile, strerror (errno));
+    return -1;
+  }
+
+  return 0;
+} /* End of WriteAvailability() */
+
+/***************************************************************************
+ * ExtractRead():
+ *
+ * Perform a read of the open file with positioned reads and write the
+ * selected records to the output.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+ExtractRead (const TSIndexPlan *plan, const TSIndexRead *read, FILE *output)
+{
+  static char *buffer = NULL;
+  MS3Record *msr = NULL;
+  int64_t readoffset = read->offset;
+  int64_t remaining = read->length;
+  int64_t cursor = read->firstrange;
+  int64_t readcount;
+  size_t buflength = 0;
+  size_t bufpos;
+  size_t readsize;
+  int rv = 0;
+
+  if (!buffer && !(buffer = malloc (READBUFSIZE)))
+  {
+    ms_log (2, "Cannot allocate read buffer\n");
+    return -1;
+  }
+
+  while (remaining > 0 || buflength > 0)
+  {
+    /* Fill buffer with up to the remaining bytes of the range */
+    readsize = READBUFSIZE - buflength;
+    if ((int64_t)readsize > remaining)
+      readsize = (size_t)remaining;
+
+    if (readsize > 0)
+    {
+      if ((readcount = lmp_pread (openfp, buffer + buflength, readsize, readoffset)) < 0)
+      {
+        ms_log (2, "Cannot read %s at offset %" PRId64 ": %s\n", read->filename, readoffset, strerror (errno));
+        rv = -1;
+        break;
+      }
+
+      totalreadbytes += readcount;
+      buflength += (size_t)readcount;
+      readoffset += readcount;
+      remaining = (readcount < (int64_t)readsize) ? 0 : remaining - readcount;
+    }
+
+    /* Parse and write complete records in buffer */
+    bufpos = 0;
+    while (bufpos < buflength)
+    {
+      rv = msr3_parse (buffer + bufpos, buflength - bufpos, &msr, 0, 0);
+
+      if (rv > 0 && remaining > 0 && (bufpos > 0 || buflength < READBUFSIZE))
+      {
+        /* More data needed for this record, read more */
+        rv = 0;
+        break;
+      }
+      else if (rv != MS_NOERROR)
+      {
+        ms_log (2, "Cannot parse record in %s at offset %" PRId64 ": %s\n", read->filename,
+                readoffset - (int64_t)(buflength - bufpos),
+                (rv > 0) ? "truncated record" : ms_errorstr (rv));
+        rv = -1;
+        break;
+      }
+
+      if (SelectRecord (plan, read, &cursor, readoffset - (int64_t)(buflength - bufpos), msr) &&
+          WriteRecord (buffer + bufpos, msr->reclen, output))
+      {
+        rv = -1;
+        break;
+      }
+
+      bufpos += msr->reclen;
+    }
+
+    if (rv)
+      break;
+
+    /* Move partial record to beginning of buffer */
+    if (bufpos > 0 && bufpos < buflength)
+      memmove (buffer, buffer + bufpos, buflength - bufpos);
+    buflength -= bufpos;
+  }
+
+  msr3_free (&msr);
+
+  return rv;
+} /* End of ExtractRead() */
+
+/***************************************************************************
+ * ExtractCompressedRead():
+ *
+ * Perform a read of the uncompressed data in the open compressed file
+ * and write the selected records to the output.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+ExtractCompressedRead (const TSIndexPlan *plan, const TSIndexRead *read, FILE *output)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  char path[1100];
+  int64_t cursor = read->firstrange;
+  int retcode;
+  int rv = 0;
+
+  snprintf (path, sizeof (path), "%s@%" PRId64 "-%" PRId64, read->filename,
+            read->offset, read->offset + read->length - 1);
+
+  while ((retcode = ms3_readmsr_r (&msfp, &msr, path, MSF_PNAMERANGE, verbose - 2)) == MS_NOERROR)
+  {
+    totalreadbytes += msr->reclen;
+
+    if (SelectRecord (plan, read, &cursor, msfp->streampos - msr->reclen, msr) &&
+        WriteRecord (msr->record, msr->reclen, output))
+    {
+      rv = -1;
+      break;
+    }
+  }
+
+  if (rv == 0 && retcode != MS_ENDOFFILE)
+  {
+    ms_log (2, "Cannot read %s: %s\n", path, ms_errorstr (retcode));
+    rv = -1;
+  }
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  return rv;
+} /* End of ExtractCompressedRead() */
+
+/***************************************************************************
+ * SelectRecord():
+ *
+ * Determine if a record at a file offset is within a planned range of
+ * a read and contains data in the time window of the range.  Records
+ * are expected in offset order, 'cursor' tracks the first range of the
+ * read that may contain later records.
+ *
+ * Returns 1 if the record is selected, otherwise 0.
+ ***************************************************************************/
+static int
+SelectRecord (const TSIndexPlan *plan, const TSIndexRead *read, int64_t *cursor,
+              int64_t offset, const MS3Record *msr)
+{
+  const TSIndexRange *range;
+  int64_t last = read->firstrange + read->rangecount;
+  int64_t idx;
+  nstime_t endtime = NSTUNSET;
+
+  /* Skip ranges ending before the record */
+  while (*cursor < last &&
+         plan->ranges[*cursor].offset + plan->ranges[*cursor].length <= offset)
+    (*cursor)++;
+
+  for (idx = *cursor; idx < last && plan->ranges[idx].offset <= offset; idx++)
+  {
+    range = &plan->ranges[idx];
+
+    if (offset >= range->offset + range->length)
+      continue;
+
+    if (range->endtime != NSTUNSET && msr->starttime > range->endtime)
+      continue;
+
+    if (range->starttime != NSTUNSET)
+    {
+      if (endtime == NSTUNSET)
+        endtime = msr3_endtime (msr);
+
+      if (endtime < range->starttime)
+        continue;
+    }
+
+    return 1;
+  }
+
+  return 0;
+} /* End of SelectRecord() */
+
+/***************************************************************************
+ * WriteRecord():
+ *
+ * Write a record to the output.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+WriteRecord (const char *record, int reclen, FILE *output)
+{
+  if (fwrite (record, reclen, 1, output) != 1)
+  {
+    ms_log (2, "Cannot write to %s: %s\n", outputfile, strerror (errno));
+    return -1;
+  }
+
+  totalrecords++;
+  totaloutputbytes += reclen;
+
+  return 0;
+} /* End of WriteRecord() */
+
+/***************************************************************************
+ * OpenFile():
+ *
+ * Open a data file for reading unless it is already open and determine
+ * if it is gzip or zstd compressed.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+OpenFile (const char *filename)
+{
+  unsigned char magic[4];
+  int64_t magiclength;
+
+  if (openfilename && !strcmp (openfilename, filename))
+    return 0;
+
+  CloseFile ();
+
+  if (!(openfp = fopen (filename, "rb")))
+  {
+    ms_log (2, "Cannot open %s: %s\n", filename, strerror (errno));
+    return -1;
+  }
+
+  if (!(openfilename = strdup (filename)))
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    CloseFile ();
+    return -1;
+  }
+
+  /* Detect gzip or zstd compression by header magic */
+  magiclength = lmp_pread (openfp, magic, sizeof (magic), 0);
+
+  if (magiclength >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+  {
+    if (!libmseed_gzip_support ())
+    {
+      ms_log (2, "Cannot read %s, gzip support not included\n", filename);
+      CloseFile ();
+      return -1;
+    }
+
+    opencompressed = 1;
+  }
+  else if (magiclength == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+           magic[2] == 0x2f && magic[3] == 0xfd)
+  {
+    if (!libmseed_zstd_support ())
+    {
+      ms_log (2, "Cannot read %s, zstd support not included\n", filename);
+      CloseFile ();
+      return -1;
+    }
+
+    opencompressed = 1;
+  }
+
+  return 0;
+} /* End of OpenFile() */
+
+/***************************************************************************
+ * CloseFile():
+ *
+ * Close the currently open data file.
+ ***************************************************************************/
+static void
+CloseFile (void)
+{
+  if (openfp)
+    fclose (openfp);
+
+  free (openfilename);
+
+  openfp = NULL;
+  openfilename = NULL;
+  opencompressed = 0;
+} /* End of CloseFile() */
+
+/***************************************************************************
+ * ProcessParam():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+ProcessParam (int argcount, char **argvec)
+{
+  char *network = NULL;
+  char *station = NULL;
+  char *location = NULL;
+  char *channel = NULL;
+  nstime_t starttime = NSTUNSET;
+  nstime_t endtime = NSTUNSET;
+  int optind;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      Usage ();
+      exit (0);
+    }
+    else if (strncmp (argvec[optind], "-v", 2) == 0)
+    {
+      verbose += strspn (&argvec[optind][1], "v");
+    }
+    else if (strcmp (argvec[optind], "-N") == 0)
+    {
+      network = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-S") == 0)
+    {
+      station = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-L") == 0)
+    {
+      location = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-C") == 0)
+    {
+      channel = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-s") == 0)
+    {
+      starttime = GetOptTime (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-e") == 0)
+    {
+      endtime = GetOptTime (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-l") == 0)
+    {
+      char *listfile = GetOptValue (argcount, argvec, optind++);
+
+      if (tsindex_readrequestfile (&requests, listfile) < 0)
+      {
+        ms_log (2, "Cannot read request file: %s\n", listfile);
+        exit (1);
+      }
+    }
+    else if (strcmp (argvec[optind], "-o") == 0)
+    {
+      outputfile = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-gap") == 0)
+    {
+      gapthreshold = strtoll (GetOptValue (argcount, argvec, optind++), NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-plan") == 0)
+    {
+      planonly = 1;
+    }
+    else if (strcmp (argvec[optind], "-avail") == 0)
+    {
+      availmode = 1;
+    }
+    else if (strcmp (argvec[optind], "-gaps") == 0)
+    {
+      availmode = 2;
+    }
+    else if (strcmp (argvec[optind], "-tt") == 0)
+    {
+      timetol = strtod (GetOptValue (argcount, argvec, optind++), NULL);
+    }
+    else if (strcmp (argvec[optind], "-rt") == 0)
+    {
+      sampratetol = strtod (GetOptValue (argcount, argvec, optind++), NULL);
+    }
+    else if (strcmp (argvec[optind], "-socket") == 0)
+    {
+      socketpath = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-table") == 0)
+    {
+      table = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-sqlitebusyto") == 0)
+    {
+      sqlitebusyto = strtoul (GetOptValue (argcount, argvec, optind++), NULL, 10);
+    }
+    else if (strncmp (argvec[optind], "-", 1) == 0 &&
+             strlen (argvec[optind]) > 1)
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      exit (1);
+    }
+    else if (!sqlitefile)
+    {
+      sqlitefile = argvec[optind];
+    }
+    else
+    {
+      ms_log (2, "Unexpected argument: %s\n", argvec[optind]);
+      exit (1);
+    }
+  }
+
+  /* Add request specified as command line options */
+  if (network || station || location || channel ||
+      starttime != NSTUNSET || endtime != NSTUNSET)
+  {
+    if (tsindex_addrequest (&requests, network, station, location, channel, starttime, endtime))
+      exit (1);
+  }
+
+  if (!sqlitefile && !socketpath)
+  {
+    ms_log (2, "No database specified\n\n");
+    ms_log (1, "%s version %s\n\n", PACKAGE, VERSION);
+    ms_log (1, "Try %s -h for usage\n", PACKAGE);
+    exit (1);
+  }
+
+  if (availmode && socketpath)
+  {
+    ms_log (2, "Availability requires a database, not supported with -socket\n");
+    exit (1);
+  }
+
+  if (!requests)
+  {
+    ms_log (2, "No selection specified\n\n");
+    ms_log (1, "Try %s -h for usage\n", PACKAGE);
+    exit (1);
+  }
+
+  /* Report the program version */
+  if (verbose)
+    ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+
+  return 0;
+} /* End of ProcessParam() */
+
+/***************************************************************************
+ * GetOptValue:
+ * Return the value to a command line option; checking that the value is
+ * itself not an option (starting with '-') and is not past the end of
+ * the argument list.
+ *
+ * argcount: total arguments in argvec
+ * argvec: argument list
+ * argopt: index of option to process, value is expected to be at argopt+1
+ *
+ * Returns value on success and exits with error message on failure
+ ***************************************************************************/
+static char *
+GetOptValue (int argcount, char **argvec, int argopt)
+{
+  if (argvec == NULL || argvec[argopt] == NULL)
+  {
+    ms_log (2, "GetOptValue(): NULL option requested\n");
+    exit (1);
+    return 0;
+  }
+
+  /* Special cases of '-o -' usage and '-L --' location alias */
+  if ((argopt + 1) < argcount && strcmp (argvec[argopt], "-o") == 0)
+    if (strcmp (argvec[argopt + 1], "-") == 0)
+      return argvec[argopt + 1];
+  if ((argopt + 1) < argcount && strcmp (argvec[argopt], "-L") == 0)
+    if (strcmp (argvec[argopt + 1], "--") == 0)
+      return argvec[argopt + 1];
+
+  if ((argopt + 1) < argcount && *argvec[argopt + 1] != '-')
+    return argvec[argopt + 1];
+
+  ms_log (2, "Option %s requires a value, try -h for usage\n", argvec[argopt]);
+  exit (1);
+  return 0;
+} /* End of GetOptValue() */
+
+/***************************************************************************
+ * GetOptTime:
+ * Return the time value of a command line option, '*' is an open time.
+ *
+ * Returns time on success and exits with error message on failure
+ ***************************************************************************/
+static nstime_t
+GetOptTime (int argcount, char **argvec, int argopt)
+{
+  char *value = GetOptValue (argcount, argvec, argopt);
+  nstime_t time;
+
+  if (!strcmp (value, "*"))
+    return NSTUNSET;
+
+  if ((time = ms_timestr2nstime (value)) == NSTERROR)
+  {
+    ms_log (2, "Cannot convert time for %s: %s\n", argvec[argopt], value);
+    exit (1);
+  }
+
+  return time;
+} /* End of GetOptTime() */
+
+/***************************************************************************
+ * Usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+Usage (void)
+{
+  fprintf (stderr, "%s - Extract miniSEED using a time series index version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options] database\n", PACKAGE);
+  fprintf (stderr, "       %s [options] -socket path\n\n", PACKAGE);
+  fprintf (stderr,
+           " ## General options ##\n"
+           " -V             Report program version\n"
+           " -h             Show this usage message\n"
+           " -v             Be more verbose, multiple flags can be used\n"
+           "\n"
+           " ## Selection options ##\n"
+           " -N network     Network code, wildcards allowed\n"
+           " -S station     Station code, wildcards allowed\n"
+           " -L location    Location code, wildcards allowed, '--' for empty\n"
+           " -C channel     Channel code, wildcards allowed\n"
+           " -s start       Start time, YYYY-MM-DDThh:mm:ss.ffffff\n"
+           " -e end         End time, YYYY-MM-DDThh:mm:ss.ffffff\n"
+           " -l file        Read selections from file, lines of:\n"
+           "                  Network Station Location Channel StartTime EndTime\n"
+           "\n"
+           " ## Output options ##\n"
+           " -o file        Write output to file, default is standard output\n"
+           " -gap bytes     Coalesce byte ranges separated by up to bytes into one read\n"
+           " -plan          Write the planned reads (offset length file) instead of miniSEED\n"
+           " -avail         Write merged availability extents instead of miniSEED\n"
+           " -gaps          Write gaps between availability extents instead of miniSEED\n"
+           " -tt secs       Time tolerance for merging availability, default 1/2 sample period\n"
+           " -rt diff       Sample rate tolerance for merging availability\n"
+           "\n"
+           " -socket path   Query mseedindex-server on Unix domain socket path\n"
+           "                  instead of the database\n"
+           " -table   table Specify database table name, currently: %s\n"
+           " -sqlitebusyto msec   Set the SQLite busy timeout in milliseconds, currently: %lu\n"
+           "\n"
+           " database       SQLite database file containing the index\n"
+           "\n",
+           table, sqlitebusyto);
+} /* End of Usage() */
@@ -0,0 +1,841 @@
+/***************************************************************************
+ * mseedindex-server.c - Serve a time series index from memory.
+ *
+ * Load a time series index table from an SQLite database, as created
+ * by mseedindex, into a memory-resident index organized by channel and
+ * answer requests for the byte ranges of data for selections and time
+ * windows over a Unix domain socket.
+ *
+ * Rows of files are reloaded from the database when an update for a
+ * file is received, as sent by mseedindex when synchronizing files.
+ * See memindex.c for a description of the protocol.
+ *
+ * A benchmark mode compares the query time of the memory index with
+ * querying the database for the same selections.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libmseed.h>
+
+#include "memindex.h"
+#include "tsindex.h"
+
+#define VERSION "1.0"
+#define PACKAGE "mseedindex-server"
+
+/* Maximum number of concurrent client connections */
+#define MAXCLIENTS 64
+
+/* Maximum length of a request line */
+#define MAXLINE 4096
+
+/* A client connection and its partially received request */
+typedef struct Client
+{
+  int fd;
+  size_t length;
+  char line[MAXLINE];
+} Client;
+
+static flag verbose = 0;
+static char *table = "tsindex";
+static char *sqlitefile = NULL;
+static char *socketpath = NULL;
+static unsigned long sqlitebusyto = 10000;
+static long benchcount = 0;
+static TSIndexRequest *requests = NULL;
+
+static sqlite3 *dbconn = NULL;
+static MemIndex *memindex = NULL;
+static MemIndexResult *results = NULL;
+static int64_t resultmax = 0;
+
+/* Response buffer */
+static char *response = NULL;
+static size_t responselength = 0;
+static size_t responsemax = 0;
+
+static volatile sig_atomic_t shutdownsig = 0;
+
+static int Serve (void);
+static int HandleLine (Client *client, char *line);
+static int HandleQuery (char *arguments);
+static int HandleUpdate (char *arguments);
+static int Respond (const char *format, ...);
+static int SendResponse (Client *client);
+static int Benchmark (void);
+static int64_t NowNS (void);
+static int CompareResults (const void *a, const void *b);
+static void TermHandler (int sig);
+static int ProcessParam (int argcount, char **argvec);
+static char *GetOptValue (int argcount, char **argvec, int argopt);
+static nstime_t GetOptTime (int argcount, char **argvec, int argopt);
+static void Usage (void);
+
+int
+main (int argc, char **argv)
+{
+  struct sigaction sa;
+  int64_t rowcount;
+  int64_t loadtime;
+  int rv;
+
+  /* Set default error message prefix */
+  ms_loginit (NULL, NULL, NULL, "ERROR: ");
+
+  /* Process given parameters (command line and parameter file) */
+  if (ProcessParam (argc, argv) < 0)
+    return 1;
+
+  /* Signal handling, stop serving on termination signals, ignore broken connections */
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_handler = TermHandler;
+  sigemptyset (&sa.sa_mask);
+  sigaction (SIGINT, &sa, NULL);
+  sigaction (SIGTERM, &sa, NULL);
+  sa.sa_handler = SIG_IGN;
+  sigaction (SIGPIPE, &sa, NULL);
+
+  if (sqlite3_open_v2 (sqlitefile, &dbconn, SQLITE_OPEN_READONLY, NULL))
+  {
+    ms_log (2, "Cannot open SQLite database: %s\n", sqlite3_errmsg (dbconn));
+    sqlite3_close (dbconn);
+    return 1;
+  }
+
+  if (sqlitebusyto && sqlite3_busy_timeout (dbconn, (int)sqlitebusyto))
+  {
+    ms_log (2, "Cannot set busy timeout on SQLite database: %s\n", sqlite3_errmsg (dbconn));
+    sqlite3_close (dbconn);
+    return 1;
+  }
+
+  if (!(memindex = memindex_init ()))
+  {
+    sqlite3_close (dbconn);
+    return 1;
+  }
+
+  loadtime = NowNS ();
+
+  if ((rowcount = memindex_load (memindex, dbconn, table)) < 0)
+  {
+    ms_log (2, "Cannot load index from table %s\n", table);
+    memindex_free (&memindex);
+    sqlite3_close (dbconn);
+    return 1;
+  }
+
+  loadtime = NowNS () - loadtime;
+
+  if (verbose)
+    ms_log (1, "Loaded %" PRId64 " rows for %" PRId64 " channels in %.3f seconds\n",
+            rowcount, memindex->channelcount, (double)loadtime / NSTMODULUS);
+
+  if (benchcount > 0)
+    rv = Benchmark ();
+  else
+    rv = Serve ();
+
+  memindex_free (&memindex);
+  sqlite3_close (dbconn);
+  tsindex_freerequests (&requests);
+  free (results);
+  free (response);
+
+  return (rv) ? 1 : 0;
+} /* End of main() */
+
+/***************************************************************************
+ * Serve():
+ *
+ * Listen on the Unix domain socket and handle requests from clients
+ * until a termination signal is received.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+Serve (void)
+{
+  struct sockaddr_un addr;
+  struct pollfd pfds[MAXCLIENTS + 1];
+  Client clients[MAXCLIENTS];
+  Client *client;
+  ssize_t received;
+  char *newline;
+  char *line;
+  int listenfd;
+  int clientcount = 0;
+  int idx;
+  int fd;
+
+  if (strlen (socketpath) >= sizeof (addr.sun_path))
+  {
+    ms_log (2, "Socket path is too long: %s\n", socketpath);
+    return -1;
+  }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, socketpath);
+
+  /* Remove a stale socket from a previous instance */
+  unlink (socketpath);
+
+  if ((listenfd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      bind (listenfd, (struct sockaddr *)&addr, sizeof (addr)) ||
+      listen (listenfd, 16))
+  {
+    ms_log (2, "Cannot listen on %s: %s\n", socketpath, strerror (errno));
+    if (listenfd >= 0)
+      close (listenfd);
+    return -1;
+  }
+
+  if (verbose)
+    ms_log (1, "Listening on %s\n", socketpath);
+
+  while (!shutdownsig)
+  {
+    pfds[0].fd = listenfd;
+    pfds[0].events = (clientcount < MAXCLIENTS) ? POLLIN : 0;
+    for (idx = 0; idx < clientcount; idx++)
+    {
+      pfds[idx + 1].fd = clients[idx].fd;
+      pfds[idx + 1].events = POLLIN;
+    }
+
+    if (poll (pfds, clientcount + 1, 1000) <= 0)
+      continue;
+
+    /* Handle client requests, closing connections on end-of-file or error */
+    for (idx = clientcount - 1; idx >= 0; idx--)
+    {
+      if (!pfds[idx + 1].revents)
+        continue;
+
+      client = &clients[idx];
+
+      received = recv (client->fd, client->line + client->length,
+                       sizeof (client->line) - 1 - client->length, 0);
+
+      if (received > 0)
+      {
+        client->length += received;
+        client->line[client->length] = '\0';
+
+        /* Handle each complete line */
+        line = client->line;
+        while ((newline = strchr (line, '\n')))
+        {
+          *newline = '\0';
+
+          if (HandleLine (client, line))
+            break;
+
+          line = newline + 1;
+        }
+
+        if (!newline)
+        {
+          client->length -= line - client->line;
+          memmove (client->line, line, client->length + 1);
+
+          if (client->length < sizeof (client->line) - 1)
+            continue;
+
+          ms_log (1, "Request line too long, closing connection\n");
+        }
+      }
+
+      close (client->fd);
+      clients[idx] = clients[--clientcount];
+    }
+
+    if (pfds[0].revents & POLLIN)
+    {
+      if ((fd = accept (listenfd, NULL, NULL)) < 0)
+        continue;
+
+      clients[clientcount].fd = fd;
+      clients[clientcount].length = 0;
+      clientcount++;
+
+      if (verbose >= 2)
+        ms_log (1, "Accepted connection, %d clients\n", clientcount);
+    }
+  }
+
+  for (idx = 0; idx < clientcount; idx++)
+    close (clients[idx].fd);
+
+  close (listenfd);
+  unlink (socketpath);
+
+  if (verbose)
+    ms_log (1, "Shutting down\n");
+
+  return 0;
+} /* End of Serve() */
+
+/***************************************************************************
+ * HandleLine():
+ *
+ * Handle a request line from a client and send the response.
+ *
+ * Returns 0 on success, and -1 on failure to send the response
+ ***************************************************************************/
+static int
+HandleLine (Client *client, char *line)
+{
+  char *arguments;
+  int64_t start = NowNS ();
+
+  responselength = 0;
+
+  if ((arguments = strchr (line, ' ')))
+    *arguments++ = '\0';
+  else
+    arguments = "";
+
+  if (!strcmp (line, "QUERY"))
+    HandleQuery (arguments);
+  else if (!strcmp (line, "UPDATE"))
+    HandleUpdate (arguments);
+  else
+    Respond ("ERROR Unrecognized request: %s\n", line);
+
+  if (verbose >= 2)
+    ms_log (1, "%s %s: %.1f microseconds\n", line, arguments,
+            (double)(NowNS () - start) / 1000.0);
+
+  return SendResponse (client);
+} /* End of HandleLine() */
+
+/***************************************************************************
+ * HandleQuery():
+ *
+ * Query the memory index and add the results to the response, rows
+ * are returned in file and offset order for sequential reading.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+HandleQuery (char *arguments)
+{
+  TSIndexRequest *request = NULL;
+  const MemIndexResult *result;
+  char network[64];
+  char station[64];
+  char location[64];
+  char channel[64];
+  char starttimestr[64];
+  char endtimestr[64];
+  nstime_t starttime = NSTUNSET;
+  nstime_t endtime = NSTUNSET;
+  int64_t resultcount;
+  int64_t idx;
+
+  if (sscanf (arguments, "%63s %63s %63s %63s %63s %63s", network, station, location,
+              channel, starttimestr, endtimestr) != 6)
+    return Respond ("ERROR Cannot parse query: %s\n", arguments);
+
+  if (strcmp (starttimestr, "*"))
+    starttime = strtoll (starttimestr, NULL, 10);
+  if (strcmp (endtimestr, "*"))
+    endtime = strtoll (endtimestr, NULL, 10);
+
+  if (tsindex_addrequest (&request, network, station, location, channel, starttime, endtime))
+    return Respond ("ERROR Cannot parse selection: %s\n", arguments);
+
+  resultcount = memindex_query (memindex, request, &results, &resultmax);
+  tsindex_freerequests (&request);
+
+  if (resultcount < 0)
+    return Respond ("ERROR Cannot query index\n");
+
+  if (resultcount > 1)
+    qsort (results, resultcount, sizeof (MemIndexResult), CompareResults);
+
+  for (idx = 0; idx < resultcount; idx++)
+  {
+    result = &results[idx];
+
+    if (Respond ("ROW %s %s %s %s %d %" PRId64 " %" PRId64 " %.10g %" PRId64 " %" PRId64
+                 " %" PRId64 " %" PRId64 " %s\n",
+                 result->channel->network, result->channel->station,
+                 (*result->channel->location) ? result->channel->location : "--",
+                 result->channel->channel, result->row->version,
+                 (int64_t)result->row->starttime, (int64_t)result->row->endtime,
+                 result->row->samplerate, result->row->byteoffset, result->row->bytes,
+                 result->offset, result->length, result->row->file->name))
+      return -1;
+  }
+
+  return Respond ("END %" PRId64 "\n", resultcount);
+} /* End of HandleQuery() */
+
+/***************************************************************************
+ * HandleUpdate():
+ *
+ * Reload the rows of a file from the database.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+HandleUpdate (char *arguments)
+{
+  int64_t rowcount;
+
+  if (!*arguments)
+    return Respond ("ERROR No file specified for update\n");
+
+  if ((rowcount = memindex_updatefile (memindex, dbconn, table, arguments)) < 0)
+    return Respond ("ERROR Cannot update %s\n", arguments);
+
+  if (verbose)
+    ms_log (1, "Updated %" PRId64 " rows for %s\n", rowcount, arguments);
+
+  return Respond ("OK %" PRId64 "\n", rowcount);
+} /* End of HandleUpdate() */
+
+/***************************************************************************
+ * Respond():
+ *
+ * Add printf()-like formatted text to the response buffer.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+Respond (const char *format, ...)
+{
+  va_list argptr;
+  char *newresponse;
+  int length;
+
+  while (1)
+  {
+    va_start (argptr, format);
+    length = vsnprintf (response + responselength, responsemax - responselength, format, argptr);
+    va_end (argptr);
+
+    if (length < 0)
+      return -1;
+
+    if (responselength + length < responsemax)
+      break;
+
+    responsemax = (responsemax + length) * 2;
+
+    if (!(newresponse = realloc (response, responsemax)))
+    {
+      ms_log (2, "Cannot allocate memory for response\n");
+      responselength = 0;
+      responsemax = 0;
+      free (response);
+      response = NULL;
+      return -1;
+    }
+
+    response = newresponse;
+  }
+
+  responselength += length;
+
+  return 0;
+} /* End of Respond() */
+
+/***************************************************************************
+ * SendResponse():
+ *
+ * Send the response buffer to a client.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+SendResponse (Client *client)
+{
+  size_t sent = 0;
+  ssize_t rv;
+
+  while (sent < responselength)
+  {
+    if ((rv = send (client->fd, response + sent, responselength - sent, 0)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      if (verbose)
+        ms_log (1, "Cannot send response to client: %s\n", strerror (errno));
+      return -1;
+    }
+
+    sent += rv;
+  }
+
+  return 0;
+} /* End of SendResponse() */
+
+/***************************************************************************
+ * Benchmark():
+ *
+ * Run the requests a number of times against the memory index and
+ * against the database, determining byte ranges for each row, and
+ * report the average time per request.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+Benchmark (void)
+{
+  TSIndexRequest *request;
+  TSIndexRow *rows = NULL;
+  int64_t rowcount;
+  int64_t memoryrows = 0;
+  int64_t sqliterows = 0;
+  int64_t memorytime;
+  int64_t sqlitetime;
+  int64_t queries = 0;
+  int64_t offset;
+  int64_t length;
+  int64_t idx;
+  long iteration;
+
+  memorytime = NowNS ();
+  for (iteration = 0; iteration < benchcount; iteration++)
+  {
+    for (request = requests; request; request = request->next)
+    {
+      if ((rowcount = memindex_query (memindex, request, &results, &resultmax)) < 0)
+        return -1;
+
+      memoryrows += rowcount;
+      queries++;
+    }
+  }
+  memorytime = NowNS () - memorytime;
+
+  sqlitetime = NowNS ();
+  for (iteration = 0; iteration < benchcount; iteration++)
+  {
+    for (request = requests; request; request = request->next)
+    {
+      if ((rowcount = tsindex_query (dbconn, table, request, &rows)) < 0)
+        return -1;
+
+      for (idx = 0; idx < rowcount; idx++)
+        if (tsindex_byterange (&rows[idx], request->starttime, request->endtime, &offset, &length) == 1)
+          sqliterows++;
+
+      tsindex_freerows (rows, rowcount);
+    }
+  }
+  sqlitetime = NowNS () - sqlitetime;
+
+  ms_log (0, "Memory index: %" PRId64 " queries, %" PRId64 " rows, %.3f microseconds per query\n",
+          queries, memoryrows, (double)memorytime / queries / 1000.0);
+  ms_log (0, "SQLite index: %" PRId64 " queries, %" PRId64 " rows, %.3f microseconds per query\n",
+          queries, sqliterows, (double)sqlitetime / queries / 1000.0);
+
+  if (memorytime > 0)
+    ms_log (0, "Speedup: %.1fx\n", (double)sqlitetime / memorytime);
+
+  return 0;
+} /* End of Benchmark() */
+
+/***************************************************************************
+ * NowNS():
+ *
+ * Returns a monotonic time in nanoseconds.
+ ***************************************************************************/
+static int64_t
+NowNS (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+} /* End of NowNS() */
+
+/***************************************************************************
+ * CompareResults():
+ *
+ * Compare results by file name and byte offset for qsort().
+ ***************************************************************************/
+static int
+CompareResults (const void *a, const void *b)
+{
+  const MemIndexResult *resulta = (const MemIndexResult *)a;
+  const MemIndexResult *resultb = (const MemIndexResult *)b;
+  int cmp;
+
+  if (resulta->row->file != resultb->row->file &&
+      (cmp = strcmp (resulta->row->file->name, resultb->row->file->name)))
+    return cmp;
+
+  if (resulta->offset < resultb->offset)
+    return -1;
+  if (resulta->offset > resultb->offset)
+    return 1;
+
+  return 0;
+} /* End of CompareResults() */
+
+/***************************************************************************
+ * TermHandler():
+ * Signal handler routine.
+ ***************************************************************************/
+static void
+TermHandler (int sig)
+{
+  (void)sig;
+  shutdownsig = 1;
+} /* End of TermHandler() */
+
+/***************************************************************************
+ * ProcessParam():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+ProcessParam (int argcount, char **argvec)
+{
+  char *network = NULL;
+  char *station = NULL;
+  char *location = NULL;
+  char *channel = NULL;
+  nstime_t starttime = NSTUNSET;
+  nstime_t endtime = NSTUNSET;
+  int optind;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      Usage ();
+      exit (0);
+    }
+    else if (strncmp (argvec[optind], "-v", 2) == 0)
+    {
+      verbose += strspn (&argvec[optind][1], "v");
+    }
+    else if (strcmp (argvec[optind], "-socket") == 0)
+    {
+      socketpath = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-bench") == 0)
+    {
+      benchcount = strtol (GetOptValue (argcount, argvec, optind++), NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-N") == 0)
+    {
+      network = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-S") == 0)
+    {
+      station = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-L") == 0)
+    {
+      location = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-C") == 0)
+    {
+      channel = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-s") == 0)
+    {
+      starttime = GetOptTime (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-e") == 0)
+    {
+      endtime = GetOptTime (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-l") == 0)
+    {
+      char *listfile = GetOptValue (argcount, argvec, optind++);
+
+      if (tsindex_readrequestfile (&requests, listfile) < 0)
+      {
+        ms_log (2, "Cannot read request file: %s\n", listfile);
+        exit (1);
+      }
+    }
+    else if (strcmp (argvec[optind], "-table") == 0)
+    {
+      table = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-sqlitebusyto") == 0)
+    {
+      sqlitebusyto = strtoul (GetOptValue (argcount, argvec, optind++), NULL, 10);
+    }
+    else if (strncmp (argvec[optind], "-", 1) == 0 &&
+             strlen (argvec[optind]) > 1)
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      exit (1);
+    }
+    else if (!sqlitefile)
+    {
+      sqlitefile = argvec[optind];
+    }
+    else
+    {
+      ms_log (2, "Unexpected argument: %s\n", argvec[optind]);
+      exit (1);
+    }
+  }
+
+  /* Add request specified as command line options */
+  if (network || station || location || channel ||
+      starttime != NSTUNSET || endtime != NSTUNSET)
+  {
+    if (tsindex_addrequest (&requests, network, station, location, channel, starttime, endtime))
+      exit (1);
+  }
+
+  if (!sqlitefile)
+  {
+    ms_log (2, "No database specified\n\n");
+    ms_log (1, "%s version %s\n\n", PACKAGE, VERSION);
+    ms_log (1, "Try %s -h for usage\n", PACKAGE);
+    exit (1);
+  }
+
+  if (benchcount > 0 && !requests)
+  {
+    ms_log (2, "No selection specified for benchmark\n\n");
+    ms_log (1, "Try %s -h for usage\n", PACKAGE);
+    exit (1);
+  }
+
+  if (benchcount <= 0 && !socketpath)
+  {
+    ms_log (2, "No socket specified\n\n");
+    ms_log (1, "Try %s -h for usage\n", PACKAGE);
+    exit (1);
+  }
+
+  /* Report the program version */
+  if (verbose)
+    ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+
+  return 0;
+} /* End of ProcessParam() */
+
+/***************************************************************************
+ * GetOptValue:
+ * Return the value to a command line option; checking that the value is
+ * itself not an option (starting with '-') and is not past the end of
+ * the argument list.
+ *
+ * argcount: total arguments in argvec
+ * argvec: argument list
+ * argopt: index of option to process, value is expected to be at argopt+1
+ *
+ * Returns value on success and exits with error message on failure
+ ***************************************************************************/
+static char *
+GetOptValue (int argcount, char **argvec, int argopt)
+{
+  if (argvec == NULL || argvec[argopt] == NULL)
+  {
+    ms_log (2, "GetOptValue(): NULL option requested\n");
+    exit (1);
+    return 0;
+  }
+
+  /* Special case of '-L --' location alias */
+  if ((argopt + 1) < argcount && strcmp (argvec[argopt], "-L") == 0)
+    if (strcmp (argvec[argopt + 1], "--") == 0)
+      return argvec[argopt + 1];
+
+  if ((argopt + 1) < argcount && *argvec[argopt + 1] != '-')
+    return argvec[argopt + 1];
+
+  ms_log (2, "Option %s requires a value, try -h for usage\n", argvec[argopt]);
+  exit (1);
+  return 0;
+} /* End of GetOptValue() */
+
+/***************************************************************************
+ * GetOptTime:
+ * Return the time value of a command line option, '*' is an open time.
+ *
+ * Returns time on success and exits with error message on failure
+ ***************************************************************************/
+static nstime_t
+GetOptTime (int argcount, char **argvec, int argopt)
+{
+  char *value = GetOptValue (argcount, argvec, argopt);
+  nstime_t time;
+
+  if (!strcmp (value, "*"))
+    return NSTUNSET;
+
+  if ((time = ms_timestr2nstime (value)) == NSTERROR)
+  {
+    ms_log (2, "Cannot convert time for %s: %s\n", argvec[argopt], value);
+    exit (1);
+  }
+
+  return time;
+} /* End of GetOptTime() */
+
+/***************************************************************************
+ * Usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+Usage (void)
+{
+  fprintf (stderr, "%s - Serve a time series index from memory version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options] -socket path database\n", PACKAGE);
+  fprintf (stderr, "       %s [options] -bench count selection database\n\n", PACKAGE);
+  fprintf (stderr,
+           " ## General options ##\n"
+           " -V             Report program version\n"
+           " -h             Show this usage message\n"
+           " -v             Be more verbose, multiple flags can be used\n"
+           "\n"
+           " -socket path   Listen for requests on Unix domain socket path\n"
+           " -table   table Specify database table name, currently: %s\n"
+           " -sqlitebusyto msec   Set the SQLite busy timeout in milliseconds, currently: %lu\n"
+           "\n"
+           " ## Benchmark options ##\n"
+           " -bench count   Run selections count times against the memory index and\n"
+           "                  the database and report query times, then exit\n"
+           " -N network     Network code, wildcards allowed\n"
+           " -S station     Station code, wildcards allowed\n"
+           " -L location    Location code, wildcards allowed, '--' for empty\n"
+           " -C channel     Channel code, wildcards allowed\n"
+           " -s start       Start time, YYYY-MM-DDThh:mm:ss.ffffff\n"
+           " -e end         End time, YYYY-MM-DDThh:mm:ss.ffffff\n"
+           " -l file        Read selections from file, lines of:\n"
+           "                  Network Station Location Channel StartTime EndTime\n"
+           "\n"
+           " database       SQLite database file containing the index\n"
+           "\n",
+           table, sqlitebusyto);
+} /* End of Usage() */
@@ -91,6 +91,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -109,10 +110,15 @@
 #if defined(LMP_WIN)
 #define asprintf internal_asprintf
 #define vasprintf internal_vasprintf
+#else
+#include <unistd.h>
 #endif
 
 #include "md5.h"
+#include "memindex.h"
+#include "probes.h"
 #include "sha256.h"
+#include "stats.h"
 
 #define VERSION "3.0.5"
 #define PACKAGE "mseedindex"
@@ -122,13 +128,21 @@ static flag skipnotdata = 0;      /* Used to control skipping of non-miniSEED da
 static char keeppath = 0;         /* Use originally specified path, do not resolve absolute */
 static flag nosync = 0;           /* Control synchronization with database, 1 = no database */
 static flag noupdate = 0;         /* Control replacement of rows in database, 1 = no updating */
+static flag gzipindex = 0;        /* Write block indexes for BGZF compressed files */
 static int  subindex = 3600;      /* Interval (seconds) to create sub-index entries for a section */
+static int  maxsections = 10000;  /* Sections of a file kept in memory before spilling, 0 = unlimited */
+static MS3Selections *selections = NULL; /* Data selections, NULL means all data */
 
 static char *table = "tsindex";
 static char *pghost = NULL;
 static char *sqlitefile = NULL;
 static char *jsonfile = NULL;
 static unsigned long int sqlitebusyto = 10000;
+static char *notifysocket = NULL; /* Socket of index server to notify of SQLite updates */
+static flag statssummary = 0;     /* Print statistics summary at exit */
+static char *statsjson = NULL;    /* File to write statistics as JSON at exit */
+static char *metricsfile = NULL;  /* File to write OpenMetrics text during indexing and at exit */
+static double metricsinterval = 15.0; /* Minimum interval (seconds) between metrics writes */
 
 static char *dbport = "5432";
 static char *dbname = "timeseries";
@@ -161,6 +175,24 @@ struct sectiondetails
   MS3TraceList *spans;
 };
 
+/* Header of a section in the spill file, followed by the time index
+ * entries and the time spans of the section */
+struct spillheader
+{
+  char sid[LM_SIDLEN];
+  uint8_t pubversion;
+  struct sectiondetails sd;
+  int64_t indexcount;
+  int64_t spancount;
+};
+
+struct spillspan
+{
+  nstime_t starttime;
+  nstime_t endtime;
+  double samprate;
+};
+
 struct filelink
 {
   char *filename;
@@ -168,16 +200,26 @@ struct filelink
   time_t scantime;
   nstime_t earliest;
   nstime_t latest;
+  int format;           /* Format version of all sections, 0 if mixed, -1 if none */
   struct sha256_buff sha256state;
   char sha256str[65];
   int localpath;
+  int synced;     /* Number of databases synchronized with */
   MS3TraceList *mstl;
+  int64_t spilloffset;  /* Offset of the first spilled section in the spill file */
+  int64_t spillcount;   /* Number of spilled sections */
+  int64_t spillloaded;  /* Number of spilled sections loaded while iterating */
+  int64_t spillnext;    /* Offset of the next spilled section to load */
+  int64_t spillpos;     /* Offset of the loaded spilled section */
+  MS3TraceID *spilled;  /* Loaded spilled section */
   struct filelink *next;
 };
 
 struct filelink *filelist = NULL;
 struct filelink *filelisttail = NULL;
 
+static FILE *spillfp = NULL; /* Temporary file of spilled sections for all files */
+
 static double timetol = -1.0;     /* Time tolerance for continuous traces */
 static double sampratetol = -1.0; /* Sample rate tolerance for continuous traces */
 static MS3Tolerance tolerance = { .time = NULL, .samprate = NULL };
@@ -185,6 +227,12 @@ double timetol_callback (const MS3Record *msr) { return timetol; }
 double samprate_callback (const MS3Record *msr) { return sampratetol; }
 
 struct timeindex *AddTimeIndex (struct timeindex **tindex, nstime_t time, int64_t byteoffset);
+static void FinishSection (struct filelink *flp, struct sectiondetails *sd, int64_t *mark);
+static void FreeSection (MS3TraceID *secid);
+static int SpillSections (struct filelink *flp, MS3TraceID *keep, int64_t *mark);
+static MS3TraceID *NextSection (struct filelink *flp, MS3TraceID *secid);
+static int SpillUpdate (struct filelink *flp, MS3TraceID *secid);
+static int AddSourcesWhere (struct filelink *flp, char **where);
 #ifdef WITHPOSTGRESQL
 static int SyncPostgres (void);
 static int SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp);
@@ -192,11 +240,15 @@ static PGresult *PQuery (PGconn *pgdb, const char *format, ...);
 #endif
 static int SyncSQLite (void);
 static int SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp);
+static int SQLiteMatchSpilled (sqlite3 *dbconn, struct filelink *flp, const char *filewhere);
 static int SQLiteExec (sqlite3 *dbconn, int (*callback) (void *, int, char **, char **),
                        void *callbackdata, char **errmsg, const char *format, ...);
 static int SQLitePrepare (sqlite3 *dbconn, sqlite3_stmt **statement, const char *format, ...);
+static int WriteJSON (FILE *fp, const char *fragment, int indent);
 static int OutputJSON (const char *filename);
-static void local_mstl_printtracelist (MS3TraceList *mstl, flag timeformat);
+static void local_mstl_printtracelist (struct filelink *flp, flag timeformat);
+static void WriteMetrics (int force);
+static void ExitMetrics (void);
 static int ProcessParam (int argcount, char **argvec);
 static char *GetOptValue (int argcount, char **argvec, int argopt);
 static int AddFile (char *filename);
@@ -223,6 +275,7 @@ main (int argc, char **argv)
 
   int64_t filepos = 0;
   int64_t nextfilepos = 0;
+  int64_t mark;
 
   /* Set default error message prefix */
   ms_loginit (NULL, NULL, NULL, "ERROR: ");
@@ -245,7 +298,28 @@ main (int argc, char **argv)
   if (skipnotdata)
     flags |= MSF_SKIPNOTDATA;
 
+  indexstats.enabled = (statssummary || statsjson || metricsfile) ? 1 : 0;
+
+  /* Track file modification times for the age of unindexed files and write
+   * metrics at exit, including exits on errors */
+  if (metricsfile)
+  {
+    indexstats.starttime = time (NULL);
+
+    for (flp = filelist; flp; flp = flp->next)
+    {
+      indexstats.filesqueued++;
+
+      if (flp->localpath && stat (flp->filename, &st) == 0)
+        flp->filemodtime = st.st_mtime;
+    }
+
+    WriteMetrics (1);
+    atexit (ExitMetrics);
+  }
+
   /* Read files and accumulate indexing details */
+  stats_stagestart ();
   flp = filelist;
   while (flp)
   {
@@ -266,6 +340,7 @@ main (int argc, char **argv)
       if (stat (flp->filename, &st))
       {
         ms_log (2, "Could not stat %s: %s\n", flp->filename, strerror (errno));
+        indexstats.errors[STATS_ERR_READ]++;
         exit (1);
       }
 
@@ -275,14 +350,23 @@ main (int argc, char **argv)
     secid = NULL;
     nextfilepos = 0;
     prevstarttime = NSTERROR;
+    mark = stats_mark ();
+
+    PROBE_FILE_OPEN (flp->filename);
 
     /* Read records from the input file */
-    while ((retcode = ms3_readmsr_r (&msfp, &msr, flp->filename,
-                                   flags, verbose - 2)) == MS_NOERROR)
+    while ((retcode = ms3_readmsr_selection (&msfp, &msr, flp->filename,
+                                             flags, selections, verbose - 2)) == MS_NOERROR)
     {
+      stats_phase (STATS_READ, &mark);
+      indexstats.records++;
+      indexstats.bytes += msr->reclen;
+
       filepos = msfp->streampos - msr->reclen;
       endtime = msr3_endtime (msr);
 
+      PROBE_RECORD_PARSED (msr->sid, msr->reclen, filepos);
+
       /* Update details of current section if record matches ID, version and is next in the file */
       if (secid &&
           strcmp (secid->sid, msr->sid) == 0 &&
@@ -333,10 +417,13 @@ main (int argc, char **argv)
             exit (1);
           }
         }
+        stats_phase (STATS_SPANS, &mark);
 
         md5_append (&(sd->digeststate), (const md5_byte_t *)msr->record, msr->reclen);
+        stats_phase (STATS_MD5, &mark);
 
         sha256_update (&(flp->sha256state), msr->record, msr->reclen);
+        stats_phase (STATS_SHA256, &mark);
       }
       /* Otherwise create a new section ID */
       else
@@ -358,8 +445,14 @@ main (int argc, char **argv)
           secid->next[0] = newsecid;
         }
 
+        if (secid)
+          PROBE_SECTION_END (secid->sid, ((struct sectiondetails *)secid->prvtptr)->startoffset,
+                             ((struct sectiondetails *)secid->prvtptr)->endoffset);
+        PROBE_SECTION_START (msr->sid, filepos);
+
         secid = newsecid;
         flp->mstl->numtraceids++;
+        indexstats.sections++;
 
         strncpy (secid->sid, msr->sid, sizeof (secid->sid));
         secid->pubversion = msr->pubversion;
@@ -411,80 +504,116 @@ main (int argc, char **argv)
             exit (1);
           }
         }
+        stats_phase (STATS_SPANS, &mark);
 
         /* Initialize MD5 calculation state */
         memset (&(sd->digeststate), 0, sizeof (md5_state_t));
         md5_init (&(sd->digeststate));
         md5_append (&(sd->digeststate), (const md5_byte_t *)msr->record, msr->reclen);
+        stats_phase (STATS_MD5, &mark);
 
         sha256_update (&(flp->sha256state), msr->record, msr->reclen);
+        stats_phase (STATS_SHA256, &mark);
+
+        /* Spill the completed sections to limit memory for files with many sections */
+        if (maxsections && flp->mstl->numtraceids > (uint32_t)maxsections)
+        {
+          if (SpillSections (flp, secid, &mark))
+            exit (1);
+        }
       }
 
       nextfilepos = filepos + msr->reclen;
       prevstarttime = msr->starttime;
     } /* Done reading records */
 
+    stats_phase (STATS_READ, &mark);
+
+    if (secid)
+      PROBE_SECTION_END (secid->sid, ((struct sectiondetails *)secid->prvtptr)->startoffset,
+                         ((struct sectiondetails *)secid->prvtptr)->endoffset);
+    PROBE_FILE_CLOSE (flp->filename, flp->mstl->numtraceids, (msfp) ? msfp->streampos : 0);
+
     /* Print error if not EOF */
     if (retcode != MS_ENDOFFILE)
     {
       ms_log (2, "Cannot read %s: %s\n", flp->filename, ms_errorstr (retcode));
-      ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+      ms3_readmsr_selection (&msfp, &msr, NULL, 0, NULL, 0);
+      indexstats.errors[STATS_ERR_READ]++;
       exit (1);
     }
 
+    /* Write block index for compressed file, index offsets are in the uncompressed data */
+    if (gzipindex && msfp->input.type == LMIO_GZIP)
+    {
+      char indexpath[1024];
+
+      snprintf (indexpath, sizeof (indexpath), "%s.gzi", flp->filename);
+
+      if (ms3_gzip_writeindex (msfp, indexpath))
+      {
+        ms_log (1, "Cannot write block index for %s\n", flp->filename);
+        indexstats.errors[STATS_ERR_OUTPUT]++;
+      }
+      else if (verbose)
+        ms_log (1, "Wrote block index %s\n", indexpath);
+    }
+
     /* Make sure everything is cleaned up */
-    ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+    ms3_readmsr_selection (&msfp, &msr, NULL, 0, NULL, 0);
 
     /* Print sections for verbose output */
     if (verbose >= 2)
     {
       ms_log (1, "Section list to synchronize for %s\n", flp->filename);
-      local_mstl_printtracelist (flp->mstl, 1);
+      local_mstl_printtracelist (flp, 1);
     }
 
+    indexstats.files++;
+    WriteMetrics (0);
+
     flp = flp->next;
   } /* End of looping over file list for reading */
 
+  stats_stageend (STATS_SCAN);
+
   /* Create all MD5 and SHA-256 digest strings and track file extents */
+  stats_stagestart ();
+  mark = stats_mark ();
   flp = filelist;
   while (flp)
   {
-    md5_byte_t digest[16];
-
-    secid = filelist->mstl->traces.next[0];
+    /* Spilled sections were finished when spilled */
+    secid = flp->mstl->traces.next[0];
     while (secid)
     {
       if ((sd = (struct sectiondetails *)secid->prvtptr))
-      {
-        /* Calculate section-level MD5 digest and create string representation */
-        md5_finish (&(sd->digeststate), digest);
-        for (int idx = 0; idx < 16; idx++)
-          sprintf (sd->digeststr + (idx * 2), "%02x", digest[idx]);
-
-        /* Determine earliest and latest times for the file */
-        if (flp->earliest == NSTERROR || flp->earliest > sd->earliest)
-          flp->earliest = sd->earliest;
-        if (flp->latest == NSTERROR || flp->latest < sd->latest)
-          flp->latest = sd->latest;
-      }
+        FinishSection (flp, sd, &mark);
 
       secid = secid->next[0];
     }
 
     /* Calculate file-level SHA-256 and create string representation */
     sha256_finalize (&(flp->sha256state));
+    stats_phase (STATS_SHA256, &mark);
+
     sha256_read_hex (&(flp->sha256state), flp->sha256str);
+    stats_phase (STATS_STRINGS, &mark);
 
     flp = flp->next;
   }
 
+  stats_stageend (STATS_DIGEST);
+
   /* Synchronize details with database */
+  stats_stagestart ();
   if (!nosync)
   {
 #ifdef WITHPOSTGRESQL
     if (pghost && SyncPostgres ())
     {
       ms_log (2, "Error synchronizing with Postgres\n");
+      indexstats.errors[STATS_ERR_DATABASE]++;
       exit (1);
     }
 #endif
@@ -492,13 +621,31 @@ main (int argc, char **argv)
     if (sqlitefile && SyncSQLite ())
     {
       ms_log (2, "Error synchronizing with SQLite\n");
+      indexstats.errors[STATS_ERR_DATABASE]++;
       exit (1);
     }
   }
 
+  stats_stageend (STATS_SYNC);
+
+  stats_stagestart ();
+  mark = stats_mark ();
   if (jsonfile && OutputJSON (jsonfile))
   {
     ms_log (2, "Error writing JSON to %s\n", jsonfile);
+    indexstats.errors[STATS_ERR_OUTPUT]++;
+    exit (1);
+  }
+  if (jsonfile)
+    stats_phase (STATS_JSON, &mark);
+  stats_stageend (STATS_OUTPUT);
+
+  if (statssummary)
+    stats_print ();
+
+  if (statsjson && stats_writejson (statsjson))
+  {
+    indexstats.errors[STATS_ERR_OUTPUT]++;
     exit (1);
   }
 
@@ -552,6 +699,480 @@ AddTimeIndex (struct timeindex **tindex, nstime_t time, int64_t byteoffset)
   return nindex;
 } /* End of AddTimeIndex */
 
+/***************************************************************************
+ * FinishSection():
+ *
+ * Finish the MD5 digest of a section and create the string
+ * representation, and track the time extents and format version of
+ * the file.
+ ***************************************************************************/
+static void
+FinishSection (struct filelink *flp, struct sectiondetails *sd, int64_t *mark)
+{
+  md5_byte_t digest[16];
+
+  /* Calculate section-level MD5 digest and create string representation */
+  md5_finish (&(sd->digeststate), digest);
+  stats_phase (STATS_MD5, mark);
+
+  for (int idx = 0; idx < 16; idx++)
+    sprintf (sd->digeststr + (idx * 2), "%02x", digest[idx]);
+  stats_phase (STATS_STRINGS, mark);
+
+  /* Determine earliest and latest times for the file */
+  if (flp->earliest == NSTERROR || flp->earliest > sd->earliest)
+    flp->earliest = sd->earliest;
+  if (flp->latest == NSTERROR || flp->latest < sd->latest)
+    flp->latest = sd->latest;
+
+  /* Track format version: all one version, mixed or unknown */
+  if (flp->format == -1)
+    flp->format = sd->format;
+  else if (flp->format != sd->format)
+    flp->format = 0;
+} /* End of FinishSection() */
+
+/***************************************************************************
+ * FreeSection():
+ *
+ * Free a section ID and the associated section details.
+ ***************************************************************************/
+static void
+FreeSection (MS3TraceID *secid)
+{
+  struct sectiondetails *sd;
+  struct timeindex *tindex;
+  struct timeindex *nextindex;
+
+  if (!secid)
+    return;
+
+  if ((sd = (struct sectiondetails *)secid->prvtptr))
+  {
+    for (tindex = sd->tindex; tindex; tindex = nextindex)
+    {
+      nextindex = tindex->next;
+      free (tindex);
+    }
+
+    if (sd->spans)
+      mstl3_free (&sd->spans, 0);
+
+    free (sd);
+  }
+
+  free (secid);
+} /* End of FreeSection() */
+
+/***************************************************************************
+ * SpillSections():
+ *
+ * Write all sections of a file except the current section to the
+ * spill file and free them, limiting the memory used for files with
+ * many sections.  The sections are finished before writing and are
+ * loaded again by NextSection() in the original order.
+ *
+ * The spill file is created on first use in the directory specified
+ * by the TMPDIR environment variable, or /tmp, and removed
+ * immediately so that nothing is left behind.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+SpillSections (struct filelink *flp, MS3TraceID *keep, int64_t *mark)
+{
+  struct spillheader header;
+  struct spillspan span;
+  struct sectiondetails *sd;
+  struct timeindex *tindex;
+  MS3TraceID *secid;
+  MS3TraceID *nextsecid;
+  MS3TraceID *id;
+  MS3TraceSeg *seg;
+  int64_t spilled = 0;
+
+  if (!flp || !flp->mstl)
+    return -1;
+
+  if (!spillfp)
+  {
+#if defined(LMP_WIN)
+    spillfp = tmpfile ();
+#else
+    char spillpath[PATH_MAX];
+    const char *tmpdir = getenv ("TMPDIR");
+    int fd;
+
+    snprintf (spillpath, sizeof (spillpath), "%s/%s-spill-XXXXXX",
+              (tmpdir && *tmpdir) ? tmpdir : "/tmp", PACKAGE);
+
+    if ((fd = mkstemp (spillpath)) >= 0)
+    {
+      unlink (spillpath);
+
+      if (!(spillfp = fdopen (fd, "w+b")))
+        close (fd);
+    }
+#endif
+
+    if (!spillfp)
+    {
+      ms_log (2, "Cannot create spill file: %s\n", strerror (errno));
+      return -1;
+    }
+
+    if (verbose >= 2)
+      ms_log (1, "Created spill file for sections\n");
+  }
+
+  /* Sections are always appended, the sections of a file are contiguous */
+  if (lmp_fseek64 (spillfp, 0, SEEK_END))
+  {
+    ms_log (2, "Cannot seek in spill file: %s\n", strerror (errno));
+    return -1;
+  }
+
+  if (flp->spillcount == 0)
+    flp->spilloffset = lmp_ftell64 (spillfp);
+
+  secid = flp->mstl->traces.next[0];
+  while (secid)
+  {
+    nextsecid = secid->next[0];
+
+    if (secid == keep || !(sd = (struct sectiondetails *)secid->prvtptr))
+    {
+      secid = nextsecid;
+      continue;
+    }
+
+    FinishSection (flp, sd, mark);
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.sid, secid->sid, sizeof (header.sid));
+    header.pubversion = secid->pubversion;
+    header.sd = *sd;
+
+    for (tindex = sd->tindex; tindex; tindex = tindex->next)
+      header.indexcount++;
+
+    for (id = (sd->spans) ? sd->spans->traces.next[0] : NULL; id; id = id->next[0])
+      for (seg = id->first; seg; seg = seg->next)
+        header.spancount++;
+
+    if (fwrite (&header, sizeof (header), 1, spillfp) != 1)
+      goto writeerror;
+
+    for (tindex = sd->tindex; tindex; tindex = tindex->next)
+      if (fwrite (tindex, sizeof (struct timeindex), 1, spillfp) != 1)
+        goto writeerror;
+
+    for (id = (sd->spans) ? sd->spans->traces.next[0] : NULL; id; id = id->next[0])
+    {
+      for (seg = id->first; seg; seg = seg->next)
+      {
+        span.starttime = seg->starttime;
+        span.endtime = seg->endtime;
+        span.samprate = seg->samprate;
+
+        if (fwrite (&span, sizeof (span), 1, spillfp) != 1)
+          goto writeerror;
+      }
+    }
+
+    FreeSection (secid);
+    flp->spillcount++;
+    spilled++;
+
+    secid = nextsecid;
+  }
+
+  /* Only the current section remains in memory */
+  flp->mstl->traces.next[0] = keep;
+  flp->mstl->numtraceids = (keep) ? 1 : 0;
+  if (keep)
+    keep->next[0] = NULL;
+
+  indexstats.spilled += spilled;
+  stats_phase (STATS_SPILL, mark);
+
+  if (verbose >= 2)
+    ms_log (1, "Spilled %lld sections of %s\n", (long long int)spilled, flp->filename);
+
+  return 0;
+
+writeerror:
+  ms_log (2, "Cannot write to spill file: %s\n", strerror (errno));
+  return -1;
+} /* End of SpillSections() */
+
+/***************************************************************************
+ * LoadSection():
+ *
+ * Read the next spilled section of a file from the spill file.
+ *
+ * Returns a new section ID on success, and NULL on failure
+ ***************************************************************************/
+static MS3TraceID *
+LoadSection (struct filelink *flp)
+{
+  struct spillheader header;
+  struct spillspan span;
+  struct sectiondetails *sd;
+  struct timeindex *tindex;
+  struct timeindex *lastindex = NULL;
+  MS3TraceID *secid;
+  MS3TraceID *id = NULL;
+  MS3TraceSeg *seg;
+  int64_t idx;
+
+  if (lmp_fseek64 (spillfp, flp->spillnext, SEEK_SET) ||
+      fread (&header, sizeof (header), 1, spillfp) != 1)
+  {
+    ms_log (2, "Cannot read section from spill file\n");
+    return NULL;
+  }
+
+  if (!(secid = calloc (1, sizeof (MS3TraceID))) ||
+      !(sd = malloc (sizeof (struct sectiondetails))))
+  {
+    ms_log (2, "Cannot allocate section, out of memory?\n");
+    free (secid);
+    return NULL;
+  }
+
+  memcpy (secid->sid, header.sid, sizeof (secid->sid));
+  secid->pubversion = header.pubversion;
+  secid->earliest = header.sd.earliest;
+  secid->latest = header.sd.latest;
+  secid->prvtptr = sd;
+
+  *sd = header.sd;
+  sd->tindex = NULL;
+  sd->spans = NULL;
+
+  for (idx = 0; idx < header.indexcount; idx++)
+  {
+    if (!(tindex = malloc (sizeof (struct timeindex))) ||
+        fread (tindex, sizeof (struct timeindex), 1, spillfp) != 1)
+    {
+      ms_log (2, "Cannot read time index from spill file\n");
+      free (tindex);
+      FreeSection (secid);
+      return NULL;
+    }
+
+    tindex->next = NULL;
+
+    if (lastindex)
+      lastindex->next = tindex;
+    else
+      sd->tindex = tindex;
+
+    lastindex = tindex;
+  }
+
+  /* Time spans are restored as the segments of a single trace ID */
+  if (header.spancount > 0)
+  {
+    if (!(sd->spans = mstl3_init (NULL)) ||
+        !(id = libmseed_memory.malloc (sizeof (MS3TraceID))))
+    {
+      ms_log (2, "Cannot allocate span list, out of memory?\n");
+      FreeSection (secid);
+      return NULL;
+    }
+
+    memset (id, 0, sizeof (MS3TraceID));
+    memcpy (id->sid, secid->sid, sizeof (id->sid));
+    id->pubversion = secid->pubversion;
+    id->height = 1;
+
+    sd->spans->traces.next[0] = id;
+    sd->spans->numtraceids = 1;
+  }
+
+  for (idx = 0; idx < header.spancount; idx++)
+  {
+    if (fread (&span, sizeof (span), 1, spillfp) != 1 ||
+        !(seg = libmseed_memory.malloc (sizeof (MS3TraceSeg))))
+    {
+      ms_log (2, "Cannot read time span from spill file\n");
+      FreeSection (secid);
+      return NULL;
+    }
+
+    memset (seg, 0, sizeof (MS3TraceSeg));
+    seg->starttime = span.starttime;
+    seg->endtime = span.endtime;
+    seg->samprate = span.samprate;
+    seg->prev = id->last;
+
+    if (id->last)
+      id->last->next = seg;
+    else
+      id->first = seg;
+
+    id->last = seg;
+    id->numsegments++;
+
+    if (idx == 0 || seg->starttime < id->earliest)
+      id->earliest = seg->starttime;
+    if (idx == 0 || seg->endtime > id->latest)
+      id->latest = seg->endtime;
+  }
+
+  flp->spillpos = flp->spillnext;
+  flp->spillnext = lmp_ftell64 (spillfp);
+
+  return secid;
+} /* End of LoadSection() */
+
+/***************************************************************************
+ * NextSection():
+ *
+ * Iterate over all sections of a file, starting with a NULL section:
+ * first the spilled sections, loaded one at a time, then the sections
+ * in memory.  A loaded section is freed by the next call.
+ *
+ * The program exits if a spilled section cannot be loaded.
+ *
+ * Returns the next section, or NULL when no sections remain
+ ***************************************************************************/
+static MS3TraceID *
+NextSection (struct filelink *flp, MS3TraceID *secid)
+{
+  int wasspilled = 0;
+
+  if (!secid)
+  {
+    flp->spillloaded = 0;
+    flp->spillnext = flp->spilloffset;
+  }
+
+  if (flp->spilled)
+  {
+    wasspilled = (secid == flp->spilled);
+    FreeSection (flp->spilled);
+    flp->spilled = NULL;
+  }
+
+  if (flp->spillloaded < flp->spillcount)
+  {
+    if (!(flp->spilled = LoadSection (flp)))
+      exit (1);
+
+    flp->spillloaded++;
+
+    return flp->spilled;
+  }
+
+  if (!secid || wasspilled)
+    return flp->mstl->traces.next[0];
+
+  return secid->next[0];
+} /* End of NextSection() */
+
+/***************************************************************************
+ * SpillUpdate():
+ *
+ * Write the update time of a section back to the spill file if it is
+ * the loaded spilled section, so that it is retained when the section
+ * is loaded again.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+SpillUpdate (struct filelink *flp, MS3TraceID *secid)
+{
+  struct sectiondetails *sd;
+
+  if (!secid || secid != flp->spilled)
+    return 0;
+
+  sd = (struct sectiondetails *)secid->prvtptr;
+
+  if (lmp_fseek64 (spillfp, flp->spillpos + offsetof (struct spillheader, sd.updated), SEEK_SET) ||
+      fwrite (&sd->updated, sizeof (sd->updated), 1, spillfp) != 1)
+  {
+    ms_log (2, "Cannot write to spill file: %s\n", strerror (errno));
+    return -1;
+  }
+
+  return 0;
+} /* End of SpillUpdate() */
+
+/***************************************************************************
+ * AddSourcesWhere():
+ *
+ * Add a condition to a WHERE clause limiting it to the network,
+ * station, location and channel values of the sections of a file.
+ * Used with data selections so that rows of sources not selected
+ * are retained.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+AddSourcesWhere (struct filelink *flp, char **where)
+{
+  MS3TraceID *secid = NULL;
+  char *sources = NULL;
+  char *combined = NULL;
+  char network[11];
+  char station[11];
+  char location[11];
+  char channel[11];
+  char tmpstring[100];
+  int rv = 0;
+
+  if (!flp || !where || !*where)
+    return -1;
+
+  /* Collect the unique sources of all sections */
+  while ((secid = NextSection (flp, secid)))
+  {
+    if (ms_sid2nslc (secid->sid, network, station, location, channel))
+    {
+      ms_log (2, "Cannot parse NSLC from source ID: %s\n", secid->sid);
+      rv = -1;
+      break;
+    }
+
+    snprintf (tmpstring, sizeof (tmpstring), "('%s','%s','%s','%s')",
+              network, station, location, channel);
+
+    if (sources && strstr (sources, tmpstring))
+      continue;
+
+    if (AddToString (&sources, tmpstring, ",", 0, 8388608))
+    {
+      ms_log (2, "Cannot allocate memory for sources (%s)\n", flp->filename);
+      rv = -1;
+      break;
+    }
+  }
+
+  if (rv == 0 && sources)
+  {
+    if (asprintf (&combined, "%s AND (network,station,location,channel) IN (%s)",
+                  *where, sources) <= 0 || !combined)
+    {
+      ms_log (2, "Cannot allocate memory for WHERE sources clause (%s)\n", flp->filename);
+      rv = -1;
+    }
+    else
+    {
+      free (*where);
+      *where = combined;
+    }
+  }
+
+  if (sources)
+    free (sources);
+
+  return rv;
+} /* End of AddSourcesWhere() */
+
 #ifdef WITHPOSTGRESQL
 /***************************************************************************
  * SyncPostgres():
@@ -566,6 +1187,7 @@ SyncPostgres (void)
   PGconn *dbconn = NULL; /* Database connection */
   PGresult *result = NULL;
   struct filelink *flp = NULL;
+  int64_t mark = stats_mark ();
   const char *keywords[7];
   const char *values[7];
 
@@ -622,7 +1244,9 @@ SyncPostgres (void)
   }
 
   /* Set session timezone to 'UTC' */
+  PROBE_DB_START ("SET SESSION timezone TO 'UTC'");
   result = PQexec (dbconn, "SET SESSION timezone TO 'UTC'");
+  PROBE_DB_END (PQresultStatus (result));
   if (PQresultStatus (result) != PGRES_COMMAND_OK)
   {
     ms_log (2, "Pg SET SESSION timezone failed: %s", PQerrorMessage (dbconn));
@@ -634,6 +1258,8 @@ SyncPostgres (void)
   if (verbose)
     ms_log (1, "Set database session timezone to UTC\n");
 
+  stats_phase (STATS_DBQUERY, &mark);
+
   /* Synchronize indexing details with database */
   flp = filelist;
   while (flp)
@@ -646,6 +1272,9 @@ SyncPostgres (void)
       return -1;
     }
 
+    flp->synced++;
+    WriteMetrics (0);
+
     flp = flp->next;
   } /* End of looping over file list for synchronization */
 
@@ -692,6 +1321,7 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
   char *vp;
   char *ep = NULL;
   double version = -1.0;
+  int64_t mark = stats_mark ();
 
   if (!flp)
     return -1;
@@ -716,6 +1346,14 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
       ms_log (1, "Parsed version %g from %s\n", version, flp->filename);
   }
 
+  /* Leave existing rows untouched for files without selected data */
+  if (selections && flp->mstl->numtraceids == 0 && flp->spillcount == 0)
+  {
+    if (verbose)
+      ms_log (0, "No selected data in %s, skipping\n", flp->filename);
+    return 0;
+  }
+
   if (flp->earliest == NSTERROR || flp->latest == NSTERROR)
   {
     ms_log (2, "No time extents found for %s\n", flp->filename);
@@ -753,6 +1391,13 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
         return -1;
       }
 
+      /* Limit to sources of selected data, retaining rows of other sources */
+      if (selections && AddSourcesWhere (flp, &filewhere))
+      {
+        free (filewhere);
+        return -1;
+      }
+
       if (verbose >= 2)
         ms_log (1, "Searching for rows matching '%s'\n", flp->filename);
 
@@ -777,53 +1422,69 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
         ms_log (1, "Found %d matching rows\n", matchcount);
 
       /* Retain previous updated value if hash is the same by searching
-         for matching values (hash,NSLCV) and storing previous update time. */
+         for matching values (hash,NSLCV) and storing previous update time.
+         Sections are visited once, spilled sections are loaded one at a time. */
       if (matchcount > 0)
       {
-        /* Fields: 0=network,1=station,2=location,3=channel,4=version,5=hash,6=updated */
-        for (idx = 0; idx < matchcount; idx++)
+        secid = NULL;
+        while ((secid = NextSection (flp, secid)))
         {
-          secid = flp->mstl->traces.next[0];
-          while (secid)
+          char network[11];
+          char station[11];
+          char location[11];
+          char channel[11];
+          time_t updated;
+
+          if (!(sd = (struct sectiondetails *)secid->prvtptr))
+            continue;
+
+          /* Parse NSLC components from source ID */
+          if (ms_sid2nslc (secid->sid, network, station, location, channel))
           {
-            if ((sd = (struct sectiondetails *)secid->prvtptr))
-            {
-              char *pvp = PQgetvalue (matchresult, idx, 4); /* Pointer to a int16_t, aka smallint */
-              char network[11];
-              char station[11];
-              char location[11];
-              char channel[11];
+            if (filewhere)
+              free (filewhere);
+            return -1;
+          }
 
-              /* Parse NSLC components from source ID */
-              if (ms_sid2nslc (secid->sid, network, station, location, channel))
-              {
-                if (filewhere)
-                  free (filewhere);
-                return -1;
-              }
+          updated = sd->updated;
 
-              if (!strcmp (sd->digeststr, PQgetvalue (matchresult, idx, 5)))
-                if (secid->pubversion == *pvp)
-                  if (!strcmp (channel, PQgetvalue (matchresult, idx, 3)))
-                    if (!strcmp (location, PQgetvalue (matchresult, idx, 2)))
-                      if (!strcmp (station, PQgetvalue (matchresult, idx, 1)))
-                        if (!strcmp (network, PQgetvalue (matchresult, idx, 0)))
-                        {
-                          sd->updated = strtoll (PQgetvalue (matchresult, idx, 6), NULL, 10);
-                        }
-            }
+          /* Fields: 0=network,1=station,2=location,3=channel,4=version,5=hash,6=updated */
+          for (idx = 0; idx < matchcount; idx++)
+          {
+            char *pvp = PQgetvalue (matchresult, idx, 4); /* Pointer to a int16_t, aka smallint */
+
+            if (!strcmp (sd->digeststr, PQgetvalue (matchresult, idx, 5)))
+              if (secid->pubversion == *pvp)
+                if (!strcmp (channel, PQgetvalue (matchresult, idx, 3)))
+                  if (!strcmp (location, PQgetvalue (matchresult, idx, 2)))
+                    if (!strcmp (station, PQgetvalue (matchresult, idx, 1)))
+                      if (!strcmp (network, PQgetvalue (matchresult, idx, 0)))
+                      {
+                        sd->updated = strtoll (PQgetvalue (matchresult, idx, 6), NULL, 10);
+                      }
+          }
 
-            secid = secid->next[0];
+          if (sd->updated != updated && SpillUpdate (flp, secid))
+          {
+            PQclear (matchresult);
+            if (filewhere)
+              free (filewhere);
+            return -1;
           }
         }
       }
 
       PQclear (matchresult);
       matchresult = NULL;
+
+      indexstats.rowsmatched += matchcount;
+      stats_phase (STATS_DBQUERY, &mark);
     } /* if (noupdate) */
 
     /* Start a transaction block */
+    PROBE_DB_START ("BEGIN TRANSACTION");
     result = PQexec (dbconn, "BEGIN TRANSACTION");
+    PROBE_DB_END (PQresultStatus (result));
     if (PQresultStatus (result) != PGRES_COMMAND_OK)
     {
       ms_log (2, "Pg BEGIN TRANSACTION failed: %s", PQerrorMessage (dbconn));
@@ -846,15 +1507,17 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
           free (filewhere);
         return -1;
       }
+      indexstats.rowsdeleted += strtoll (PQcmdTuples (result), NULL, 10);
       PQclear (result);
     }
 
     free (filewhere);
+    stats_phase (STATS_DBWRITE, &mark);
   }
 
   /* Loop through trace list, synchronizing with database */
-  secid = flp->mstl->traces.next[0];
-  while (secid)
+  secid = NULL;
+  while ((secid = NextSection (flp, secid)))
   {
     char secnetwork[11];
     char secstation[11];
@@ -1004,6 +1667,7 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
         free (ratesstr);
       }
     } /* End if (sd->spans) */
+    stats_phase (STATS_STRINGS, &mark);
 
     if (dbconn)
     {
@@ -1040,6 +1704,9 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
         return -1;
       }
       PQclear (result);
+
+      indexstats.rowsinserted++;
+      stats_phase (STATS_DBWRITE, &mark);
     }
 
     /* Print trace line when verbose >=2 or when verbose and not sync'ing */
@@ -1070,15 +1737,17 @@ SyncPostgresFileSeries (PGconn *dbconn, struct filelink *flp)
       free (timeratesstr);
       timeratesstr = NULL;
     }
-
-    secid = secid->next[0];
   }
 
   /* End the transaction */
   if (dbconn)
   {
+    PROBE_DB_START ("COMMIT");
     result = PQexec (dbconn, "COMMIT");
+    PROBE_DB_END (PQresultStatus (result));
     PQclear (result);
+
+    stats_phase (STATS_DBCOMMIT, &mark);
   }
 
   return 0;
@@ -1112,7 +1781,9 @@ PQuery (PGconn *pgdb, const char *format, ...)
   if (verbose >= 2)
     fprintf (stderr, "QUERY(%d): '%s'\n", length, query);
 
+  PROBE_DB_START (query);
   result = PQexec (pgdb, query);
+  PROBE_DB_END (PQresultStatus (result));
 
   if (query)
     free (query);
@@ -1132,6 +1803,8 @@ static int
 SyncSQLite (void)
 {
   sqlite3 *dbconn = NULL;
+  MemIndexClient *client = NULL;
+  int64_t mark = stats_mark ();
   char *errmsg = NULL;
   struct filelink *flp = NULL;
   int rv;
@@ -1242,6 +1915,15 @@ SyncSQLite (void)
     return -1;
   }
 
+  stats_phase (STATS_DBQUERY, &mark);
+
+  /* Connect to index server, synchronization continues without notification on failure */
+  if (notifysocket && !(client = memindex_connect (notifysocket)))
+  {
+    ms_log (1, "Warning: cannot connect to index server, updates will not be sent\n");
+    indexstats.errors[STATS_ERR_NOTIFY]++;
+  }
+
   /* Synchronize indexing details with database */
   flp = filelist;
   while (flp)
@@ -1250,13 +1932,36 @@ SyncSQLite (void)
     if (SyncSQLiteFileSeries (dbconn, flp))
     {
       ms_log (2, "Error synchronizing time series for %s with SQLite\n", flp->filename);
+      memindex_disconnect (&client);
       sqlite3_close (dbconn);
       return -1;
     }
 
+    flp->synced++;
+
+    /* Notify index server of committed rows for file */
+    if (client)
+    {
+      if (memindex_remoteupdate (client, flp->filename) < 0)
+      {
+        ms_log (1, "Warning: cannot send update for %s to index server, updates will not be sent\n",
+                flp->filename);
+        memindex_disconnect (&client);
+        indexstats.errors[STATS_ERR_NOTIFY]++;
+      }
+      else if (verbose >= 2)
+      {
+        ms_log (1, "Sent update for %s to index server\n", flp->filename);
+      }
+    }
+
+    WriteMetrics (0);
+
     flp = flp->next;
   } /* End of looping over file list for synchronization */
 
+  memindex_disconnect (&client);
+
   if (verbose >= 2)
     ms_log (1, "Closing SQLite database %s\n", sqlitefile);
 
@@ -1300,10 +2005,10 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
   char *timeratesstr = NULL;
 
   int rv;
-  int idx;
   char *vp;
   char *ep = NULL;
   double version = -1.0;
+  int64_t mark = stats_mark ();
 
   if (!flp)
     return -1;
@@ -1328,6 +2033,14 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
       ms_log (1, "Parsed version %g from %s\n", version, flp->filename);
   }
 
+  /* Leave existing rows untouched for files without selected data */
+  if (selections && flp->mstl->numtraceids == 0 && flp->spillcount == 0)
+  {
+    if (verbose)
+      ms_log (0, "No selected data in %s, skipping\n", flp->filename);
+    return 0;
+  }
+
   if (flp->earliest == NSTERROR || flp->latest == NSTERROR)
   {
     ms_log (2, "No time extents found for %s\n", flp->filename);
@@ -1369,36 +2082,56 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
         return -1;
       }
 
+      /* Limit to sources of selected data, retaining rows of other sources */
+      if (selections && AddSourcesWhere (flp, &filewhere))
+      {
+        free (filewhere);
+        return -1;
+      }
+
       if (verbose >= 2)
         ms_log (1, "Searching for rows matching '%s'\n", flp->filename);
 
-      rv = SQLitePrepare (dbconn, &statement,
-                          "SELECT network,station,location,channel,version,hash,updated "
-                          "FROM %s "
-                          "WHERE %s",
-                          table, filewhere);
-      if (rv != SQLITE_OK)
+      /* Files with spilled sections are matched with a temporary table of the
+         rows, which avoids loading every section for each row */
+      if (flp->spillcount > 0)
       {
-        ms_log (2, "SQLite SELECT preparation failed: %s\n", sqlite3_errstr (rv));
-        if (filewhere)
+        if ((matchcount = SQLiteMatchSpilled (dbconn, flp, filewhere)) < 0)
+        {
           free (filewhere);
-        return -1;
+          return -1;
+        }
       }
-
-      /* Retain previous updated value if hash is the same by searching
-         for matching values (hash,NSLCV) and storing previous update time. */
-      matchcount = 0;
-      while ((rv = sqlite3_step (statement)) == SQLITE_ROW)
+      else
       {
-        matchcount++;
+        rv = SQLitePrepare (dbconn, &statement,
+                            "SELECT network,station,location,channel,version,hash,updated "
+                            "FROM %s "
+                            "WHERE %s",
+                            table, filewhere);
+        if (rv != SQLITE_OK)
+        {
+          ms_log (2, "SQLite SELECT preparation failed: %s\n", sqlite3_errstr (rv));
+          if (filewhere)
+            free (filewhere);
+          return -1;
+        }
 
-        /* Fields: 0=network,1=station,2=location,3=channel,4=version,5=hash,6=updated */
-        for (idx = 0; idx < matchcount; idx++)
+        /* Retain previous updated value if hash is the same by searching
+           for matching values (hash,NSLCV) and storing previous update time. */
+        matchcount = 0;
+        while ((rv = sqlite3_step (statement)) == SQLITE_ROW)
         {
+          matchcount++;
+
+          /* Fields: 0=network,1=station,2=location,3=channel,4=version,5=hash,6=updated */
           secid = flp->mstl->traces.next[0];
           while (secid)
           {
-            if ((sd = (struct sectiondetails *)secid->prvtptr))
+            /* Compare hash and version before parsing NSLC components */
+            if ((sd = (struct sectiondetails *)secid->prvtptr) &&
+                !strcmp (sd->digeststr, (char *)sqlite3_column_text (statement, 5)) &&
+                secid->pubversion == sqlite3_column_int (statement, 4))
             {
               nstime_t hpupdated;
               char network[11];
@@ -1409,46 +2142,50 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
               /* Parse NSLC components from source ID */
               if (ms_sid2nslc (secid->sid, network, station, location, channel))
               {
+                sqlite3_finalize (statement);
                 if (filewhere)
                   free (filewhere);
                 return -1;
               }
 
-              if (!strcmp (sd->digeststr, (char *)sqlite3_column_text (statement, 5)))
-                if (secid->pubversion == sqlite3_column_int (statement, 4))
-                  if (!strcmp (channel, (char *)sqlite3_column_text (statement, 3)))
-                    if (!strcmp (location, (char *)sqlite3_column_text (statement, 2)))
-                      if (!strcmp (station, (char *)sqlite3_column_text (statement, 1)))
-                        if (!strcmp (network, (char *)sqlite3_column_text (statement, 0)))
-                        {
-                          hpupdated = ms_timestr2nstime ((char *)sqlite3_column_text (statement, 6));
-
-                          if (hpupdated == NSTERROR)
-                          {
-                            ms_log (1, "Warning: could not convert 'updated' time value: '%s'\n",
-                                    sqlite3_column_text (statement, 6));
-                          }
-
-                          /* Convert to time_t with simple rounding */
-                          sd->updated = (double)MS_NSTIME2EPOCH (hpupdated) + 0.5;
-                        }
+              if (!strcmp (channel, (char *)sqlite3_column_text (statement, 3)))
+                if (!strcmp (location, (char *)sqlite3_column_text (statement, 2)))
+                  if (!strcmp (station, (char *)sqlite3_column_text (statement, 1)))
+                    if (!strcmp (network, (char *)sqlite3_column_text (statement, 0)))
+                    {
+                      hpupdated = ms_timestr2nstime ((char *)sqlite3_column_text (statement, 6));
+
+                      if (hpupdated == NSTERROR)
+                      {
+                        ms_log (1, "Warning: could not convert 'updated' time value: '%s'\n",
+                                sqlite3_column_text (statement, 6));
+                      }
+
+                      /* Convert to time_t with simple rounding */
+                      sd->updated = (double)MS_NSTIME2EPOCH (hpupdated) + 0.5;
+                    }
             }
 
             secid = secid->next[0];
           }
         }
-      }
 
-      if (rv != SQLITE_DONE)
-      {
-        ms_log (2, "Cannot step through SQLite results: %s\n", sqlite3_errstr (rv));
+        PROBE_DB_END (rv);
+
+        if (rv != SQLITE_DONE)
+        {
+          ms_log (2, "Cannot step through SQLite results: %s\n", sqlite3_errstr (rv));
+          sqlite3_finalize (statement);
+          if (filewhere)
+            free (filewhere);
+          return -1;
+        }
+
         sqlite3_finalize (statement);
-        if (filewhere)
-          free (filewhere);
-        return -1;
       }
 
-      sqlite3_finalize (statement);
+      indexstats.rowsmatched += matchcount;
+      stats_phase (STATS_DBQUERY, &mark);
 
       if (verbose >= 2)
         ms_log (1, "Found %d matching rows\n", matchcount);
@@ -1478,14 +2215,17 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
           free (filewhere);
         return -1;
       }
+
+      indexstats.rowsdeleted += sqlite3_changes (dbconn);
     }
 
     free (filewhere);
+    stats_phase (STATS_DBWRITE, &mark);
   }
 
   /* Loop through trace list, synchronizing with database */
-  secid = flp->mstl->traces.next[0];
-  while (secid)
+  secid = NULL;
+  while ((secid = NextSection (flp, secid)))
   {
     char secnetwork[11];
     char secstation[11];
@@ -1646,6 +2386,7 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
       ms_nstime2timestr (MS_EPOCH2NSTIME (flp->filemodtime), filemodtimestr, ISOMONTHDAY, NONE);
       ms_nstime2timestr (MS_EPOCH2NSTIME (sd->updated), updatedstr, ISOMONTHDAY, NONE);
       ms_nstime2timestr (MS_EPOCH2NSTIME (flp->scantime), scannedstr, ISOMONTHDAY, NONE);
+      stats_phase (STATS_STRINGS, &mark);
 
       /* Insert new row */
       rv = SQLiteExec (dbconn, NULL, NULL, &errmsg,
@@ -1678,6 +2419,9 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
         sqlite3_free (errmsg);
         return -1;
       }
+
+      indexstats.rowsinserted++;
+      stats_phase (STATS_DBWRITE, &mark);
     }
 
     /* Print trace line when verbose >=2 or when verbose and not sync'ing */
@@ -1709,8 +2453,6 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
       free (timeratesstr);
       timeratesstr = NULL;
     }
-
-    secid = secid->next[0];
   }
 
   /* End the transaction */
@@ -1723,11 +2465,157 @@ SyncSQLiteFileSeries (sqlite3 *dbconn, struct filelink *flp)
       sqlite3_free (errmsg);
       return -1;
     }
+
+    stats_phase (STATS_DBCOMMIT, &mark);
   }
 
   return 0;
 } /* End of SyncSQLiteFileSeries() */
 
+/***************************************************************************
+ * SQLiteMatchSpilled():
+ *
+ * Retain previous updated values for the sections of a file with
+ * spilled sections.  The rows matching the file are copied to a
+ * temporary table, indexed on hash, that is searched for each section
+ * while the sections are loaded one at a time.  As when searching for
+ * files without spilled sections, the last matching row is used.
+ *
+ * Returns the number of matching rows on success, and -1 on failure
+ ***************************************************************************/
+static int
+SQLiteMatchSpilled (sqlite3 *dbconn, struct filelink *flp, const char *filewhere)
+{
+  sqlite3_stmt *statement = NULL;
+  struct sectiondetails *sd;
+  MS3TraceID *secid = NULL;
+  char *errmsg = NULL;
+  int matchcount = 0;
+  int rv;
+
+  rv = SQLiteExec (dbconn, NULL, NULL, &errmsg,
+                   "DROP TABLE IF EXISTS temp.mseedindex_match;"
+                   "CREATE TEMP TABLE mseedindex_match AS "
+                   "SELECT network,station,location,channel,version,hash,updated "
+                   "FROM %s "
+                   "WHERE %s;"
+                   "CREATE INDEX temp.mseedindex_match_hash_idx ON mseedindex_match (hash)",
+                   table, filewhere);
+  if (rv != SQLITE_OK)
+  {
+    ms_log (2, "SQLite CREATE TEMP TABLE failed: %s\n", (errmsg) ? errmsg : "");
+    sqlite3_free (errmsg);
+    return -1;
+  }
+
+  rv = SQLitePrepare (dbconn, &statement, "SELECT count(*) FROM temp.mseedindex_match");
+  if (rv != SQLITE_OK)
+  {
+    ms_log (2, "SQLite SELECT preparation failed: %s\n", sqlite3_errstr (rv));
+    return -1;
+  }
+
+  if ((rv = sqlite3_step (statement)) == SQLITE_ROW)
+    matchcount = sqlite3_column_int (statement, 0);
+
+  PROBE_DB_END (rv);
+  sqlite3_finalize (statement);
+
+  if (rv != SQLITE_ROW)
+  {
+    ms_log (2, "Cannot count SQLite matching rows: %s\n", sqlite3_errstr (rv));
+    return -1;
+  }
+
+  if (matchcount > 0)
+  {
+    rv = SQLitePrepare (dbconn, &statement,
+                        "SELECT updated FROM temp.mseedindex_match "
+                        "WHERE hash=?1 AND version=?2 AND network=?3 AND station=?4 "
+                        "AND location=?5 AND channel=?6 "
+                        "ORDER BY rowid DESC LIMIT 1");
+    if (rv != SQLITE_OK)
+    {
+      ms_log (2, "SQLite SELECT preparation failed: %s\n", sqlite3_errstr (rv));
+      return -1;
+    }
+
+    while ((secid = NextSection (flp, secid)))
+    {
+      nstime_t hpupdated;
+      time_t updated;
+      char network[11];
+      char station[11];
+      char location[11];
+      char channel[11];
+
+      if (!(sd = (struct sectiondetails *)secid->prvtptr))
+        continue;
+
+      /* Parse NSLC components from source ID */
+      if (ms_sid2nslc (secid->sid, network, station, location, channel))
+      {
+        sqlite3_finalize (statement);
+        return -1;
+      }
+
+      sqlite3_bind_text (statement, 1, sd->digeststr, -1, SQLITE_STATIC);
+      sqlite3_bind_int (statement, 2, secid->pubversion);
+      sqlite3_bind_text (statement, 3, network, -1, SQLITE_STATIC);
+      sqlite3_bind_text (statement, 4, station, -1, SQLITE_STATIC);
+      sqlite3_bind_text (statement, 5, location, -1, SQLITE_STATIC);
+      sqlite3_bind_text (statement, 6, channel, -1, SQLITE_STATIC);
+
+      if ((rv = sqlite3_step (statement)) == SQLITE_ROW)
+      {
+        hpupdated = ms_timestr2nstime ((char *)sqlite3_column_text (statement, 0));
+
+        if (hpupdated == NSTERROR)
+        {
+          ms_log (1, "Warning: could not convert 'updated' time value: '%s'\n",
+                  sqlite3_column_text (statement, 0));
+        }
+
+        /* Convert to time_t with simple rounding */
+        updated = (double)MS_NSTIME2EPOCH (hpupdated) + 0.5;
+
+        if (updated != sd->updated)
+        {
+          sd->updated = updated;
+
+          if (SpillUpdate (flp, secid))
+          {
+            sqlite3_finalize (statement);
+            return -1;
+          }
+        }
+      }
+      else if (rv != SQLITE_DONE)
+      {
+        ms_log (2, "Cannot step through SQLite results: %s\n", sqlite3_errstr (rv));
+        PROBE_DB_END (rv);
+        sqlite3_finalize (statement);
+        return -1;
+      }
+
+      sqlite3_reset (statement);
+    }
+
+    PROBE_DB_END (SQLITE_DONE);
+    sqlite3_finalize (statement);
+  }
+
+  rv = SQLiteExec (dbconn, NULL, NULL, &errmsg, "DROP TABLE temp.mseedindex_match");
+  if (rv != SQLITE_OK)
+  {
+    ms_log (2, "SQLite DROP TABLE failed: %s\n", (errmsg) ? errmsg : "");
+    sqlite3_free (errmsg);
+    return -1;
+  }
+
+  return matchcount;
+} /* End of SQLiteMatchSpilled() */
+
 /***************************************************************************
  * SQLiteExec():
  *
@@ -1759,7 +2647,9 @@ SQLiteExec (sqlite3 *dbconn, int (*callback) (void *, int, char **, char **),
   if (verbose >= 2)
     fprintf (stderr, "QUERY(%d): '%s'\n", length, query);
 
+  PROBE_DB_START (query);
   rv = sqlite3_exec (dbconn, query, callback, callbackdata, errmsg);
+  PROBE_DB_END (rv);
 
   if (query)
     free (query);
@@ -1797,8 +2687,13 @@ SQLitePrepare (sqlite3 *dbconn, sqlite3_stmt **statement, const char *format, ..
   if (verbose >= 2)
     fprintf (stderr, "QUERY(%d): '%s'\n", length, query);
 
+  PROBE_DB_START (query);
   rv = sqlite3_prepare_v2 (dbconn, query, length + 1, statement, NULL);
 
+  /* The end of a prepared statement is probed by the caller after stepping */
+  if (rv != SQLITE_OK)
+    PROBE_DB_END (rv);
+
   if (query)
     free (query);
 
@@ -1806,12 +2701,50 @@ SQLitePrepare (sqlite3 *dbconn, sqlite3_stmt **statement, const char *format, ..
 } /* End of SQLitePrepare() */
 
 
+/***************************************************************************
+ * WriteJSON():
+ *
+ * Write a fragment of JSON to the output file and, if verbose, to
+ * stdout.  Every line break in the fragment is followed by indent
+ * spaces, to place a separately serialized pretty value at its depth
+ * in the document.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+WriteJSON (FILE *fp, const char *fragment, int indent)
+{
+  FILE *streams[2] = {fp, (verbose && fp != stdout) ? stdout : NULL};
+  const char *line;
+  const char *newline;
+
+  for (int idx = 0; idx < 2 && streams[idx]; idx++)
+  {
+    line = fragment;
+
+    while (indent && (newline = strchr (line, '\n')))
+    {
+      fwrite (line, 1, newline - line + 1, streams[idx]);
+      fprintf (streams[idx], "%*s", indent, "");
+      line = newline + 1;
+    }
+
+    fputs (line, streams[idx]);
+  }
+
+  return (ferror (fp)) ? -1 : 0;
+} /* End of WriteJSON() */
+
 /***************************************************************************
  * OutputJSON():
  *
  * Write index information to specified output file.  Can be '-' to
  * write output to stdout.
  *
+ * The document is written one file and one section at a time, with
+ * the same layout as serializing the complete document, so that
+ * memory use does not grow with the number of sections.
+ *
  * Returns 0 on success, and -1 on failure
  ***************************************************************************/
 static int
@@ -1823,25 +2756,26 @@ OutputJSON (const char *filename)
   struct sectiondetails *sd;
   MS3TraceID *secid = NULL;
   int64_t bytecount;
-  nstime_t earliest_ts = NSTUNSET;
-  nstime_t latest_ts = NSTUNSET;
   char start_string[64];
   char end_string[64];
   char pathmod[64];
   char updated[64];
   char scanned[64];
   char *formatstr;
-  int format = -1;
+  int pretty = (verbose > 0) ? 1 : 0;
+  int sections;
+  int rv = 0;
 
   struct timeindex *tindex;
 
-  yyjson_mut_doc *rootdoc = NULL;
-  yyjson_mut_val *root = NULL;
-  yyjson_mut_val *pathkey = NULL;
+  yyjson_mut_doc *doc = NULL;
   yyjson_mut_val *pathobj = NULL;
-  yyjson_mut_val *content_arr = NULL;
   yyjson_mut_val *content = NULL;
+  yyjson_write_flag flg = (pretty) ? YYJSON_WRITE_PRETTY_TWO_SPACES : YYJSON_WRITE_NOFLAG;
+  yyjson_write_err err;
+  size_t length;
 
+  char *pathkey = NULL;
   char *serialized = NULL;
 
   if (!filename)
@@ -1863,75 +2797,124 @@ OutputJSON (const char *filename)
     ms_log (1, "Opened JSON output file %s\n", filename);
   }
 
-  /* Init root container */
-  if ((rootdoc = yyjson_mut_doc_new (NULL)) == NULL ||
-      (root = yyjson_mut_obj (rootdoc)) == NULL)
-  {
-    ms_log (2, "Cannot create JSON document\n");
-    return -1;
-  }
-
-  /* Set the document's root value. */
-  yyjson_mut_doc_set_root (rootdoc, root);
+  rv = WriteJSON (fp, "{", 0);
 
   /* Create JSON representation of trace listing */
-  flp = filelist;
-  while (flp)
+  for (flp = filelist; flp && rv == 0; flp = flp->next)
   {
-    /* Add root key and object for path entry */
-    pathkey = yyjson_mut_strcpy (rootdoc, flp->filename);
-    pathobj = yyjson_mut_obj (rootdoc);
-    yyjson_mut_obj_add (root, pathkey, pathobj);
+    /* Create document of path-level entries, the content is written after them */
+    if ((doc = yyjson_mut_doc_new (NULL)) == NULL ||
+        (pathobj = yyjson_mut_obj (doc)) == NULL)
+    {
+      ms_log (2, "Cannot create JSON document\n");
+      rv = -1;
+      break;
+    }
+
+    yyjson_mut_doc_set_root (doc, pathobj);
+
+    /* Set path-level entries */
+    if (flp->format == 2)
+      formatstr = "application/vnd.fdsn.mseed;version=2";
+    else if (flp->format == 3)
+      formatstr = "application/vnd.fdsn.mseed;version=3";
+    else
+      formatstr = "application/vnd.fdsn.mseed";
+
+    yyjson_mut_ptr_add (pathobj, "/content_type", yyjson_mut_strcpy (doc, formatstr), doc);
+    yyjson_mut_ptr_add (pathobj, "/sha256", yyjson_mut_strcpy (doc, flp->sha256str), doc);
+
+    if (flp->filemodtime)
+    {
+      ms_nstime2timestr (MS_EPOCH2NSTIME (flp->filemodtime), pathmod, ISOMONTHDAY_Z, NONE);
+      yyjson_mut_ptr_add (pathobj, "/path_modtime", yyjson_mut_strcpy (doc, pathmod), doc);
+    }
+
+    ms_nstime2timestr (MS_EPOCH2NSTIME (flp->scantime), scanned, ISOMONTHDAY_Z, NONE);
+    yyjson_mut_ptr_add (pathobj, "/path_indextime", yyjson_mut_strcpy (doc, scanned), doc);
+
+    /* Time extents are not included when no data was selected */
+    if (flp->earliest != NSTERROR && flp->latest != NSTERROR)
+    {
+      ms_nstime2timestr (flp->earliest, start_string, ISOMONTHDAY_Z, NANO_MICRO);
+      ms_nstime2timestr (flp->latest, end_string, ISOMONTHDAY_Z, NANO_MICRO);
+
+      yyjson_mut_ptr_add (pathobj, "/start_string", yyjson_mut_strcpy (doc, start_string), doc);
+      yyjson_mut_ptr_add (pathobj, "/end_string", yyjson_mut_strcpy (doc, end_string), doc);
+      yyjson_mut_ptr_add (pathobj, "/start", yyjson_mut_sint (doc, flp->earliest), doc);
+      yyjson_mut_ptr_add (pathobj, "/end", yyjson_mut_sint (doc, flp->latest), doc);
+    }
+
+    pathkey = yyjson_mut_val_write (yyjson_mut_strcpy (doc, flp->filename), YYJSON_WRITE_NOFLAG, NULL);
+    serialized = yyjson_mut_write_opts (doc, flg, NULL, &length, &err);
+    yyjson_mut_doc_free (doc);
 
-    content_arr = yyjson_mut_arr (rootdoc);
+    if (pathkey == NULL || serialized == NULL)
+    {
+      ms_log (2, "Cannot serialize JSON to string: %s\n",
+              (serialized == NULL && err.msg) ? err.msg : "Unknown error");
+      free (pathkey);
+      free (serialized);
+      rv = -1;
+      break;
+    }
+
+    /* Remove the closing brace of the path object to continue with the content array */
+    serialized[--length] = '\0';
+    if (pretty && length > 0 && serialized[length - 1] == '\n')
+      serialized[--length] = '\0';
+
+    if (flp != filelist)
+      rv |= WriteJSON (fp, ",", 0);
+
+    rv |= WriteJSON (fp, (pretty) ? "\n  " : "", 0);
+    rv |= WriteJSON (fp, pathkey, 0);
+    rv |= WriteJSON (fp, (pretty) ? ": " : ":", 0);
+    rv |= WriteJSON (fp, serialized, 2);
+    rv |= WriteJSON (fp, (pretty) ? ",\n    \"content\": [" : ",\"content\":[", 0);
+
+    free (pathkey);
+    free (serialized);
 
     /* Generate content entries */
-    secid = flp->mstl->traces.next[0];
-    while (secid)
+    sections = 0;
+    secid = NULL;
+    while (rv == 0 && (secid = NextSection (flp, secid)))
     {
       sd = (struct sectiondetails *)secid->prvtptr;
 
       bytecount = sd->endoffset - sd->startoffset + 1;
 
-      /* Track format version: all one version, a mixed, or unknonwn */
-      if (format == -1)
-      {
-        format = sd->format;
-      }
-      else if (format != sd->format)
+      /* Create and populate content array object entry */
+      if ((doc = yyjson_mut_doc_new (NULL)) == NULL ||
+          (content = yyjson_mut_obj (doc)) == NULL)
       {
-        format = 0; /* Mixed or unknown */
+        ms_log (2, "Cannot create JSON document\n");
+        rv = -1;
+        break;
       }
 
-      /* Track earliest and latest times at path level */
-      if (earliest_ts == NSTUNSET || sd->earliest < earliest_ts)
-        earliest_ts = sd->earliest;
-
-      if (latest_ts == NSTUNSET || sd->latest > latest_ts)
-        latest_ts = sd->latest;
-
-      /* Create and populate content array object entry */
-      content = yyjson_mut_obj (rootdoc);
+      yyjson_mut_doc_set_root (doc, content);
 
-      yyjson_mut_ptr_add (content, "/source_id", yyjson_mut_strcpy (rootdoc, secid->sid), rootdoc);
+      yyjson_mut_ptr_add (content, "/source_id", yyjson_mut_strcpy (doc, secid->sid), doc);
 
       /* Create start and end and other time strings */
       ms_nstime2timestr (sd->earliest, start_string, ISOMONTHDAY_Z, NANO_MICRO);
       ms_nstime2timestr (sd->latest, end_string, ISOMONTHDAY_Z, NANO_MICRO);
       ms_nstime2timestr (MS_EPOCH2NSTIME(sd->updated), updated, ISOMONTHDAY_Z, NONE);
 
-      yyjson_mut_ptr_add (content, "/start_string", yyjson_mut_strcpy (rootdoc, start_string), rootdoc);
-      yyjson_mut_ptr_add (content, "/end_string", yyjson_mut_strcpy (rootdoc, end_string), rootdoc);
-      yyjson_mut_ptr_add (content, "/start", yyjson_mut_sint (rootdoc, sd->earliest), rootdoc);
-      yyjson_mut_ptr_add (content, "/end", yyjson_mut_sint (rootdoc, sd->latest), rootdoc);
-      yyjson_mut_ptr_add (content, "/updated", yyjson_mut_strcpy (rootdoc, updated), rootdoc);
+      yyjson_mut_ptr_add (content, "/start_string", yyjson_mut_strcpy (doc, start_string), doc);
+      yyjson_mut_ptr_add (content, "/end_string", yyjson_mut_strcpy (doc, end_string), doc);
+      yyjson_mut_ptr_add (content, "/start", yyjson_mut_sint (doc, sd->earliest), doc);
+      yyjson_mut_ptr_add (content, "/end", yyjson_mut_sint (doc, sd->latest), doc);
+      yyjson_mut_ptr_add (content, "/updated", yyjson_mut_strcpy (doc, updated), doc);
 
-      yyjson_mut_ptr_add (content, "/publication_version", yyjson_mut_int (rootdoc, secid->pubversion), rootdoc);
-      yyjson_mut_ptr_add (content, "/byte_offset", yyjson_mut_sint (rootdoc, sd->startoffset), rootdoc);
-      yyjson_mut_ptr_add (content, "/byte_count", yyjson_mut_sint (rootdoc, bytecount), rootdoc);
+      yyjson_mut_ptr_add (content, "/publication_version", yyjson_mut_int (doc, secid->pubversion), doc);
+      yyjson_mut_ptr_add (content, "/byte_offset", yyjson_mut_sint (doc, sd->startoffset), doc);
+      yyjson_mut_ptr_add (content, "/byte_count", yyjson_mut_sint (doc, bytecount), doc);
 
-      yyjson_mut_ptr_add (content, "/md5", yyjson_mut_strcpy (rootdoc, sd->digeststr), rootdoc);
-      yyjson_mut_ptr_add (content, "/time_ordered_records", yyjson_mut_bool (rootdoc, sd->timeorderrecords), rootdoc);
+      yyjson_mut_ptr_add (content, "/md5", yyjson_mut_strcpy (doc, sd->digeststr), doc);
+      yyjson_mut_ptr_add (content, "/time_ordered_records", yyjson_mut_bool (doc, sd->timeorderrecords), doc);
 
       /* If time index includes the earliest data first create the time index array:
        * 'time1=>offset1,time2=>offset2,time3=>offset3,...'
@@ -1941,16 +2924,16 @@ OutputJSON (const char *filename)
       {
         yyjson_mut_val *obj;
 
-        yyjson_mut_ptr_add (content, "/ts_time_byteoffset", yyjson_mut_arr (rootdoc), rootdoc);
+        yyjson_mut_ptr_add (content, "/ts_time_byteoffset", yyjson_mut_arr (doc), doc);
 
         while (tindex)
         {
-          obj = yyjson_mut_obj (rootdoc);
+          obj = yyjson_mut_obj (doc);
 
-          yyjson_mut_ptr_add (obj, "/timestamp", yyjson_mut_sint (rootdoc, tindex->time), rootdoc);
-          yyjson_mut_ptr_add (obj, "/offset", yyjson_mut_sint (rootdoc, tindex->byteoffset), rootdoc);
+          yyjson_mut_ptr_add (obj, "/timestamp", yyjson_mut_sint (doc, tindex->time), doc);
+          yyjson_mut_ptr_add (obj, "/offset", yyjson_mut_sint (doc, tindex->byteoffset), doc);
 
-          yyjson_mut_ptr_add (content, "/ts_time_byteoffset/-", obj, rootdoc);
+          yyjson_mut_ptr_add (content, "/ts_time_byteoffset/-", obj, doc);
 
           tindex = tindex->next;
         }
@@ -1963,7 +2946,7 @@ OutputJSON (const char *filename)
         MS3TraceSeg *seg;
         yyjson_mut_val *obj;
 
-        yyjson_mut_ptr_add (content, "/ts_timespans", yyjson_mut_arr (rootdoc), rootdoc);
+        yyjson_mut_ptr_add (content, "/ts_timespans", yyjson_mut_arr (doc), doc);
 
         /* Create the time span entries */
         id = sd->spans->traces.next[0];
@@ -1972,13 +2955,13 @@ OutputJSON (const char *filename)
           seg = id->first;
           while (seg)
           {
-            obj = yyjson_mut_obj (rootdoc);
+            obj = yyjson_mut_obj (doc);
 
-            yyjson_mut_ptr_add (obj, "/start", yyjson_mut_sint (rootdoc, seg->starttime), rootdoc);
-            yyjson_mut_ptr_add (obj, "/end", yyjson_mut_sint (rootdoc, seg->endtime), rootdoc);
-            yyjson_mut_ptr_add (obj, "/sample_rate", yyjson_mut_real (rootdoc, seg->samprate), rootdoc);
+            yyjson_mut_ptr_add (obj, "/start", yyjson_mut_sint (doc, seg->starttime), doc);
+            yyjson_mut_ptr_add (obj, "/end", yyjson_mut_sint (doc, seg->endtime), doc);
+            yyjson_mut_ptr_add (obj, "/sample_rate", yyjson_mut_real (doc, seg->samprate), doc);
 
-            yyjson_mut_ptr_add (content, "/ts_timespans/-", obj, rootdoc);
+            yyjson_mut_ptr_add (content, "/ts_timespans/-", obj, doc);
 
             seg = seg->next;
           }
@@ -1987,91 +2970,134 @@ OutputJSON (const char *filename)
         }
       }  /* End if (sd->spans) */
 
-      yyjson_mut_arr_append (content_arr, content);
+      /* Serialize and write the content entry, pretty if verbose */
+      serialized = yyjson_mut_write_opts (doc, flg, NULL, NULL, &err);
+      yyjson_mut_doc_free (doc);
 
-      secid = secid->next[0];
+      if (serialized == NULL)
+      {
+        ms_log (2, "Cannot serialize JSON to string: %s\n",
+                (err.msg) ? err.msg : "Unknown error");
+        rv = -1;
+        break;
+      }
+
+      if (sections++)
+        rv |= WriteJSON (fp, ",", 0);
+
+      rv |= WriteJSON (fp, (pretty) ? "\n      " : "", 0);
+      rv |= WriteJSON (fp, serialized, 6);
+
+      free (serialized);
     } /* End of section ID loop */
 
-    /* Set path-level entries */
-    if (format == 2)
-      formatstr = "application/vnd.fdsn.mseed;version=2";
-    else if (format == 3)
-      formatstr = "application/vnd.fdsn.mseed;version=3";
-    else
-      formatstr = "application/vnd.fdsn.mseed";
+    if (pretty && sections)
+      rv |= WriteJSON (fp, "\n    ", 0);
 
-    yyjson_mut_ptr_add (pathobj, "/content_type", yyjson_mut_strcpy (rootdoc, formatstr), rootdoc);
-    yyjson_mut_ptr_add (pathobj, "/sha256", yyjson_mut_strcpy (rootdoc, flp->sha256str), rootdoc);
+    rv |= WriteJSON (fp, (pretty) ? "]\n  }" : "]}", 0);
+  } /* End of looping over file list for synchronization */
 
-    if (flp->filemodtime)
-    {
-      ms_nstime2timestr (MS_EPOCH2NSTIME (flp->filemodtime), pathmod, ISOMONTHDAY_Z, NONE);
-      yyjson_mut_ptr_add (pathobj, "/path_modtime", yyjson_mut_strcpy (rootdoc, pathmod), rootdoc);
-    }
+  if (rv == 0)
+    rv = WriteJSON (fp, (pretty && filelist) ? "\n}" : "}", 0);
 
-    ms_nstime2timestr (MS_EPOCH2NSTIME (flp->scantime), scanned, ISOMONTHDAY_Z, NONE);
-    yyjson_mut_ptr_add (pathobj, "/path_indextime", yyjson_mut_strcpy (rootdoc, scanned), rootdoc);
+  /* Pretty JSON printed to console ends with a newline */
+  if (verbose && fp != stdout)
+    printf ("\n");
 
-    ms_nstime2timestr (earliest_ts, start_string, ISOMONTHDAY_Z, NANO_MICRO);
-    ms_nstime2timestr (latest_ts, end_string, ISOMONTHDAY_Z, NANO_MICRO);
+  if (rv)
+    ms_log (2, "Error writing JSON %s\n", filename);
 
-    yyjson_mut_ptr_add (pathobj, "/start_string", yyjson_mut_strcpy (rootdoc, start_string), rootdoc);
-    yyjson_mut_ptr_add (pathobj, "/end_string", yyjson_mut_strcpy (rootdoc, end_string), rootdoc);
-    yyjson_mut_ptr_add (pathobj, "/start", yyjson_mut_sint (rootdoc, earliest_ts), rootdoc);
-    yyjson_mut_ptr_add (pathobj, "/end", yyjson_mut_sint (rootdoc, latest_ts), rootdoc);
+  if (fp)
+  {
+    if (verbose >= 2)
+      ms_log (1, "Closing JSON output file %s\n", filename);
 
-    /* Add content object to content array */
-    yyjson_mut_ptr_add (pathobj, "/content", content_arr, rootdoc);
+    if (fp != stdout && fclose (fp))
+      rv = -1;
+  }
 
-    flp = flp->next;
-  } /* End of looping over file list for synchronization */
+  return (rv) ? -1 : 0;
+} /* End of OutputJSON() */
+
+/***************************************************************************
+ * WriteMetrics():
+ *
+ * Write metrics to the metrics file if specified, when forced or when
+ * the metrics interval has passed since the last write.
+ *
+ * A file is indexed when it has been scanned and synchronized with
+ * each database, or only scanned when not synchronizing.  The age of
+ * the oldest file not indexed is determined from modification times,
+ * which are only known for local files.
+ ***************************************************************************/
+static void
+WriteMetrics (int force)
+{
+  static int64_t lastwrite = 0;
+  struct filelink *flp;
+  int64_t now;
+  int databases = 0;
+  int scanned;
 
-  if (rootdoc)
+  if (!metricsfile)
+    return;
+
+  now = stats_clock ();
+
+  if (!force && (now - lastwrite) < (int64_t)(metricsinterval * 1e9))
+    return;
+
+  if (!nosync)
   {
-    yyjson_write_flag flg = (verbose > 0) ? YYJSON_WRITE_PRETTY_TWO_SPACES : YYJSON_WRITE_NOFLAG;
-    yyjson_write_err err;
-    size_t serialsize = 0;
+#ifdef WITHPOSTGRESQL
+    if (pghost)
+      databases++;
+#endif
+    if (sqlitefile)
+      databases++;
+  }
 
-    /* Serialize JSON to string, pretty if verbose */
-    serialized = yyjson_mut_write_opts (rootdoc, flg, NULL, &serialsize, &err);
+  indexstats.filesindexed = 0;
+  indexstats.oldestpending = 0;
 
-    if (serialized == NULL)
+  /* Files are scanned in list order */
+  scanned = 0;
+  for (flp = filelist; flp; flp = flp->next, scanned++)
+  {
+    if (scanned < indexstats.files && flp->synced >= databases)
     {
-      ms_log (2, "Cannot serialize JSON to string: %s\n",
-              (err.msg) ? err.msg : "Unknown error");
+      indexstats.filesindexed++;
     }
-    else
+    else if (flp->filemodtime > 0 &&
+             (!indexstats.oldestpending || flp->filemodtime < indexstats.oldestpending))
     {
-      /* Write JSON to output file */
-      if ((fwrite (serialized, serialsize, 1, fp)) != 1)
-      {
-        ms_log (2, "Error writing JSON %s\n", filename);
-      }
-
-      /* Print pretty JSON to console */
-      if (verbose)
-        printf ("%s\n", serialized);
+      indexstats.oldestpending = flp->filemodtime;
     }
   }
 
-  yyjson_mut_doc_free (rootdoc);
-
-  if (fp)
-  {
-    if (verbose >= 2)
-      ms_log (1, "Closing JSON output file %s\n", filename);
+  if (stats_writemetrics (metricsfile))
+    ms_log (1, "Warning: cannot write metrics to %s\n", metricsfile);
 
-    fclose (fp);
-  }
+  lastwrite = now;
+} /* End of WriteMetrics() */
 
-  return (rootdoc) ? 0 : -1;
-} /* End of OutputJSON() */
+/***************************************************************************
+ * ExitMetrics():
+ *
+ * Write final metrics, registered with atexit().
+ ***************************************************************************/
+static void
+ExitMetrics (void)
+{
+  WriteMetrics (1);
+} /* End of ExitMetrics() */
 
 
 /***************************************************************************
  * local_mstl_printtracelist:
  *
- * Print trace list summary information for the specified MSTraceList.
+ * Print trace list summary information for the sections of the
+ * specified file, including spilled sections.
  *
  * The timeformat flag can either be:
  * 0 : SEED time format (year, day-of-year, hour, min, sec)
@@ -2079,7 +3105,7 @@ OutputJSON (const char *filename)
  * 2 : Epoch time, seconds since the epoch
  ***************************************************************************/
 void
-local_mstl_printtracelist (MS3TraceList *mstl, flag timeformat)
+local_mstl_printtracelist (struct filelink *flp, flag timeformat)
 {
   struct sectiondetails *sd;
   MS3TraceID *secid = 0;
@@ -2087,7 +3113,7 @@ local_mstl_printtracelist (MS3TraceList *mstl, flag timeformat)
   char stime[30];
   char etime[30];
 
-  if (!mstl)
+  if (!flp || !flp->mstl)
   {
     return;
   }
@@ -2095,8 +3121,8 @@ local_mstl_printtracelist (MS3TraceList *mstl, flag timeformat)
   /* Print out header */
   ms_log (0, "   Source                    Earliest sample            Latest sample        Hz\n");
 
-  secid = mstl->traces.next[0];
-  while (secid)
+  secid = NULL;
+  while ((secid = NextSection (flp, secid)))
   {
     sd = (struct sectiondetails *)secid->prvtptr;
 
@@ -2163,8 +3189,6 @@ local_mstl_printtracelist (MS3TraceList *mstl, flag timeformat)
         seg = seg->next;
       }
     }
-
-    secid = secid->next[0];
   }
 } /* End of local_mst_printtracelist() */
 
@@ -2227,6 +3251,67 @@ ProcessParam (int argcount, char **argvec)
     {
       subindex = strtol (GetOptValue (argcount, argvec, optind++), NULL, 10);
     }
+    else if (strcmp (argvec[optind], "-s") == 0)
+    {
+      tptr = GetOptValue (argcount, argvec, optind++);
+
+      if (ms3_readselectionsfile (&selections, tptr) < 0)
+      {
+        ms_log (2, "Cannot read data selection file: %s\n", tptr);
+        exit (1);
+      }
+    }
+    else if (strcmp (argvec[optind], "-ur") == 0)
+    {
+      char *endptr;
+      long connections;
+      unsigned long long chunksize = 0;
+
+      tptr = GetOptValue (argcount, argvec, optind++);
+      connections = strtol (tptr, &endptr, 10);
+
+      if (*endptr == ':')
+        chunksize = strtoull (endptr + 1, &endptr, 10);
+
+      if (*endptr != '\0' || connections < 0)
+      {
+        ms_log (2, "Invalid URL range request specification: %s\n", tptr);
+        exit (1);
+      }
+
+      if (ms3_url_parallel ((int)connections, (uint64_t)chunksize))
+      {
+        ms_log (2, "Cannot configure parallel URL range requests\n");
+        exit (1);
+      }
+    }
+    else if (strcmp (argvec[optind], "-dt") == 0)
+    {
+      int threads = (int)strtol (GetOptValue (argcount, argvec, optind++), NULL, 10);
+
+      /* Applies to BGZF and seekable zstd, whichever are supported */
+      if ((!libmseed_gzip_support () && !libmseed_zstd_support ()) ||
+          (libmseed_gzip_support () && ms3_gzip_threads (threads)) ||
+          (libmseed_zstd_support () && ms3_zstd_threads (threads)))
+      {
+        ms_log (2, "Cannot configure decompression threads\n");
+        exit (1);
+      }
+    }
+    else if (strcmp (argvec[optind], "-gzi") == 0)
+    {
+      gzipindex = 1;
+    }
+    else if (strcmp (argvec[optind], "-maxsections") == 0)
+    {
+      maxsections = (int)strtol (GetOptValue (argcount, argvec, optind++), NULL, 10);
+
+      if (maxsections < 0)
+      {
+        ms_log (2, "Invalid maximum number of sections: %d\n", maxsections);
+        exit (1);
+      }
+    }
     else if (strncmp (argvec[optind], "-table", 6) == 0)
     {
       table = strdup (GetOptValue (argcount, argvec, optind++));
@@ -2247,6 +3332,22 @@ ProcessParam (int argcount, char **argvec)
     {
       jsonfile = strdup (GetOptValue (argcount, argvec, optind++));
     }
+    else if (strcmp (argvec[optind], "-stats") == 0)
+    {
+      statssummary = 1;
+    }
+    else if (strcmp (argvec[optind], "-statsjson") == 0)
+    {
+      statsjson = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-metrics") == 0)
+    {
+      metricsfile = GetOptValue (argcount, argvec, optind++);
+    }
+    else if (strcmp (argvec[optind], "-metricsint") == 0)
+    {
+      metricsinterval = strtod (GetOptValue (argcount, argvec, optind++), NULL);
+    }
     else if (strncmp (argvec[optind], "-dbport", 7) == 0)
     {
       dbport = strdup (GetOptValue (argcount, argvec, optind++));
@@ -2271,6 +3372,10 @@ ProcessParam (int argcount, char **argvec)
     {
       sqlitebusyto = strtoul (GetOptValue (argcount, argvec, optind++), NULL, 10);
     }
+    else if (strcmp (argvec[optind], "-notify") == 0)
+    {
+      notifysocket = GetOptValue (argcount, argvec, optind++);
+    }
     else if (strncmp (argvec[optind], "-", 1) == 0 &&
              strlen (argvec[optind]) > 1)
     {
@@ -2350,8 +3455,9 @@ GetOptValue (int argcount, char **argvec, int argopt)
     return 0;
   }
 
-  /* Special case of '-json -' usage */
-  if ((argopt + 1) < argcount && strcmp (argvec[argopt], "-json") == 0)
+  /* Special case of '-json -' and '-statsjson -' usage */
+  if ((argopt + 1) < argcount && (strcmp (argvec[argopt], "-json") == 0 ||
+                                  strcmp (argvec[argopt], "-statsjson") == 0))
     if (strcmp (argvec[argopt + 1], "-") == 0)
       return argvec[argopt + 1];
 
@@ -2396,6 +3502,7 @@ AddFile (char *filename)
   newlp->mstl = NULL;
   newlp->earliest = NSTERROR;
   newlp->latest = NSTERROR;
+  newlp->format = -1;
   sha256_init (&newlp->sha256state);
   newlp->localpath = 0;
   newlp->next = NULL;
@@ -2620,6 +3727,13 @@ Usage (void)
            " -tt secs       Specify a time tolerance for continuous traces\n"
            " -rt diff       Specify a sample rate tolerance for continuous traces\n"
            " -si secs       Specify a sub-indexing interval, currently: %d\n"
+           " -s file        Specify a file of data selections, only selected data is indexed\n"
+           " -ur count[:bytes] Read URLs with count parallel range requests of bytes each\n"
+           " -dt threads    Decompress BGZF and seekable zstd files with threads, 0 for all\n"
+           "                  processors\n"
+           " -gzi           Write a block index (file.gzi) for each BGZF file read\n"
+           " -maxsections count Sections of a file kept in memory, others are spilled\n"
+           "                  to a temporary file, 0 for no limit, currently: %d\n"
            "\n"
 #ifdef WITHPOSTGRESQL
            "Either the -pghost or -sqlite argument is required\n"
@@ -2638,8 +3752,14 @@ Usage (void)
            "\n"
            " -TRACE         Enable Postgres libpq tracing facility and direct output to stderr\n"
            " -sqlitebusyto msec   Set the SQLite busy timeout in milliseconds, currently: %lu\n"
+           " -notify socket Send updates of SQLite rows for each file to mseedindex-server\n"
+           "\n"
+           " -stats         Print timing and throughput statistics to stderr at exit\n"
+           " -statsjson file Write timing and throughput statistics as JSON to file, '-' for stdout\n"
+           " -metrics file  Write OpenMetrics text to file during indexing and at exit\n"
+           " -metricsint secs Minimum interval between metrics writes, currently: %g\n"
            "\n"
            " files          File(s) of miniSEED records, list files prefixed with '@'\n"
            "\n",
-           subindex, table, dbport, dbname, dbuser, sqlitebusyto);
+           subindex, maxsections, table, dbport, dbname, dbuser, sqlitebusyto, metricsinterval);
 } /* End of Usage() */
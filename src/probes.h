@@ -0,0 +1,62 @@
+/***************************************************************************
+ * probes.h - Static tracepoints of mseedindex.
+ *
+ * When built with WITHUSDT the probes are USDT (user-level statically
+ * defined tracing) probes of the "mseedindex" provider, defined with
+ * the SystemTap <sys/sdt.h> macros.  Each probe is a single no-op
+ * instruction until attached by a tracer such as perf, bpftrace or
+ * SystemTap, and arguments are only evaluated into registers.
+ * Without WITHUSDT the probes are removed at compile time.
+ *
+ * Probes and arguments:
+ *
+ *   file__open      (filename)
+ *   file__close     (filename, sections, bytes read)
+ *   record__parsed  (sid, reclen, offset)
+ *   section__start  (sid, offset)
+ *   section__end    (sid, startoffset, endoffset)
+ *   db__start       (statement)
+ *   db__end         (status)
+ *
+ * The database status is the SQLite result code or the Postgres
+ * ExecStatusType of the statement.  For SQLite SELECT statements the
+ * end is after all result rows are processed.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#ifndef PROBES_H
+#define PROBES_H 1
+
+#if defined(WITHUSDT)
+
+#include <sys/sdt.h>
+
+#define PROBE_FILE_OPEN(filename) \
+  DTRACE_PROBE1 (mseedindex, file__open, filename)
+#define PROBE_FILE_CLOSE(filename, sections, bytes) \
+  DTRACE_PROBE3 (mseedindex, file__close, filename, sections, bytes)
+#define PROBE_RECORD_PARSED(sid, reclen, offset) \
+  DTRACE_PROBE3 (mseedindex, record__parsed, sid, reclen, offset)
+#define PROBE_SECTION_START(sid, offset) \
+  DTRACE_PROBE2 (mseedindex, section__start, sid, offset)
+#define PROBE_SECTION_END(sid, startoffset, endoffset) \
+  DTRACE_PROBE3 (mseedindex, section__end, sid, startoffset, endoffset)
+#define PROBE_DB_START(statement) \
+  DTRACE_PROBE1 (mseedindex, db__start, statement)
+#define PROBE_DB_END(status) \
+  DTRACE_PROBE1 (mseedindex, db__end, status)
+
+#else
+
+#define PROBE_FILE_OPEN(filename) ((void)0)
+#define PROBE_FILE_CLOSE(filename, sections, bytes) ((void)0)
+#define PROBE_RECORD_PARSED(sid, reclen, offset) ((void)0)
+#define PROBE_SECTION_START(sid, offset) ((void)0)
+#define PROBE_SECTION_END(sid, startoffset, endoffset) ((void)0)
+#define PROBE_DB_START(statement) ((void)0)
+#define PROBE_DB_END(status) ((void)0)
+
+#endif
+
+#endif /* PROBES_H */
@@ -0,0 +1,460 @@
+/***************************************************************************
+ * stats.c - Indexing statistics.
+ *
+ * Phases are timed with a monotonic clock, which is inexpensive enough
+ * to read for every record.  CPU time is only read at the boundaries
+ * of stages, a few times per run.
+ *
+ * Metrics are written in the OpenMetrics text format to a temporary
+ * file that is renamed over the target, as expected by collectors of
+ * text files such as that of the Prometheus node_exporter.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+#include <yyjson.h>
+
+#if !defined(LMP_WIN)
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#include "stats.h"
+
+IndexStats indexstats;
+
+static const char *phasenames[STATS_PHASES] = {
+    "read", "spans", "md5", "sha256", "strings", "dbquery", "dbwrite", "dbcommit", "json", "spill"};
+
+static const char *stagenames[STATS_STAGES] = {
+    "scan", "digest", "sync", "output"};
+
+static const char *dbphasenames[STATS_DBPHASES] = {
+    "query", "write", "commit"};
+
+static const char *errornames[STATS_ERRORS] = {
+    "read", "database", "notify", "output"};
+
+static const int64_t bucketbounds[STATS_BUCKETS] = {
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+    25000000, 50000000, 100000000, 250000000, 1000000000};
+
+static void CPUTime (double *user, double *system);
+static double TotalWall (void);
+
+/***************************************************************************
+ * stats_clock():
+ *
+ * Return a monotonic clock value in nanoseconds.
+ ***************************************************************************/
+int64_t
+stats_clock (void)
+{
+#if defined(LMP_WIN)
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+
+  if (!frequency.QuadPart)
+    QueryPerformanceFrequency (&frequency);
+
+  QueryPerformanceCounter (&counter);
+
+  return (int64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+} /* End of stats_clock() */
+
+/***************************************************************************
+ * stats_stagestart():
+ *
+ * Start timing a stage.
+ ***************************************************************************/
+void
+stats_stagestart (void)
+{
+  if (!indexstats.enabled)
+    return;
+
+  indexstats.stagestartwall = stats_clock ();
+  CPUTime (&indexstats.stagestartuser, &indexstats.stagestartsystem);
+} /* End of stats_stagestart() */
+
+/***************************************************************************
+ * stats_stageend():
+ *
+ * Add the wall and CPU time since stats_stagestart() to a stage.
+ ***************************************************************************/
+void
+stats_stageend (StatsStage stage)
+{
+  double user;
+  double system;
+
+  if (!indexstats.enabled)
+    return;
+
+  CPUTime (&user, &system);
+
+  indexstats.stagewall[stage] += (stats_clock () - indexstats.stagestartwall) / 1e9;
+  indexstats.stageuser[stage] += user - indexstats.stagestartuser;
+  indexstats.stagesystem[stage] += system - indexstats.stagestartsystem;
+} /* End of stats_stageend() */
+
+/***************************************************************************
+ * stats_observe():
+ *
+ * Count an interval of a database phase in its latency bucket.
+ * Intervals beyond the last bound are only counted in the phase
+ * count, the +Inf bucket.
+ ***************************************************************************/
+void
+stats_observe (StatsPhase phase, int64_t elapsed)
+{
+  int idx;
+
+  for (idx = 0; idx < STATS_BUCKETS; idx++)
+  {
+    if (elapsed <= bucketbounds[idx])
+    {
+      indexstats.dbbuckets[phase - STATS_DBQUERY][idx]++;
+      break;
+    }
+  }
+} /* End of stats_observe() */
+
+/***************************************************************************
+ * stats_print():
+ *
+ * Print a summary of the statistics.
+ ***************************************************************************/
+void
+stats_print (void)
+{
+  double wall = TotalWall ();
+  int idx;
+
+  ms_log (1, "Statistics:\n");
+  ms_log (1, "  Files: %" PRId64 ", records: %" PRId64 ", bytes: %" PRId64 ", sections: %" PRId64
+             " (%" PRId64 " spilled)\n",
+          indexstats.files, indexstats.records, indexstats.bytes, indexstats.sections,
+          indexstats.spilled);
+  ms_log (1, "  Rows: %" PRId64 " matched, %" PRId64 " deleted, %" PRId64 " inserted\n",
+          indexstats.rowsmatched, indexstats.rowsdeleted, indexstats.rowsinserted);
+
+  if (wall > 0.0)
+    ms_log (1, "  Throughput: %.1f records/s, %.2f MB/s\n",
+            indexstats.records / wall, indexstats.bytes / 1048576.0 / wall);
+
+  ms_log (1, "  Stage      Wall (s)   User (s) System (s)\n");
+  for (idx = 0; idx < STATS_STAGES; idx++)
+    ms_log (1, "  %-8s %10.3f %10.3f %10.3f\n", stagenames[idx], indexstats.stagewall[idx],
+            indexstats.stageuser[idx], indexstats.stagesystem[idx]);
+
+  ms_log (1, "  Phase      Wall (s)      Count\n");
+  for (idx = 0; idx < STATS_PHASES; idx++)
+    ms_log (1, "  %-8s %10.3f %10" PRId64 "\n", phasenames[idx],
+            indexstats.phasewall[idx] / 1e9, indexstats.phasecount[idx]);
+} /* End of stats_print() */
+
+/***************************************************************************
+ * stats_writejson():
+ *
+ * Write the statistics as a JSON object to a file, or standard output
+ * when the file is "-".
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+stats_writejson (const char *filename)
+{
+  yyjson_mut_doc *doc;
+  yyjson_mut_val *root;
+  yyjson_mut_val *group;
+  yyjson_mut_val *entry;
+  double wall = TotalWall ();
+  FILE *fp;
+  int idx;
+  int rv = 0;
+
+  if (!(doc = yyjson_mut_doc_new (NULL)) || !(root = yyjson_mut_obj (doc)))
+  {
+    ms_log (2, "Cannot create JSON document\n");
+    yyjson_mut_doc_free (doc);
+    return -1;
+  }
+
+  yyjson_mut_doc_set_root (doc, root);
+
+  yyjson_mut_obj_add_int (doc, root, "files", indexstats.files);
+  yyjson_mut_obj_add_int (doc, root, "records", indexstats.records);
+  yyjson_mut_obj_add_int (doc, root, "bytes", indexstats.bytes);
+  yyjson_mut_obj_add_int (doc, root, "sections", indexstats.sections);
+  yyjson_mut_obj_add_int (doc, root, "sections_spilled", indexstats.spilled);
+  yyjson_mut_obj_add_int (doc, root, "rows_matched", indexstats.rowsmatched);
+  yyjson_mut_obj_add_int (doc, root, "rows_deleted", indexstats.rowsdeleted);
+  yyjson_mut_obj_add_int (doc, root, "rows_inserted", indexstats.rowsinserted);
+
+  group = yyjson_mut_obj_add_obj (doc, root, "errors");
+  for (idx = 0; idx < STATS_ERRORS; idx++)
+    yyjson_mut_obj_add_int (doc, group, errornames[idx], indexstats.errors[idx]);
+
+  yyjson_mut_obj_add_real (doc, root, "wall_seconds", wall);
+  yyjson_mut_obj_add_real (doc, root, "records_per_second",
+                           (wall > 0.0) ? indexstats.records / wall : 0.0);
+  yyjson_mut_obj_add_real (doc, root, "mb_per_second",
+                           (wall > 0.0) ? indexstats.bytes / 1048576.0 / wall : 0.0);
+
+  group = yyjson_mut_obj_add_obj (doc, root, "stages");
+  for (idx = 0; idx < STATS_STAGES; idx++)
+  {
+    entry = yyjson_mut_obj_add_obj (doc, group, stagenames[idx]);
+    yyjson_mut_obj_add_real (doc, entry, "wall_seconds", indexstats.stagewall[idx]);
+    yyjson_mut_obj_add_real (doc, entry, "user_seconds", indexstats.stageuser[idx]);
+    yyjson_mut_obj_add_real (doc, entry, "system_seconds", indexstats.stagesystem[idx]);
+  }
+
+  group = yyjson_mut_obj_add_obj (doc, root, "phases");
+  for (idx = 0; idx < STATS_PHASES; idx++)
+  {
+    entry = yyjson_mut_obj_add_obj (doc, group, phasenames[idx]);
+    yyjson_mut_obj_add_real (doc, entry, "wall_seconds", indexstats.phasewall[idx] / 1e9);
+    yyjson_mut_obj_add_int (doc, entry, "count", indexstats.phasecount[idx]);
+  }
+
+  if (!strcmp (filename, "-"))
+  {
+    fp = stdout;
+  }
+  else if (!(fp = fopen (filename, "wb")))
+  {
+    ms_log (2, "Cannot open statistics file %s: %s\n", filename, strerror (errno));
+    yyjson_mut_doc_free (doc);
+    return -1;
+  }
+
+  if (!yyjson_mut_write_fp (fp, doc, YYJSON_WRITE_PRETTY, NULL, NULL) ||
+      fputc ('\n', fp) == EOF)
+  {
+    ms_log (2, "Cannot write statistics to %s\n", filename);
+    rv = -1;
+  }
+
+  if (fp != stdout && fclose (fp))
+  {
+    ms_log (2, "Cannot write statistics to %s: %s\n", filename, strerror (errno));
+    rv = -1;
+  }
+
+  yyjson_mut_doc_free (doc);
+
+  return rv;
+} /* End of stats_writejson() */
+
+/***************************************************************************
+ * stats_writemetrics():
+ *
+ * Write the statistics as OpenMetrics text.  The text is written to
+ * "filename.tmp" which is then renamed to the file, so a reader never
+ * sees a partially written file.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+stats_writemetrics (const char *filename)
+{
+  char tmpname[1024];
+  time_t now = time (NULL);
+  int64_t cumulative;
+  FILE *fp;
+  int phase;
+  int idx;
+  int rv = 0;
+
+  snprintf (tmpname, sizeof (tmpname), "%s.tmp", filename);
+
+  if (!(fp = fopen (tmpname, "wb")))
+  {
+    ms_log (2, "Cannot open metrics file %s: %s\n", tmpname, strerror (errno));
+    return -1;
+  }
+
+  fprintf (fp, "# TYPE mseedindex_start_time_seconds gauge\n"
+               "# HELP mseedindex_start_time_seconds Start time of indexing.\n"
+               "mseedindex_start_time_seconds %lld\n",
+           (long long int)indexstats.starttime);
+
+  fprintf (fp, "# TYPE mseedindex_files counter\n"
+               "# HELP mseedindex_files Files read.\n"
+               "mseedindex_files_total %" PRId64 "\n",
+           indexstats.files);
+  fprintf (fp, "# TYPE mseedindex_records counter\n"
+               "# HELP mseedindex_records Records read.\n"
+               "mseedindex_records_total %" PRId64 "\n",
+           indexstats.records);
+  fprintf (fp, "# TYPE mseedindex_bytes counter\n"
+               "# UNIT mseedindex_bytes bytes\n"
+               "# HELP mseedindex_bytes Bytes of records read.\n"
+               "mseedindex_bytes_total %" PRId64 "\n",
+           indexstats.bytes);
+  fprintf (fp, "# TYPE mseedindex_sections counter\n"
+               "# HELP mseedindex_sections Sections of time series identified.\n"
+               "mseedindex_sections_total %" PRId64 "\n",
+           indexstats.sections);
+  fprintf (fp, "# TYPE mseedindex_sections_spilled counter\n"
+               "# HELP mseedindex_sections_spilled Sections spilled to a temporary file to bound memory.\n"
+               "mseedindex_sections_spilled_total %" PRId64 "\n",
+           indexstats.spilled);
+
+  fprintf (fp, "# TYPE mseedindex_queued_files gauge\n"
+               "# HELP mseedindex_queued_files Files waiting for a stage of indexing.\n"
+               "mseedindex_queued_files{stage=\"scan\"} %" PRId64 "\n"
+               "mseedindex_queued_files{stage=\"sync\"} %" PRId64 "\n",
+           indexstats.filesqueued - indexstats.files,
+           indexstats.files - indexstats.filesindexed);
+  fprintf (fp, "# TYPE mseedindex_oldest_unindexed_file_age_seconds gauge\n"
+               "# UNIT mseedindex_oldest_unindexed_file_age_seconds seconds\n"
+               "# HELP mseedindex_oldest_unindexed_file_age_seconds Age of the oldest modified file not yet indexed.\n"
+               "mseedindex_oldest_unindexed_file_age_seconds %lld\n",
+           (indexstats.oldestpending > 0 && now > indexstats.oldestpending) ? (long long int)(now - indexstats.oldestpending) : 0LL);
+
+  fprintf (fp, "# TYPE mseedindex_db_rows counter\n"
+               "# HELP mseedindex_db_rows Database rows by operation.\n"
+               "mseedindex_db_rows_total{operation=\"matched\"} %" PRId64 "\n"
+               "mseedindex_db_rows_total{operation=\"deleted\"} %" PRId64 "\n"
+               "mseedindex_db_rows_total{operation=\"inserted\"} %" PRId64 "\n",
+           indexstats.rowsmatched, indexstats.rowsdeleted, indexstats.rowsinserted);
+  fprintf (fp, "# TYPE mseedindex_db_commits counter\n"
+               "# HELP mseedindex_db_commits Database transactions committed.\n"
+               "mseedindex_db_commits_total %" PRId64 "\n",
+           indexstats.phasecount[STATS_DBCOMMIT]);
+
+  fprintf (fp, "# TYPE mseedindex_db_latency_seconds histogram\n"
+               "# UNIT mseedindex_db_latency_seconds seconds\n"
+               "# HELP mseedindex_db_latency_seconds Latency of database operations.\n");
+  for (phase = 0; phase < STATS_DBPHASES; phase++)
+  {
+    cumulative = 0;
+    for (idx = 0; idx < STATS_BUCKETS; idx++)
+    {
+      cumulative += indexstats.dbbuckets[phase][idx];
+      fprintf (fp, "mseedindex_db_latency_seconds_bucket{operation=\"%s\",le=\"%g\"} %" PRId64 "\n",
+               dbphasenames[phase], bucketbounds[idx] / 1e9, cumulative);
+    }
+    fprintf (fp, "mseedindex_db_latency_seconds_bucket{operation=\"%s\",le=\"+Inf\"} %" PRId64 "\n"
+                 "mseedindex_db_latency_seconds_sum{operation=\"%s\"} %.9f\n"
+                 "mseedindex_db_latency_seconds_count{operation=\"%s\"} %" PRId64 "\n",
+             dbphasenames[phase], indexstats.phasecount[STATS_DBQUERY + phase],
+             dbphasenames[phase], indexstats.phasewall[STATS_DBQUERY + phase] / 1e9,
+             dbphasenames[phase], indexstats.phasecount[STATS_DBQUERY + phase]);
+  }
+
+  fprintf (fp, "# TYPE mseedindex_phase_seconds counter\n"
+               "# UNIT mseedindex_phase_seconds seconds\n"
+               "# HELP mseedindex_phase_seconds Wall time of indexing phases.\n");
+  for (idx = 0; idx < STATS_PHASES; idx++)
+    fprintf (fp, "mseedindex_phase_seconds_total{phase=\"%s\"} %.9f\n",
+             phasenames[idx], indexstats.phasewall[idx] / 1e9);
+
+  fprintf (fp, "# TYPE mseedindex_errors counter\n"
+               "# HELP mseedindex_errors Errors by category.\n");
+  for (idx = 0; idx < STATS_ERRORS; idx++)
+    fprintf (fp, "mseedindex_errors_total{category=\"%s\"} %" PRId64 "\n",
+             errornames[idx], indexstats.errors[idx]);
+
+  fprintf (fp, "# EOF\n");
+
+  if (ferror (fp))
+  {
+    ms_log (2, "Cannot write metrics to %s\n", tmpname);
+    rv = -1;
+  }
+
+  if (fclose (fp))
+  {
+    ms_log (2, "Cannot write metrics to %s: %s\n", tmpname, strerror (errno));
+    rv = -1;
+  }
+
+#if defined(LMP_WIN)
+  /* Windows rename does not replace an existing file */
+  if (rv == 0)
+    remove (filename);
+#endif
+
+  if (rv == 0 && rename (tmpname, filename))
+  {
+    ms_log (2, "Cannot rename %s to %s: %s\n", tmpname, filename, strerror (errno));
+    rv = -1;
+  }
+
+  if (rv)
+    remove (tmpname);
+
+  return rv;
+} /* End of stats_writemetrics() */
+
+/***************************************************************************
+ * CPUTime():
+ *
+ * Determine the user and system CPU time of the process in seconds.
+ ***************************************************************************/
+static void
+CPUTime (double *user, double *system)
+{
+#if defined(LMP_WIN)
+  FILETIME creation, exit, kernel, usertime;
+  ULARGE_INTEGER value;
+
+  *user = *system = 0.0;
+
+  if (GetProcessTimes (GetCurrentProcess (), &creation, &exit, &kernel, &usertime))
+  {
+    /* FILETIME values are in 100 nanosecond intervals */
+    value.LowPart = usertime.dwLowDateTime;
+    value.HighPart = usertime.dwHighDateTime;
+    *user = value.QuadPart / 1e7;
+
+    value.LowPart = kernel.dwLowDateTime;
+    value.HighPart = kernel.dwHighDateTime;
+    *system = value.QuadPart / 1e7;
+  }
+#else
+  struct rusage usage;
+
+  *user = *system = 0.0;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+  {
+    *user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    *system = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  }
+#endif
+} /* End of CPUTime() */
+
+/***************************************************************************
+ * TotalWall():
+ *
+ * Return the total wall time of all stages in seconds.
+ ***************************************************************************/
+static double
+TotalWall (void)
+{
+  double wall = 0.0;
+  int idx;
+
+  for (idx = 0; idx < STATS_STAGES; idx++)
+    wall += indexstats.stagewall[idx];
+
+  return wall;
+} /* End of TotalWall() */
@@ -0,0 +1,130 @@
+/***************************************************************************
+ * stats.h - Interface for indexing statistics.
+ *
+ * Counters and timers of the phases of indexing, collected when
+ * enabled and reported as a summary, as JSON or as OpenMetrics text.
+ * Counters are always maintained, timers only read a monotonic clock
+ * when enabled.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H 1
+
+#include <stdint.h>
+#include <time.h>
+
+/* Phases with accumulated wall time */
+typedef enum
+{
+  STATS_READ,     /* Reading, detecting and parsing records (libmseed) */
+  STATS_SPANS,    /* Section tracking, time index and span building */
+  STATS_MD5,      /* Section MD5 digests */
+  STATS_SHA256,   /* File SHA-256 digests */
+  STATS_STRINGS,  /* Digest, time index, time span and time strings */
+  STATS_DBQUERY,  /* Database schema and searching existing rows */
+  STATS_DBWRITE,  /* Deleting and inserting rows */
+  STATS_DBCOMMIT, /* Committing transactions */
+  STATS_JSON,     /* JSON serialization and writing */
+  STATS_SPILL,    /* Writing sections to the spill file */
+  STATS_PHASES
+} StatsPhase;
+
+/* Database phases with latency histograms, STATS_DBQUERY to STATS_DBCOMMIT */
+#define STATS_DBPHASES 3
+
+/* Upper bounds of latency histogram buckets in nanoseconds, excluding +Inf */
+#define STATS_BUCKETS 12
+
+/* Categories of errors */
+typedef enum
+{
+  STATS_ERR_READ,     /* Reading input files */
+  STATS_ERR_DATABASE, /* Synchronizing with databases */
+  STATS_ERR_NOTIFY,   /* Sending updates to an index server */
+  STATS_ERR_OUTPUT,   /* Writing output files */
+  STATS_ERRORS
+} StatsError;
+
+/* Stages with accumulated wall and CPU time */
+typedef enum
+{
+  STATS_SCAN,   /* Reading files */
+  STATS_DIGEST, /* Finishing digests */
+  STATS_SYNC,   /* Synchronizing with databases */
+  STATS_OUTPUT, /* Writing JSON output */
+  STATS_STAGES
+} StatsStage;
+
+typedef struct IndexStats
+{
+  int enabled;
+
+  int64_t files;
+  int64_t records;
+  int64_t bytes;
+  int64_t sections;
+  int64_t spilled;      /* Sections spilled to a temporary file */
+  int64_t rowsmatched;  /* Existing rows found for files */
+  int64_t rowsdeleted;
+  int64_t rowsinserted;
+  int64_t errors[STATS_ERRORS];
+
+  /* Progress of the file list, set before writing metrics */
+  time_t starttime;
+  int64_t filesqueued;  /* Files in the list */
+  int64_t filesindexed; /* Files scanned and synchronized with all databases */
+  time_t oldestpending; /* Oldest modification time of files not indexed, 0 if none */
+
+  int64_t phasewall[STATS_PHASES];  /* Nanoseconds */
+  int64_t phasecount[STATS_PHASES]; /* Number of timed intervals */
+  int64_t dbbuckets[STATS_DBPHASES][STATS_BUCKETS]; /* Intervals per latency bucket */
+
+  double stagewall[STATS_STAGES];   /* Seconds */
+  double stageuser[STATS_STAGES];
+  double stagesystem[STATS_STAGES];
+
+  /* Start of the current stage */
+  int64_t stagestartwall;
+  double stagestartuser;
+  double stagestartsystem;
+} IndexStats;
+
+extern IndexStats indexstats;
+
+extern int64_t stats_clock (void);
+extern void stats_stagestart (void);
+extern void stats_stageend (StatsStage stage);
+extern void stats_observe (StatsPhase phase, int64_t elapsed);
+extern void stats_print (void);
+extern int stats_writejson (const char *filename);
+extern int stats_writemetrics (const char *filename);
+
+/* Return a time mark for stats_phase(), 0 when not enabled */
+static inline int64_t
+stats_mark (void)
+{
+  return (indexstats.enabled) ? stats_clock () : 0;
+}
+
+/* Add the time since a mark to a phase and advance the mark to now */
+static inline void
+stats_phase (StatsPhase phase, int64_t *mark)
+{
+  int64_t now;
+
+  if (!indexstats.enabled)
+    return;
+
+  now = stats_clock ();
+  indexstats.phasewall[phase] += now - *mark;
+  indexstats.phasecount[phase]++;
+
+  if (phase >= STATS_DBQUERY && phase <= STATS_DBCOMMIT)
+    stats_observe (phase, now - *mark);
+
+  *mark = now;
+}
+
+#endif /* STATS_H */
@@ -0,0 +1,157 @@
+/* Tests of extracting miniSEED with mseedindex-fetch from compressed
+ * files, indexed by offsets in the uncompressed data.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+#include <tau/tau.h>
+
+extern int run_mseedindex (const char *arguments);
+extern int run_fetch (const char *arguments);
+
+#define DATADIR "../../libmseed/test/data/"
+#define REFFILE "testdata-fetch.mseed3"
+#define REFSQLITE "testdata-fetch.sqlite"
+#define REFOUTPUT "testdata-fetch.out"
+#define COMPRESSEDSQLITE "testdata-fetch-compressed.sqlite"
+#define COMPRESSEDOUTPUT "testdata-fetch-compressed.out"
+
+/* A window within the data of a channel that is not first in the file */
+#define FETCHOPTIONS "-C LH2 -s 2010-02-27T07:00:00 -e 2010-02-27T07:30:00"
+
+/* Copy a file.
+ *
+ * Returns 0 on success, and -1 on error.
+ *********************************************************************/
+static int
+copy_file (const char *input, const char *output)
+{
+  char buffer[4096];
+  FILE *ifp;
+  FILE *ofp;
+  size_t readsize;
+  int rv = 0;
+
+  if (!(ifp = fopen (input, "rb")))
+    return -1;
+
+  if (!(ofp = fopen (output, "wb")))
+  {
+    fclose (ifp);
+    return -1;
+  }
+
+  while ((readsize = fread (buffer, 1, sizeof (buffer), ifp)) > 0)
+  {
+    if (fwrite (buffer, 1, readsize, ofp) != readsize)
+    {
+      rv = -1;
+      break;
+    }
+  }
+
+  fclose (ifp);
+  fclose (ofp);
+
+  return rv;
+}
+
+/* Read a file into a newly allocated buffer.
+ *
+ * Returns the file length on success, and -1 on error.
+ *********************************************************************/
+static int64_t
+read_file (const char *path, char **buffer)
+{
+  FILE *fp;
+  long length;
+
+  *buffer = NULL;
+
+  if (!(fp = fopen (path, "rb")))
+    return -1;
+
+  if (fseek (fp, 0, SEEK_END) || (length = ftell (fp)) < 0 || fseek (fp, 0, SEEK_SET) ||
+      !(*buffer = (char *)malloc (length + 1)) ||
+      fread (*buffer, 1, length, fp) != (size_t)length)
+  {
+    free (*buffer);
+    *buffer = NULL;
+    length = -1;
+  }
+
+  fclose (fp);
+
+  return length;
+}
+
+/* Index and fetch a window of data from a compressed file and from
+ * the uncompressed reference file, the outputs must be identical.
+ *
+ * Returns the length of the fetched output on success, and -1 on
+ * error or mismatch.
+ *********************************************************************/
+static int64_t
+fetch_compressed (const char *source, const char *compressedfile)
+{
+  char arguments[512];
+  char *reference = NULL;
+  char *fetched = NULL;
+  int64_t reflength;
+  int64_t length;
+
+  remove (REFSQLITE);
+  remove (COMPRESSEDSQLITE);
+  remove (REFOUTPUT);
+  remove (COMPRESSEDOUTPUT);
+
+  if (copy_file (DATADIR "testdata-3channel-signal.mseed3", REFFILE) ||
+      copy_file (source, compressedfile))
+    return -1;
+
+  snprintf (arguments, sizeof (arguments), "-sqlite %s %s", COMPRESSEDSQLITE, compressedfile);
+
+  if (run_mseedindex ("-sqlite " REFSQLITE " " REFFILE) ||
+      run_mseedindex (arguments))
+    return -1;
+
+  if (run_fetch (FETCHOPTIONS " -o " REFOUTPUT " " REFSQLITE) ||
+      run_fetch (FETCHOPTIONS " -o " COMPRESSEDOUTPUT " " COMPRESSEDSQLITE))
+    return -1;
+
+  reflength = read_file (REFOUTPUT, &reference);
+  length = read_file (COMPRESSEDOUTPUT, &fetched);
+
+  if (reflength <= 0 || length != reflength || memcmp (reference, fetched, length))
+    length = -1;
+
+  free (reference);
+  free (fetched);
+
+  return length;
+}
+
+TEST (fetch, gzip)
+{
+  /* Skip when the library does not include gzip support */
+  if (!libmseed_gzip_support ())
+    return;
+
+  CHECK (fetch_compressed (DATADIR "testdata-3channel-signal.mseed3.bgz", "testdata-fetch.mseed3.bgz") > 0,
+         "Fetch from BGZF file does not match uncompressed file");
+}
+
+TEST (fetch, zstd)
+{
+  /* Skip when the library does not include zstd support */
+  if (!libmseed_zstd_support ())
+    return;
+
+  CHECK (fetch_compressed (DATADIR "testdata-3channel-signal-seekable.mseed3.zst", "testdata-fetch.mseed3.zst") > 0,
+         "Fetch from seekable zstd file does not match uncompressed file");
+  CHECK (fetch_compressed (DATADIR "testdata-3channel-signal.mseed3.zst", "testdata-fetch.mseed3.zst") > 0,
+         "Fetch from zstd file does not match uncompressed file");
+}
@@ -0,0 +1,93 @@
+/* Main entry point for tests of mseedindex.
+ *********************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include <libmseed.h>
+#include <tau/tau.h>
+
+
+TAU_MAIN() // sets up Tau
+
+
+/* Run mseedindex with the specified arguments, output is discarded.
+ *
+ * Returns the exit status of mseedindex, or -1 if it cannot be run.
+ *********************************************************************/
+int
+run_mseedindex (const char *arguments)
+{
+  char command[1024];
+  int rv;
+
+  snprintf (command, sizeof (command), "../../mseedindex %s > /dev/null 2>&1", arguments);
+
+  if ((rv = system (command)) == -1 || !WIFEXITED (rv))
+    return -1;
+
+  return WEXITSTATUS (rv);
+}
+
+/* Run mseedindex-fetch with the specified arguments, output is discarded.
+ *
+ * Returns the exit status of mseedindex-fetch, or -1 if it cannot be run.
+ *********************************************************************/
+int
+run_fetch (const char *arguments)
+{
+  char command[1024];
+  int rv;
+
+  snprintf (command, sizeof (command), "../../mseedindex-fetch %s > /dev/null 2>&1", arguments);
+
+  if ((rv = system (command)) == -1 || !WIFEXITED (rv))
+    return -1;
+
+  return WEXITSTATUS (rv);
+}
+
+/* Record handler for shift_file(), write records to a file.
+ *********************************************************************/
+static void
+write_record (char *record, int reclen, void *handlerdata)
+{
+  fwrite (record, reclen, 1, (FILE *)handlerdata);
+}
+
+/* Write a copy of a miniSEED file with the data shifted in time by
+ * the specified number of seconds.
+ *
+ * Returns 0 on success, and -1 on error.
+ *********************************************************************/
+int
+shift_file (const char *input, const char *output, int64_t seconds)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  FILE *fp = NULL;
+  int64_t packedsamples;
+  int rv;
+
+  if (!(fp = fopen (output, "wb")))
+  {
+    fprintf (stderr, "%s() Error opening %s: %s\n", __func__, output, strerror (errno));
+    return -1;
+  }
+
+  while ((rv = ms3_readmsr_r (&msfp, &msr, input, MSF_UNPACKDATA, 0)) == MS_NOERROR)
+  {
+    msr->starttime += MS_EPOCH2NSTIME (seconds);
+
+    if (msr3_pack (msr, write_record, fp, &packedsamples, MSF_FLUSHDATA, 0) < 0)
+      break;
+  }
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+  fclose (fp);
+
+  return (rv == MS_ENDOFFILE) ? 0 : -1;
+}
@@ -0,0 +1,275 @@
+/* Tests of indexing multiple files with database synchronization and
+ * JSON output.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <utime.h>
+
+#include <libmseed.h>
+#include <sqlite3.h>
+#include <tau/tau.h>
+#include <yyjson.h>
+
+#include "md5.h"
+
+extern int run_mseedindex (const char *arguments);
+extern int shift_file (const char *input, const char *output, int64_t seconds);
+
+#define INPUTFILE "../../libmseed/test/data/testdata-3channel-signal.mseed2"
+#define FILEA "testdata-a.mseed2"
+#define FILEB "testdata-b.mseed2"
+#define JSONFILE "testdata-sync.json"
+#define SQLITEFILE "testdata-sync.sqlite"
+#define SELECTFILE "testdata-sync.select"
+
+/* Data of the second file is shifted by 10 days, beyond the +-1 day
+ * window used to search for existing rows of a file */
+#define SHIFTSECONDS (10 * 86400)
+
+/* Create the MD5 digest string of a byte range of a file.
+ *
+ * Returns 0 on success, and -1 on error.
+ *********************************************************************/
+static int
+md5_range (const char *path, int64_t offset, int64_t count, char *digeststr)
+{
+  md5_state_t state;
+  md5_byte_t digest[16];
+  char buffer[4096];
+  FILE *fp;
+  size_t readsize;
+
+  if (!(fp = fopen (path, "rb")) || fseek (fp, (long)offset, SEEK_SET))
+  {
+    if (fp)
+      fclose (fp);
+    return -1;
+  }
+
+  md5_init (&state);
+
+  while (count > 0)
+  {
+    readsize = (count < (int64_t)sizeof (buffer)) ? (size_t)count : sizeof (buffer);
+
+    if (fread (buffer, readsize, 1, fp) != 1)
+    {
+      fclose (fp);
+      return -1;
+    }
+
+    md5_append (&state, (const md5_byte_t *)buffer, (int)readsize);
+    count -= readsize;
+  }
+
+  fclose (fp);
+  md5_finish (&state, digest);
+
+  for (int idx = 0; idx < 16; idx++)
+    sprintf (digeststr + (idx * 2), "%02x", digest[idx]);
+
+  return 0;
+}
+
+/* Determine the earliest and latest sample times of a file.
+ *
+ * Returns 0 on success, and -1 on error.
+ *********************************************************************/
+static int
+file_extents (const char *path, nstime_t *earliest, nstime_t *latest)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  nstime_t endtime;
+  int rv;
+
+  *earliest = NSTUNSET;
+  *latest = NSTUNSET;
+
+  while ((rv = ms3_readmsr_r (&msfp, &msr, path, 0, 0)) == MS_NOERROR)
+  {
+    endtime = msr3_endtime (msr);
+
+    if (*earliest == NSTUNSET || msr->starttime < *earliest)
+      *earliest = msr->starttime;
+    if (*latest == NSTUNSET || endtime > *latest)
+      *latest = endtime;
+  }
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  return (rv == MS_ENDOFFILE) ? 0 : -1;
+}
+
+/* Count the rows of the index table in an SQLite database, optionally
+ * limited to rows matching a WHERE condition.
+ *
+ * Returns the number of rows on success, and -1 on error.
+ *********************************************************************/
+static int64_t
+count_rows (const char *sqlitefile, const char *condition)
+{
+  sqlite3 *db = NULL;
+  sqlite3_stmt *statement = NULL;
+  char query[256];
+  int64_t rows = -1;
+
+  snprintf (query, sizeof (query), "SELECT count(*) FROM tsindex%s%s",
+            (condition) ? " WHERE " : "", (condition) ? condition : "");
+
+  if (sqlite3_open_v2 (sqlitefile, &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK &&
+      sqlite3_prepare_v2 (db, query, -1, &statement, NULL) == SQLITE_OK &&
+      sqlite3_step (statement) == SQLITE_ROW)
+    rows = sqlite3_column_int64 (statement, 0);
+
+  sqlite3_finalize (statement);
+  sqlite3_close (db);
+
+  return rows;
+}
+
+/* Write a data selection file with a single source identifier.
+ *
+ * Returns 0 on success, and -1 on error.
+ *********************************************************************/
+static int
+write_selection (const char *path, const char *sid)
+{
+  FILE *fp;
+
+  if (!(fp = fopen (path, "w")))
+    return -1;
+
+  fprintf (fp, "%s\n", sid);
+
+  return (fclose (fp)) ? -1 : 0;
+}
+
+TEST (sync, multifile_digests_extents)
+{
+  yyjson_doc *doc;
+  yyjson_val *root;
+  yyjson_val *pathkey;
+  yyjson_val *pathobj;
+  yyjson_val *content;
+  yyjson_val *entry;
+  yyjson_obj_iter pathiter;
+  yyjson_arr_iter entryiter;
+  nstime_t earliest;
+  nstime_t latest;
+  char digeststr[33];
+  const char *path;
+  int64_t sections = 0;
+  int files = 0;
+
+  REQUIRE (shift_file (INPUTFILE, FILEA, 0) == 0, "shift_file() did not return expected 0");
+  REQUIRE (shift_file (INPUTFILE, FILEB, SHIFTSECONDS) == 0, "shift_file() did not return expected 0");
+  remove (SQLITEFILE);
+
+  REQUIRE (run_mseedindex ("-kp -json " JSONFILE " -sqlite " SQLITEFILE " " FILEA " " FILEB) == 0,
+           "mseedindex did not exit with expected 0");
+
+  doc = yyjson_read_file (JSONFILE, 0, NULL, NULL);
+  REQUIRE (doc != NULL, "Cannot read JSON output");
+  root = yyjson_doc_get_root (doc);
+
+  /* Each file has its own time extents and digests of its sections */
+  yyjson_obj_iter_init (root, &pathiter);
+  while ((pathkey = yyjson_obj_iter_next (&pathiter)))
+  {
+    path = yyjson_get_str (pathkey);
+    pathobj = yyjson_obj_iter_get_val (pathkey);
+    files++;
+
+    CHECK (file_extents (path, &earliest, &latest) == 0);
+    CHECK (yyjson_get_sint (yyjson_obj_get (pathobj, "start")) == earliest);
+    CHECK (yyjson_get_sint (yyjson_obj_get (pathobj, "end")) == latest);
+
+    content = yyjson_obj_get (pathobj, "content");
+    CHECK (yyjson_arr_size (content) > 0);
+
+    yyjson_arr_iter_init (content, &entryiter);
+    while ((entry = yyjson_arr_iter_next (&entryiter)))
+    {
+      sections++;
+
+      CHECK (md5_range (path,
+                        yyjson_get_sint (yyjson_obj_get (entry, "byte_offset")),
+                        yyjson_get_sint (yyjson_obj_get (entry, "byte_count")),
+                        digeststr) == 0);
+      CHECK_STREQ (yyjson_get_str (yyjson_obj_get (entry, "md5")), digeststr);
+    }
+  }
+
+  yyjson_doc_free (doc);
+
+  CHECK (files == 2);
+  CHECK (count_rows (SQLITEFILE, NULL) == sections);
+
+  /* Existing rows of both files are found by their extents and replaced */
+  REQUIRE (run_mseedindex ("-kp -sqlite " SQLITEFILE " " FILEA " " FILEB) == 0,
+           "mseedindex did not exit with expected 0");
+  CHECK (count_rows (SQLITEFILE, NULL) == sections);
+}
+
+TEST (sync, reindex_retains_updated)
+{
+  struct utimbuf original = {1577836800, 1577836800}; /* 2020-01-01T00:00:00 */
+  struct utimbuf modified = {1609459200, 1609459200}; /* 2021-01-01T00:00:00 */
+  int64_t rows;
+
+  REQUIRE (shift_file (INPUTFILE, FILEA, 0) == 0, "shift_file() did not return expected 0");
+  REQUIRE (shift_file (INPUTFILE, FILEB, SHIFTSECONDS) == 0, "shift_file() did not return expected 0");
+  REQUIRE (utime (FILEA, &original) == 0 && utime (FILEB, &original) == 0, "Cannot set file times");
+  remove (SQLITEFILE);
+
+  REQUIRE (run_mseedindex ("-sqlite " SQLITEFILE " " FILEA " " FILEB) == 0,
+           "mseedindex did not exit with expected 0");
+
+  rows = count_rows (SQLITEFILE, NULL);
+  CHECK (rows > 0);
+  CHECK (count_rows (SQLITEFILE, "updated = '2020-01-01T00:00:00'") == rows);
+
+  /* Unchanged sections of both files retain their updated time, while
+   * the file modification time is replaced */
+  REQUIRE (utime (FILEA, &modified) == 0 && utime (FILEB, &modified) == 0, "Cannot set file times");
+  REQUIRE (run_mseedindex ("-sqlite " SQLITEFILE " " FILEA " " FILEB) == 0,
+           "mseedindex did not exit with expected 0");
+
+  CHECK (count_rows (SQLITEFILE, NULL) == rows);
+  CHECK (count_rows (SQLITEFILE, "updated = '2020-01-01T00:00:00'") == rows);
+  CHECK (count_rows (SQLITEFILE, "filemodtime = '2021-01-01T00:00:00'") == rows);
+}
+
+TEST (sync, selection_retains_sources)
+{
+  REQUIRE (shift_file (INPUTFILE, FILEA, 0) == 0, "shift_file() did not return expected 0");
+  remove (SQLITEFILE);
+
+  /* Index a file in passes for different channels */
+  REQUIRE (write_selection (SELECTFILE, "FDSN:IU_COLA_00_L_H_Z") == 0, "Cannot write selection file");
+  REQUIRE (run_mseedindex ("-s " SELECTFILE " -sqlite " SQLITEFILE " " FILEA) == 0,
+           "mseedindex did not exit with expected 0");
+  CHECK (count_rows (SQLITEFILE, NULL) == 1);
+  CHECK (count_rows (SQLITEFILE, "channel = 'LHZ'") == 1);
+
+  REQUIRE (write_selection (SELECTFILE, "FDSN:IU_COLA_00_L_H_1") == 0, "Cannot write selection file");
+  REQUIRE (run_mseedindex ("-s " SELECTFILE " -sqlite " SQLITEFILE " " FILEA) == 0,
+           "mseedindex did not exit with expected 0");
+  CHECK (count_rows (SQLITEFILE, NULL) == 2);
+  CHECK (count_rows (SQLITEFILE, "channel = 'LHZ'") == 1);
+  CHECK (count_rows (SQLITEFILE, "channel = 'LH1'") == 1);
+
+  /* Re-indexing a selected channel replaces only its rows */
+  REQUIRE (write_selection (SELECTFILE, "FDSN:IU_COLA_00_L_H_Z") == 0, "Cannot write selection file");
+  REQUIRE (run_mseedindex ("-s " SELECTFILE " -sqlite " SQLITEFILE " " FILEA) == 0,
+           "mseedindex did not exit with expected 0");
+  CHECK (count_rows (SQLITEFILE, NULL) == 2);
+  CHECK (count_rows (SQLITEFILE, "channel = 'LHZ'") == 1);
+
+  /* Indexing without selections replaces all rows of the file */
+  REQUIRE (run_mseedindex ("-sqlite " SQLITEFILE " " FILEA) == 0,
+           "mseedindex did not exit with expected 0");
+  CHECK (count_rows (SQLITEFILE, NULL) == 3);
+}
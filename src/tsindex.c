@@ -0,0 +1,1683 @@
+/***************************************************************************
+ * tsindex.c - Routines for reading time series index rows.
+ *
+ * Query a time series index table in an SQLite database, as created by
+ * mseedindex, for rows matching request selections and determine the
+ * byte ranges of data within each row (section) for a time window
+ * using the time index.
+ *
+ * The time index of a row is a list of 'time=>offset' pairs with epoch
+ * times, followed by a 'latest=>[0|1]' flag, for example:
+ *
+ *   '1267253400.069539=>0,1267256935.069538=>15654,latest=>1'
+ *
+ * Time markers are always at increasing byte offsets, records before
+ * an offset do not contain data later than the corresponding time.
+ * If 'latest' is 1 the records are in time order and records at or
+ * after an offset do not contain data earlier than the time.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tsindex.h"
+
+/* Fields of index rows in the order expected by ReadRows() */
+#define ROWFIELDS "network,station,location,channel,version,starttime,endtime," \
+                  "samplerate,filename,byteoffset,bytes,hash,timeindex,timespans,timerates"
+
+/* A sorted list of spans from a row and the position of the next span */
+typedef struct SpanRun
+{
+  TSIndexSpan *spans;
+  int count;
+  int position;
+} SpanRun;
+
+/* State for merging the span lists of a channel, arrays are reused */
+typedef struct SpanMerge
+{
+  SpanRun *runs;
+  int runcount;
+  int runmax;
+  int *heap;
+  int heapmax;
+  TSIndexSpan *open; /* Extents that may be extended, one per sample rate */
+  int64_t opencount;
+  int64_t openmax;
+  TSIndexSpan *extents;
+  int64_t extentcount;
+  int64_t extentmax;
+  TSIndexSpan *gaps;
+  int64_t gapcount;
+  int64_t gapmax;
+  double timetol;
+  double sampratetol;
+  nstime_t starttime;
+  nstime_t endtime;
+} SpanMerge;
+
+static sqlite3_stmt *PrepareSelect (sqlite3 *dbconn, const char *table, const char *select,
+                                    const TSIndexRequest *request, const char *orderby);
+static int64_t ReadRows (sqlite3_stmt *statement, TSIndexRow **rows);
+static int MergeChannel (SpanMerge *merge, TSIndexAvailability *availability);
+static int AddSpan (SpanMerge *merge, const TSIndexSpan *span);
+static int AppendSpan (TSIndexSpan **spans, int64_t *count, int64_t *max, const TSIndexSpan *span);
+static void HeapUp (SpanMerge *merge, int position);
+static void HeapDown (SpanMerge *merge, int position, int heapcount);
+static nstime_t RunStart (const SpanMerge *merge, int run);
+static nstime_t SamplePeriod (double samplerate);
+static nstime_t TimeTolerance (const SpanMerge *merge, nstime_t nsdelta);
+static int RateTolerable (const SpanMerge *merge, double ratea, double rateb);
+static int SpansSorted (const TSIndexSpan *spans, int count);
+static int CompareSpanStart (const void *a, const void *b);
+static int CompareRanges (const void *a, const void *b);
+static int CompareRangeNames (const void *a, const void *b);
+static int CopyPattern (char *dest, size_t destsize, const char *pattern, int allowempty);
+static int HasWildcards (const char *pattern);
+static char *DupColumn (sqlite3_stmt *statement, int column);
+
+/***************************************************************************
+ * tsindex_addrequest():
+ *
+ * Add a request selection to the end of a request list.  NULL or empty
+ * patterns match everything, a location pattern of "--" matches an
+ * empty location.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+tsindex_addrequest (TSIndexRequest **requests, const char *network,
+                    const char *station, const char *location,
+                    const char *channel, nstime_t starttime, nstime_t endtime)
+{
+  TSIndexRequest *request;
+  TSIndexRequest *last;
+
+  if (!requests)
+    return -1;
+
+  if (!(request = calloc (1, sizeof (TSIndexRequest))))
+  {
+    ms_log (2, "Cannot allocate memory for request\n");
+    return -1;
+  }
+
+  /* Replace "--" location ID request alias with true empty value */
+  if (location && !strcmp (location, "--"))
+    location = "";
+  else if (location && !*location)
+    location = NULL;
+
+  if (CopyPattern (request->network, sizeof (request->network), network, 0) ||
+      CopyPattern (request->station, sizeof (request->station), station, 0) ||
+      CopyPattern (request->location, sizeof (request->location), location, 1) ||
+      CopyPattern (request->channel, sizeof (request->channel), channel, 0))
+  {
+    ms_log (2, "Request pattern too long: %s_%s_%s_%s\n",
+            (network) ? network : "", (station) ? station : "",
+            (location) ? location : "", (channel) ? channel : "");
+    free (request);
+    return -1;
+  }
+
+  request->starttime = starttime;
+  request->endtime = endtime;
+
+  if (*requests)
+  {
+    last = *requests;
+    while (last->next)
+      last = last->next;
+    last->next = request;
+  }
+  else
+  {
+    *requests = request;
+  }
+
+  return 0;
+} /* End of tsindex_addrequest() */
+
+/***************************************************************************
+ * tsindex_readrequestfile():
+ *
+ * Read request selections from a file and add them to a request list.
+ * The expected selection format is:
+ *
+ *   Network Station Location Channel StartTime EndTime
+ *
+ * where the fields are space delimited, Network, Station, Location and
+ * Channel may contain '*' and '?' wildcards and StartTime and EndTime
+ * are date-times or '*'.  Empty lines and lines starting with '#' are
+ * ignored.
+ *
+ * Returns the number of selections added on success and -1 on error.
+ ***************************************************************************/
+int
+tsindex_readrequestfile (TSIndexRequest **requests, const char *filename)
+{
+  FILE *fp;
+  char line[1024];
+  char network[64];
+  char station[64];
+  char location[64];
+  char channel[64];
+  char starttimestr[64];
+  char endtimestr[64];
+  nstime_t starttime;
+  nstime_t endtime;
+  char *cp;
+  int linenumber = 0;
+  int count = 0;
+
+  if (!requests || !filename)
+    return -1;
+
+  if (!(fp = fopen (filename, "r")))
+  {
+    ms_log (2, "Cannot open request file %s\n", filename);
+    return -1;
+  }
+
+  while (fgets (line, sizeof (line), fp))
+  {
+    linenumber++;
+
+    /* Skip leading white space */
+    cp = line;
+    while (isspace ((unsigned char)*cp))
+      cp++;
+
+    if (*cp == '\0' || *cp == '#')
+      continue;
+
+    if (sscanf (cp, "%63s %63s %63s %63s %63s %63s",
+                network, station, location, channel, starttimestr, endtimestr) != 6)
+    {
+      ms_log (2, "Unrecognized selection line (%d) in %s: '%s'\n", linenumber, filename, cp);
+      fclose (fp);
+      return -1;
+    }
+
+    starttime = NSTUNSET;
+    endtime = NSTUNSET;
+
+    if (strcmp (starttimestr, "*") && (starttime = ms_timestr2nstime (starttimestr)) == NSTERROR)
+    {
+      ms_log (2, "Cannot convert start time (line %d) in %s: %s\n", linenumber, filename, starttimestr);
+      fclose (fp);
+      return -1;
+    }
+
+    if (strcmp (endtimestr, "*") && (endtime = ms_timestr2nstime (endtimestr)) == NSTERROR)
+    {
+      ms_log (2, "Cannot convert end time (line %d) in %s: %s\n", linenumber, filename, endtimestr);
+      fclose (fp);
+      return -1;
+    }
+
+    if (tsindex_addrequest (requests, network, station, location, channel, starttime, endtime))
+    {
+      fclose (fp);
+      return -1;
+    }
+
+    count++;
+  }
+
+  fclose (fp);
+
+  return count;
+} /* End of tsindex_readrequestfile() */
+
+/***************************************************************************
+ * tsindex_freerequests():
+ *
+ * Free a request list and set the pointer to NULL.
+ ***************************************************************************/
+void
+tsindex_freerequests (TSIndexRequest **requests)
+{
+  TSIndexRequest *request;
+  TSIndexRequest *next;
+
+  if (!requests)
+    return;
+
+  request = *requests;
+  while (request)
+  {
+    next = request->next;
+    free (request);
+    request = next;
+  }
+
+  *requests = NULL;
+} /* End of tsindex_freerequests() */
+
+/***************************************************************************
+ * tsindex_query():
+ *
+ * Query the index table for rows matching a request selection, the
+ * NSLC patterns are matched with GLOB and rows are selected if their
+ * time range intersects the request time window.
+ *
+ * The time index of each row is decoded.  The returned array of rows
+ * is allocated and must be freed with tsindex_freerows().  Rows are
+ * returned in the order provided by the database.
+ *
+ * Returns the number of rows on success and -1 on error.
+ ***************************************************************************/
+int64_t
+tsindex_query (sqlite3 *dbconn, const char *table,
+               const TSIndexRequest *request, TSIndexRow **rows)
+{
+  sqlite3_stmt *statement;
+  int64_t rowcount;
+
+  if (!dbconn || !table || !request || !rows)
+    return -1;
+
+  *rows = NULL;
+
+  if (!(statement = PrepareSelect (dbconn, table, ROWFIELDS, request, NULL)))
+    return -1;
+
+  rowcount = ReadRows (statement, rows);
+
+  sqlite3_finalize (statement);
+
+  return rowcount;
+} /* End of tsindex_query() */
+
+/***************************************************************************
+ * tsindex_queryfile():
+ *
+ * Query the index table for all rows of a file.  If the filename
+ * contains a version suffix ('#version') rows for all versions of the
+ * file, i.e. with the same name before the '#', are returned, matching
+ * the rows replaced by mseedindex when synchronizing a versioned file.
+ *
+ * The returned array of rows is allocated and must be freed with
+ * tsindex_freerows().
+ *
+ * Returns the number of rows on success and -1 on error.
+ ***************************************************************************/
+int64_t
+tsindex_queryfile (sqlite3 *dbconn, const char *table,
+                   const char *filename, TSIndexRow **rows)
+{
+  sqlite3_stmt *statement = NULL;
+  char query[512];
+  char *upper = NULL;
+  const char *vp;
+  size_t baselength;
+  int64_t rowcount;
+
+  if (!dbconn || !table || !filename || !rows)
+    return -1;
+
+  *rows = NULL;
+
+  if ((vp = strrchr (filename, '#')))
+  {
+    /* Range of names starting with the base name, allows the filename index to be used */
+    baselength = vp - filename;
+
+    if (baselength == 0 || !(upper = strdup (filename)))
+      return -1;
+
+    upper[baselength - 1]++;
+    upper[baselength] = '\0';
+
+    snprintf (query, sizeof (query),
+              "SELECT " ROWFIELDS " FROM %s WHERE filename >= ? AND filename < ?", table);
+  }
+  else
+  {
+    snprintf (query, sizeof (query),
+              "SELECT " ROWFIELDS " FROM %s WHERE filename = ?", table);
+  }
+
+  if (sqlite3_prepare_v2 (dbconn, query, -1, &statement, NULL) != SQLITE_OK)
+  {
+    ms_log (2, "SQLite SELECT preparation failed: %s\n", sqlite3_errmsg (dbconn));
+    free (upper);
+    return -1;
+  }
+
+  if (vp)
+  {
+    sqlite3_bind_text (statement, 1, filename, (int)baselength, SQLITE_STATIC);
+    sqlite3_bind_text (statement, 2, upper, -1, SQLITE_STATIC);
+  }
+  else
+  {
+    sqlite3_bind_text (statement, 1, filename, -1, SQLITE_STATIC);
+  }
+
+  rowcount = ReadRows (statement, rows);
+
+  sqlite3_finalize (statement);
+  free (upper);
+
+  return rowcount;
+} /* End of tsindex_queryfile() */
+
+/***************************************************************************
+ * tsindex_availability():
+ *
+ * Determine the merged availability of each channel matching a request
+ * selection.  Rows are read in channel order without loading the
+ * entire result, the time spans of each row (or the row time range if
+ * not available) are decoded and the sorted span lists of all rows of
+ * a channel are merged in time order with a k-way merge.
+ *
+ * Spans are merged into an extent when they overlap or are contiguous,
+ * i.e. the gap after the end of the extent and one sample period is
+ * within the time tolerance, and the sample rates are within the rate
+ * tolerance.  The tolerances follow mstl3_addmsr(): a negative
+ * 'timetol' is the default of 1/2 sample period and a negative
+ * 'sampratetol' is the default rate test of MS_ISRATETOLERABLE(),
+ * otherwise they are seconds and the absolute rate difference.
+ *
+ * Extents are trimmed to the request time window and gaps between
+ * extents beyond the time tolerance are identified.  The handler is
+ * called with the availability of each channel, the arrays are only
+ * valid during the call.
+ *
+ * Returns the number of channels on success and -1 on error, including
+ * a non-zero return from the handler.
+ ***************************************************************************/
+int64_t
+tsindex_availability (sqlite3 *dbconn, const char *table,
+                      const TSIndexRequest *request,
+                      double timetol, double sampratetol,
+                      TSIndexAvailabilityHandler handler, void *handlerdata)
+{
+  sqlite3_stmt *statement;
+  TSIndexAvailability availability;
+  SpanMerge merge;
+  SpanRun *newruns;
+  SpanRun *run;
+  const char *codes[4];
+  const char *timespans;
+  const char *timerates;
+  double samplerate;
+  int64_t channelcount = 0;
+  int error = 0;
+  int idx;
+  int rv;
+
+  if (!dbconn || !table || !request || !handler)
+    return -1;
+
+  memset (&availability, 0, sizeof (availability));
+  memset (&merge, 0, sizeof (merge));
+  merge.timetol = timetol;
+  merge.sampratetol = sampratetol;
+  merge.starttime = request->starttime;
+  merge.endtime = request->endtime;
+
+  if (!(statement = PrepareSelect (dbconn, table,
+                                   "network,station,location,channel,starttime,endtime,"
+                                   "samplerate,timespans,timerates",
+                                   request, "network,station,location,channel")))
+    return -1;
+
+  while ((rv = sqlite3_step (statement)) == SQLITE_ROW)
+  {
+    for (idx = 0; idx < 4; idx++)
+      codes[idx] = (const char *)sqlite3_column_text (statement, idx);
+
+    if (!codes[0] || !codes[1] || !codes[2] || !codes[3])
+      continue;
+
+    /* Merge and report previous channel when the channel changes */
+    if (merge.runcount > 0 &&
+        (strcmp (codes[0], availability.network) || strcmp (codes[1], availability.station) ||
+         strcmp (codes[2], availability.location) || strcmp (codes[3], availability.channel)))
+    {
+      if (MergeChannel (&merge, &availability) || handler (&availability, handlerdata))
+      {
+        error = 1;
+        break;
+      }
+
+      channelcount++;
+    }
+
+    if (merge.runcount == 0)
+    {
+      snprintf (availability.network, sizeof (availability.network), "%s", codes[0]);
+      snprintf (availability.station, sizeof (availability.station), "%s", codes[1]);
+      snprintf (availability.location, sizeof (availability.location), "%s", codes[2]);
+      snprintf (availability.channel, sizeof (availability.channel), "%s", codes[3]);
+    }
+
+    if (merge.runcount == merge.runmax)
+    {
+      merge.runmax = (merge.runmax) ? merge.runmax * 2 : 64;
+
+      if (!(newruns = realloc (merge.runs, merge.runmax * sizeof (SpanRun))))
+      {
+        ms_log (2, "Cannot allocate memory for span lists\n");
+        error = 1;
+        break;
+      }
+
+      merge.runs = newruns;
+    }
+
+    run = &merge.runs[merge.runcount];
+    memset (run, 0, sizeof (SpanRun));
+
+    samplerate = sqlite3_column_double (statement, 6);
+    timespans = (const char *)sqlite3_column_text (statement, 7);
+    timerates = (const char *)sqlite3_column_text (statement, 8);
+
+    /* Use time spans if available, otherwise the time range of the row */
+    if (!timespans ||
+        tsindex_parse_timespans (timespans, timerates, samplerate, &run->spans, &run->count))
+    {
+      if (!(run->spans = malloc (sizeof (TSIndexSpan))))
+      {
+        ms_log (2, "Cannot allocate memory for span list\n");
+        error = 1;
+        break;
+      }
+
+      run->spans[0].start = ms_timestr2nstime ((const char *)sqlite3_column_text (statement, 4));
+      run->spans[0].end = ms_timestr2nstime ((const char *)sqlite3_column_text (statement, 5));
+      run->spans[0].samplerate = samplerate;
+      run->count = 1;
+
+      if (run->spans[0].start == NSTERROR || run->spans[0].end == NSTERROR)
+      {
+        ms_log (2, "Cannot parse time range for %s_%s_%s_%s\n",
+                codes[0], codes[1], codes[2], codes[3]);
+        free (run->spans);
+        error = 1;
+        break;
+      }
+    }
+
+    merge.runcount++;
+  }
+
+  if (!error && rv != SQLITE_DONE)
+  {
+    ms_log (2, "Cannot step through SQLite results: %s\n", sqlite3_errstr (rv));
+    error = 1;
+  }
+
+  /* Merge and report the last channel */
+  if (!error && merge.runcount > 0)
+  {
+    if (MergeChannel (&merge, &availability) || handler (&availability, handlerdata))
+      error = 1;
+    else
+      channelcount++;
+  }
+
+  sqlite3_finalize (statement);
+
+  for (idx = 0; idx < merge.runcount; idx++)
+    free (merge.runs[idx].spans);
+  free (merge.runs);
+  free (merge.heap);
+  free (merge.open);
+  free (merge.extents);
+  free (merge.gaps);
+
+  return (error) ? -1 : channelcount;
+} /* End of tsindex_availability() */
+
+/***************************************************************************
+ * tsindex_freerows():
+ *
+ * Free an array of rows returned by tsindex_query().
+ ***************************************************************************/
+void
+tsindex_freerows (TSIndexRow *rows, int64_t rowcount)
+{
+  int64_t idx;
+
+  if (!rows)
+    return;
+
+  for (idx = 0; idx < rowcount; idx++)
+  {
+    free (rows[idx].filename);
+    free (rows[idx].tindex);
+    free (rows[idx].timespans);
+    free (rows[idx].timerates);
+  }
+
+  free (rows);
+} /* End of tsindex_freerows() */
+
+/***************************************************************************
+ * tsindex_parse_timeindex():
+ *
+ * Decode a time index string of 'time=>offset' pairs and a trailing
+ * 'latest=>[0|1]' flag.  The returned array of entries is allocated
+ * and must be freed by the caller.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+tsindex_parse_timeindex (const char *timeindex, TSIndexEntry **entries,
+                         int *count, int *latest)
+{
+  const char *cp;
+  char *endptr;
+  int maxcount = 1;
+
+  if (!timeindex || !entries || !count || !latest)
+    return -1;
+
+  *entries = NULL;
+  *count = 0;
+  *latest = 0;
+
+  /* Count pairs to allocate entries */
+  for (cp = timeindex; *cp; cp++)
+    if (*cp == ',')
+      maxcount++;
+
+  if (!(*entries = malloc (maxcount * sizeof (TSIndexEntry))))
+    return -1;
+
+  cp = timeindex;
+  while (*cp)
+  {
+    if (!strncmp (cp, "latest=>", 8))
+    {
+      *latest = (int)strtol (cp + 8, &endptr, 10);
+    }
+    else
+    {
+      (*entries)[*count].time = tsindex_epoch2nstime (cp, &endptr);
+
+      if ((*entries)[*count].time == NSTERROR || strncmp (endptr, "=>", 2))
+        break;
+
+      (*entries)[*count].offset = strtoll (endptr + 2, &endptr, 10);
+      (*count)++;
+    }
+
+    if (*endptr == ',')
+      endptr++;
+    else if (*endptr != '\0')
+      break;
+
+    cp = endptr;
+  }
+
+  if (*cp != '\0' || *count == 0)
+  {
+    free (*entries);
+    *entries = NULL;
+    *count = 0;
+    return -1;
+  }
+
+  return 0;
+} /* End of tsindex_parse_timeindex() */
+
+/***************************************************************************
+ * tsindex_parse_timespans():
+ *
+ * Decode a time spans string of '[start:end]' epoch time pairs and,
+ * if available, the corresponding time rates string of comma-separated
+ * sample rates.  Without time rates each span is assigned the nominal
+ * sample rate of the row.  The returned array of spans is allocated
+ * and must be freed by the caller.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+tsindex_parse_timespans (const char *timespans, const char *timerates,
+                         double samplerate, TSIndexSpan **spans, int *count)
+{
+  const char *cp;
+  const char *rp = timerates;
+  char *endptr;
+  char *ratepos;
+  int maxcount = 1;
+
+  if (!timespans || !spans || !count)
+    return -1;
+
+  *spans = NULL;
+  *count = 0;
+
+  for (cp = timespans; *cp; cp++)
+    if (*cp == '[')
+      maxcount++;
+
+  if (!(*spans = malloc (maxcount * sizeof (TSIndexSpan))))
+    return -1;
+
+  cp = timespans;
+  while (*cp == '[')
+  {
+    (*spans)[*count].start = tsindex_epoch2nstime (cp + 1, &endptr);
+
+    if ((*spans)[*count].start == NSTERROR || *endptr != ':')
+      break;
+
+    (*spans)[*count].end = tsindex_epoch2nstime (endptr + 1, &endptr);
+
+    if ((*spans)[*count].end == NSTERROR || *endptr != ']')
+      break;
+
+    (*spans)[*count].samplerate = samplerate;
+
+    /* Rates correspond to spans in order */
+    if (rp && *rp)
+    {
+      (*spans)[*count].samplerate = strtod (rp, &ratepos);
+      rp = (*ratepos == ',') ? ratepos + 1 : ratepos;
+    }
+
+    (*count)++;
+
+    cp = endptr + 1;
+    if (*cp == ',')
+      cp++;
+  }
+
+  if (*cp != '\0' || *count == 0)
+  {
+    free (*spans);
+    *spans = NULL;
+    *count = 0;
+    return -1;
+  }
+
+  return 0;
+} /* End of tsindex_parse_timespans() */
+
+/***************************************************************************
+ * tsindex_byterange():
+ *
+ * Determine the byte range of a row (section) that contains the data
+ * for a time window using the time index of the row.  The start is the
+ * offset of the last time marker at or before the window start.  When
+ * records are in time order the end is before the first time marker
+ * after the window end, otherwise the range extends to the end of the
+ * section.  Without a time index the range is the entire section.
+ *
+ * The range may contain records outside the time window, but contains
+ * all records with data in the window.
+ *
+ * Returns 1 when the row has data in the time window, 0 when it does not
+ * and -1 on error.
+ ***************************************************************************/
+int
+tsindex_byterange (const TSIndexRow *row, nstime_t starttime, nstime_t endtime,
+                   int64_t *offset, int64_t *length)
+{
+  int64_t start;
+  int64_t end;
+  int idx;
+
+  if (!row || !offset || !length)
+    return -1;
+
+  if ((endtime != NSTUNSET && row->starttime > endtime) ||
+      (starttime != NSTUNSET && row->endtime < starttime))
+    return 0;
+
+  start = row->byteoffset;
+  end = row->byteoffset + row->bytes;
+
+  if (row->tindex)
+  {
+    for (idx = 0; idx < row->tindexcount; idx++)
+    {
+      if (starttime != NSTUNSET && row->tindex[idx].time <= starttime)
+        start = row->tindex[idx].offset;
+
+      if (row->latest && endtime != NSTUNSET && row->tindex[idx].time > endtime)
+      {
+        end = row->tindex[idx].offset;
+        break;
+      }
+    }
+
+    /* Guard against index offsets outside of the section */
+    if (start < row->byteoffset || start >= row->byteoffset + row->bytes)
+      start = row->byteoffset;
+    if (end <= start || end > row->byteoffset + row->bytes)
+      end = row->byteoffset + row->bytes;
+  }
+
+  *offset = start;
+  *length = end - start;
+
+  return 1;
+} /* End of tsindex_byterange() */
+
+/***************************************************************************
+ * tsindex_globmatch():
+ *
+ * Match a string against a glob pattern with the wildcards used in
+ * request selections, matching the SQLite GLOB operator:
+ *
+ *   '*'      matches zero or more characters
+ *   '?'      matches a single character
+ *   '[list]' matches a character in the list, ranges and negation
+ *            with '^' or '!' are supported
+ *
+ * Returns 1 if the string matches the pattern, otherwise 0.
+ ***************************************************************************/
+int
+tsindex_globmatch (const char *string, const char *pattern)
+{
+  const char *star = NULL;
+  const char *starstring = NULL;
+  const char *pp;
+  int negate;
+  int matched;
+
+  if (!string || !pattern)
+    return 0;
+
+  while (*string)
+  {
+    if (*pattern == '*')
+    {
+      /* Note position for backtracking */
+      star = pattern++;
+      starstring = string;
+      continue;
+    }
+
+    if (*pattern == '?')
+    {
+      pattern++;
+      string++;
+      continue;
+    }
+
+    if (*pattern == '[')
+    {
+      pp = pattern + 1;
+      negate = (*pp == '^' || *pp == '!');
+      if (negate)
+        pp++;
+
+      matched = 0;
+      do
+      {
+        if (pp[1] == '-' && pp[2] && pp[2] != ']')
+        {
+          if (*string >= pp[0] && *string <= pp[2])
+            matched = 1;
+          pp += 3;
+        }
+        else
+        {
+          if (*string == *pp)
+            matched = 1;
+          pp++;
+        }
+      } while (*pp && *pp != ']');
+
+      if (*pp == ']' && matched != negate)
+      {
+        pattern = pp + 1;
+        string++;
+        continue;
+      }
+    }
+    else if (*pattern == *string)
+    {
+      pattern++;
+      string++;
+      continue;
+    }
+
+    /* Mismatch, backtrack to the last '*' if any */
+    if (!star)
+      return 0;
+
+    pattern = star + 1;
+    string = ++starstring;
+  }
+
+  while (*pattern == '*')
+    pattern++;
+
+  return (*pattern == '\0') ? 1 : 0;
+} /* End of tsindex_globmatch() */
+
+/***************************************************************************
+ * tsindex_planrange():
+ *
+ * Add a byte range of a file and the time window of data wanted from
+ * the range to a read plan.  The plan must be initialized to zero
+ * before the first range is added.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+tsindex_planrange (TSIndexPlan *plan, const char *filename, int64_t offset,
+                   int64_t length, nstime_t starttime, nstime_t endtime)
+{
+  TSIndexRange *newranges;
+  TSIndexRange *range;
+
+  if (!plan || !filename || offset < 0 || length <= 0)
+    return -1;
+
+  if (plan->rangecount == plan->rangemax)
+  {
+    plan->rangemax = (plan->rangemax) ? plan->rangemax * 2 : 64;
+
+    if (!(newranges = realloc (plan->ranges, plan->rangemax * sizeof (TSIndexRange))))
+    {
+      ms_log (2, "Cannot allocate memory for read plan\n");
+      return -1;
+    }
+
+    plan->ranges = newranges;
+  }
+
+  range = &plan->ranges[plan->rangecount];
+
+  /* Share the file name of the previous range when the same */
+  if (plan->rangecount > 0 && !strcmp (plan->ranges[plan->rangecount - 1].filename, filename))
+    range->filename = plan->ranges[plan->rangecount - 1].filename;
+  else if (!(range->filename = strdup (filename)))
+  {
+    ms_log (2, "Cannot allocate memory for read plan\n");
+    return -1;
+  }
+
+  range->offset = offset;
+  range->length = length;
+  range->starttime = starttime;
+  range->endtime = endtime;
+  plan->rangecount++;
+
+  return 0;
+} /* End of tsindex_planrange() */
+
+/***************************************************************************
+ * tsindex_planrow():
+ *
+ * Add the byte range of a row (section) containing a time window, as
+ * determined by tsindex_byterange(), to a read plan.
+ *
+ * Returns 1 when the range was added, 0 when the row has no data in
+ * the time window and -1 on error.
+ ***************************************************************************/
+int
+tsindex_planrow (TSIndexPlan *plan, const TSIndexRow *row,
+                 nstime_t starttime, nstime_t endtime)
+{
+  int64_t offset;
+  int64_t length;
+  int rv;
+
+  if ((rv = tsindex_byterange (row, starttime, endtime, &offset, &length)) <= 0)
+    return rv;
+
+  if (tsindex_planrange (plan, row->filename, offset, length, starttime, endtime))
+    return -1;
+
+  return 1;
+} /* End of tsindex_planrow() */
+
+/***************************************************************************
+ * tsindex_planreads():
+ *
+ * Sort the ranges of a plan by file and offset and coalesce ranges of
+ * the same file into reads when they overlap or the gap between them
+ * is at most 'gapthreshold' bytes.  Reads are in file and offset order
+ * for sequential access, and refer to the ranges they cover, in offset
+ * order, for selecting the data wanted from a read.
+ *
+ * Returns the number of reads on success and -1 on error.
+ ***************************************************************************/
+int64_t
+tsindex_planreads (TSIndexPlan *plan, int64_t gapthreshold)
+{
+  TSIndexRange *range;
+  TSIndexRead *read = NULL;
+  int64_t idx;
+
+  if (!plan)
+    return -1;
+
+  free (plan->reads);
+  plan->reads = NULL;
+  plan->readcount = 0;
+
+  if (plan->rangecount == 0)
+    return 0;
+
+  if (plan->rangecount > 1)
+    qsort (plan->ranges, plan->rangecount, sizeof (TSIndexRange), CompareRanges);
+
+  /* At most one read per range */
+  if (!(plan->reads = malloc (plan->rangecount * sizeof (TSIndexRead))))
+  {
+    ms_log (2, "Cannot allocate memory for read plan\n");
+    return -1;
+  }
+
+  for (idx = 0; idx < plan->rangecount; idx++)
+  {
+    range = &plan->ranges[idx];
+
+    if (read && (read->filename == range->filename || !strcmp (read->filename, range->filename)) &&
+        range->offset - (read->offset + read->length) <= gapthreshold)
+    {
+      if (range->offset + range->length > read->offset + read->length)
+        read->length = range->offset + range->length - read->offset;
+
+      read->rangecount++;
+      continue;
+    }
+
+    read = &plan->reads[plan->readcount++];
+    read->filename = range->filename;
+    read->offset = range->offset;
+    read->length = range->length;
+    read->firstrange = idx;
+    read->rangecount = 1;
+  }
+
+  return plan->readcount;
+} /* End of tsindex_planreads() */
+
+/***************************************************************************
+ * tsindex_planfree():
+ *
+ * Free the ranges and reads of a plan and reset it to empty.
+ ***************************************************************************/
+void
+tsindex_planfree (TSIndexPlan *plan)
+{
+  char *filename = NULL;
+  int64_t idx;
+
+  if (!plan)
+    return;
+
+  /* File names are shared by consecutive ranges, free each once */
+  qsort (plan->ranges, plan->rangecount, sizeof (TSIndexRange), CompareRangeNames);
+
+  for (idx = 0; idx < plan->rangecount; idx++)
+  {
+    if (plan->ranges[idx].filename != filename)
+    {
+      filename = plan->ranges[idx].filename;
+      free (filename);
+    }
+  }
+
+  free (plan->ranges);
+  free (plan->reads);
+  memset (plan, 0, sizeof (TSIndexPlan));
+} /* End of tsindex_planfree() */
+
+/***************************************************************************
+ * tsindex_epoch2nstime():
+ *
+ * Convert an epoch time string with up to nanosecond resolution,
+ * e.g. '1267253400.069539', to an nstime_t without the rounding of a
+ * floating point conversion.  If 'endptr' is not NULL it is set to the
+ * first character after the value.
+ *
+ * Returns the time on success and NSTERROR on error.
+ ***************************************************************************/
+nstime_t
+tsindex_epoch2nstime (const char *string, char **endptr)
+{
+  const char *cp = string;
+  nstime_t seconds;
+  nstime_t fraction = 0;
+  nstime_t scale = NSTMODULUS;
+  int negative = 0;
+  char *end;
+
+  if (!string)
+    return NSTERROR;
+
+  if (*cp == '-')
+  {
+    negative = 1;
+    cp++;
+  }
+
+  if (!isdigit ((unsigned char)*cp))
+  {
+    if (endptr)
+      *endptr = (char *)string;
+    return NSTERROR;
+  }
+
+  seconds = strtoll (cp, &end, 10);
+  cp = end;
+
+  if (*cp == '.')
+  {
+    for (cp++; isdigit ((unsigned char)*cp); cp++)
+    {
+      if (scale > 1)
+      {
+        scale /= 10;
+        fraction += (*cp - '0') * scale;
+      }
+    }
+  }
+
+  if (endptr)
+    *endptr = (char *)cp;
+
+  seconds = seconds * NSTMODULUS + fraction;
+
+  return (negative) ? -seconds : seconds;
+} /* End of tsindex_epoch2nstime() */
+
+/***************************************************************************
+ * PrepareSelect():
+ *
+ * Prepare a statement selecting fields of the rows matching a request
+ * selection, optionally ordered by 'orderby'.  The NSLC patterns are
+ * matched with GLOB and rows are selected if their time range
+ * intersects the request time window.
+ *
+ * Returns the prepared statement on success and NULL on error.
+ ***************************************************************************/
+static sqlite3_stmt *
+PrepareSelect (sqlite3 *dbconn, const char *table, const char *select,
+               const TSIndexRequest *request, const char *orderby)
+{
+  const char *fields[4] = {"network", "station", "location", "channel"};
+  const char *patterns[4];
+  sqlite3_stmt *statement = NULL;
+  char query[1024];
+  char timestr[40];
+  size_t length;
+  int param = 0;
+  int idx;
+
+  patterns[0] = request->network;
+  patterns[1] = request->station;
+  patterns[2] = request->location;
+  patterns[3] = request->channel;
+
+  length = snprintf (query, sizeof (query), "SELECT %s FROM %s WHERE 1", select, table);
+
+  /* Add NSLC criteria, exact matches with '=' allow the table index to be used */
+  for (idx = 0; idx < 4 && length < sizeof (query); idx++)
+  {
+    if (strcmp (patterns[idx], "*"))
+      length += snprintf (query + length, sizeof (query) - length, " AND %s %s ?",
+                          fields[idx], HasWildcards (patterns[idx]) ? "GLOB" : "=");
+  }
+
+  if (request->endtime != NSTUNSET && length < sizeof (query))
+    length += snprintf (query + length, sizeof (query) - length, " AND starttime <= ?");
+  if (request->starttime != NSTUNSET && length < sizeof (query))
+    length += snprintf (query + length, sizeof (query) - length, " AND endtime >= ?");
+  if (orderby && length < sizeof (query))
+    length += snprintf (query + length, sizeof (query) - length, " ORDER BY %s", orderby);
+
+  if (length >= sizeof (query))
+  {
+    ms_log (2, "Query for table %s is too long\n", table);
+    return NULL;
+  }
+
+  if (sqlite3_prepare_v2 (dbconn, query, -1, &statement, NULL) != SQLITE_OK)
+  {
+    ms_log (2, "SQLite SELECT preparation failed: %s\n", sqlite3_errmsg (dbconn));
+    return NULL;
+  }
+
+  for (idx = 0; idx < 4; idx++)
+  {
+    if (strcmp (patterns[idx], "*"))
+      sqlite3_bind_text (statement, ++param, patterns[idx], -1, SQLITE_STATIC);
+  }
+
+  /* Time strings in the same format as stored for string comparison */
+  if (request->endtime != NSTUNSET)
+  {
+    ms_nstime2timestr (request->endtime, timestr, ISOMONTHDAY, NANO_MICRO_NONE);
+    sqlite3_bind_text (statement, ++param, timestr, -1, SQLITE_TRANSIENT);
+  }
+  if (request->starttime != NSTUNSET)
+  {
+    ms_nstime2timestr (request->starttime, timestr, ISOMONTHDAY, NANO_MICRO_NONE);
+    sqlite3_bind_text (statement, ++param, timestr, -1, SQLITE_TRANSIENT);
+  }
+
+  return statement;
+} /* End of PrepareSelect() */
+
+/***************************************************************************
+ * ReadRows():
+ *
+ * Step through the results of a prepared statement selecting the
+ * index row fields and decode each row into an allocated array.
+ *
+ * Returns the number of rows on success and -1 on error.
+ ***************************************************************************/
+static int64_t
+ReadRows (sqlite3_stmt *statement, TSIndexRow **rows)
+{
+  TSIndexRow *newrows;
+  TSIndexRow *row;
+  int64_t rowcount = 0;
+  int64_t rowmax = 0;
+  int rv;
+
+  *rows = NULL;
+
+  while ((rv = sqlite3_step (statement)) == SQLITE_ROW)
+  {
+    if (rowcount == rowmax)
+    {
+      rowmax = (rowmax) ? rowmax * 2 : 64;
+
+      if (!(newrows = realloc (*rows, rowmax * sizeof (TSIndexRow))))
+      {
+        ms_log (2, "Cannot allocate memory for index rows\n");
+        break;
+      }
+
+      *rows = newrows;
+    }
+
+    row = &(*rows)[rowcount];
+    memset (row, 0, sizeof (TSIndexRow));
+    rowcount++;
+
+    /* Fields: 0=network,1=station,2=location,3=channel,4=version,5=starttime,6=endtime,
+       7=samplerate,8=filename,9=byteoffset,10=bytes,11=hash,12=timeindex,13=timespans,14=timerates */
+    snprintf (row->network, sizeof (row->network), "%s", (const char *)sqlite3_column_text (statement, 0));
+    snprintf (row->station, sizeof (row->station), "%s", (const char *)sqlite3_column_text (statement, 1));
+    snprintf (row->location, sizeof (row->location), "%s", (const char *)sqlite3_column_text (statement, 2));
+    snprintf (row->channel, sizeof (row->channel), "%s", (const char *)sqlite3_column_text (statement, 3));
+    row->version = sqlite3_column_int (statement, 4);
+    row->starttime = ms_timestr2nstime ((const char *)sqlite3_column_text (statement, 5));
+    row->endtime = ms_timestr2nstime ((const char *)sqlite3_column_text (statement, 6));
+    row->samplerate = sqlite3_column_double (statement, 7);
+    row->filename = DupColumn (statement, 8);
+    row->byteoffset = sqlite3_column_int64 (statement, 9);
+    row->bytes = sqlite3_column_int64 (statement, 10);
+    if (sqlite3_column_text (statement, 11))
+      snprintf (row->hash, sizeof (row->hash), "%s", (const char *)sqlite3_column_text (statement, 11));
+    row->timespans = DupColumn (statement, 13);
+    row->timerates = DupColumn (statement, 14);
+
+    if (!row->filename || row->starttime == NSTERROR || row->endtime == NSTERROR)
+    {
+      ms_log (2, "Cannot parse index row for %s_%s_%s_%s\n",
+              row->network, row->station, row->location, row->channel);
+      break;
+    }
+
+    if (sqlite3_column_text (statement, 12) &&
+        tsindex_parse_timeindex ((const char *)sqlite3_column_text (statement, 12),
+                                 &row->tindex, &row->tindexcount, &row->latest))
+    {
+      ms_log (2, "Cannot parse time index for %s_%s_%s_%s in %s\n",
+              row->network, row->station, row->location, row->channel, row->filename);
+      break;
+    }
+  }
+
+  if (rv != SQLITE_DONE)
+  {
+    if (rv != SQLITE_ROW)
+      ms_log (2, "Cannot step through SQLite results: %s\n", sqlite3_errstr (rv));
+
+    tsindex_freerows (*rows, rowcount);
+    *rows = NULL;
+    return -1;
+  }
+
+  return rowcount;
+} /* End of ReadRows() */
+
+/***************************************************************************
+ * MergeChannel():
+ *
+ * Merge the span lists (runs) of a channel in time order, using a heap
+ * of runs ordered by the start of their next span, into extents trimmed
+ * to the time window and determine the gaps between extents.  The span
+ * lists are freed and the availability is set to refer to the results.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+MergeChannel (SpanMerge *merge, TSIndexAvailability *availability)
+{
+  TSIndexSpan span;
+  TSIndexSpan *extent;
+  SpanRun *run;
+  nstime_t coverend;
+  nstime_t nsdelta;
+  double coverrate;
+  int *newheap;
+  int heapcount = 0;
+  int64_t idx;
+  int rv = 0;
+
+  merge->opencount = 0;
+  merge->extentcount = 0;
+  merge->gapcount = 0;
+
+  if (merge->runcount > merge->heapmax)
+  {
+    if (!(newheap = realloc (merge->heap, merge->runcount * sizeof (int))))
+    {
+      ms_log (2, "Cannot allocate memory for merge heap\n");
+      return -1;
+    }
+
+    merge->heap = newheap;
+    merge->heapmax = merge->runcount;
+  }
+
+  /* Build heap of runs, sorting spans of runs that are not in time order */
+  for (idx = 0; idx < merge->runcount; idx++)
+  {
+    run = &merge->runs[idx];
+    run->position = 0;
+
+    if (run->count > 1 && !SpansSorted (run->spans, run->count))
+      qsort (run->spans, run->count, sizeof (TSIndexSpan), CompareSpanStart);
+
+    if (run->count > 0)
+    {
+      merge->heap[heapcount] = (int)idx;
+      HeapUp (merge, heapcount++);
+    }
+  }
+
+  while (heapcount > 0 && rv == 0)
+  {
+    run = &merge->runs[merge->heap[0]];
+    span = run->spans[run->position++];
+
+    /* Replace heap root with the next span of the run or the last run */
+    if (run->position >= run->count)
+      merge->heap[0] = merge->heap[--heapcount];
+    HeapDown (merge, 0, heapcount);
+
+    /* Trim to time window */
+    if ((merge->endtime != NSTUNSET && span.start > merge->endtime) ||
+        (merge->starttime != NSTUNSET && span.end < merge->starttime))
+      continue;
+
+    if (merge->starttime != NSTUNSET && span.start < merge->starttime)
+      span.start = merge->starttime;
+    if (merge->endtime != NSTUNSET && span.end > merge->endtime)
+      span.end = merge->endtime;
+
+    rv = AddSpan (merge, &span);
+  }
+
+  /* Complete open extents */
+  for (idx = 0; idx < merge->opencount && rv == 0; idx++)
+    rv = AppendSpan (&merge->extents, &merge->extentcount, &merge->extentmax, &merge->open[idx]);
+
+  if (merge->extentcount > 1)
+    qsort (merge->extents, merge->extentcount, sizeof (TSIndexSpan), CompareSpanStart);
+
+  /* Identify gaps between the coverage end and following extents */
+  if (rv == 0 && merge->extentcount > 0)
+  {
+    coverend = merge->extents[0].end;
+    coverrate = merge->extents[0].samplerate;
+
+    for (idx = 1; idx < merge->extentcount && rv == 0; idx++)
+    {
+      extent = &merge->extents[idx];
+      nsdelta = SamplePeriod (coverrate);
+
+      if (extent->start - coverend - nsdelta > TimeTolerance (merge, nsdelta))
+      {
+        span.start = coverend;
+        span.end = extent->start;
+        span.samplerate = coverrate;
+
+        rv = AppendSpan (&merge->gaps, &merge->gapcount, &merge->gapmax, &span);
+      }
+
+      if (extent->end > coverend)
+      {
+        coverend = extent->end;
+        coverrate = extent->samplerate;
+      }
+    }
+  }
+
+  for (idx = 0; idx < merge->runcount; idx++)
+    free (merge->runs[idx].spans);
+  merge->runcount = 0;
+
+  availability->extents = merge->extents;
+  availability->extentcount = merge->extentcount;
+  availability->gaps = merge->gaps;
+  availability->gapcount = merge->gapcount;
+
+  return rv;
+} /* End of MergeChannel() */
+
+/***************************************************************************
+ * AddSpan():
+ *
+ * Add a span, in time order, to the open extent with a tolerable sample
+ * rate if contiguous or overlapping, otherwise the open extent is
+ * completed and replaced by the span.  A span without an open extent
+ * of a tolerable rate is added as a new open extent.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+AddSpan (SpanMerge *merge, const TSIndexSpan *span)
+{
+  TSIndexSpan *extent;
+  nstime_t nsdelta;
+  int64_t idx;
+
+  for (idx = 0; idx < merge->opencount; idx++)
+  {
+    extent = &merge->open[idx];
+
+    if (!RateTolerable (merge, extent->samplerate, span->samplerate))
+      continue;
+
+    nsdelta = SamplePeriod (extent->samplerate);
+
+    if (span->start - extent->end - nsdelta <= TimeTolerance (merge, nsdelta))
+    {
+      if (span->end > extent->end)
+        extent->end = span->end;
+      return 0;
+    }
+
+    if (AppendSpan (&merge->extents, &merge->extentcount, &merge->extentmax, extent))
+      return -1;
+
+    *extent = *span;
+    return 0;
+  }
+
+  return AppendSpan (&merge->open, &merge->opencount, &merge->openmax, span);
+} /* End of AddSpan() */
+
+/***************************************************************************
+ * AppendSpan():
+ *
+ * Append a span to an array, growing the array as needed.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+AppendSpan (TSIndexSpan **spans, int64_t *count, int64_t *max, const TSIndexSpan *span)
+{
+  TSIndexSpan *newspans;
+
+  if (*count == *max)
+  {
+    *max = (*max) ? *max * 2 : 64;
+
+    if (!(newspans = realloc (*spans, *max * sizeof (TSIndexSpan))))
+    {
+      ms_log (2, "Cannot allocate memory for spans\n");
+      return -1;
+    }
+
+    *spans = newspans;
+  }
+
+  (*spans)[(*count)++] = *span;
+
+  return 0;
+} /* End of AppendSpan() */
+
+/***************************************************************************
+ * HeapUp():
+ *
+ * Move a run up the merge heap to restore heap order.
+ ***************************************************************************/
+static void
+HeapUp (SpanMerge *merge, int position)
+{
+  int parent;
+  int swap;
+
+  while (position > 0)
+  {
+    parent = (position - 1) / 2;
+
+    if (RunStart (merge, merge->heap[parent]) <= RunStart (merge, merge->heap[position]))
+      break;
+
+    swap = merge->heap[parent];
+    merge->heap[parent] = merge->heap[position];
+    merge->heap[position] = swap;
+    position = parent;
+  }
+} /* End of HeapUp() */
+
+/***************************************************************************
+ * HeapDown():
+ *
+ * Move a run down the merge heap to restore heap order.
+ ***************************************************************************/
+static void
+HeapDown (SpanMerge *merge, int position, int heapcount)
+{
+  int child;
+  int swap;
+
+  while ((child = position * 2 + 1) < heapcount)
+  {
+    if (child + 1 < heapcount &&
+        RunStart (merge, merge->heap[child + 1]) < RunStart (merge, merge->heap[child]))
+      child++;
+
+    if (RunStart (merge, merge->heap[position]) <= RunStart (merge, merge->heap[child]))
+      break;
+
+    swap = merge->heap[child];
+    merge->heap[child] = merge->heap[position];
+    merge->heap[position] = swap;
+    position = child;
+  }
+} /* End of HeapDown() */
+
+/***************************************************************************
+ * RunStart():
+ *
+ * Returns the start time of the next span of a run.
+ ***************************************************************************/
+static nstime_t
+RunStart (const SpanMerge *merge, int run)
+{
+  return merge->runs[run].spans[merge->runs[run].position].start;
+} /* End of RunStart() */
+
+/***************************************************************************
+ * SamplePeriod():
+ *
+ * Returns the sample period in nanoseconds for a sample rate in Hz, or
+ * 0 for a zero rate.
+ ***************************************************************************/
+static nstime_t
+SamplePeriod (double samplerate)
+{
+  return (samplerate > 0.0) ? (nstime_t)(NSTMODULUS / samplerate) : 0;
+} /* End of SamplePeriod() */
+
+/***************************************************************************
+ * TimeTolerance():
+ *
+ * Returns the time tolerance in nanoseconds, the default is 1/2 of the
+ * sample period.
+ ***************************************************************************/
+static nstime_t
+TimeTolerance (const SpanMerge *merge, nstime_t nsdelta)
+{
+  return (merge->timetol < 0.0) ? (nstime_t)(0.5 * nsdelta) : (nstime_t)(NSTMODULUS * merge->timetol);
+} /* End of TimeTolerance() */
+
+/***************************************************************************
+ * RateTolerable():
+ *
+ * Returns 1 if sample rates are within the rate tolerance, otherwise 0.
+ ***************************************************************************/
+static int
+RateTolerable (const SpanMerge *merge, double ratea, double rateb)
+{
+  if (ratea == rateb)
+    return 1;
+
+  if (merge->sampratetol >= 0.0)
+    return (ms_dabs (ratea - rateb) <= merge->sampratetol) ? 1 : 0;
+
+  return (rateb != 0.0 && MS_ISRATETOLERABLE (ratea, rateb)) ? 1 : 0;
+} /* End of RateTolerable() */
+
+/***************************************************************************
+ * SpansSorted():
+ *
+ * Returns 1 if spans are in start time order, otherwise 0.
+ ***************************************************************************/
+static int
+SpansSorted (const TSIndexSpan *spans, int count)
+{
+  int idx;
+
+  for (idx = 1; idx < count; idx++)
+    if (spans[idx].start < spans[idx - 1].start)
+      return 0;
+
+  return 1;
+} /* End of SpansSorted() */
+
+/***************************************************************************
+ * CompareSpanStart():
+ *
+ * Compare spans by start time, then end time, for qsort().
+ ***************************************************************************/
+static int
+CompareSpanStart (const void *a, const void *b)
+{
+  const TSIndexSpan *spana = (const TSIndexSpan *)a;
+  const TSIndexSpan *spanb = (const TSIndexSpan *)b;
+
+  if (spana->start != spanb->start)
+    return (spana->start < spanb->start) ? -1 : 1;
+
+  if (spana->end != spanb->end)
+    return (spana->end < spanb->end) ? -1 : 1;
+
+  return 0;
+} /* End of CompareSpanStart() */
+
+/***************************************************************************
+ * CompareRanges():
+ *
+ * Compare ranges by file name and offset for qsort().
+ ***************************************************************************/
+static int
+CompareRanges (const void *a, const void *b)
+{
+  const TSIndexRange *rangea = (const TSIndexRange *)a;
+  const TSIndexRange *rangeb = (const TSIndexRange *)b;
+  int cmp;
+
+  if (rangea->filename != rangeb->filename &&
+      (cmp = strcmp (rangea->filename, rangeb->filename)))
+    return cmp;
+
+  if (rangea->offset != rangeb->offset)
+    return (rangea->offset < rangeb->offset) ? -1 : 1;
+
+  return 0;
+} /* End of CompareRanges() */
+
+/***************************************************************************
+ * CompareRangeNames():
+ *
+ * Compare ranges by file name pointer for qsort(), grouping ranges
+ * sharing a file name.
+ ***************************************************************************/
+static int
+CompareRangeNames (const void *a, const void *b)
+{
+  const TSIndexRange *rangea = (const TSIndexRange *)a;
+  const TSIndexRange *rangeb = (const TSIndexRange *)b;
+
+  if (rangea->filename == rangeb->filename)
+    return 0;
+
+  return ((uintptr_t)rangea->filename < (uintptr_t)rangeb->filename) ? -1 : 1;
+} /* End of CompareRangeNames() */
+
+/***************************************************************************
+ * CopyPattern():
+ *
+ * Copy a request pattern, NULL patterns and empty patterns, unless
+ * allowed, are copied as '*'.
+ *
+ * Returns 0 on success and -1 if the pattern does not fit.
+ ***************************************************************************/
+static int
+CopyPattern (char *dest, size_t destsize, const char *pattern, int allowempty)
+{
+  if (!pattern || (!*pattern && !allowempty))
+    pattern = "*";
+
+  if (strlen (pattern) >= destsize)
+    return -1;
+
+  strcpy (dest, pattern);
+
+  return 0;
+} /* End of CopyPattern() */
+
+/***************************************************************************
+ * HasWildcards():
+ *
+ * Returns 1 if the pattern contains GLOB wildcards, otherwise 0.
+ ***************************************************************************/
+static int
+HasWildcards (const char *pattern)
+{
+  return (strpbrk (pattern, "*?[") != NULL) ? 1 : 0;
+} /* End of HasWildcards() */
+
+/***************************************************************************
+ * DupColumn():
+ *
+ * Returns an allocated copy of a text column or NULL if the column is
+ * NULL or on allocation error.
+ ***************************************************************************/
+static char *
+DupColumn (sqlite3_stmt *statement, int column)
+{
+  const char *text = (const char *)sqlite3_column_text (statement, column);
+
+  return (text) ? strdup (text) : NULL;
+} /* End of DupColumn() */
@@ -0,0 +1,146 @@
+/***************************************************************************
+ * tsindex.h - Interface for reading time series index rows.
+ *
+ * Routines to query a time series index table in an SQLite database,
+ * as created by mseedindex, and to use the time index of each row
+ * (section) to determine byte ranges for time windows.
+ *
+ * Written by Chad Trabant, EarthScope Data Services.
+ ***************************************************************************/
+
+#ifndef TSINDEX_H
+#define TSINDEX_H 1
+
+#include <stdint.h>
+
+#include <sqlite3.h>
+
+#include <libmseed.h>
+
+/* Entry of a time index, time of a record and its byte offset */
+typedef struct TSIndexEntry
+{
+  nstime_t time;
+  int64_t offset;
+} TSIndexEntry;
+
+/* A time span of continuous data and its sample rate */
+typedef struct TSIndexSpan
+{
+  nstime_t start;
+  nstime_t end;
+  double samplerate;
+} TSIndexSpan;
+
+/* A time series index row, a single section of data in a file */
+typedef struct TSIndexRow
+{
+  char network[11];
+  char station[11];
+  char location[11];
+  char channel[11];
+  int version;
+  nstime_t starttime;
+  nstime_t endtime;
+  double samplerate;
+  char *filename;
+  int64_t byteoffset;
+  int64_t bytes;
+  char hash[33];
+  TSIndexEntry *tindex; /* Decoded time index, NULL if not available */
+  int tindexcount;
+  int latest;           /* Time index identifies offsets to latest data */
+  char *timespans;      /* Time spans as stored, NULL if not available */
+  char *timerates;      /* Time rates as stored, NULL if not available */
+} TSIndexRow;
+
+/* A request selection, NSLC patterns may contain '*' and '?' wildcards */
+typedef struct TSIndexRequest
+{
+  char network[11];
+  char station[11];
+  char location[11];
+  char channel[11];
+  nstime_t starttime;  /* NSTUNSET for open start */
+  nstime_t endtime;    /* NSTUNSET for open end */
+  struct TSIndexRequest *next;
+} TSIndexRequest;
+
+/* Merged availability of a channel, extents and gaps in time order */
+typedef struct TSIndexAvailability
+{
+  char network[11];
+  char station[11];
+  char location[11];
+  char channel[11];
+  TSIndexSpan *extents;
+  int64_t extentcount;
+  TSIndexSpan *gaps;    /* Gap start is the end of coverage, gap end the next start */
+  int64_t gapcount;
+} TSIndexAvailability;
+
+typedef int (*TSIndexAvailabilityHandler) (const TSIndexAvailability *availability,
+                                           void *handlerdata);
+
+/* A byte range of a file and the time window of data wanted from it */
+typedef struct TSIndexRange
+{
+  char *filename;
+  int64_t offset;
+  int64_t length;
+  nstime_t starttime;  /* NSTUNSET for open start */
+  nstime_t endtime;    /* NSTUNSET for open end */
+} TSIndexRange;
+
+/* A read of a file covering one or more ranges */
+typedef struct TSIndexRead
+{
+  const char *filename;
+  int64_t offset;
+  int64_t length;
+  int64_t firstrange;  /* Index of first range of the read in plan ranges */
+  int64_t rangecount;
+} TSIndexRead;
+
+/* A read plan, ranges to read coalesced into reads in file and offset order */
+typedef struct TSIndexPlan
+{
+  TSIndexRange *ranges;
+  int64_t rangecount;
+  int64_t rangemax;
+  TSIndexRead *reads;
+  int64_t readcount;
+} TSIndexPlan;
+
+extern int tsindex_addrequest (TSIndexRequest **requests, const char *network,
+                               const char *station, const char *location,
+                               const char *channel, nstime_t starttime, nstime_t endtime);
+extern int tsindex_readrequestfile (TSIndexRequest **requests, const char *filename);
+extern void tsindex_freerequests (TSIndexRequest **requests);
+
+extern int64_t tsindex_query (sqlite3 *dbconn, const char *table,
+                              const TSIndexRequest *request, TSIndexRow **rows);
+extern int64_t tsindex_queryfile (sqlite3 *dbconn, const char *table,
+                                  const char *filename, TSIndexRow **rows);
+extern int64_t tsindex_availability (sqlite3 *dbconn, const char *table,
+                                     const TSIndexRequest *request,
+                                     double timetol, double sampratetol,
+                                     TSIndexAvailabilityHandler handler, void *handlerdata);
+extern void tsindex_freerows (TSIndexRow *rows, int64_t rowcount);
+
+extern int tsindex_parse_timeindex (const char *timeindex, TSIndexEntry **entries,
+                                    int *count, int *latest);
+extern int tsindex_parse_timespans (const char *timespans, const char *timerates,
+                                    double samplerate, TSIndexSpan **spans, int *count);
+extern int tsindex_byterange (const TSIndexRow *row, nstime_t starttime, nstime_t endtime,
+                              int64_t *offset, int64_t *length);
+extern int tsindex_globmatch (const char *string, const char *pattern);
+extern int tsindex_planrange (TSIndexPlan *plan, const char *filename, int64_t offset,
+                              int64_t length, nstime_t starttime, nstime_t endtime);
+extern int tsindex_planrow (TSIndexPlan *plan, const TSIndexRow *row,
+                            nstime_t starttime, nstime_t endtime);
+extern int64_t tsindex_planreads (TSIndexPlan *plan, int64_t gapthreshold);
+extern void tsindex_planfree (TSIndexPlan *plan);
+extern nstime_t tsindex_epoch2nstime (const char *string, char **endptr);
+
+#endif /* TSINDEX_H */